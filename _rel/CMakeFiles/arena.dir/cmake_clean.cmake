@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/arena.dir/benchmarks/arena.cpp.o"
+  "CMakeFiles/arena.dir/benchmarks/arena.cpp.o.d"
+  "arena"
+  "arena.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/arena.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/baseline.dir/benchmarks/baseline.cpp.o"
+  "CMakeFiles/baseline.dir/benchmarks/baseline.cpp.o.d"
+  "baseline"
+  "baseline.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/baseline.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/bbo.dir/benchmarks/bbo.cpp.o"
+  "CMakeFiles/bbo.dir/benchmarks/bbo.cpp.o.d"
+  "bbo"
+  "bbo.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/bbo.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
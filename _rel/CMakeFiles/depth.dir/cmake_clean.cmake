@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/depth.dir/benchmarks/depth.cpp.o"
+  "CMakeFiles/depth.dir/benchmarks/depth.cpp.o.d"
+  "depth"
+  "depth.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/depth.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/differential.dir/tests/differential.cpp.o"
+  "CMakeFiles/differential.dir/tests/differential.cpp.o.d"
+  "differential"
+  "differential.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/differential.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/journal.dir/benchmarks/journal.cpp.o"
+  "CMakeFiles/journal.dir/benchmarks/journal.cpp.o.d"
+  "journal"
+  "journal.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/journal.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
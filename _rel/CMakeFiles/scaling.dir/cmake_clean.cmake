@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/scaling.dir/benchmarks/scaling.cpp.o"
+  "CMakeFiles/scaling.dir/benchmarks/scaling.cpp.o.d"
+  "scaling"
+  "scaling.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/scaling.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
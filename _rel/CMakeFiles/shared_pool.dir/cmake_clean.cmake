@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/shared_pool.dir/benchmarks/shared_pool.cpp.o"
+  "CMakeFiles/shared_pool.dir/benchmarks/shared_pool.cpp.o.d"
+  "shared_pool"
+  "shared_pool.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/shared_pool.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/stp.dir/benchmarks/stp.cpp.o"
+  "CMakeFiles/stp.dir/benchmarks/stp.cpp.o.d"
+  "stp"
+  "stp.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/stp.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
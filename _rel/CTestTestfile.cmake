@@ -0,0 +1,12 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo
+# Build directory: /root/repo/_rel
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test([=[correctness]=] "/root/repo/_rel/tests")
+set_tests_properties([=[correctness]=] PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;28;add_test;/root/repo/CMakeLists.txt;0;")
+add_test([=[differential]=] "/root/repo/_rel/differential")
+set_tests_properties([=[differential]=] PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;33;add_test;/root/repo/CMakeLists.txt;0;")
+add_test([=[throughput]=] "/root/repo/_rel/regression" "--baseline" "/root/repo/benchmarks/throughput_baseline.txt")
+set_tests_properties([=[throughput]=] PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;91;add_test;/root/repo/CMakeLists.txt;0;")
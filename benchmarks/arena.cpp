@@ -0,0 +1,141 @@
+#include "book_traits.hpp"
+#include "timer.hpp"
+#include "workload.hpp"
+#include "harness.hpp"
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <vector>
+#include <unistd.h>
+
+using namespace ob;
+
+static constexpr size_t SYMBOLS = 4096;
+static constexpr size_t HOT_SYMBOLS = 8;
+static constexpr size_t HOT_OPS = 125'000;       // per hot symbol
+static constexpr size_t COLD_ORDERS = 16;        // per illiquid symbol
+
+using Sizes = Sized<100000, (1 << 18), ArenaTraits>;
+using ArenaBook = BookOf<Sizes>;
+// same layout with inline arrays - every book commits its levels and index up front
+struct InlineCompact : Sizes {
+    using storage = InlineStorage;
+};
+using InlineBook = BookOf<InlineCompact>;
+
+// resident set from /proc/self/statm
+static size_t rss_bytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    statm >> pages >> resident;
+    return resident * static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+}
+
+template<typename Book>
+bool run_op(Book& book, const Op& op) {
+    switch (op.type) {
+        case OpType::Add: return book.add(op.id, op.side, op.price, op.qty, op.ord_type) == AddResult::Ok;
+        case OpType::Cancel: return book.cancel(op.id);
+        case OpType::Match: (void)book.match(op.side, op.qty); return true;
+        case OpType::Modify: (void)book.modify(op.id, op.price, op.qty); return true;
+    }
+    return true;
+}
+
+// hot flows interleaved across the books, every op timed
+template<typename Book>
+void bench_hot(const char* name, std::vector<Book*>& books, const std::vector<std::vector<Op>>& flows,
+               uint64_t overhead, double freq_ghz) {
+    std::array<LatencyHistogram<>, OP_TYPES> cycles{};
+    uint64_t total_start = rdtsc_fenced();
+    for (size_t i = 0; i < HOT_OPS; ++i) {
+        for (size_t h = 0; h < HOT_SYMBOLS; ++h) {
+            const Op& op = flows[h][i];
+            uint64_t start = rdtsc_fenced();
+            (void)run_op(*books[h], op);
+            cycles[static_cast<size_t>(op.type)].record(net_cycles(start, overhead));
+        }
+    }
+    uint64_t ns = cycles_to_ns(rdtsc_end() - total_start, freq_ghz);
+    printf("  %-8s %6.2f Mops/s", name, static_cast<double>(HOT_OPS * HOT_SYMBOLS) / static_cast<double>(ns) * 1e3);
+    for (auto [t, label] : {std::pair{OpType::Add, "add"}, std::pair{OpType::Cancel, "cancel"},
+                            std::pair{OpType::Match, "match"}}) {
+        auto st = LatencyStats::of(cycles[static_cast<size_t>(t)], 1.0 / freq_ghz);
+        printf(" | %s p50=%-4lu p99=%-5lu p99.9=%-6lu", label, st.p50, st.p99, st.p999);
+    }
+    printf("\n");
+}
+
+// arena [--cpu N]
+int main(int argc, char** argv) {
+    HarnessOptions opt = parse_harness_args(argc, argv);
+    printf("=== Arena-backed books ===\n\n");
+    MachineInfo machine = setup_machine(opt);
+    print_machine(machine);
+    double freq_ghz = machine.tsc.ghz;
+    printf("%zu symbols (%zu hot x %zu ops, the rest %zu orders each); MaxPrice=%ld, MaxOrders=%zu\n",
+           SYMBOLS, HOT_SYMBOLS, HOT_OPS, COLD_ORDERS, ArenaBook::max_price(), ArenaBook::max_orders());
+
+    // one book's share of the arena, to size the reservation
+    size_t per_book = 0;
+    {
+        Arena probe(size_t{1} << 30);
+        auto book = make_in<ArenaBook>(probe);
+        per_book = probe.used();
+    }
+    Arena arena(per_book * SYMBOLS);
+
+    size_t rss0 = rss_bytes();
+    std::vector<ArenaPtr<ArenaBook>> books;
+    books.reserve(SYMBOLS);
+    for (size_t s = 0; s < SYMBOLS; ++s) books.push_back(make_in<ArenaBook>(arena));
+    size_t built = arena.resident();
+
+    // illiquid symbols: a handful of quotes each
+    for (size_t s = HOT_SYMBOLS; s < SYMBOLS; ++s) {
+        for (uint64_t i = 0; i < COLD_ORDERS; ++i) {
+            Side side = i % 2 ? Side::Sell : Side::Buy;
+            auto off = static_cast<int64_t>(i / 2 + 1);
+            (void)books[s]->add(OrderId{i + 1}, side, Price{side == Side::Buy ? 50000 - off : 50000 + off}, Qty{100});
+        }
+    }
+    size_t cold = arena.resident();
+
+    std::vector<std::vector<Op>> flows;
+    for (size_t h = 0; h < HOT_SYMBOLS; ++h) {
+        WorkloadGen gen(42 + h, 1000.0, 50000, 50.0, 0.35, 0.25, 0.05, 1.5, ArenaBook::max_price());
+        flows.push_back(gen.generate(HOT_OPS));
+    }
+
+    printf("\nHot flow (hot books grow on demand):\n");
+    std::vector<ArenaBook*> hot;
+    for (size_t h = 0; h < HOT_SYMBOLS; ++h) hot.push_back(books[h].get());
+    bench_hot("arena", hot, flows, machine.timer_overhead, freq_ghz);
+    size_t after = arena.resident();
+
+    size_t inline_rss0 = rss_bytes();
+    std::vector<std::unique_ptr<InlineBook>> inline_books;
+    std::vector<InlineBook*> inline_hot;
+    for (size_t h = 0; h < HOT_SYMBOLS; ++h) {
+        inline_books.push_back(std::make_unique<InlineBook>());
+        inline_hot.push_back(inline_books.back().get());
+    }
+    size_t inline_built = rss_bytes() - inline_rss0;
+    bench_hot("inline", inline_hot, flows, machine.timer_overhead, freq_ghz);
+
+    size_t hot_orders = 0;
+    for (size_t h = 0; h < HOT_SYMBOLS; ++h) hot_orders += books[h]->order_count();
+    auto kib = [](size_t b) { return static_cast<double>(b) / 1024.0; };
+    auto mib = [](size_t b) { return static_cast<double>(b) / (1024.0 * 1024.0); };
+    printf("\nFootprint:\n");
+    printf("  arena reserved      %9.1f MiB (%.1f MiB per book)\n", mib(arena.reserved()), mib(per_book));
+    printf("  arena resident      %9.1f MiB: %.1f built, %.1f with cold quotes, %.1f after hot flow\n",
+           mib(after), mib(built), mib(cold), mib(after));
+    printf("  per cold book       %9.1f KiB\n", kib((cold - built) / (SYMBOLS - HOT_SYMBOLS) + built / SYMBOLS));
+    printf("  per hot book        %9.1f KiB (%zu resting orders in all)\n",
+           kib((after - cold) / HOT_SYMBOLS + built / SYMBOLS), hot_orders);
+    printf("  inline book, built  %9.1f KiB\n", kib(inline_built / HOT_SYMBOLS));
+    printf("  process rss before  %9.1f MiB\n", mib(rss0));
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include "book_traits.hpp"
+#include "timer.hpp"
+#include "harness.hpp"
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace ob;
+
+static constexpr size_t OPEN_ORDERS = 200'000;
+static constexpr int64_t OPEN_MID = 50'000;
+
+using Sizes = Sized<100000, 1'000'000>;
+
+// counts fills without keeping them
+struct FillCount {
+    size_t fills = 0;
+    Qty volume{0};
+
+    void on_fill(const Fill& f) noexcept {
+        ++fills;
+        volume += f.qty;
+    }
+};
+
+using Book = BookOf<Listened<FillCount, Sizes>>;
+
+struct Entry {
+    Side side;
+    Price price;
+    Qty qty;
+};
+
+// pre-open interest: buys priced over the mid and sells under it, so most of it crosses
+[[nodiscard]] static std::vector<Entry> opening_flow(size_t n, uint64_t seed) {
+    std::mt19937_64 rng{seed};
+    std::normal_distribution<double> bid_px(static_cast<double>(OPEN_MID) + 8.0, 20.0);
+    std::normal_distribution<double> ask_px(static_cast<double>(OPEN_MID) - 8.0, 20.0);
+    std::uniform_int_distribution<int64_t> qty(1, 500);
+    std::vector<Entry> flow;
+    flow.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        bool buy = (rng() & 1) != 0;
+        auto px = static_cast<int64_t>(buy ? bid_px(rng) : ask_px(rng));
+        flow.push_back(Entry{buy ? Side::Buy : Side::Sell, Price{px}, Qty{qty(rng)}});
+    }
+    return flow;
+}
+
+// auction [--cpu N]
+int main(int argc, char** argv) {
+    HarnessOptions opt = parse_harness_args(argc, argv);
+    printf("=== Opening auction ===\n\n");
+    MachineInfo machine = setup_machine(opt);
+    print_machine(machine);
+    double freq_ghz = machine.tsc.ghz;
+    auto ms = [freq_ghz](uint64_t cycles) { return static_cast<double>(cycles_to_ns(cycles, freq_ghz)) / 1e6; };
+
+    auto flow = opening_flow(OPEN_ORDERS, 42);
+    printf("%zu pre-open orders, buys around %ld + 8 and sells around %ld - 8\n\n", flow.size(), OPEN_MID, OPEN_MID);
+
+    // today: replay the pre-open through continuous matching
+    {
+        auto book = std::make_unique<Book>();
+        uint64_t start = rdtsc_fenced();
+        for (size_t i = 0; i < flow.size(); ++i) {
+            (void)book->add(OrderId{i + 1}, flow[i].side, flow[i].price, flow[i].qty);
+        }
+        uint64_t total = rdtsc_end() - start;
+        const FillCount& c = book->listener();
+        printf("  continuous  %8.2f ms | %zu fills, volume %ld, at many prices\n", ms(total), c.fills,
+               c.volume.raw());
+    }
+
+    // call phase then one uncross
+    {
+        auto book = std::make_unique<Book>();
+        book->begin_auction();
+        uint64_t start = rdtsc_fenced();
+        for (size_t i = 0; i < flow.size(); ++i) {
+            (void)book->add(OrderId{i + 1}, flow[i].side, flow[i].price, flow[i].qty);
+        }
+        uint64_t collected = rdtsc_fenced();
+        AuctionResult ind = book->indicative();
+        uint64_t priced = rdtsc_fenced();
+        AuctionResult r = book->uncross();
+        uint64_t done = rdtsc_end();
+        const FillCount& c = book->listener();
+        printf("  auction     %8.2f ms | adds %.2f ms, clearing price %.3f ms, uncross %.2f ms\n",
+               ms(done - start), ms(collected - start), ms(priced - collected), ms(done - priced));
+        printf("              %zu fills, volume %ld at %ld (surplus %ld); indicative %ld x %ld\n",
+               c.fills, r.volume.raw(), r.price.raw(), r.surplus.raw(), ind.price.raw(), ind.volume.raw());
+        printf("              after: bid %ld ask %ld, %zu resting\n", book->bid().raw(), book->ask().raw(),
+               book->order_count());
+    }
+    return 0;
+}
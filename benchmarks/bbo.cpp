@@ -0,0 +1,115 @@
+#include "order_book.hpp"
+#include "timer.hpp"
+#include "workload.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace ob;
+
+static constexpr size_t OPS = 5'000'000;
+static constexpr size_t REPS = 3;
+static constexpr size_t STAMPS = 1 << 16;    // publication time ring, by version
+
+using PlainBook = OrderBook<100000, 1'000'000>;
+using PubBook = OrderBook<100000, 1'000'000, BboPublisher<>>;
+
+// writer-side cost: same ops with and without publishing, ns/op
+template<typename Book, typename... Args>
+double writer_ns(const std::vector<Op>& ops, double freq_ghz, Args&&... args) {
+    auto book = std::make_unique<Book>(std::forward<Args>(args)...);
+    uint64_t start = rdtsc_start();
+    for (const Op& op : ops) {
+        switch (op.type) {
+            case OpType::Add: (void)book->add(op.id, op.side, op.price, op.qty, op.ord_type); break;
+            case OpType::Cancel: (void)book->cancel(op.id); break;
+            case OpType::Match: (void)book->match(op.side, op.qty); break;
+            case OpType::Modify: (void)book->modify(op.id, op.price, op.qty); break;
+        }
+    }
+    return static_cast<double>(cycles_to_ns(rdtsc_end() - start, freq_ghz)) / static_cast<double>(ops.size());
+}
+
+int main() {
+    printf("=== Published BBO (seqlock) ===\n\n");
+    double freq_ghz = get_cpu_freq_ghz();
+    WorkloadGen gen(42);
+    auto ops = gen.generate(OPS);
+
+    // best of REPS, alternating so drift hits both
+    double plain = 1e9, published = 1e9;
+    uint64_t publications = 0;
+    for (size_t rep = 0; rep < REPS; ++rep) {
+        plain = std::min(plain, writer_ns<PlainBook>(ops, freq_ghz));
+        SeqlockBbo snap;
+        published = std::min(published, writer_ns<PubBook>(ops, freq_ghz, BboPublisher<>{snap}));
+        publications = snap.stores();
+    }
+    printf("Writer, no readers (%zu ops):\n", OPS);
+    printf("  plain book:     %6.1f ns/op\n", plain);
+    printf("  publishing:     %6.1f ns/op (+%.1f ns, %lu publications)\n",
+           published, published - plain, publications);
+
+    // one reader polling while the writer runs; the writer stamps each
+    // publication so the reader can age the copy it got
+    SeqlockBbo live;
+    auto stamps = std::make_unique<std::array<std::atomic<uint64_t>, STAMPS>>();
+    std::atomic<bool> done{false};
+    std::vector<uint64_t> ages;
+    std::vector<uint64_t> lags;
+    uint64_t reads = 0, retries = 0;
+    ages.reserve(OPS);
+    lags.reserve(OPS);
+
+    std::thread reader([&] {
+        while (!done.load(std::memory_order_acquire)) {
+            Bbo b;
+            if (!live.try_load(b)) {
+                ++retries;
+                continue;
+            }
+            uint64_t now = rdtsc();
+            ++reads;
+            if (b.version == 0) continue;
+            uint64_t at = (*stamps)[b.version % STAMPS].load(std::memory_order_acquire);
+            if ((reads & 63) == 0 && at != 0 && now > at) {
+                ages.push_back(cycles_to_ns(now - at, freq_ghz));
+                lags.push_back(live.stores() - b.version);
+            }
+        }
+    });
+
+    auto book = std::make_unique<PubBook>(BboPublisher<>{live});
+    uint64_t start = rdtsc_start();
+    uint64_t seen = 0;
+    for (const Op& op : ops) {
+        switch (op.type) {
+            case OpType::Add: (void)book->add(op.id, op.side, op.price, op.qty, op.ord_type); break;
+            case OpType::Cancel: (void)book->cancel(op.id); break;
+            case OpType::Match: (void)book->match(op.side, op.qty); break;
+            case OpType::Modify: (void)book->modify(op.id, op.price, op.qty); break;
+        }
+        uint64_t v = book->listener().published();
+        if (v != seen) {
+            (*stamps)[v % STAMPS].store(rdtsc(), std::memory_order_release);
+            seen = v;
+        }
+    }
+    double contended = static_cast<double>(cycles_to_ns(rdtsc_end() - start, freq_ghz)) / static_cast<double>(OPS);
+    done.store(true, std::memory_order_release);
+    reader.join();
+
+    auto age = LatencyStats::calc(ages);
+    auto lag = LatencyStats::calc(lags);
+    printf("\nWriter + 1 reader (hardware threads: %u):\n", std::thread::hardware_concurrency());
+    printf("  writer:         %6.1f ns/op (incl. publication stamps)\n", contended);
+    printf("  reader:         %lu reads, %.2f%% torn retries\n", reads,
+           reads + retries == 0 ? 0.0 : 100.0 * static_cast<double>(retries) / static_cast<double>(reads + retries));
+    printf("  staleness ns:   p50=%-6lu p99=%-6lu p99.9=%-6lu\n", age.p50, age.p99, age.p999);
+    printf("  versions behind: p50=%-5lu p99=%-5lu p99.9=%-5lu\n", lag.p50, lag.p99, lag.p999);
+    return 0;
+}
@@ -1,111 +1,440 @@
 #include "order_book.hpp"
+#include "depth_feed.hpp"
+#include "instrument.hpp"
 #include "timer.hpp"
 #include "workload.hpp"
+#include "perf_counters.hpp"
+#include "harness.hpp"
+#include <array>
 #include <cstdio>
+#include <utility>
 #include <vector>
 #include <algorithm>
 #include <memory>
+#include <span>
 
 using namespace ob;
 
 static constexpr size_t WARMUP_OPS = 10000;
 static constexpr size_t BENCH_OPS = 10'000'000;
+static constexpr size_t REP_OPS = 2'000'000;      // timed ops per repetition
 
-int main() {
-    printf("=== Order Book Benchmark ===\n\n");
+static constexpr size_t SPARSE_ITERS = 1'000'000;
+static constexpr int64_t SPARSE_MID = 50000;
+static constexpr int64_t SPARSE_GAP = 2000;  // empty ticks between levels
 
-    // Get CPU frequency
-    double freq_ghz = get_cpu_freq_ghz();
-    printf("CPU frequency: %.2f GHz\n", freq_ghz);
+static constexpr size_t OPEN_OPS = 1'000'000;
 
-    // Create order book on heap (large due to array size)
-    using Book = OrderBook<100000, 1'000'000>;
+// measured once in main, taken off every per-op sample
+static uint64_t timer_overhead = 0;
+
+template<typename Book>
+void run_op(Book& book, const Op& op) {
+    switch (op.type) {
+        case OpType::Add:
+            (void)book.add(op.id, op.side, op.price, op.qty, op.ord_type);
+            break;
+        case OpType::Cancel:
+            (void)book.cancel(op.id);
+            break;
+        case OpType::Match:
+            (void)book.match(op.side, op.qty);
+            break;
+        case OpType::Modify:
+            (void)book.modify(op.id, op.price, op.qty);
+            break;
+    }
+}
+
+// fresh book per storage policy: construction cost, then page faults and
+// dTLB misses taken by the first OPEN_OPS ops after open
+template<typename Book>
+void bench_storage(const char* name, const std::vector<Op>& ops, double freq_ghz) {
+    uint64_t faults = page_faults();
+    uint64_t start = rdtsc_start();
     auto book = std::make_unique<Book>();
+    double ctor_ms = static_cast<double>(cycles_to_ns(rdtsc_end() - start, freq_ghz)) / 1e6;
+    uint64_t ctor_faults = page_faults() - faults;
 
-    // Generate workload
-    printf("Generating %zu operations...\n", WARMUP_OPS + BENCH_OPS);
-    WorkloadGen gen(42);
-    auto warmup_ops = gen.generate(WARMUP_OPS);
-    auto bench_ops = gen.generate(BENCH_OPS);
+    auto dtlb = dtlb_miss_counter();
+    size_t n = std::min(OPEN_OPS, ops.size());
+    faults = page_faults();
+    dtlb.start();
+    start = rdtsc_start();
+    for (size_t i = 0; i < n; ++i) run_op(*book, ops[i]);
+    double run_ms = static_cast<double>(cycles_to_ns(rdtsc_end() - start, freq_ghz)) / 1e6;
+    uint64_t dtlb_misses = dtlb.stop();
+    uint64_t run_faults = page_faults() - faults;
+
+    char dtlb_buf[32] = "n/a";
+    if (dtlb.valid()) snprintf(dtlb_buf, sizeof(dtlb_buf), "%lu", dtlb_misses);
+
+    printf("  %-24s ctor=%7.1fms faults=%-7lu | run=%7.1fms faults=%-7lu dTLB-miss=%s\n",
+           name, ctor_ms, ctor_faults, run_ms, run_faults, dtlb_buf);
+}
+
+// same flow through each ladder: top-of-book add/cancel latency and ladder footprint
+template<typename Book>
+void bench_ladder(const char* name, const std::vector<Op>& ops, double freq_ghz) {
+    auto book = std::make_unique<Book>();
+    LatencyHistogram<> add_cycles;
+    LatencyHistogram<> cancel_cycles;
+    size_t n = std::min(OPEN_OPS, ops.size());
+
+    for (size_t i = 0; i < n; ++i) {
+        const Op& op = ops[i];
+        uint64_t start = rdtsc_fenced();
+        run_op(*book, op);
+        uint64_t cycles = net_cycles(start, timer_overhead);
+        if (op.type == OpType::Add) add_cycles.record(cycles);
+        else if (op.type == OpType::Cancel) cancel_cycles.record(cycles);
+    }
+
+    auto add_stats = LatencyStats::of(add_cycles, 1.0 / freq_ghz);
+    auto cancel_stats = LatencyStats::of(cancel_cycles, 1.0 / freq_ghz);
+    double pool_mb = static_cast<double>(Book::max_orders() * sizeof(typename Book::order_type)) / (1024.0 * 1024.0);
+    printf("  %-14s ladder=%8.1f KB pool=%5.1f MB | Add p50=%-4lu p99=%-4lu | Cancel p50=%-4lu p99=%-4lu\n",
+           name, static_cast<double>(sizeof(book->ladder())) / 1024.0, pool_mb,
+           add_stats.p50, add_stats.p99, cancel_stats.p50, cancel_stats.p99);
+}
+
+static constexpr size_t BATCH_REPS = 3;
+
+// per-op dispatch vs OrderBook::apply over Batch-sized chunks, same ops
+// Batch = 1 is the per-op loop; best of BATCH_REPS fresh books
+template<typename Book, size_t Batch>
+double batch_mops(const std::vector<Op>& ops, double freq_ghz) {
+    double best = 0.0;
+    for (size_t rep = 0; rep < BATCH_REPS; ++rep) {
+        auto book = std::make_unique<Book>();
+        uint64_t start = rdtsc_start();
+        if constexpr (Batch == 1) {
+            for (const Op& op : ops) run_op(*book, op);
+        } else {
+            std::span<const Op> all(ops);
+            for (size_t i = 0; i < all.size(); i += Batch) {
+                book->apply(all.subspan(i, std::min(Batch, all.size() - i)));
+            }
+        }
+        uint64_t ns = cycles_to_ns(rdtsc_end() - start, freq_ghz);
+        best = std::max(best, static_cast<double>(ops.size()) / static_cast<double>(ns) * 1e3);
+    }
+    return best;
+}
+
+template<typename Book>
+void bench_batch(const char* name, const std::vector<Op>& ops, double freq_ghz) {
+    double per_op = batch_mops<Book, 1>(ops, freq_ghz);
+    double b64 = batch_mops<Book, 64>(ops, freq_ghz);
+    double b256 = batch_mops<Book, 256>(ops, freq_ghz);
+    printf("  %-22s per-op=%6.2f | batch 64=%6.2f (%.2fx) | batch 256=%6.2f (%.2fx) M ops/sec\n",
+           name, per_op, b64, b64 / per_op, b256, b256 / per_op);
+}
+
+static constexpr size_t DEPTH_BATCH = 256;
+
+// batched apply with and without an L2 delta feed drained after every batch
+// best of BATCH_REPS; reports level changes vs coalesced updates per batch
+template<typename Book>
+void bench_depth(const std::vector<Op>& ops, double freq_ghz) {
+    using Feed = DepthPublisher<Book::max_price()>;
+    using FeedBook = OrderBook<Book::max_price(), Book::max_orders(), Feed>;
+    std::vector<LevelUpdate> buf(DEPTH_BATCH * 4);
+    std::span<const Op> all(ops);
 
-    // Storage for latencies
-    std::vector<uint64_t> add_latencies;
-    std::vector<uint64_t> cancel_latencies;
-    std::vector<uint64_t> match_latencies;
-
-    add_latencies.reserve(BENCH_OPS);
-    cancel_latencies.reserve(BENCH_OPS);
-    match_latencies.reserve(BENCH_OPS);
-
-    // Warmup
-    printf("Warming up cache (%zu ops)...\n", WARMUP_OPS);
-    for (const auto& op : warmup_ops) {
-        switch (op.type) {
-            case OpType::Add:
-                (void)book->add(op.id, op.side, op.price, op.qty, op.ord_type);
-                break;
-            case OpType::Cancel:
-                (void)book->cancel(op.id);
-                break;
-            case OpType::Match:
-                (void)book->match(op.side, op.qty);
-                break;
+    double plain = batch_mops<Book, DEPTH_BATCH>(ops, freq_ghz);
+    double best = 0.0;
+    size_t changes = 0;
+    size_t updates = 0;
+    size_t batches = 0;
+    for (size_t rep = 0; rep < BATCH_REPS; ++rep) {
+        auto book = std::make_unique<FeedBook>(Feed{buf});
+        changes = updates = batches = 0;
+        uint64_t start = rdtsc_start();
+        for (size_t i = 0; i < all.size(); i += DEPTH_BATCH) {
+            book->apply(all.subspan(i, std::min(DEPTH_BATCH, all.size() - i)));
+            Feed& feed = book->listener();
+            changes += feed.changes();
+            updates += feed.size();
+            ++batches;
+            feed.clear();
         }
+        uint64_t ns = cycles_to_ns(rdtsc_end() - start, freq_ghz);
+        best = std::max(best, static_cast<double>(ops.size()) / static_cast<double>(ns) * 1e3);
     }
+    printf("  no feed=%6.2f | L2 deltas=%6.2f (%.2fx) M ops/sec | per batch: %.1f changes -> %.1f updates\n",
+           plain, best, best / plain,
+           static_cast<double>(changes) / static_cast<double>(batches),
+           static_cast<double>(updates) / static_cast<double>(batches));
+}
 
-    // Reset book for benchmark (recreate)
-    book = std::make_unique<Book>();
-    gen.reset(42);
-    (void)gen.generate(WARMUP_OPS);  // Skip warmup IDs
+static constexpr double MODIFY_RATE = 0.30;
 
-    // Benchmark
-    printf("Running benchmark (%zu ops)...\n\n", BENCH_OPS);
+// amend-heavy flow: in-place modify vs the cancel + re-add a venue without
+// amends forces on clients; latency of the amend ops, throughput of the run
+template<typename Book>
+void bench_modify(const char* name, const std::vector<Op>& ops, double freq_ghz, bool replace) {
+    auto book = std::make_unique<Book>();
+    LatencyHistogram<> amend_cycles;
 
     uint64_t total_start = rdtsc_start();
+    for (const Op& op : ops) {
+        if (op.type != OpType::Modify) {
+            run_op(*book, op);
+            continue;
+        }
+        uint64_t start = rdtsc_fenced();
+        if (replace) {
+            if (book->cancel(op.id)) (void)book->add(op.id, op.side, op.price, op.qty);
+        } else {
+            (void)book->modify(op.id, op.price, op.qty);
+        }
+        amend_cycles.record(net_cycles(start, timer_overhead));
+    }
+    uint64_t total_ns = cycles_to_ns(rdtsc_end() - total_start, freq_ghz);
 
-    for (const auto& op : bench_ops) {
-        uint64_t start = rdtsc();
+    auto stats = LatencyStats::of(amend_cycles, 1.0 / freq_ghz);
+    printf("  %-16s amend p50=%-4lu p90=%-4lu p99=%-4lu p99.9=%-5lu | %6.2f M ops/sec\n",
+           name, stats.p50, stats.p90, stats.p99, stats.p999,
+           static_cast<double>(ops.size()) / static_cast<double>(total_ns) * 1e3);
+}
 
-        switch (op.type) {
-            case OpType::Add: {
-                (void)book->add(op.id, op.side, op.price, op.qty, op.ord_type);
-                uint64_t cycles = rdtsc() - start;
-                add_latencies.push_back(cycles_to_ns(cycles, freq_ghz));
-                break;
+// the same flow timed from inside the book by an OpLatency listener -
+// the numbers a live engine reports - against the plain book's throughput
+template<typename Book>
+void bench_instrumented(const std::vector<Op>& ops, double freq_ghz) {
+    using TimedBook = OrderBook<Book::max_price(), Book::max_orders(), OpLatency<>>;
+    double plain = batch_mops<Book, 1>(ops, freq_ghz);
+    double timed = 0.0;
+    LatencyHistogram<> all;
+    std::array<LatencyStats, OP_TYPES> stats{};
+    for (size_t rep = 0; rep < BATCH_REPS; ++rep) {
+        auto book = std::make_unique<TimedBook>();
+        uint64_t start = rdtsc_start();
+        for (const Op& op : ops) run_op(*book, op);
+        uint64_t ns = cycles_to_ns(rdtsc_end() - start, freq_ghz);
+        timed = std::max(timed, static_cast<double>(ops.size()) / static_cast<double>(ns) * 1e3);
+        if (rep + 1 == BATCH_REPS) {
+            for (size_t t = 0; t < OP_TYPES; ++t) {
+                stats[t] = LatencyStats::of(book->listener().histogram(static_cast<OpType>(t)), 1.0 / freq_ghz);
             }
-            case OpType::Cancel: {
-                (void)book->cancel(op.id);
-                uint64_t cycles = rdtsc() - start;
-                cancel_latencies.push_back(cycles_to_ns(cycles, freq_ghz));
-                break;
+            all = book->listener().all();
+        }
+    }
+    auto total = LatencyStats::of(all, 1.0 / freq_ghz);
+    for (auto [t, name] : {std::pair{OpType::Add, "Add"}, std::pair{OpType::Cancel, "Cancel"},
+                           std::pair{OpType::Match, "Match"}}) {
+        const LatencyStats& st = stats[static_cast<size_t>(t)];
+        printf("  %-7s p50=%-4lu p99=%-4lu p99.9=%-5lu p99.99=%-5lu\n", name, st.p50, st.p99, st.p999, st.p9999);
+    }
+    printf("  all     p50=%-4lu p99=%-4lu p99.9=%-5lu p99.99=%-5lu | %6.2f vs %6.2f M ops/sec untimed (%.2fx)\n",
+           total.p50, total.p99, total.p999, total.p9999, timed, plain, timed / plain);
+}
+
+static constexpr size_t SCAN_REPS = 20;
+static constexpr int64_t SCAN_STRIDE = 8;    // one populated level every 8 ticks
+
+// full-ladder depth scan via level_at: aggregate qty and populated-level count
+template<typename Book>
+void bench_level_scan(const char* name, double freq_ghz) {
+    auto book = std::make_unique<Book>();
+    uint64_t id = 1;
+    for (int64_t px = 0; px <= Book::max_price(); px += SCAN_STRIDE) {
+        Side side = px < Book::max_price() / 2 ? Side::Buy : Side::Sell;
+        (void)book->add(OrderId{id++}, side, Price{px}, Qty{10});
+    }
+
+    int64_t total = 0;
+    size_t populated = 0;
+    uint64_t start = rdtsc_start();
+    for (size_t r = 0; r < SCAN_REPS; ++r) {
+        for (int64_t px = 0; px <= Book::max_price(); ++px) {
+            const auto& level = book->level_at(Price{px});
+            total += level.qty().raw();
+            populated += level.empty() ? 0 : 1;
+        }
+    }
+    uint64_t ns = cycles_to_ns(rdtsc_end() - start, freq_ghz);
+    double levels = static_cast<double>(SCAN_REPS) * static_cast<double>(Book::max_price() + 1);
+
+    printf("  %-14s ladder=%8.1f KB (%3zu B/tick) | scan %.2f ns/level (%.0f M levels/s) [%ld/%zu]\n",
+           name, static_cast<double>(sizeof(book->ladder())) / 1024.0,
+           sizeof(book->ladder()) / static_cast<size_t>(Book::max_price() + 1),
+           static_cast<double>(ns) / levels, levels / (static_cast<double>(ns) / 1e3),
+           total / static_cast<int64_t>(SCAN_REPS), populated / SCAN_REPS);
+}
+
+// sweep-then-reprice on a thin book: every market order empties the best ask
+// and every cancel removes the best bid, so each op pays for best-price recovery
+// across SPARSE_GAP empty ticks before the level is re-quoted
+template<typename Book>
+void bench_sparse_sweep(double freq_ghz) {
+    auto book = std::make_unique<Book>();
+
+    // resting backstop levels far from touch
+    uint64_t id = 1;
+    (void)book->add(OrderId{id++}, Side::Sell, Price{SPARSE_MID + 2 * SPARSE_GAP}, Qty{100});
+    (void)book->add(OrderId{id++}, Side::Buy, Price{SPARSE_MID - 2 * SPARSE_GAP}, Qty{100});
+
+    LatencyHistogram<> sweep_cycles;
+    LatencyHistogram<> cancel_cycles;
+
+    for (size_t i = 0; i < SPARSE_ITERS; ++i) {
+        // re-quote touch on both sides
+        (void)book->add(OrderId{id++}, Side::Sell, Price{SPARSE_MID + SPARSE_GAP}, Qty{10});
+        OrderId bid_id{id++};
+        (void)book->add(bid_id, Side::Buy, Price{SPARSE_MID - SPARSE_GAP}, Qty{10});
+
+        uint64_t start = rdtsc_fenced();
+        (void)book->match(Side::Buy, Qty{10});
+        sweep_cycles.record(net_cycles(start, timer_overhead));
+
+        start = rdtsc_fenced();
+        (void)book->cancel(bid_id);
+        cancel_cycles.record(net_cycles(start, timer_overhead));
+    }
+
+    auto sweep_stats = LatencyStats::of(sweep_cycles, 1.0 / freq_ghz);
+    auto cancel_stats = LatencyStats::of(cancel_cycles, 1.0 / freq_ghz);
+
+    printf("\nSparse book sweep-then-reprice (gap=%ld ticks, %zu iters):\n",
+           SPARSE_GAP, SPARSE_ITERS);
+    printf("  Sweep:         p50=%-4lu p90=%-4lu p99=%-4lu p99.9=%-4lu p99.99=%-4lu\n",
+           sweep_stats.p50, sweep_stats.p90, sweep_stats.p99, sweep_stats.p999, sweep_stats.p9999);
+    printf("  Cancel@best:   p50=%-4lu p90=%-4lu p99=%-4lu p99.9=%-4lu p99.99=%-4lu\n",
+           cancel_stats.p50, cancel_stats.p90, cancel_stats.p99, cancel_stats.p999, cancel_stats.p9999);
+}
+
+// one measured repetition: warm the book with warmup ops, then time every
+// bench op on that same book; per-type cycles, net of the timer overhead
+template<typename Book>
+double measured_run(Book& book, const std::vector<Op>& warmup_ops, const std::vector<Op>& bench_ops,
+                    std::array<LatencyHistogram<>, OP_TYPES>& cycles, uint64_t overhead, double freq_ghz) {
+    for (const Op& op : warmup_ops) run_op(book, op);
+
+    uint64_t total_start = rdtsc_fenced();
+    for (const Op& op : bench_ops) {
+        uint64_t start = rdtsc_fenced();
+        run_op(book, op);
+        cycles[static_cast<size_t>(op.type)].record(net_cycles(start, overhead));
+    }
+    uint64_t total_ns = cycles_to_ns(rdtsc_end() - total_start, freq_ghz);
+    return static_cast<double>(bench_ops.size()) / static_cast<double>(total_ns) * 1e3;
+}
+
+// per-op counter value, or n/a when the event did not open
+static void print_event(const PerfGroup& pmu, PmuEvent e, uint64_t total, uint64_t ops) {
+    if (!pmu.valid(e)) printf(" %9s", "n/a");
+    else printf(" %9.2f", static_cast<double>(total) / static_cast<double>(std::max<uint64_t>(ops, 1)));
+}
+
+// where each op type spends its time: the book's phase marks attribute tsc
+// cycles and the pmu group's counts to lookup / level / recovery / match,
+// per op, on a book warmed like the measured repetitions
+template<typename Book>
+void bench_profile(const std::vector<Op>& warmup_ops, const std::vector<Op>& ops, double freq_ghz) {
+    using ProfiledBook = OrderBook<Book::max_price(), Book::max_orders(), PhaseProfiler>;
+    PerfGroup pmu;
+    auto book = std::make_unique<ProfiledBook>(PhaseProfiler{&pmu});
+    for (const Op& op : warmup_ops) run_op(*book, op);
+    book->listener().clear();
+    for (const Op& op : ops) run_op(*book, op);
+
+    const PhaseProfiler& prof = book->listener();
+    const char* source = !pmu.any() ? "unavailable, tsc only" : pmu.user_rdpmc() ? "rdpmc" : "read(2)";
+    printf("\nCounter profile (%zu ops, per op; pmu: %s; %lu tsc cycles per mark removed):\n",
+           ops.size(), source, prof.mark_cost().tsc);
+    printf("  %-7s %-9s %6s %7s %9s %9s %5s %9s %9s %9s %9s\n", "op", "phase", "share", "ns",
+           "cycles", "instr", "IPC", "L1D-miss", "LLC-miss", "dTLB-miss", "br-miss");
+    static constexpr const char* PHASE_NAMES[PHASES] = {"lookup", "level", "recovery", "match"};
+    for (auto [t, name] : {std::pair{OpType::Add, "add"}, std::pair{OpType::Cancel, "cancel"},
+                           std::pair{OpType::Match, "match"}}) {
+        uint64_t n = prof.ops(t);
+        PhaseTotals total{};
+        for (size_t p = 0; p < PHASES; ++p) {
+            const PhaseTotals& x = prof.totals(t, static_cast<Phase>(p));
+            total.tsc += x.tsc;
+            for (size_t i = 0; i < PMU_EVENTS; ++i) total.pmu[i] += x.pmu[i];
+        }
+        for (size_t p = 0; p <= PHASES; ++p) {
+            const PhaseTotals& x = p < PHASES ? prof.totals(t, static_cast<Phase>(p)) : total;
+            if (p < PHASES && x.tsc == 0) continue;
+            auto per_op = [&](uint64_t v) { return static_cast<double>(v) / static_cast<double>(std::max<uint64_t>(n, 1)); };
+            auto ev = [&](PmuEvent e) { return x.pmu[static_cast<size_t>(e)]; };
+            printf("  %-7s %-9s %5.1f%% %7.1f", p == 0 ? name : "", p < PHASES ? PHASE_NAMES[p] : "total",
+                   100.0 * static_cast<double>(x.tsc) / static_cast<double>(std::max<uint64_t>(total.tsc, 1)),
+                   per_op(x.tsc) / freq_ghz);
+            print_event(pmu, PmuEvent::Cycles, ev(PmuEvent::Cycles), n);
+            print_event(pmu, PmuEvent::Instructions, ev(PmuEvent::Instructions), n);
+            if (pmu.valid(PmuEvent::Cycles) && pmu.valid(PmuEvent::Instructions) && ev(PmuEvent::Cycles) > 0) {
+                printf(" %5.2f", static_cast<double>(ev(PmuEvent::Instructions)) / static_cast<double>(ev(PmuEvent::Cycles)));
+            } else {
+                printf(" %5s", "n/a");
             }
-            case OpType::Match: {
-                (void)book->match(op.side, op.qty);
-                uint64_t cycles = rdtsc() - start;
-                match_latencies.push_back(cycles_to_ns(cycles, freq_ghz));
-                break;
+            for (PmuEvent e : {PmuEvent::L1dMiss, PmuEvent::LlcMiss, PmuEvent::DtlbMiss, PmuEvent::BranchMiss}) {
+                print_event(pmu, e, ev(e), n);
             }
+            printf("\n");
         }
     }
+}
+
+// benchmark [--reps N] [--cpu N] [--json path] [--profile]
+int main(int argc, char** argv) {
+    HarnessOptions opt = parse_harness_args(argc, argv);
+    printf("=== Order Book Benchmark ===\n\n");
+
+    MachineInfo machine = setup_machine(opt);
+    print_machine(machine);
+    double freq_ghz = machine.tsc.ghz;
+    uint64_t overhead = machine.timer_overhead;
+    timer_overhead = overhead;
+
+    using Book = OrderBook<100000, 1'000'000>;
 
-    uint64_t total_cycles = rdtsc_end() - total_start;
-    uint64_t total_ns = cycles_to_ns(total_cycles, freq_ghz);
+    // Generate workload
+    printf("\nGenerating %zu operations...\n", WARMUP_OPS + BENCH_OPS);
+    WorkloadGen gen(42);
+    auto warmup_ops = gen.generate(WARMUP_OPS);
+    auto bench_ops = gen.generate(BENCH_OPS);
+    std::vector<Op> rep_ops(bench_ops.begin(), bench_ops.begin() + static_cast<std::ptrdiff_t>(REP_OPS));
 
-    // Calculate stats
-    auto add_stats = LatencyStats::calc(add_latencies);
-    auto cancel_stats = LatencyStats::calc(cancel_latencies);
-    auto match_stats = LatencyStats::calc(match_latencies);
+    // fresh book per repetition, warmed with the ops it is then measured on
+    printf("Running %zu repetitions of %zu warmup + %zu timed ops...\n\n", opt.reps, WARMUP_OPS, REP_OPS);
+    BenchReport report("benchmark");
+    std::array<LatencyHistogram<>, OP_TYPES> merged{};
+    std::unique_ptr<Book> book;
+    for (size_t rep = 0; rep < opt.reps; ++rep) {
+        book = std::make_unique<Book>();
+        std::array<LatencyHistogram<>, OP_TYPES> cycles{};
+        double mops = measured_run(*book, warmup_ops, rep_ops, cycles, overhead, freq_ghz);
+        report.add("throughput", "Mops/s", mops);
+        for (auto [t, name] : {std::pair{OpType::Add, "add"}, std::pair{OpType::Cancel, "cancel"},
+                               std::pair{OpType::Match, "match"}}) {
+            const auto& h = cycles[static_cast<size_t>(t)];
+            auto st = LatencyStats::of(h, 1.0 / freq_ghz);
+            report.add(std::string(name) + "_p50", "ns", static_cast<double>(st.p50));
+            report.add(std::string(name) + "_p99", "ns", static_cast<double>(st.p99));
+            report.add(std::string(name) + "_p999", "ns", static_cast<double>(st.p999));
+            merged[static_cast<size_t>(t)].merge(h);
+        }
+    }
+
+    const auto& add_cycles = merged[static_cast<size_t>(OpType::Add)];
+    const auto& cancel_cycles = merged[static_cast<size_t>(OpType::Cancel)];
+    const auto& match_cycles = merged[static_cast<size_t>(OpType::Match)];
+    auto add_stats = LatencyStats::of(add_cycles, 1.0 / freq_ghz);
+    auto cancel_stats = LatencyStats::of(cancel_cycles, 1.0 / freq_ghz);
+    auto match_stats = LatencyStats::of(match_cycles, 1.0 / freq_ghz);
+    double total_ops = static_cast<double>(opt.reps * REP_OPS);
 
     // Print results
-    printf("Workload: %zu operations\n", BENCH_OPS);
-    printf("  Add:    %zu ops (%.1f%%)\n", add_latencies.size(),
-           100.0 * static_cast<double>(add_latencies.size()) / BENCH_OPS);
-    printf("  Cancel: %zu ops (%.1f%%)\n", cancel_latencies.size(),
-           100.0 * static_cast<double>(cancel_latencies.size()) / BENCH_OPS);
-    printf("  Match:  %zu ops (%.1f%%)\n", match_latencies.size(),
-           100.0 * static_cast<double>(match_latencies.size()) / BENCH_OPS);
-
-    printf("\nLatency (nanoseconds):\n");
+    printf("Workload: %zu operations per repetition\n", REP_OPS);
+    printf("  Add:    %.1f%%\n", 100.0 * static_cast<double>(add_cycles.count()) / total_ops);
+    printf("  Cancel: %.1f%%\n", 100.0 * static_cast<double>(cancel_cycles.count()) / total_ops);
+    printf("  Match:  %.1f%%\n", 100.0 * static_cast<double>(match_cycles.count()) / total_ops);
+
+    printf("\nLatency (nanoseconds, all repetitions, timer overhead removed):\n");
     printf("  Add:    p50=%-4lu p90=%-4lu p99=%-4lu p99.9=%-4lu p99.99=%-4lu\n",
            add_stats.p50, add_stats.p90, add_stats.p99, add_stats.p999, add_stats.p9999);
     printf("  Cancel: p50=%-4lu p90=%-4lu p99=%-4lu p99.9=%-4lu p99.99=%-4lu\n",
@@ -113,11 +442,14 @@ int main() {
     printf("  Match:  p50=%-4lu p90=%-4lu p99=%-4lu p99.9=%-4lu p99.99=%-4lu\n",
            match_stats.p50, match_stats.p90, match_stats.p99, match_stats.p999, match_stats.p9999);
 
-    double throughput = static_cast<double>(BENCH_OPS) / (static_cast<double>(total_ns) / 1e9);
-    double avg_ns = static_cast<double>(total_ns) / static_cast<double>(BENCH_OPS);
+    if (opt.profile) bench_profile<Book>(warmup_ops, rep_ops, freq_ghz);
 
-    printf("\nThroughput: %.2f M ops/sec (%.1f ns/op avg)\n",
-           throughput / 1e6, avg_ns);
+    printf("\nPer repetition, mean +- 95%% CI:\n");
+    report.print();
+    if (!opt.json.empty()) {
+        if (report.write_json(opt.json, machine)) printf("  -> %s\n", opt.json.c_str());
+        else fprintf(stderr, "cannot write %s\n", opt.json.c_str());
+    }
 
     printf("\nBook state after benchmark:\n");
     printf("  Orders: %zu\n", book->order_count());
@@ -128,5 +460,53 @@ int main() {
         printf("  Spread: %ld ticks\n", book->spread().raw());
     }
 
+    printf("\nStorage policy (first %zu ops after open):\n", OPEN_OPS);
+    using MappedBook = OrderBook<100000, 1'000'000, NullListener, DirectIndex,
+                                 MappedStorage<>>;
+    using LazyMappedBook = OrderBook<100000, 1'000'000, NullListener, DirectIndex,
+                                     MappedStorage<MapOptions{.huge_pages = false, .populate = false}>>;
+    bench_storage<Book>("inline (make_unique)", bench_ops, freq_ghz);
+    bench_storage<LazyMappedBook>("mmap 4k, lazy", bench_ops, freq_ghz);
+    bench_storage<MappedBook>("mmap huge, prefaulted", bench_ops, freq_ghz);
+
+    printf("\nPrice ladder (first %zu ops):\n", OPEN_OPS);
+    using WindowBook = OrderBook<100000, 1'000'000, NullListener, DirectIndex,
+                                 InlineStorage, WindowLadder>;
+    using CompactBook = OrderBook<100000, 1'000'000, NullListener, DirectIndex,
+                                  InlineStorage, CompactLadder>;
+    using SlotBook = OrderBook<100000, 1'000'000, NullListener, DirectIndex,
+                               InlineStorage, SlotLadder>;
+    bench_ladder<Book>("dense", bench_ops, freq_ghz);
+    bench_ladder<CompactBook>("compact", bench_ops, freq_ghz);
+    bench_ladder<SlotBook>("compact 32B", bench_ops, freq_ghz);
+    bench_ladder<WindowBook>("window 4096", bench_ops, freq_ghz);
+
+    printf("\nLevel array scan (%zu full passes):\n", SCAN_REPS);
+    bench_level_scan<Book>("dense", freq_ghz);
+    bench_level_scan<CompactBook>("compact", freq_ghz);
+
+    bench_sparse_sweep<Book>(freq_ghz);
+
+    printf("\nBatch apply throughput (%zu ops):\n", bench_ops.size());
+    bench_batch<Book>("sequential ids", bench_ops, freq_ghz);
+    using SwissBook = OrderBook<100000, 1'000'000, NullListener, SwissIndex>;
+    WorkloadGen random_gen(42);
+    random_gen.set_id_mode(IdMode::Random);
+    auto random_ops = random_gen.generate(BENCH_OPS);
+    bench_batch<SwissBook>("random ids, swiss", random_ops, freq_ghz);
+
+    printf("\nL2 delta feed (batches of %zu, %zu ops):\n", DEPTH_BATCH, bench_ops.size());
+    bench_depth<Book>(bench_ops, freq_ghz);
+
+    printf("\nAmend flow (%.0f%% modifies, %zu ops):\n", MODIFY_RATE * 100.0, OPEN_OPS);
+    WorkloadGen modify_gen(42);
+    modify_gen.set_modify_rate(MODIFY_RATE);
+    auto modify_ops = modify_gen.generate(OPEN_OPS);
+    bench_modify<Book>("modify", modify_ops, freq_ghz, false);
+    bench_modify<Book>("cancel + add", modify_ops, freq_ghz, true);
+
+    printf("\nIn-book instrumentation (OpLatency listener, %zu ops):\n", bench_ops.size());
+    bench_instrumented<Book>(bench_ops, freq_ghz);
+
     return 0;
 }
@@ -1,84 +1,13 @@
 #include "order_book.hpp"
 #include "timer.hpp"
 #include "workload.hpp"
+#include "naive_book.hpp"
 #include <cstdio>
 #include <vector>
-#include <map>
-#include <list>
-#include <unordered_map>
 #include <memory>
 
 using namespace ob;
 
-// Naive baseline
-class NaiveBook {
-    struct NaiveOrder { OrderId id; Price price; Qty qty; Side side; };
-    std::map<int64_t, std::list<NaiveOrder>> bids_, asks_;
-    std::unordered_map<uint64_t, std::pair<int64_t, std::list<NaiveOrder>::iterator>> order_map_;
-public:
-    bool add(OrderId id, Side side, Price px, Qty qty) {
-        if (order_map_.count(id.raw())) return false;
-        NaiveOrder o{id, px, qty, side};
-        if (side == Side::Buy) {
-            auto& level = bids_[px.raw()];
-            level.push_back(o);
-            order_map_[id.raw()] = {px.raw(), std::prev(level.end())};
-        } else {
-            auto& level = asks_[px.raw()];
-            level.push_back(o);
-            order_map_[id.raw()] = {px.raw(), std::prev(level.end())};
-        }
-        return true;
-    }
-    bool cancel(OrderId id) {
-        auto it = order_map_.find(id.raw());
-        if (it == order_map_.end()) return false;
-        int64_t px = it->second.first;
-        auto list_it = it->second.second;
-        Side side = list_it->side;
-        if (side == Side::Buy) {
-            auto& level = bids_[px];
-            level.erase(list_it);
-            if (level.empty()) bids_.erase(px);
-        } else {
-            auto& level = asks_[px];
-            level.erase(list_it);
-            if (level.empty()) asks_.erase(px);
-        }
-        order_map_.erase(it);
-        return true;
-    }
-    Qty match(Side aggressor, Qty qty) {
-        if (aggressor == Side::Buy) {
-            while (qty.raw() > 0 && !asks_.empty()) {
-                auto it = asks_.begin();
-                auto& level = it->second;
-                while (qty.raw() > 0 && !level.empty()) {
-                    auto& front = level.front();
-                    Qty fill = std::min(qty, front.qty);
-                    front.qty -= fill; qty -= fill;
-                    if (front.qty.raw() <= 0) { order_map_.erase(front.id.raw()); level.pop_front(); }
-                }
-                if (level.empty()) asks_.erase(it);
-            }
-        } else {
-            while (qty.raw() > 0 && !bids_.empty()) {
-                auto it = bids_.rbegin();
-                int64_t px = it->first;
-                auto& level = bids_[px];
-                while (qty.raw() > 0 && !level.empty()) {
-                    auto& front = level.front();
-                    Qty fill = std::min(qty, front.qty);
-                    front.qty -= fill; qty -= fill;
-                    if (front.qty.raw() <= 0) { order_map_.erase(front.id.raw()); level.pop_front(); }
-                }
-                if (level.empty()) bids_.erase(px);
-            }
-        }
-        return qty;
-    }
-};
-
 static constexpr size_t OPS = 1'000'000;
 
 template<typename Book>
@@ -103,6 +32,9 @@ void bench(const char* name, std::vector<Op>& ops, double freq) {
                 (void)book->match(op.side, op.qty);
                 match_lat.push_back(rdtsc() - t0);
                 break;
+            case OpType::Modify:  // not in the default mix
+                (void)book->modify(op.id, op.price, op.qty);
+                break;
         }
     }
 
@@ -134,6 +66,11 @@ int main() {
     WorkloadGen gen(42, 1000.0, 50000, 50.0, 0.35, 0.25, 0.05);
     auto ops = gen.generate(OPS);
 
+    // Same flow with hashed 64-bit ids
+    WorkloadGen rgen(42, 1000.0, 50000, 50.0, 0.35, 0.25, 0.05);
+    rgen.set_id_mode(IdMode::Random);
+    auto random_ops = rgen.generate(OPS);
+
     printf("\nWorkload mix:");
     size_t a=0, c=0, m=0;
     for (auto& op : ops) {
@@ -151,6 +88,20 @@ int main() {
     // Benchmark baseline
     bench<NaiveBook>("Baseline (std::map)", ops, freq);
 
+    // Id index policies, sequential vs random ids
+    using RobinHoodBook = OrderBook<100000, 500000, NullListener, RobinHoodIndex>;
+    using SwissBook = OrderBook<100000, 500000, NullListener, SwissIndex>;
+
+    printf("\n--- Id index, sequential ids ---\n");
+    bench<RobinHoodBook>("RobinHoodIndex", ops, freq);
+    bench<SwissBook>("SwissIndex", ops, freq);
+
+    printf("\n--- Id index, random ids ---\n");
+    bench<OptBook>("DirectIndex", random_ops, freq);
+    bench<RobinHoodBook>("RobinHoodIndex", random_ops, freq);
+    bench<SwissBook>("SwissIndex", random_ops, freq);
+    bench<NaiveBook>("Baseline (std::map)", random_ops, freq);
+
     printf("\n");
     return 0;
 }
@@ -0,0 +1,138 @@
+#include "order_book.hpp"
+#include "timer.hpp"
+#include "workload.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <span>
+#include <vector>
+
+using namespace ob;
+
+static constexpr size_t DEPTH = 10;
+static constexpr size_t CALLS = 2'000'000;
+static constexpr size_t FLOW_OPS = 2'000'000;
+static constexpr size_t REPS = 3;
+static constexpr int64_t MID = 50000;
+static constexpr size_t LEVELS = 200;   // per side in the static book
+
+template<template<int64_t, typename> class Ladder>
+using LadderBook = OrderBook<100000, 1'000'000, NullListener, DirectIndex, InlineStorage, Ladder>;
+
+// top-n by probing every tick from the touch - what callers did before depth()
+template<typename Book>
+size_t walk_depth(const Book& book, Side side, size_t n, std::span<LevelView> out) {
+    size_t k = 0;
+    int64_t step = side == Side::Buy ? -1 : 1;
+    for (int64_t px = side == Side::Buy ? book.bid().raw() : book.ask().raw();
+         k < n && px >= 0 && px <= Book::max_price(); px += step) {
+        const auto& level = book.level_at(Price{px});
+        if (level.empty()) continue;
+        out[k++] = LevelView{Price{px}, level.qty(), static_cast<uint32_t>(level.count())};
+    }
+    return k;
+}
+
+// LEVELS levels a side, one every stride ticks, a few orders each
+template<typename Book>
+std::unique_ptr<Book> static_book(int64_t stride) {
+    auto book = std::make_unique<Book>();
+    uint64_t id = 1;
+    for (size_t i = 0; i < LEVELS; ++i) {
+        auto off = static_cast<int64_t>(i) * stride;
+        for (int64_t q = 1; q <= 3; ++q) {
+            (void)book->add(OrderId{id++}, Side::Buy, Price{MID - 1 - off}, Qty{q * 10});
+            (void)book->add(OrderId{id++}, Side::Sell, Price{MID + 1 + off}, Qty{q * 10});
+        }
+    }
+    return book;
+}
+
+// ns per top-n of both sides, best of REPS
+template<typename Book, bool Walk>
+double pair_ns(const Book& book, double freq_ghz) {
+    std::array<LevelView, DEPTH> bids{};
+    std::array<LevelView, DEPTH> asks{};
+    double best = 1e9;
+    int64_t sink = 0;
+    for (size_t rep = 0; rep < REPS; ++rep) {
+        uint64_t start = rdtsc_start();
+        for (size_t i = 0; i < CALLS; ++i) {
+            size_t nb = Walk ? walk_depth(book, Side::Buy, DEPTH, bids) : book.depth(Side::Buy, DEPTH, bids);
+            size_t na = Walk ? walk_depth(book, Side::Sell, DEPTH, asks) : book.depth(Side::Sell, DEPTH, asks);
+            sink += bids[nb - 1].qty.raw() + asks[na - 1].qty.raw();
+        }
+        uint64_t ns = cycles_to_ns(rdtsc_end() - start, freq_ghz);
+        best = std::min(best, static_cast<double>(ns) / static_cast<double>(CALLS));
+    }
+    if (sink == 42) printf(" ");
+    return best;
+}
+
+template<typename Book>
+void bench_static(const char* name, double freq_ghz) {
+    printf("  %-12s", name);
+    for (int64_t stride : {1, 8, 64}) {
+        auto book = static_book<Book>(stride);
+        double fast = pair_ns<Book, false>(*book, freq_ghz);
+        double walk = pair_ns<Book, true>(*book, freq_ghz);
+        printf(" | stride %-2ld depth=%6.1f walk=%7.1f", stride, fast, walk);
+    }
+    printf("  ns\n");
+}
+
+// default flow with top-n of both sides after every op
+template<typename Book>
+void bench_flow(const char* name, const std::vector<Op>& ops, double freq_ghz) {
+    std::array<LevelView, DEPTH> bids{};
+    std::array<LevelView, DEPTH> asks{};
+    double plain = 1e9;
+    double with_depth = 1e9;
+    size_t levels = 0;
+    for (size_t rep = 0; rep < REPS; ++rep) {
+        for (bool depth : {false, true}) {
+            auto book = std::make_unique<Book>();
+            levels = 0;
+            uint64_t start = rdtsc_start();
+            for (const Op& op : ops) {
+                switch (op.type) {
+                    case OpType::Add: (void)book->add(op.id, op.side, op.price, op.qty, op.ord_type); break;
+                    case OpType::Cancel: (void)book->cancel(op.id); break;
+                    case OpType::Match: (void)book->match(op.side, op.qty); break;
+                    case OpType::Modify: (void)book->modify(op.id, op.price, op.qty); break;
+                }
+                if (depth) {
+                    levels += book->depth(Side::Buy, DEPTH, bids);
+                    levels += book->depth(Side::Sell, DEPTH, asks);
+                }
+            }
+            double ns = static_cast<double>(cycles_to_ns(rdtsc_end() - start, freq_ghz)) /
+                        static_cast<double>(ops.size());
+            (depth ? with_depth : plain) = std::min(depth ? with_depth : plain, ns);
+        }
+    }
+    printf("  %-12s update=%6.1f | update + top-%zu x2=%6.1f (+%.1f ns, %.1f levels/side)\n",
+           name, plain, DEPTH, with_depth, with_depth - plain,
+           static_cast<double>(levels) / static_cast<double>(2 * ops.size()));
+}
+
+int main() {
+    printf("=== Top-%zu depth ===\n\n", DEPTH);
+    double freq_ghz = get_cpu_freq_ghz();
+    printf("CPU frequency: %.2f GHz\n\n", freq_ghz);
+
+    printf("Static book, %zu levels a side, ns per bid + ask top-%zu:\n", LEVELS, DEPTH);
+    bench_static<LadderBook<DenseLadder>>("dense", freq_ghz);
+    bench_static<LadderBook<CompactLadder>>("compact", freq_ghz);
+    bench_static<LadderBook<SlotLadder>>("compact 32B", freq_ghz);
+    bench_static<LadderBook<WindowLadder>>("window 4096", freq_ghz);
+
+    WorkloadGen gen(42);
+    auto ops = gen.generate(FLOW_OPS);
+    printf("\nLive flow (%zu ops), ns/op:\n", FLOW_OPS);
+    bench_flow<LadderBook<DenseLadder>>("dense", ops, freq_ghz);
+    bench_flow<LadderBook<CompactLadder>>("compact", ops, freq_ghz);
+    bench_flow<LadderBook<SlotLadder>>("compact 32B", ops, freq_ghz);
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include "book_traits.hpp"
+#include "gateway.hpp"
+#include "timer.hpp"
+#include "workload.hpp"
+#include "harness.hpp"
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+using namespace ob;
+
+static constexpr size_t GATEWAY_OPS = 1'000'000;
+
+using Sizes = Sized<100000, 1'000'000>;
+using Book = BookOf<Listened<GatewayTap, Sizes>>;
+
+// the publisher end: wire-to-fill latency of every fill, from the tsc stamp
+// the decoder puts on its batch to the moment the sink sees the fill
+struct LatencySink {
+    LatencyHistogram<> cycles{};
+    size_t fills = 0;
+    size_t levels = 0;
+
+    void on_fill(const Fill& f) noexcept {
+        cycles.record(rdtsc() - f.ts.raw());
+        ++fills;
+    }
+    void on_level(const LevelUpdate&) noexcept { ++levels; }
+};
+
+static void report(const char* name, const LatencySink& sink, size_t msgs, uint64_t cycles, double freq_ghz) {
+    uint64_t ns = cycles_to_ns(cycles, freq_ghz);
+    auto st = LatencyStats::of(sink.cycles, 1.0 / freq_ghz);
+    printf("  %-18s %6.2f Mmsg/s | wire-to-fill p50=%-6lu p99=%-7lu p99.9=%-8lu | %zu fills, %zu levels\n", name,
+           static_cast<double>(msgs) / static_cast<double>(ns) * 1e3, st.p50, st.p99, st.p999, sink.fills,
+           sink.levels);
+}
+
+// today's shape: one loop decodes, checks and applies a message, then publishes
+static void bench_loop(std::span<const std::byte> wire, const RiskLimits& limits, double freq_ghz) {
+    auto book = std::make_unique<Book>();
+    LatencySink sink;
+    GatewayTap& tap = book->listener();
+    size_t msgs = wire.size() / REPLAY_RECORD;
+    uint64_t start = rdtsc_fenced();
+    for (size_t i = 0; i < msgs; ++i) {
+        Timestamp now{rdtsc()};
+        Msg m = decode(wire.data() + i * REPLAY_RECORD);
+        if (check_risk(limits, m) != RiskCheck::Ok) continue;
+        dispatch(*book, m, now);
+        for (const Fill& f : tap.fills()) sink.on_fill(f);
+        for (const LevelUpdate& u : tap.levels()) sink.on_level(u);
+        tap.clear();
+    }
+    report("single loop", sink, msgs, rdtsc_end() - start, freq_ghz);
+}
+
+template<size_t Batch>
+static void bench_pipeline(const char* name, std::span<const std::byte> wire, const RiskLimits& limits,
+                           std::span<const int> cpus, bool threads, double freq_ghz) {
+    auto book = std::make_unique<Book>();
+    LatencySink sink;
+    auto gw = std::make_unique<Gateway<Book, LatencySink, 1024, Batch>>(*book, sink, limits);
+    uint64_t start = rdtsc_fenced();
+    if (threads) {
+        gw->run_threads(wire, cpus);
+    } else {
+        gw->run(wire);
+    }
+    report(name, sink, wire.size() / REPLAY_RECORD, rdtsc_end() - start, freq_ghz);
+}
+
+// gateway [--cpu N]
+int main(int argc, char** argv) {
+    HarnessOptions opt = parse_harness_args(argc, argv);
+    printf("=== Gateway pipeline ===\n\n");
+    MachineInfo machine = setup_machine(opt);
+    print_machine(machine);
+    double freq_ghz = machine.tsc.ghz;
+
+    WorkloadGen gen(42, 1000.0, 50000, 50.0, 0.30, 0.25, 0.05, 1.5, Sizes::max_price);
+    auto ops = gen.generate(GATEWAY_OPS);
+    std::vector<std::byte> wire(ops.size() * REPLAY_RECORD);
+    for (size_t i = 0; i < ops.size(); ++i) encode(wire.data() + i * REPLAY_RECORD, to_msg(ops[i]));
+    RiskLimits limits{Qty{5000}, Price{1}, Price{Sizes::max_price}, int64_t{1} << 40};
+    printf("%zu messages of %zu bytes, decode -> risk -> book -> publish; latencies in ns\n\n", ops.size(),
+           REPLAY_RECORD);
+
+    bench_loop(wire, limits, freq_ghz);
+    bench_pipeline<1>("coroutines, b=1", wire, limits, {}, false, freq_ghz);
+    bench_pipeline<16>("coroutines, b=16", wire, limits, {}, false, freq_ghz);
+    bench_pipeline<64>("coroutines, b=64", wire, limits, {}, false, freq_ghz);
+    bench_pipeline<256>("coroutines, b=256", wire, limits, {}, false, freq_ghz);
+
+    // a thread per stage on the next cpus along, wrapping on small machines
+    std::array<int, 4> cpus{};
+    unsigned online = machine.online == 0 ? 1 : machine.online;
+    int first = machine.cpu < 0 ? 0 : machine.cpu;
+    for (size_t i = 0; i < cpus.size(); ++i) cpus[i] = static_cast<int>((static_cast<unsigned>(first) + i) % online);
+    if (online < cpus.size()) printf("\n  only %u cpus online: the stage threads below share cores\n", online);
+    bench_pipeline<64>("threads, b=64", wire, limits, cpus, true, freq_ghz);
+    return 0;
+}
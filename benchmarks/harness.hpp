@@ -0,0 +1,256 @@
+#pragma once
+
+#include "timer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sched.h>
+#include <unistd.h>
+
+namespace ob {
+
+// benchmark harness: calibrated tsc, pinned thread, environment checks,
+// repetitions summarised with confidence intervals, json for ci
+//
+//   bench [--reps N] [--cpu N] [--json path] [--profile]
+
+struct HarnessOptions {
+    size_t reps = 5;
+    int cpu = -1;              // -1: first isolated cpu, else the current one
+    std::string json;          // empty: no json
+    bool profile = false;      // per-op, per-phase hardware counters
+};
+
+[[nodiscard]] inline HarnessOptions parse_harness_args(int argc, char** argv) {
+    HarnessOptions o;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--profile") == 0) {
+            o.profile = true;
+            continue;
+        }
+        if (i + 1 == argc) {
+            std::fprintf(stderr, "option %s needs a value\n", argv[i]);
+            break;
+        }
+        const char* v = argv[++i];
+        if (std::strcmp(argv[i - 1], "--reps") == 0) o.reps = std::max<size_t>(2, std::strtoul(v, nullptr, 10));
+        else if (std::strcmp(argv[i - 1], "--cpu") == 0) o.cpu = std::atoi(v);
+        else if (std::strcmp(argv[i - 1], "--json") == 0) o.json = v;
+        else std::fprintf(stderr, "unknown option %s\n", argv[i - 1]);
+    }
+    return o;
+}
+
+namespace detail {
+
+[[nodiscard]] inline std::string read_line(const std::string& path) {
+    std::ifstream f(path);
+    std::string line;
+    std::getline(f, line);
+    return line;
+}
+
+// "0-3,8,10-11" style cpu lists
+[[nodiscard]] inline bool cpu_in_list(const std::string& list, int cpu) {
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos) end = list.size();
+        std::string part = list.substr(pos, end - pos);
+        size_t dash = part.find('-');
+        int lo = std::atoi(part.c_str());
+        int hi = dash == std::string::npos ? lo : std::atoi(part.c_str() + dash + 1);
+        if (!part.empty() && cpu >= lo && cpu <= hi) return true;
+        pos = end + 1;
+    }
+    return false;
+}
+
+[[nodiscard]] inline int first_in_list(const std::string& list) {
+    return list.empty() ? -1 : std::atoi(list.c_str());
+}
+
+} // namespace detail
+
+// what the numbers were measured on, and what might have skewed them
+struct MachineInfo {
+    TscInfo tsc{};
+    uint64_t timer_overhead = 0;    // cycles, subtracted from per-op samples
+    int cpu = -1;
+    bool pinned = false;
+    bool isolated = false;          // listed in isolcpus
+    bool nohz_full = false;
+    std::string governor;           // empty: no cpufreq (vm, container)
+    bool smt_sibling = false;       // another hardware thread shares the core
+    unsigned online = 0;
+    std::vector<std::string> warnings;
+};
+
+// pin the calling thread, probe the tsc and the environment
+[[nodiscard]] inline MachineInfo setup_machine(const HarnessOptions& opt) {
+    MachineInfo m;
+    const std::string sys = "/sys/devices/system/cpu/";
+    std::string isolated = detail::read_line(sys + "isolated");
+    m.cpu = opt.cpu >= 0 ? opt.cpu : detail::first_in_list(isolated);
+    if (m.cpu < 0) m.cpu = ::sched_getcpu();
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(m.cpu, &set);
+    m.pinned = ::sched_setaffinity(0, sizeof(set), &set) == 0;
+    if (!m.pinned) m.warnings.push_back("could not pin to cpu " + std::to_string(m.cpu));
+
+    m.tsc = tsc_info();
+    m.timer_overhead = timer_overhead_cycles();
+    m.online = static_cast<unsigned>(::sysconf(_SC_NPROCESSORS_ONLN));
+    m.isolated = detail::cpu_in_list(isolated, m.cpu);
+    m.nohz_full = detail::cpu_in_list(detail::read_line(sys + "nohz_full"), m.cpu);
+
+    std::string cpu_dir = sys + "cpu" + std::to_string(m.cpu) + "/";
+    m.governor = detail::read_line(cpu_dir + "cpufreq/scaling_governor");
+    std::string siblings = detail::read_line(cpu_dir + "topology/thread_siblings_list");
+    m.smt_sibling = siblings.find_first_of(",-") != std::string::npos;
+
+    if (!m.tsc.invariant) m.warnings.push_back("tsc is not invariant: cycles are not time");
+    if (!m.isolated) m.warnings.push_back("cpu " + std::to_string(m.cpu) + " is not isolated (isolcpus)");
+    if (!m.governor.empty() && m.governor != "performance") {
+        m.warnings.push_back("cpufreq governor is " + m.governor + ", not performance");
+    }
+    if (detail::read_line(sys + "intel_pstate/no_turbo") == "0") m.warnings.push_back("turbo is on");
+    if (m.smt_sibling) m.warnings.push_back("smt sibling " + siblings + " shares the core");
+    if (m.online == 1) m.warnings.push_back("single online cpu: background threads share the measured core");
+    return m;
+}
+
+[[nodiscard]] inline const char* tsc_source_name(TscSource s) noexcept {
+    switch (s) {
+        case TscSource::Cpuid: return "cpuid 0x15";
+        case TscSource::Hypervisor: return "hypervisor";
+        case TscSource::Calibrated: return "calibrated";
+    }
+    return "?";
+}
+
+// timed region from a rdtsc_fenced() stamp, less the stamps' own cost
+[[nodiscard]] inline uint64_t net_cycles(uint64_t start, uint64_t overhead) noexcept {
+    uint64_t c = rdtsc_end() - start;
+    return c > overhead ? c - overhead : 0;
+}
+
+inline void print_machine(const MachineInfo& m) {
+    std::printf("TSC: %.4f GHz (%s%s), timer overhead %lu cycles, cpu %d%s\n",
+                m.tsc.ghz, tsc_source_name(m.tsc.source), m.tsc.invariant ? ", invariant" : "",
+                m.timer_overhead, m.cpu, m.pinned ? " (pinned)" : "");
+    for (const std::string& w : m.warnings) std::printf("  warning: %s\n", w.c_str());
+}
+
+// mean and 95% confidence interval of per-repetition values
+struct RepStats {
+    size_t n = 0;
+    double mean = 0;
+    double stddev = 0;
+    double ci95 = 0;       // half-width
+    double min = 0;
+    double max = 0;
+};
+
+// two-sided 95% student t for n - 1 degrees of freedom
+[[nodiscard]] inline double t95(size_t n) noexcept {
+    static constexpr double T[] = {0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+                                   2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093,
+                                   2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045};
+    return n < 2 ? 0.0 : n - 1 < std::size(T) ? T[n - 1] : 1.96;
+}
+
+[[nodiscard]] inline RepStats rep_stats(std::span<const double> v) {
+    RepStats s;
+    s.n = v.size();
+    if (v.empty()) return s;
+    for (double x : v) s.mean += x;
+    s.mean /= static_cast<double>(v.size());
+    for (double x : v) s.stddev += (x - s.mean) * (x - s.mean);
+    s.stddev = v.size() > 1 ? std::sqrt(s.stddev / static_cast<double>(v.size() - 1)) : 0.0;
+    s.ci95 = t95(v.size()) * s.stddev / std::sqrt(static_cast<double>(v.size()));
+    s.min = *std::min_element(v.begin(), v.end());
+    s.max = *std::max_element(v.begin(), v.end());
+    return s;
+}
+
+// named metrics, one value per repetition, printed and written as json
+class BenchReport {
+    struct Metric {
+        std::string name;
+        std::string unit;
+        std::vector<double> values;
+    };
+    std::string bench_;
+    std::vector<Metric> metrics_;
+
+public:
+    explicit BenchReport(std::string bench) : bench_(std::move(bench)) {}
+
+    void add(const std::string& name, const std::string& unit, double value) {
+        for (Metric& m : metrics_) {
+            if (m.name == name) {
+                m.values.push_back(value);
+                return;
+            }
+        }
+        metrics_.push_back(Metric{name, unit, {value}});
+    }
+
+    // summary of one metric; n == 0 if it was never added
+    [[nodiscard]] RepStats stats(const std::string& name) const {
+        for (const Metric& m : metrics_) {
+            if (m.name == name) return rep_stats(m.values);
+        }
+        return RepStats{};
+    }
+
+    void print() const {
+        for (const Metric& m : metrics_) {
+            RepStats s = rep_stats(m.values);
+            std::printf("  %-24s %10.2f +- %-8.2f %-6s (min %.2f, max %.2f, n=%zu)\n",
+                        m.name.c_str(), s.mean, s.ci95, m.unit.c_str(), s.min, s.max, s.n);
+        }
+    }
+
+    // {"bench":..., "machine":{...}, "metrics":[{"name", "unit", "mean", "ci95", ..., "values"}]}
+    // names are plain identifiers, nothing is escaped
+    [[nodiscard]] bool write_json(const std::string& path, const MachineInfo& m) const {
+        std::FILE* f = std::fopen(path.c_str(), "w");
+        if (f == nullptr) return false;
+        std::fprintf(f, "{\n  \"bench\": \"%s\",\n", bench_.c_str());
+        std::fprintf(f, "  \"machine\": {\"tsc_ghz\": %.6f, \"tsc_source\": \"%s\", \"invariant_tsc\": %s, "
+                        "\"timer_overhead_cycles\": %lu, \"cpu\": %d, \"pinned\": %s, \"isolated\": %s, "
+                        "\"nohz_full\": %s, \"governor\": \"%s\", \"smt_sibling\": %s, \"online_cpus\": %u, "
+                        "\"warnings\": [",
+                     m.tsc.ghz, tsc_source_name(m.tsc.source), m.tsc.invariant ? "true" : "false",
+                     m.timer_overhead, m.cpu, m.pinned ? "true" : "false", m.isolated ? "true" : "false",
+                     m.nohz_full ? "true" : "false", m.governor.c_str(), m.smt_sibling ? "true" : "false",
+                     m.online);
+        for (size_t i = 0; i < m.warnings.size(); ++i) std::fprintf(f, "%s\"%s\"", i ? ", " : "", m.warnings[i].c_str());
+        std::fprintf(f, "]},\n  \"metrics\": [\n");
+        for (size_t i = 0; i < metrics_.size(); ++i) {
+            const Metric& x = metrics_[i];
+            RepStats s = rep_stats(x.values);
+            std::fprintf(f, "    {\"name\": \"%s\", \"unit\": \"%s\", \"n\": %zu, \"mean\": %.4f, \"stddev\": %.4f, "
+                            "\"ci95\": %.4f, \"min\": %.4f, \"max\": %.4f, \"values\": [",
+                         x.name.c_str(), x.unit.c_str(), s.n, s.mean, s.stddev, s.ci95, s.min, s.max);
+            for (size_t k = 0; k < x.values.size(); ++k) std::fprintf(f, "%s%.4f", k ? ", " : "", x.values[k]);
+            std::fprintf(f, "]}%s\n", i + 1 < metrics_.size() ? "," : "");
+        }
+        std::fprintf(f, "  ]\n}\n");
+        return std::fclose(f) == 0;
+    }
+};
+
+} // namespace ob
@@ -0,0 +1,106 @@
+#include "order_book.hpp"
+#include "journal.hpp"
+#include "timer.hpp"
+#include "workload.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+using namespace ob;
+
+static constexpr size_t OPS = 2'000'000;
+static constexpr size_t REPS = 3;
+
+using Book = OrderBook<100000, 1'000'000>;
+
+template<typename B>
+void run_op(B& book, const Op& op) {
+    switch (op.type) {
+        case OpType::Add: (void)book.add(op.id, op.side, op.price, op.qty, op.ord_type); break;
+        case OpType::Cancel: (void)book.cancel(op.id); break;
+        case OpType::Match: (void)book.match(op.side, op.qty); break;
+        case OpType::Modify: (void)book.modify(op.id, op.price, op.qty); break;
+    }
+}
+
+// ns per op on the matching thread, every op timed
+template<typename B>
+LatencyStats op_latency(B& book, const std::vector<Op>& ops, double freq_ghz) {
+    LatencyHistogram<> cycles;
+    for (const Op& op : ops) {
+        uint64_t start = rdtsc();
+        run_op(book, op);
+        cycles.record(rdtsc() - start);
+    }
+    return LatencyStats::of(cycles, 1.0 / freq_ghz);
+}
+
+// whole-stream ns/op, best of REPS
+template<typename Make>
+double stream_ns(const std::vector<Op>& ops, double freq_ghz, Make make) {
+    double best = 1e9;
+    for (size_t rep = 0; rep < REPS; ++rep) {
+        auto book = std::make_unique<Book>();
+        auto front = make(*book);
+        uint64_t start = rdtsc_start();
+        for (const Op& op : ops) run_op(*front, op);
+        double ns = static_cast<double>(cycles_to_ns(rdtsc_end() - start, freq_ghz)) /
+                    static_cast<double>(ops.size());
+        best = std::min(best, ns);
+    }
+    return best;
+}
+
+void print_row(const char* name, const LatencyStats& s) {
+    printf("  %-22s p50=%-4lu p99=%-5lu p99.9=%-6lu p99.99=%-7lu avg=%6.1f ns\n",
+           name, s.p50, s.p99, s.p999, s.p9999, s.avg);
+}
+
+// journal [dir]
+int main(int argc, char** argv) {
+    printf("=== Write-ahead journal ===\n\n");
+    double freq_ghz = get_cpu_freq_ghz();
+    std::string dir = argc > 1 ? argv[1] : "/tmp";
+    std::string path = dir + "/ob_journal_bench.bin";
+    printf("CPU frequency: %.2f GHz, hardware threads: %u, journal: %s\n\n",
+           freq_ghz, std::thread::hardware_concurrency(), path.c_str());
+
+    WorkloadGen gen(42);
+    auto ops = gen.generate(OPS);
+
+    printf("Matching-thread latency (%zu ops, ns/op):\n", OPS);
+    {
+        auto book = std::make_unique<Book>();
+        print_row("plain book", op_latency(*book, ops, freq_ghz));
+    }
+    for (auto interval : {std::chrono::microseconds{200}, std::chrono::microseconds{2000}}) {
+        auto book = std::make_unique<Book>();
+        JournaledBook<Book> jb(*book, path, interval);
+        auto stats = op_latency(jb, ops, freq_ghz);
+        auto& j = jb.journal();
+        if (!j.flush()) printf("  journal write failed: errno %d\n", j.error());
+        char name[32];
+        snprintf(name, sizeof(name), "journaled, %ld us", static_cast<long>(interval.count()));
+        print_row(name, stats);
+        printf("  %-22s %lu records, %lu commits (%.0f records each), %lu ring stalls\n", "",
+               j.appended(), j.commits(),
+               static_cast<double>(j.appended()) / static_cast<double>(std::max<uint64_t>(j.commits(), 1)),
+               j.stalls());
+    }
+
+    double plain = stream_ns(ops, freq_ghz, [](Book& b) { return &b; });
+    double journaled = stream_ns(ops, freq_ghz, [&](Book& b) {
+        return std::make_unique<JournaledBook<Book>>(b, path);
+    });
+    printf("\nThroughput, best of %zu:\n", REPS);
+    printf("  plain book:     %6.1f ns/op\n", plain);
+    printf("  journaled:      %6.1f ns/op (+%.1f ns)\n", journaled, journaled - plain);
+
+    ::unlink(path.c_str());
+    return 0;
+}
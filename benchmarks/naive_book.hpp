@@ -0,0 +1,259 @@
+#pragma once
+
+#include "types.hpp"
+#include "fill_listener.hpp"
+#include "price_ladder.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <map>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ob {
+
+// Naive baseline: std::map of std::list levels, unordered_map id index
+// crossing limits trade first like OrderBook; ioc/market/fok don't rest;
+// icebergs refill at the back of their level; stops wait in their own maps
+// until a trade prints through them
+// also the reference model for differential tests: with record_fills it
+// keeps every fill OrderBook would report, and depth() reads the levels
+// back. no auctions, stp or pool limits - those are OrderBook's alone
+class NaiveBook {
+    struct NaiveOrder { OrderId id; Price price; Qty qty; Side side; Qty peak{0}; Qty reserve{0}; };
+    // shown is the level's displayed qty, kept as orders come and go so
+    // depth() doesn't walk the fifo
+    struct Level : std::list<NaiveOrder> { int64_t shown = 0; };
+    std::map<int64_t, Level> bids_, asks_;
+    std::map<int64_t, Level> buy_stops_, sell_stops_;
+    std::unordered_map<uint64_t, std::pair<int64_t, Level::iterator>> order_map_, stop_map_;
+    int64_t last_ = -1;                 // last trade price, none yet
+    int64_t lo_ = INT64_MAX, hi_ = -1;  // traded since the last stop check
+    OrderId aggressor_{0};              // id on the fills being printed
+    bool record_ = false;
+    std::vector<Fill> fills_;
+
+    // fill qty against one level's fifo, erasing filled orders
+    void fill_level(Level& level, Qty& qty) {
+        while (qty.raw() > 0 && !level.empty()) {
+            auto& front = level.front();
+            Qty fill = std::min(qty, front.qty);
+            front.qty -= fill; qty -= fill;
+            level.shown -= fill.raw();
+            if (record_) fills_.push_back(Fill{front.id, aggressor_, fill, front.price, Timestamp{0}});
+            if (front.qty.raw() > 0) continue;
+            if (front.reserve.raw() > 0) {
+                front.qty = std::min(front.peak, front.reserve);
+                front.reserve -= front.qty;
+                level.shown += front.qty.raw();
+                level.splice(level.end(), level, level.begin());
+                continue;
+            }
+            order_map_.erase(front.id.raw());
+            level.pop_front();
+        }
+    }
+
+    // trade against the other side up to limit, best price first
+    Qty match_to(Side aggressor, Qty qty, int64_t limit) {
+        auto traded = [this](int64_t px) { last_ = px; lo_ = std::min(lo_, px); hi_ = std::max(hi_, px); };
+        if (aggressor == Side::Buy) {
+            while (qty.raw() > 0 && !asks_.empty() && asks_.begin()->first <= limit) {
+                auto it = asks_.begin();
+                traded(it->first);
+                fill_level(it->second, qty);
+                if (it->second.empty()) asks_.erase(it);
+            }
+        } else {
+            while (qty.raw() > 0 && !bids_.empty() && bids_.rbegin()->first >= limit) {
+                auto it = std::prev(bids_.end());
+                traded(it->first);
+                fill_level(it->second, qty);
+                if (it->second.empty()) bids_.erase(it);
+            }
+        }
+        return qty;
+    }
+
+    // open qty a limit order at px could trade against, reserves included
+    int64_t available(Side side, int64_t limit) const {
+        int64_t sum = 0;
+        auto add_level = [&sum](const Level& level) {
+            for (const NaiveOrder& o : level) sum += o.qty.raw() + o.reserve.raw();
+        };
+        if (side == Side::Buy) {
+            for (auto it = asks_.begin(); it != asks_.end() && it->first <= limit; ++it) add_level(it->second);
+        } else {
+            for (auto it = bids_.rbegin(); it != bids_.rend() && it->first >= limit; ++it) add_level(it->second);
+        }
+        return sum;
+    }
+
+    Qty market(Side side, Qty qty) { return match_to(side, qty, side == Side::Buy ? INT64_MAX : INT64_MIN); }
+
+    // run triggered stops - lowest buy trigger, then highest sell trigger - until none are left
+    void fire_stops() {
+        for (;;) {
+            Level* level = nullptr;
+            std::map<int64_t, Level>* stops = nullptr;
+            int64_t px = 0;
+            if (!buy_stops_.empty() && buy_stops_.begin()->first <= hi_) {
+                stops = &buy_stops_;
+                px = buy_stops_.begin()->first;
+            } else if (!sell_stops_.empty() && sell_stops_.rbegin()->first >= lo_) {
+                stops = &sell_stops_;
+                px = sell_stops_.rbegin()->first;
+            } else {
+                break;
+            }
+            level = &(*stops)[px];
+            NaiveOrder o = level->front();
+            level->pop_front();
+            if (level->empty()) stops->erase(px);
+            stop_map_.erase(o.id.raw());
+            aggressor_ = o.id;
+            (void)market(o.side, o.qty);
+        }
+        lo_ = INT64_MAX;
+        hi_ = -1;
+    }
+
+    bool add_order(OrderId id, Side side, Price px, Qty qty, OrdType type, Qty peak) {
+        if (order_map_.count(id.raw()) || stop_map_.count(id.raw())) return false;
+        aggressor_ = id;
+        if (type == OrdType::Iceberg && peak.raw() <= 0) return false;
+        if (type == OrdType::Stop) {
+            bool through = side == Side::Buy ? last_ >= px.raw() : last_ >= 0 && last_ <= px.raw();
+            if (through) {
+                (void)market(side, qty);
+                return true;
+            }
+            auto& level = side == Side::Buy ? buy_stops_[px.raw()] : sell_stops_[px.raw()];
+            level.push_back(NaiveOrder{id, px, qty, side});
+            stop_map_[id.raw()] = {px.raw(), std::prev(level.end())};
+            return true;
+        }
+        if (type == OrdType::FOK && available(side, px.raw()) < qty.raw()) return false;
+        bool crosses = side == Side::Buy ? !asks_.empty() && px.raw() >= asks_.begin()->first
+                                         : !bids_.empty() && px.raw() <= bids_.rbegin()->first;
+        if (crosses) qty = match_to(side, qty, px.raw());
+        if (type == OrdType::IOC || type == OrdType::Market || type == OrdType::FOK || qty.raw() <= 0) return true;
+        NaiveOrder o{id, px, qty, side};
+        if (type == OrdType::Iceberg) {
+            o.peak = peak;
+            o.qty = std::min(peak, qty);
+            o.reserve = qty - o.qty;
+        }
+        auto& level = side == Side::Buy ? bids_[px.raw()] : asks_[px.raw()];
+        level.push_back(o);
+        level.shown += o.qty.raw();
+        order_map_[id.raw()] = {px.raw(), std::prev(level.end())};
+        return true;
+    }
+
+    bool cancel_order(OrderId id) {
+        if (auto it = stop_map_.find(id.raw()); it != stop_map_.end()) {
+            auto list_it = it->second.second;
+            auto& stops = list_it->side == Side::Buy ? buy_stops_ : sell_stops_;
+            auto& level = stops[it->second.first];
+            level.erase(list_it);
+            if (level.empty()) stops.erase(it->second.first);
+            stop_map_.erase(it);
+            return true;
+        }
+        auto it = order_map_.find(id.raw());
+        if (it == order_map_.end()) return false;
+        int64_t px = it->second.first;
+        auto list_it = it->second.second;
+        auto& book = list_it->side == Side::Buy ? bids_ : asks_;
+        auto& level = book[px];
+        level.shown -= list_it->qty.raw();
+        level.erase(list_it);
+        if (level.empty()) book.erase(px);
+        order_map_.erase(it);
+        return true;
+    }
+
+    // populated levels of one side, best first
+    template<typename It>
+    static size_t levels(It it, It end, size_t n, std::span<LevelView> out) {
+        size_t k = 0;
+        for (; it != end && k < std::min(n, out.size()); ++it, ++k) {
+            out[k] = LevelView{Price{it->first}, Qty{it->second.shown}, static_cast<uint32_t>(it->second.size())};
+        }
+        return k;
+    }
+
+public:
+    NaiveBook() = default;
+    explicit NaiveBook(bool record_fills) : record_(record_fills) {}
+
+    bool add(OrderId id, Side side, Price px, Qty qty, OrdType type = OrdType::Limit) {
+        bool ok = add_order(id, side, px, qty, type, Qty{0});
+        fire_stops();
+        return ok;
+    }
+    bool add_iceberg(OrderId id, Side side, Price px, Qty qty, Qty peak) {
+        bool ok = add_order(id, side, px, qty, OrdType::Iceberg, peak);
+        fire_stops();
+        return ok;
+    }
+    bool cancel(OrderId id) { return cancel_order(id); }
+    // qty is the open qty; an iceberg cuts its reserve first
+    bool modify(OrderId id, Price px, Qty qty) {
+        if (auto it = stop_map_.find(id.raw()); it != stop_map_.end()) {
+            Side side = it->second.second->side;
+            cancel_order(id);
+            bool ok = add_order(id, side, px, qty, OrdType::Stop, Qty{0});
+            fire_stops();
+            return ok;
+        }
+        auto it = order_map_.find(id.raw());
+        if (it == order_map_.end()) return false;
+        auto list_it = it->second.second;
+        if (px == list_it->price && qty <= list_it->qty + list_it->reserve) {
+            auto& level = (list_it->side == Side::Buy ? bids_ : asks_)[px.raw()];
+            level.shown -= list_it->qty.raw();
+            list_it->qty = std::min(list_it->qty, qty);
+            level.shown += list_it->qty.raw();
+            list_it->reserve = qty - list_it->qty;
+            return true;
+        }
+        Side side = list_it->side;
+        Qty peak = list_it->peak;
+        cancel_order(id);
+        bool ok = add_order(id, side, px, qty, peak.raw() > 0 ? OrdType::Iceberg : OrdType::Limit, peak);
+        fire_stops();
+        return ok;
+    }
+    Qty match(Side aggressor, Qty qty, OrderId aggressor_id = OrderId{0}) {
+        aggressor_ = aggressor_id;
+        Qty left = market(aggressor, qty);
+        fire_stops();
+        return left;
+    }
+    // n best levels of one side into out, as OrderBook::depth; qty is what shows
+    size_t depth(Side side, size_t n, std::span<LevelView> out) const {
+        return side == Side::Buy ? levels(bids_.rbegin(), bids_.rend(), n, out)
+                                 : levels(asks_.begin(), asks_.end(), n, out);
+    }
+
+    [[nodiscard]] bool has_bid() const { return !bids_.empty(); }
+    [[nodiscard]] bool has_ask() const { return !asks_.empty(); }
+    [[nodiscard]] Price bid() const { return bids_.empty() ? NO_BID : Price{bids_.rbegin()->first}; }
+    // no ask: Price{-1}, where OrderBook says MaxPrice + 1
+    [[nodiscard]] Price ask() const { return asks_.empty() ? Price{-1} : Price{asks_.begin()->first}; }
+    [[nodiscard]] Price last_trade() const { return Price{last_}; }
+
+    // fills since the last clear_fills(), in print order; empty without record_fills
+    [[nodiscard]] std::span<const Fill> fills() const { return fills_; }
+    void clear_fills() { fills_.clear(); }
+
+    [[nodiscard]] size_t order_count() const { return order_map_.size(); }
+    [[nodiscard]] size_t stop_count() const { return stop_map_.size(); }
+};
+
+} // namespace ob
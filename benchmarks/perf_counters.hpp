@@ -0,0 +1,295 @@
+#pragma once
+
+#include "instrument.hpp"
+#include "timer.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace ob {
+
+// single hardware/software counter via perf_event_open, user space only
+// valid() is false when the kernel refuses (containers, perf_event_paranoid)
+class PerfCounter {
+    int fd_ = -1;
+
+public:
+    PerfCounter(uint32_t type, uint64_t config) noexcept {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    ~PerfCounter() {
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    PerfCounter(const PerfCounter&) = delete;
+    PerfCounter& operator=(const PerfCounter&) = delete;
+
+    [[nodiscard]] bool valid() const noexcept { return fd_ >= 0; }
+
+    void start() noexcept {
+        if (fd_ < 0) return;
+        ::ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+        ::ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    uint64_t stop() noexcept {
+        if (fd_ < 0) return 0;
+        ::ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t v = 0;
+        if (::read(fd_, &v, sizeof(v)) != sizeof(v)) return 0;
+        return v;
+    }
+};
+
+// PERF_TYPE_HW_CACHE config
+[[nodiscard]] constexpr uint64_t cache_event(uint64_t cache, uint64_t op, uint64_t result) noexcept {
+    return cache | (op << 8) | (result << 16);
+}
+
+// dTLB load misses
+inline PerfCounter dtlb_miss_counter() noexcept {
+    return PerfCounter{PERF_TYPE_HW_CACHE,
+        cache_event(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)};
+}
+
+// events read together by PerfGroup
+enum class PmuEvent : uint8_t {
+    Cycles = 0,
+    Instructions,
+    L1dMiss,          // l1d read misses
+    LlcMiss,          // last-level cache misses
+    DtlbMiss,         // dtlb read misses
+    BranchMiss
+};
+
+inline constexpr size_t PMU_EVENTS = 6;
+
+using PmuCounts = std::array<uint64_t, PMU_EVENTS>;
+
+// the six events as one perf group, user space only, counting from
+// construction. each event's page is mapped so read() can use rdpmc without
+// a syscall (cap_user_rdpmc); otherwise it falls back to read(2) per event.
+// events the kernel refuses stay invalid and read as 0 - in a vm or
+// container usually all of them
+class PerfGroup {
+    struct Counter {
+        int fd = -1;
+        perf_event_mmap_page* page = nullptr;
+    };
+    std::array<Counter, PMU_EVENTS> ctr_{};
+    bool rdpmc_ = false;
+
+    static constexpr std::array<std::pair<uint32_t, uint64_t>, PMU_EVENTS> EVENTS{{
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+                                         PERF_COUNT_HW_CACHE_RESULT_MISS)},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ,
+                                         PERF_COUNT_HW_CACHE_RESULT_MISS)},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    }};
+
+    // seqlock read of the mapped page: kernel offset + the live pmc
+    [[nodiscard]] static uint64_t read_page(const perf_event_mmap_page* pc) noexcept {
+        const volatile perf_event_mmap_page* p = pc;
+        uint32_t seq = 0;
+        uint64_t count = 0;
+        do {
+            seq = p->lock;
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+            uint32_t idx = p->index;
+            count = static_cast<uint64_t>(p->offset);
+            if (idx != 0) {
+                unsigned width = p->pmc_width;
+                auto pmc = static_cast<uint64_t>(__builtin_ia32_rdpmc(static_cast<int>(idx - 1)));
+                count += static_cast<uint64_t>(static_cast<int64_t>(pmc << (64 - width)) >> (64 - width));
+            }
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        } while (p->lock != seq);
+        return count;
+    }
+
+public:
+    PerfGroup() noexcept {
+        int leader = -1;
+        for (size_t i = 0; i < PMU_EVENTS; ++i) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = EVENTS[i].first;
+            attr.config = EVENTS[i].second;
+            attr.disabled = leader < 0 ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            int fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+            if (fd < 0) continue;
+            if (leader < 0) leader = fd;
+            ctr_[i].fd = fd;
+            void* page = ::mmap(nullptr, static_cast<size_t>(::sysconf(_SC_PAGESIZE)), PROT_READ, MAP_SHARED, fd, 0);
+            if (page != MAP_FAILED) ctr_[i].page = static_cast<perf_event_mmap_page*>(page);
+        }
+        if (leader < 0) return;
+        ::ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+        rdpmc_ = true;
+        for (const Counter& c : ctr_) {
+            if (c.fd >= 0 && (c.page == nullptr || !c.page->cap_user_rdpmc)) rdpmc_ = false;
+        }
+    }
+
+    ~PerfGroup() {
+        // members before the leader
+        for (size_t i = PMU_EVENTS; i-- > 0;) {
+            if (ctr_[i].page != nullptr) ::munmap(ctr_[i].page, static_cast<size_t>(::sysconf(_SC_PAGESIZE)));
+            if (ctr_[i].fd >= 0) ::close(ctr_[i].fd);
+        }
+    }
+
+    PerfGroup(const PerfGroup&) = delete;
+    PerfGroup& operator=(const PerfGroup&) = delete;
+
+    [[nodiscard]] bool valid(PmuEvent e) const noexcept { return ctr_[static_cast<size_t>(e)].fd >= 0; }
+
+    [[nodiscard]] bool any() const noexcept {
+        return std::any_of(ctr_.begin(), ctr_.end(), [](const Counter& c) { return c.fd >= 0; });
+    }
+
+    // reads go through rdpmc rather than a syscall per event
+    [[nodiscard]] bool user_rdpmc() const noexcept { return rdpmc_; }
+
+    // running totals since construction
+    void read(PmuCounts& out) const noexcept {
+        for (size_t i = 0; i < PMU_EVENTS; ++i) {
+            const Counter& c = ctr_[i];
+            if (c.fd < 0) {
+                out[i] = 0;
+            } else if (rdpmc_) {
+                out[i] = read_page(c.page);
+            } else if (::read(c.fd, &out[i], sizeof(out[i])) != sizeof(out[i])) {
+                out[i] = 0;
+            }
+        }
+    }
+};
+
+// interval totals charged to one (op type, phase)
+struct PhaseTotals {
+    uint64_t tsc = 0;      // rdtsc cycles, available without a pmu
+    PmuCounts pmu{};
+};
+
+// listener that charges counters to the op and phase the book is in, from its
+// PhaseListener marks. every interval has the cost of one empty mark - the
+// counter reads themselves - taken off, measured at construction
+class PhaseProfiler {
+    const PerfGroup* pmu_;
+    std::array<std::array<PhaseTotals, PHASES>, OP_TYPES> totals_{};
+    std::array<uint64_t, OP_TYPES> ops_{};
+    PhaseTotals mark_cost_{};
+    PmuCounts last_{};
+    uint64_t last_tsc_ = 0;
+    OpType op_ = OpType::Add;
+    Phase phase_ = Phase::Lookup;
+
+    void stamp() noexcept {
+        if (pmu_ != nullptr) pmu_->read(last_);
+        last_tsc_ = rdtsc();
+    }
+
+    // the interval since the last stamp, less one mark
+    void charge(PhaseTotals& into) noexcept {
+        PmuCounts now{};
+        if (pmu_ != nullptr) pmu_->read(now);
+        uint64_t t = rdtsc();
+        auto net = [](uint64_t d, uint64_t cost) { return d > cost ? d - cost : 0; };
+        into.tsc += net(t - last_tsc_, mark_cost_.tsc);
+        for (size_t i = 0; i < PMU_EVENTS; ++i) into.pmu[i] += net(now[i] - last_[i], mark_cost_.pmu[i]);
+        last_ = now;
+        last_tsc_ = t;
+    }
+
+    void calibrate() noexcept {
+        static constexpr size_t SAMPLES = 1000;
+        PhaseTotals best{};
+        best.tsc = UINT64_MAX;
+        best.pmu.fill(UINT64_MAX);
+        for (size_t s = 0; s < SAMPLES; ++s) {
+            PhaseTotals one{};
+            stamp();
+            charge(one);
+            best.tsc = std::min(best.tsc, one.tsc);
+            for (size_t i = 0; i < PMU_EVENTS; ++i) best.pmu[i] = std::min(best.pmu[i], one.pmu[i]);
+        }
+        mark_cost_ = best;
+    }
+
+public:
+    // pmu may be null (or empty) for tsc-only attribution; must outlive this
+    explicit PhaseProfiler(const PerfGroup* pmu = nullptr) noexcept
+        : pmu_(pmu != nullptr && pmu->any() ? pmu : nullptr) {
+        calibrate();
+    }
+
+    void on_fill(const Fill&) noexcept {}
+
+    void on_op_begin(OpType t) noexcept {
+        op_ = t;
+        phase_ = Phase::Lookup;
+        stamp();
+    }
+
+    void on_phase(Phase p) noexcept {
+        charge(totals_[static_cast<size_t>(op_)][static_cast<size_t>(phase_)]);
+        phase_ = p;
+    }
+
+    void on_op_end() noexcept {
+        charge(totals_[static_cast<size_t>(op_)][static_cast<size_t>(phase_)]);
+        ++ops_[static_cast<size_t>(op_)];
+    }
+
+    [[nodiscard]] const PhaseTotals& totals(OpType t, Phase p) const noexcept {
+        return totals_[static_cast<size_t>(t)][static_cast<size_t>(p)];
+    }
+
+    [[nodiscard]] uint64_t ops(OpType t) const noexcept { return ops_[static_cast<size_t>(t)]; }
+    [[nodiscard]] const PhaseTotals& mark_cost() const noexcept { return mark_cost_; }
+    [[nodiscard]] bool counting() const noexcept { return pmu_ != nullptr; }
+
+    void clear() noexcept {
+        totals_ = {};
+        ops_ = {};
+    }
+};
+
+template<>
+inline constexpr bool LISTENS<PhaseProfiler> = false;
+
+static_assert(PhaseListener<PhaseProfiler>);
+
+// minor + major page faults of this process so far (always available)
+inline uint64_t page_faults() noexcept {
+    rusage ru{};
+    ::getrusage(RUSAGE_SELF, &ru);
+    return static_cast<uint64_t>(ru.ru_minflt + ru.ru_majflt);
+}
+
+} // namespace ob
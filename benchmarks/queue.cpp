@@ -0,0 +1,104 @@
+#include "book_traits.hpp"
+#include "timer.hpp"
+#include "workload.hpp"
+#include "scenarios.hpp"
+#include "harness.hpp"
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+using namespace ob;
+
+static constexpr size_t QUEUE_OPS = 1'000'000;
+static constexpr size_t QUERIES = 100'000;
+
+using Sizes = Sized<100000, 1'000'000>;
+
+// one pass of the flow on a fresh book, in Mops/s
+template<typename Book>
+[[nodiscard]] double flow_mops(const std::vector<Op>& ops, double freq_ghz) {
+    auto book = std::make_unique<Book>();
+    uint64_t start = rdtsc_fenced();
+    for (const Op& op : ops) {
+        switch (op.type) {
+            case OpType::Add: (void)submit_add(*book, op); break;
+            case OpType::Cancel: (void)book->cancel(op.id); break;
+            case OpType::Match: (void)book->match(op.side, op.qty); break;
+            case OpType::Modify: (void)book->modify(op.id, op.price, op.qty); break;
+        }
+    }
+    uint64_t ns = cycles_to_ns(rdtsc_end() - start, freq_ghz);
+    return static_cast<double>(ops.size()) / static_cast<double>(ns) * 1e3;
+}
+
+// today's answer: walk the level from its front up to the order
+template<typename Book>
+[[nodiscard]] Qty walk_ahead(const Book& book, OrderId id) {
+    const auto* o = book.get_order(id);
+    const auto& level = book.level_at(o->price);
+    Qty ahead{0};
+    for (const auto* x = level.front(); x != o; x = level.next_of(x)) ahead += x->remaining();
+    return ahead;
+}
+
+template<typename Query>
+void bench_query(const char* name, const std::vector<OrderId>& ids, Query&& query, uint64_t overhead,
+                 double freq_ghz) {
+    LatencyHistogram<> cycles{};
+    int64_t sum = 0;
+    for (OrderId id : ids) {
+        uint64_t start = rdtsc_fenced();
+        sum += query(id).raw();
+        cycles.record(net_cycles(start, overhead));
+    }
+    auto st = LatencyStats::of(cycles, 1.0 / freq_ghz);
+    printf("  %-14s p50=%-6lu p99=%-7lu p99.9=%-8lu | mean ahead %.0f\n", name, st.p50, st.p99, st.p999,
+           static_cast<double>(sum) / static_cast<double>(ids.size()));
+}
+
+// queue [--reps N] [--cpu N]
+int main(int argc, char** argv) {
+    HarnessOptions opt = parse_harness_args(argc, argv);
+    printf("=== Queue position ===\n\n");
+    MachineInfo machine = setup_machine(opt);
+    print_machine(machine);
+    double freq_ghz = machine.tsc.ghz;
+
+    WorkloadGen gen(42, 1000.0, 50000, 50.0, 0.30, 0.25, 0.05, 1.5, Sizes::max_price);
+    gen.set_modify_rate(0.10);
+    auto ops = gen.generate(QUEUE_OPS);
+    printf("%zu ops with amends, %zu reps; the cost of keeping queue marks\n\n", ops.size(), opt.reps);
+
+    BenchReport report("queue");
+    for (size_t rep = 0; rep < opt.reps; ++rep) {
+        report.add("dense", "Mops/s", flow_mops<BookOf<Sizes>>(ops, freq_ghz));
+        report.add("dense_queued", "Mops/s", flow_mops<BookOf<Queued<Sizes>>>(ops, freq_ghz));
+        report.add("sparse", "Mops/s", flow_mops<BookOf<Sized<100000, 1'000'000, SparseTraits>>>(ops, freq_ghz));
+        report.add("sparse_queued", "Mops/s",
+                   flow_mops<BookOf<Queued<Sized<100000, 1'000'000, SparseTraits>>>>(ops, freq_ghz));
+    }
+    report.print();
+
+    // the book the flow leaves, and up to QUERIES of its resting orders
+    using Book = BookOf<Queued<Sizes>>;
+    auto book = std::make_unique<Book>();
+    std::vector<OrderId> ids;
+    for (const Op& op : ops) {
+        switch (op.type) {
+            case OpType::Add: (void)submit_add(*book, op); break;
+            case OpType::Cancel: (void)book->cancel(op.id); break;
+            case OpType::Match: (void)book->match(op.side, op.qty); break;
+            case OpType::Modify: (void)book->modify(op.id, op.price, op.qty); break;
+        }
+    }
+    for (const Op& op : ops) {
+        if (op.type == OpType::Add && book->get_order(op.id) != nullptr && ids.size() < QUERIES) ids.push_back(op.id);
+    }
+    printf("\n%zu resting orders queried, %zu on the book; latencies in ns\n\n", ids.size(), book->order_count());
+
+    bench_query("walk", ids, [&book](OrderId id) { return walk_ahead(*book, id); }, machine.timer_overhead,
+                freq_ghz);
+    bench_query("queue_ahead", ids, [&book](OrderId id) { return book->queue_ahead(id); }, machine.timer_overhead,
+                freq_ghz);
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include "book_traits.hpp"
+#include "timer.hpp"
+#include "workload.hpp"
+#include "scenarios.hpp"
+#include "harness.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ob;
+
+// throughput regression gate: fixed flows through the main book shapes in
+// Mops/s. the baseline stores each one's mean over the reps, and a run's best
+// rep is held to it, so one noisy rep neither fails the gate nor sets the bar.
+// exits 1 when any falls more than the tolerance below; --update rewrites it
+// baselines are only good for the machine they were taken on - refresh them
+// there when the gate machine changes
+
+static constexpr size_t GATE_OPS = 1'000'000;
+static constexpr size_t GATE_BATCH = 256;
+static constexpr double DEFAULT_TOLERANCE = 0.10;
+
+using Sizes = Sized<100000, 1'000'000>;
+
+struct CompactTraits : BookTraits {
+    template<int64_t MaxPrice, typename Storage>
+    using ladder = CompactLadder<MaxPrice, Storage>;
+};
+
+enum class Drive : uint8_t {
+    Direct,
+    Lazy,
+    Batch
+};
+
+// one pass over ops on a fresh book, in cycles
+template<typename Book>
+[[nodiscard]] uint64_t pass_cycles(const std::vector<Op>& ops, Drive drive) {
+    auto book = std::make_unique<Book>();
+    uint64_t start = rdtsc_fenced();
+    if (drive == Drive::Batch) {
+        for (size_t i = 0; i < ops.size(); i += GATE_BATCH) {
+            book->apply(std::span<const Op>(ops).subspan(i, std::min(GATE_BATCH, ops.size() - i)));
+        }
+    } else {
+        for (const Op& op : ops) {
+            switch (op.type) {
+                case OpType::Add: (void)submit_add(*book, op); break;
+                case OpType::Cancel:
+                    (void)(drive == Drive::Lazy ? book->cancel_lazy(op.id) : book->cancel(op.id));
+                    break;
+                case OpType::Match: (void)book->match(op.side, op.qty); break;
+                case OpType::Modify: (void)book->modify(op.id, op.price, op.qty); break;
+            }
+        }
+    }
+    return rdtsc_end() - start;
+}
+
+// each flow on its own fresh book, in Mops/s over all of them
+template<typename Book>
+[[nodiscard]] double pass(std::span<const std::vector<Op>> flows, Drive drive, double freq_ghz) {
+    uint64_t cycles = 0;
+    size_t n = 0;
+    for (const std::vector<Op>& ops : flows) {
+        cycles += pass_cycles<Book>(ops, drive);
+        n += ops.size();
+    }
+    return static_cast<double>(n) / static_cast<double>(cycles_to_ns(cycles, freq_ghz)) * 1e3;
+}
+
+template<typename Book>
+[[nodiscard]] double pass(const std::vector<Op>& ops, Drive drive, double freq_ghz) {
+    return pass<Book>(std::span<const std::vector<Op>>(&ops, 1), drive, freq_ghz);
+}
+
+// "name value" lines; # starts a comment
+[[nodiscard]] static std::map<std::string, double> read_baseline(const std::string& path) {
+    std::map<std::string, double> base;
+    std::ifstream f(path);
+    std::string line;
+    while (std::getline(f, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream in(line);
+        std::string name;
+        double v = 0;
+        if (in >> name >> v) base[name] = v;
+    }
+    return base;
+}
+
+// regression [--reps N] [--cpu N] [--json path] [--baseline path] [--tolerance f] [--update]
+int main(int argc, char** argv) {
+    std::string baseline_path = "benchmarks/throughput_baseline.txt";
+    double tolerance = DEFAULT_TOLERANCE;
+    bool update = false;
+    std::vector<char*> rest{argv[0]};
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--update") == 0) update = true;
+        else if (std::strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) baseline_path = argv[++i];
+        else if (std::strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) tolerance = std::atof(argv[++i]);
+        else rest.push_back(argv[i]);
+    }
+    HarnessOptions opt = parse_harness_args(static_cast<int>(rest.size()), rest.data());
+    printf("=== Throughput regression gate ===\n\n");
+    MachineInfo machine = setup_machine(opt);
+    print_machine(machine);
+    double freq_ghz = machine.tsc.ghz;
+
+    WorkloadGen gen(42, 1000.0, 50000, 50.0, 0.30, 0.25, 0.05, 1.5, Sizes::max_price);
+    gen.set_modify_rate(0.10);
+    auto ops = gen.generate(GATE_OPS);
+    WorkloadGen rgen(42, 1000.0, 50000, 50.0, 0.30, 0.25, 0.05, 1.5, Sizes::max_price);
+    rgen.set_id_mode(IdMode::Random);
+    auto random_ops = rgen.generate(GATE_OPS);
+    ScenarioConfig cfg;
+    cfg.ops = GATE_OPS / 8;
+    cfg.max_price = Sizes::max_price;
+    cfg.capacity = Sizes::max_orders;
+    std::vector<std::vector<Op>> stress;
+    for (Scenario sc : {Scenario::FlashCrash, Scenario::IcebergRefill, Scenario::FokSweep, Scenario::StopCascade}) {
+        stress.push_back(make_scenario(sc, cfg));
+    }
+    printf("%zu reps of %zu-op flows, tolerance %.0f%%\n\n", opt.reps, GATE_OPS, tolerance * 100.0);
+
+    BenchReport report("regression");
+    for (size_t rep = 0; rep < opt.reps; ++rep) {
+        report.add("dense_mix", "Mops/s", pass<BookOf<Sizes>>(ops, Drive::Direct, freq_ghz));
+        report.add("dense_lazy", "Mops/s", pass<BookOf<Sizes>>(ops, Drive::Lazy, freq_ghz));
+        report.add("dense_apply", "Mops/s", pass<BookOf<Sizes>>(ops, Drive::Batch, freq_ghz));
+        report.add("compact_mix", "Mops/s", pass<BookOf<Sized<100000, 1'000'000, CompactTraits>>>(
+            ops, Drive::Direct, freq_ghz));
+        report.add("slot_mix", "Mops/s", pass<BookOf<Sized<100000, 1'000'000, SlotTraits>>>(
+            ops, Drive::Direct, freq_ghz));
+        report.add("sparse_random_ids", "Mops/s", pass<BookOf<Sized<100000, 1'000'000, SparseTraits>>>(
+            random_ops, Drive::Batch, freq_ghz));
+        report.add("stress_scenarios", "Mops/s", pass<BookOf<Sizes>>(
+            std::span<const std::vector<Op>>(stress), Drive::Direct, freq_ghz));
+    }
+    report.print();
+    if (!opt.json.empty() && !report.write_json(opt.json, machine)) {
+        fprintf(stderr, "cannot write %s\n", opt.json.c_str());
+    }
+
+    static constexpr const char* METRICS[] = {"dense_mix", "dense_lazy", "dense_apply", "compact_mix",
+                                              "slot_mix", "sparse_random_ids", "stress_scenarios"};
+    if (update) {
+        std::FILE* f = std::fopen(baseline_path.c_str(), "w");
+        if (f == nullptr) {
+            fprintf(stderr, "cannot write %s\n", baseline_path.c_str());
+            return 1;
+        }
+        std::fprintf(f, "# mean of %zu reps, Mops/s - refresh with: regression --update\n", opt.reps);
+        for (const char* m : METRICS) std::fprintf(f, "%s %.2f\n", m, report.stats(m).mean);
+        std::fclose(f);
+        printf("\n  baseline written to %s\n", baseline_path.c_str());
+        return 0;
+    }
+
+    std::map<std::string, double> base = read_baseline(baseline_path);
+    if (base.empty()) {
+        fprintf(stderr, "no baseline in %s - record one with --update\n", baseline_path.c_str());
+        return 1;
+    }
+    printf("\nBest rep against the means in %s:\n", baseline_path.c_str());
+    bool failed = false;
+    for (const char* m : METRICS) {
+        double got = report.stats(m).max;
+        auto it = base.find(m);
+        if (it == base.end()) {
+            printf("  %-20s %8.2f  (no baseline)\n", m, got);
+            continue;
+        }
+        double change = got / it->second - 1.0;
+        bool slow = change < -tolerance;
+        failed |= slow;
+        printf("  %-20s %8.2f vs %8.2f  %+6.1f%%%s\n", m, got, it->second, change * 100.0,
+               slow ? "  REGRESSED" : "");
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,71 @@
+#include "order_book.hpp"
+#include "replay.hpp"
+#include "timer.hpp"
+#include "workload.hpp"
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace ob;
+
+static constexpr size_t SYNTH_OPS = 10'000'000;
+
+using Book = OrderBook<100000, 1'000'000>;
+
+// replay [file]
+// without a file, a WorkloadGen stream is converted first so synthetic and
+// recorded runs go through the same path
+int main(int argc, char** argv) {
+    printf("=== Replay ===\n\n");
+    double freq_ghz = get_cpu_freq_ghz();
+
+    std::string path;
+    if (argc > 1) {
+        path = argv[1];
+    } else {
+        path = "/tmp/ob_replay.bin";
+        WorkloadGen gen(42);
+        auto ops = gen.generate(SYNTH_OPS);
+        write_replay(path, ops);
+        printf("Wrote %zu WorkloadGen ops to %s\n", ops.size(), path.c_str());
+    }
+
+    ReplayFile file(path);
+    printf("Replaying %zu messages (%zu MB mapped)\n\n", file.size(),
+           file.records().size() >> 20);
+
+    // sustained: one untimed pass per message
+    auto book = std::make_unique<Book>();
+    uint64_t start = rdtsc_start();
+    file.replay(*book);
+    uint64_t total_ns = cycles_to_ns(rdtsc_end() - start, freq_ghz);
+    printf("Sustained: %.2f M msgs/sec (%.1f ns/msg)\n",
+           static_cast<double>(file.size()) / (static_cast<double>(total_ns) / 1e9) / 1e6,
+           static_cast<double>(total_ns) / static_cast<double>(file.size()));
+
+    // per message, decode included, by type
+    book = std::make_unique<Book>();
+    std::vector<uint64_t> lat[4];
+    for (auto& v : lat) v.reserve(file.size() / 2);
+    for (size_t i = 0; i < file.size(); ++i) {
+        uint64_t t0 = rdtsc();
+        Msg m = file[i];
+        dispatch(*book, m);
+        uint64_t ns = cycles_to_ns(rdtsc() - t0, freq_ghz);
+        size_t k = m.type == MsgType::Add ? 0 : m.type == MsgType::Cancel ? 1
+                 : m.type == MsgType::Execute ? 2 : 3;
+        lat[k].push_back(ns);
+    }
+
+    const char* names[4] = {"Add", "Cancel", "Execute", "Replace"};
+    printf("\nPer-message latency (ns):\n");
+    for (size_t k = 0; k < 4; ++k) {
+        if (lat[k].empty()) continue;
+        size_t n = lat[k].size();
+        auto s = LatencyStats::calc(lat[k]);
+        printf("  %-8s %9zu  p50=%-4lu p90=%-4lu p99=%-4lu p99.9=%-4lu p99.99=%-4lu\n",
+               names[k], n, s.p50, s.p90, s.p99, s.p999, s.p9999);
+    }
+    return 0;
+}
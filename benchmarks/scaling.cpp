@@ -0,0 +1,62 @@
+#include "order_book.hpp"
+#include "book_manager.hpp"
+#include "workload.hpp"
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace ob;
+
+static constexpr size_t SYMBOLS = 32;
+static constexpr size_t OPS_PER_SYMBOL = 200'000;
+static constexpr int64_t MAX_PRICE = 20000;
+static constexpr int64_t MID = 10000;
+
+using Book = OrderBook<MAX_PRICE, 65536>;
+
+// one producer round-robins per-symbol WorkloadGen streams into the shards
+double run(size_t shards, const std::vector<std::vector<Op>>& streams) {
+    // worker i on cpu i + 1, leaving cpu 0 to the producer when there is room
+    unsigned ncpu = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> cpus;
+    for (size_t i = 0; i < shards; ++i) cpus.push_back(static_cast<int>((i + 1) % ncpu));
+
+    BookManager<Book> mgr(shards, SYMBOLS, cpus);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < OPS_PER_SYMBOL; ++i) {
+        for (uint32_t sym = 0; sym < SYMBOLS; ++sym) mgr.submit(sym, streams[sym][i]);
+    }
+    mgr.drain();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    double secs = std::chrono::duration<double>(elapsed).count();
+    return static_cast<double>(mgr.applied()) / secs;
+}
+
+int main() {
+    printf("=== BookManager Scaling (%zu symbols x %zu ops) ===\n\n", SYMBOLS, OPS_PER_SYMBOL);
+
+    std::vector<std::vector<Op>> streams;
+    for (size_t sym = 0; sym < SYMBOLS; ++sym) {
+        WorkloadGen gen(1000 + sym, 1000.0, MID, 100.0, 0.40, 0.30, 0.10, 1.5, MAX_PRICE);
+        streams.push_back(gen.generate(OPS_PER_SYMBOL));
+    }
+
+    unsigned ncpu = std::max(1u, std::thread::hardware_concurrency());
+    printf("hardware threads: %u\n", ncpu);
+
+    double base = 0.0;
+    for (size_t shards = 1; shards <= ncpu; shards *= 2) {
+        double ops = run(shards, streams);
+        if (shards == 1) base = ops;
+        printf("  %3zu cores: %7.2f M ops/sec (%.2fx)\n", shards, ops / 1e6, ops / base);
+    }
+    if ((ncpu & (ncpu - 1)) != 0) {
+        double ops = run(ncpu, streams);
+        printf("  %3u cores: %7.2f M ops/sec (%.2fx)\n", ncpu, ops / 1e6, ops / base);
+    }
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "order_book.hpp"
+#include "timer.hpp"
+#include "scenarios.hpp"
+#include "naive_book.hpp"
+#include "harness.hpp"
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+using namespace ob;
+
+static constexpr size_t SCENARIO_OPS = 1'000'000;
+
+// small pool so pool_exhaustion fills it and deep_passive rests 64k orders
+using Book = OrderBook<100000, (1 << 18)>;
+
+struct RunStats {
+    std::array<LatencyHistogram<>, OP_TYPES> cycles{};
+    double mops = 0.0;
+    size_t rejected = 0;      // adds the book refused
+    size_t resting = 0;       // orders left at the end
+};
+
+template<typename B, bool Lazy>
+bool run_op(B& book, const Op& op) {
+    switch (op.type) {
+        case OpType::Add:
+            if constexpr (requires { book.pool_capacity(); }) {
+                return submit_add(book, op) == AddResult::Ok;
+            } else {
+                return submit_add(book, op);
+            }
+        case OpType::Cancel:
+            if constexpr (Lazy) return book.cancel_lazy(op.id);
+            else return book.cancel(op.id);
+        case OpType::Match: (void)book.match(op.side, op.qty); return true;
+        case OpType::Modify: (void)book.modify(op.id, op.price, op.qty); return true;
+    }
+    return true;
+}
+
+// every op timed on one fresh book, net of the timer overhead
+// Lazy: cancels leave tombstones (cancel_lazy)
+template<typename B, bool Lazy = false>
+RunStats run(const std::vector<Op>& ops, uint64_t overhead, double freq_ghz) {
+    auto book = std::make_unique<B>();
+    RunStats s;
+    uint64_t total_start = rdtsc_fenced();
+    for (const Op& op : ops) {
+        uint64_t start = rdtsc_fenced();
+        bool ok = run_op<B, Lazy>(*book, op);
+        s.cycles[static_cast<size_t>(op.type)].record(net_cycles(start, overhead));
+        if (!ok && op.type == OpType::Add) ++s.rejected;
+    }
+    uint64_t ns = cycles_to_ns(rdtsc_end() - total_start, freq_ghz);
+    s.mops = static_cast<double>(ops.size()) / static_cast<double>(ns) * 1e3;
+    s.resting = book->order_count();
+    return s;
+}
+
+void print_run(const char* name, const RunStats& s, double freq_ghz) {
+    printf("  %-14s %6.2f Mops/s", name, s.mops);
+    for (auto [t, label] : {std::pair{OpType::Add, "add"}, std::pair{OpType::Cancel, "cancel"},
+                            std::pair{OpType::Match, "match"}}) {
+        const auto& h = s.cycles[static_cast<size_t>(t)];
+        if (h.count() == 0) continue;
+        auto st = LatencyStats::of(h, 1.0 / freq_ghz);
+        printf(" | %s p50=%-4lu p99=%-5lu p99.9=%-6lu max=%-7lu", label, st.p50, st.p99, st.p999,
+               static_cast<uint64_t>(static_cast<double>(h.max()) / freq_ghz));
+    }
+    printf(" | rejected=%zu resting=%zu\n", s.rejected, s.resting);
+}
+
+// scenarios [--cpu N]
+int main(int argc, char** argv) {
+    HarnessOptions opt = parse_harness_args(argc, argv);
+    printf("=== Adversarial scenarios ===\n\n");
+    MachineInfo machine = setup_machine(opt);
+    print_machine(machine);
+    double freq_ghz = machine.tsc.ghz;
+
+    ScenarioConfig cfg;
+    cfg.ops = SCENARIO_OPS;
+    cfg.max_price = Book::max_price();
+    cfg.capacity = Book::max_orders();
+    printf("Book: MaxPrice=%ld, MaxOrders=%zu; latencies in ns\n", Book::max_price(), Book::max_orders());
+
+    for (Scenario sc : ALL_SCENARIOS) {
+        std::vector<Op> ops = make_scenario(sc, cfg);
+        std::array<size_t, OP_TYPES> mix{};
+        for (const Op& op : ops) ++mix[static_cast<size_t>(op.type)];
+        auto pct = [&](OpType t) { return 100.0 * static_cast<double>(mix[static_cast<size_t>(t)]) / static_cast<double>(ops.size()); };
+        printf("\n%s (%zu ops: %.1f%% add, %.1f%% cancel, %.1f%% match):\n", scenario_name(sc), ops.size(),
+               pct(OpType::Add), pct(OpType::Cancel), pct(OpType::Match));
+        print_run("OrderBook", run<Book>(ops, machine.timer_overhead, freq_ghz), freq_ghz);
+        print_run("lazy cancel", run<Book, true>(ops, machine.timer_overhead, freq_ghz), freq_ghz);
+        print_run("std::map", run<NaiveBook>(ops, machine.timer_overhead, freq_ghz), freq_ghz);
+    }
+    return 0;
+}
@@ -0,0 +1,445 @@
+#pragma once
+
+#include "types.hpp"
+#include "op.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace ob {
+
+// named adversarial workloads - the slow paths WorkloadGen's stationary mix
+// never reaches: deep sweeps, cancel storms at best, long fifo queues, sparse
+// wide ladders, colliding ids, a full pool and the iceberg/fok/stop engines
+
+enum class Scenario : uint8_t {
+    FlashCrash = 0,    // deep two-sided book, then market sells through ~500 bid levels
+    QuoteStuffing,     // bursts of orders inside the spread, cancelled at once
+    OpeningAuction,    // long queues on a few prices, then an aggressive open
+    DeepPassive,       // orders spread over the whole price range, sweeps over gaps
+    HashCollision,     // default flow with ids that all share a few index homes
+    PoolExhaustion,    // adds into a book whose pool is full
+    IcebergRefill,     // icebergs at the touch refilled by a stream of small trades
+    FokSweep,          // fill-or-kill orders through the top levels, about a third killed
+    StopCascade        // stop ladders on both sides, set off by crash and rip sweeps
+};
+
+inline constexpr std::array<Scenario, 9> ALL_SCENARIOS{
+    Scenario::FlashCrash, Scenario::QuoteStuffing, Scenario::OpeningAuction,
+    Scenario::DeepPassive, Scenario::HashCollision, Scenario::PoolExhaustion,
+    Scenario::IcebergRefill, Scenario::FokSweep, Scenario::StopCascade};
+
+[[nodiscard]] constexpr const char* scenario_name(Scenario s) noexcept {
+    switch (s) {
+        case Scenario::FlashCrash: return "flash_crash";
+        case Scenario::QuoteStuffing: return "quote_stuffing";
+        case Scenario::OpeningAuction: return "opening_auction";
+        case Scenario::DeepPassive: return "deep_passive";
+        case Scenario::HashCollision: return "hash_collision";
+        case Scenario::PoolExhaustion: return "pool_exhaustion";
+        case Scenario::IcebergRefill: return "iceberg_refill";
+        case Scenario::FokSweep: return "fok_sweep";
+        case Scenario::StopCascade: return "stop_cascade";
+    }
+    return "?";
+}
+
+struct ScenarioConfig {
+    size_t ops = 1'000'000;
+    uint64_t seed = 42;
+    int64_t mid = 50000;
+    int64_t max_price = 100000;     // the book's MaxPrice
+    size_t capacity = 1'000'000;    // the book's MaxOrders: how much to rest, when the pool fills
+};
+
+// levels swept by a flash crash
+inline constexpr int64_t CRASH_LEVELS = 500;
+// hash-collision ids are multiples of the stride plus one of a few offsets,
+// so they share COLLISION_HOMES slots of any power-of-two table up to the
+// stride; COLLISION_LIVE of them rest at once
+inline constexpr uint64_t COLLISION_STRIDE = uint64_t{1} << 24;
+inline constexpr uint64_t COLLISION_HOMES = 64;
+inline constexpr size_t COLLISION_LIVE = 256;
+
+namespace detail {
+
+// ops plus the id counter and randomness the generators share
+class ScenarioBuilder {
+    std::mt19937_64 rng_;
+    std::uniform_real_distribution<double> uniform_{0.0, 1.0};
+    std::vector<Op> ops_;
+    uint64_t next_id_ = 1;
+    bool collide_ = false;
+    size_t target_;
+
+    [[nodiscard]] OrderId make_id() noexcept {
+        uint64_t seq = next_id_++;
+        if (!collide_) return OrderId{seq};
+        // distinct for distinct seq, and every id lands on home seq % COLLISION_HOMES
+        return OrderId{seq * COLLISION_STRIDE + seq % COLLISION_HOMES};
+    }
+
+public:
+    explicit ScenarioBuilder(const ScenarioConfig& cfg) : rng_(cfg.seed), target_(cfg.ops) {
+        ops_.reserve(cfg.ops);
+    }
+
+    [[nodiscard]] bool full() const noexcept { return ops_.size() >= target_; }
+
+    // ids fall on COLLISION_HOMES index slots from here on
+    void collide() noexcept { collide_ = true; }
+
+    OrderId add(Side side, int64_t px, int64_t qty, OrdType type = OrdType::Limit) {
+        OrderId id = make_id();
+        push(Op{OpType::Add, id, side, Price{px}, Qty{qty}, type});
+        return id;
+    }
+
+    OrderId iceberg(Side side, int64_t px, int64_t qty, int64_t peak) {
+        OrderId id = make_id();
+        push(Op{OpType::Add, id, side, Price{px}, Qty{qty}, OrdType::Iceberg, Qty{peak}});
+        return id;
+    }
+
+    void cancel(OrderId id) { push(Op{OpType::Cancel, id, Side::Buy, Price{0}, Qty{0}, OrdType::Limit}); }
+
+    void match(Side side, int64_t qty) {
+        push(Op{OpType::Match, OrderId{0}, side, Price{0}, Qty{qty}, OrdType::Market});
+    }
+
+    [[nodiscard]] int64_t between(int64_t lo, int64_t hi) {
+        return std::uniform_int_distribution<int64_t>(lo, hi)(rng_);
+    }
+
+    [[nodiscard]] size_t index(size_t n) { return std::uniform_int_distribution<size_t>(0, n - 1)(rng_); }
+
+    [[nodiscard]] bool chance(double p) { return uniform_(rng_) < p; }
+
+    [[nodiscard]] Side side() { return chance(0.5) ? Side::Buy : Side::Sell; }
+
+    // heavy-tailed size in [1, cap], alpha 1.5 like WorkloadGen
+    [[nodiscard]] int64_t size(int64_t cap = 1000) {
+        double q = 1.0 / std::pow(std::max(uniform_(rng_), 1e-12), 1.0 / 1.5);
+        return std::clamp(static_cast<int64_t>(q), int64_t{1}, cap);
+    }
+
+    // cancel and forget a random entry of live
+    void cancel_one(std::vector<OrderId>& live) {
+        size_t i = index(live.size());
+        cancel(live[i]);
+        live[i] = live.back();
+        live.pop_back();
+    }
+
+    [[nodiscard]] std::vector<Op> take() {
+        ops_.resize(std::min(ops_.size(), target_));
+        return std::move(ops_);
+    }
+
+private:
+    void push(const Op& op) {
+        if (!full()) ops_.push_back(op);
+    }
+};
+
+// rebuild DEPTH levels a side, churn near the touch, then sell through
+// CRASH_LEVELS of bids in one market order and a few follow-ups, and pull
+// what is left
+inline std::vector<Op> flash_crash(const ScenarioConfig& cfg) {
+    static constexpr int64_t DEPTH = CRASH_LEVELS + 100;
+    static constexpr int PER_LEVEL = 2;
+    ScenarioBuilder b(cfg);
+    std::vector<OrderId> live;
+    while (!b.full()) {
+        int64_t swept = 0;
+        for (int64_t i = 1; i <= DEPTH; ++i) {
+            for (int k = 0; k < PER_LEVEL; ++k) {
+                int64_t bid_qty = b.size(100);
+                if (i <= CRASH_LEVELS) swept += bid_qty;
+                live.push_back(b.add(Side::Buy, cfg.mid - i, bid_qty));
+                live.push_back(b.add(Side::Sell, cfg.mid + i, b.size(100)));
+            }
+        }
+        for (int i = 0; i < 2000 && !live.empty(); ++i) {
+            if (b.chance(0.5)) b.cancel_one(live);
+            else {
+                Side s = b.side();
+                int64_t off = b.between(1, 5);
+                live.push_back(b.add(s, s == Side::Buy ? cfg.mid - off : cfg.mid + off, b.size(100)));
+            }
+        }
+        b.match(Side::Sell, swept);
+        for (int i = 0; i < 16; ++i) b.match(Side::Sell, b.size(500));
+        for (OrderId id : live) b.cancel(id);
+        live.clear();
+    }
+    return b.take();
+}
+
+// resting book DEPTH levels a side; each burst adds BURST orders one tick
+// inside the spread on one side, then cancels them all at best, with the
+// occasional trade and replenishment of the resting book
+inline std::vector<Op> quote_stuffing(const ScenarioConfig& cfg) {
+    static constexpr int64_t DEPTH = 200;
+    static constexpr size_t BURST = 64;
+    ScenarioBuilder b(cfg);
+    for (int64_t i = 2; i <= DEPTH + 1; ++i) {
+        b.add(Side::Buy, cfg.mid - i, b.size(100));
+        b.add(Side::Sell, cfg.mid + i, b.size(100));
+    }
+    std::vector<OrderId> burst;
+    while (!b.full()) {
+        Side side = b.side();
+        int64_t px = side == Side::Buy ? cfg.mid - 1 : cfg.mid + 1;
+        for (size_t i = 0; i < BURST; ++i) burst.push_back(b.add(side, px, b.between(1, 10)));
+        // newest first, like a stuffer pulling a ladder of quotes
+        while (!burst.empty()) {
+            b.cancel(burst.back());
+            burst.pop_back();
+        }
+        if (b.chance(0.1)) {
+            b.match(b.side(), b.size(50));
+            for (int k = 0; k < 4; ++k) {
+                Side s = b.side();
+                int64_t off = b.between(2, DEPTH + 1);
+                b.add(s, s == Side::Buy ? cfg.mid - off : cfg.mid + off, b.size(100));
+            }
+        }
+    }
+    return b.take();
+}
+
+// build-up: up to 20000 orders (half the pool) on a handful of prices each
+// side, with cancels from the middle of the queues; the open: aggressive
+// limits and ioc through the top levels, then the rest is pulled
+inline std::vector<Op> opening_auction(const ScenarioConfig& cfg) {
+    static constexpr int64_t SPREAD = 6;     // prices per side
+    size_t build = std::min<size_t>(20000, cfg.capacity / 2);
+    ScenarioBuilder b(cfg);
+    std::vector<OrderId> live;
+    while (!b.full()) {
+        for (size_t i = 0; i < build; ++i) {
+            if (!live.empty() && b.chance(0.2)) {
+                b.cancel_one(live);
+                continue;
+            }
+            Side s = b.side();
+            int64_t off = b.between(0, SPREAD - 1);
+            live.push_back(b.add(s, s == Side::Buy ? cfg.mid - off : cfg.mid + 1 + off, b.size(100)));
+        }
+        for (int i = 0; i < 200; ++i) {
+            Side s = b.side();
+            int64_t limit = s == Side::Buy ? cfg.mid + 3 : cfg.mid - 2;
+            OrdType type = b.chance(0.5) ? OrdType::IOC : OrdType::Limit;
+            OrderId id = b.add(s, limit, b.size(5000), type);
+            if (type == OrdType::Limit) live.push_back(id);
+        }
+        for (OrderId id : live) b.cancel(id);
+        live.clear();
+    }
+    return b.take();
+}
+
+// a quarter of the pool resting anywhere in the price range: bids uniform
+// below the mid, asks above, so most ticks are empty. churn is random
+// cancels plus market orders that step best price over wide gaps
+inline std::vector<Op> deep_passive(const ScenarioConfig& cfg) {
+    ScenarioBuilder b(cfg);
+    size_t target = cfg.capacity / 4;
+    std::vector<OrderId> live;
+    live.reserve(target + 1);
+    auto place = [&] {
+        Side s = b.side();
+        int64_t px = s == Side::Buy ? b.between(0, cfg.mid - 1) : b.between(cfg.mid + 1, cfg.max_price);
+        live.push_back(b.add(s, px, b.size(100)));
+    };
+    while (live.size() < target && !b.full()) place();
+    while (!b.full()) {
+        int64_t r = b.between(0, 99);
+        if (r < 45 && !live.empty()) b.cancel_one(live);
+        else if (r < 55) b.match(b.side(), b.size(100));
+        else place();
+    }
+    return b.take();
+}
+
+// a hot book of COLLISION_LIVE orders near the mid, churned by cancels, adds
+// and small trades, with every id mapped onto one of a few index homes,
+// so a modulo index probes one long cluster
+inline std::vector<Op> hash_collision(const ScenarioConfig& cfg) {
+    ScenarioBuilder b(cfg);
+    b.collide();
+    std::vector<OrderId> live;
+    auto place = [&] {
+        Side s = b.side();
+        int64_t off = b.between(1, 50);
+        live.push_back(b.add(s, s == Side::Buy ? cfg.mid - off : cfg.mid + off, b.size(100)));
+    };
+    while (live.size() < COLLISION_LIVE && !b.full()) place();
+    while (!b.full()) {
+        if (live.size() > COLLISION_LIVE / 2 && b.chance(0.5)) b.cancel_one(live);
+        else if (b.chance(0.1)) b.match(b.side(), b.size(20));
+        else place();
+    }
+    return b.take();
+}
+
+// fill the pool with passive orders, then keep adding into it: most adds are
+// rejected, and the few cancels let one through at a time
+inline std::vector<Op> pool_exhaustion(const ScenarioConfig& cfg) {
+    ScenarioBuilder b(cfg);
+    std::vector<OrderId> live;
+    live.reserve(cfg.capacity);
+    auto place = [&] {
+        Side s = b.side();
+        int64_t off = b.between(1, 1000);
+        live.push_back(b.add(s, s == Side::Buy ? cfg.mid - off : cfg.mid + off, b.size(100)));
+    };
+    while (live.size() < cfg.capacity && !b.full()) place();
+    while (!b.full()) {
+        if (b.chance(0.05) && !live.empty()) b.cancel_one(live);
+        else place();   // tracked even when rejected; cancels of those just miss
+    }
+    return b.take();
+}
+
+// DEPTH levels a side with an iceberg on each side of the touch, hit by small
+// trades; new orders queue behind the icebergs and fresh icebergs replace
+// spent ones, so most trades end in a refill at the back of the level
+inline std::vector<Op> iceberg_refill(const ScenarioConfig& cfg) {
+    static constexpr int64_t DEPTH = 50;
+    ScenarioBuilder b(cfg);
+    size_t target = std::min<size_t>(2000, cfg.capacity / 4);
+    std::vector<OrderId> live;
+    for (int64_t i = 1; i <= DEPTH; ++i) {
+        live.push_back(b.add(Side::Buy, cfg.mid - i, b.size(100)));
+        live.push_back(b.add(Side::Sell, cfg.mid + i, b.size(100)));
+    }
+    live.push_back(b.iceberg(Side::Buy, cfg.mid - 1, 5000, 20));
+    live.push_back(b.iceberg(Side::Sell, cfg.mid + 1, 5000, 20));
+    while (!b.full()) {
+        int64_t r = b.between(0, 99);
+        Side s = b.side();
+        if (r < 40) {
+            b.match(s, b.between(1, 30));
+        } else if (r < 70) {
+            live.push_back(b.add(s, s == Side::Buy ? cfg.mid - 1 : cfg.mid + 1, b.between(10, 100)));
+        } else if (r < 90 || live.size() > target) {
+            if (!live.empty()) b.cancel_one(live);
+        } else {
+            int64_t off = b.between(1, 3);
+            live.push_back(b.iceberg(s, s == Side::Buy ? cfg.mid - off : cfg.mid + off,
+                                     b.between(500, 5000), b.between(5, 50)));
+        }
+    }
+    return b.take();
+}
+
+// two orders a level on DEPTH levels, one add in ten an iceberg, refilled
+// within ten ticks of the mid; fok orders a few ticks through the touch for
+// sizes either side of what is there
+inline std::vector<Op> fok_sweep(const ScenarioConfig& cfg) {
+    static constexpr int64_t DEPTH = 50;
+    ScenarioBuilder b(cfg);
+    size_t target = std::min<size_t>(2000, cfg.capacity / 4);
+    std::vector<OrderId> live;
+    auto place = [&](Side s, int64_t off) {
+        int64_t px = s == Side::Buy ? cfg.mid - off : cfg.mid + off;
+        live.push_back(b.chance(0.1) ? b.iceberg(s, px, b.between(100, 1000), b.between(5, 50))
+                                     : b.add(s, px, b.between(10, 100)));
+    };
+    for (int64_t i = 1; i <= DEPTH; ++i) {
+        for (int k = 0; k < 2; ++k) {
+            place(Side::Buy, i);
+            place(Side::Sell, i);
+        }
+    }
+    while (!b.full()) {
+        int64_t r = b.between(0, 99);
+        Side s = b.side();
+        if (r < 15) {
+            int64_t off = b.between(1, 10);
+            (void)b.add(s, s == Side::Buy ? cfg.mid + off : cfg.mid - off, b.between(1, 600), OrdType::FOK);
+        } else if (r < 60) {
+            place(s, b.between(1, 10));
+        } else if (r < 90 || live.size() > target) {
+            if (!live.empty()) b.cancel_one(live);
+        } else {
+            b.match(s, b.size(50));
+        }
+    }
+    return b.take();
+}
+
+// each round: DEPTH levels a side, one small trade at the touch, STOPS stops a
+// side every other tick beyond it, churn near the touch, then a market sell
+// and a market buy through ~20 levels that set the stops off in cascades;
+// whatever is left is pulled
+inline std::vector<Op> stop_cascade(const ScenarioConfig& cfg) {
+    static constexpr int64_t DEPTH = 100;
+    static constexpr int64_t STOPS = 50;
+    ScenarioBuilder b(cfg);
+    std::vector<OrderId> live;
+    while (!b.full()) {
+        int64_t inside = 0;
+        for (int64_t i = 1; i <= DEPTH; ++i) {
+            int64_t q = b.size(100);
+            if (i <= 20) inside += q;
+            live.push_back(b.add(Side::Buy, cfg.mid - i, q));
+            live.push_back(b.add(Side::Sell, cfg.mid + i, q));
+        }
+        b.match(Side::Buy, 1);      // last trade at the touch: no stop starts out triggered
+        for (int64_t i = 1; i <= STOPS; ++i) {
+            live.push_back(b.add(Side::Sell, cfg.mid - 2 * i, b.size(200), OrdType::Stop));
+            live.push_back(b.add(Side::Buy, cfg.mid + 2 * i, b.size(200), OrdType::Stop));
+        }
+        for (int i = 0; i < 500 && !live.empty(); ++i) {
+            int64_t r = b.between(0, 99);
+            Side s = b.side();
+            if (r < 40) {
+                b.cancel_one(live);
+            } else if (r < 90) {
+                int64_t off = b.between(1, 5);
+                live.push_back(b.add(s, s == Side::Buy ? cfg.mid - off : cfg.mid + off, b.size(100)));
+            } else {
+                b.match(s, b.size(20));
+            }
+        }
+        b.match(Side::Sell, inside);
+        b.match(Side::Buy, inside);
+        for (OrderId id : live) b.cancel(id);
+        live.clear();
+    }
+    return b.take();
+}
+
+} // namespace detail
+
+// send an add op to a book, icebergs through add_iceberg
+template<typename Book>
+[[nodiscard]] inline auto submit_add(Book& book, const Op& op) {
+    return op.ord_type == OrdType::Iceberg ? book.add_iceberg(op.id, op.side, op.price, op.qty, op.peak)
+                                           : book.add(op.id, op.side, op.price, op.qty, op.ord_type);
+}
+
+[[nodiscard]] inline std::vector<Op> make_scenario(Scenario s, const ScenarioConfig& cfg) {
+    switch (s) {
+        case Scenario::FlashCrash: return detail::flash_crash(cfg);
+        case Scenario::QuoteStuffing: return detail::quote_stuffing(cfg);
+        case Scenario::OpeningAuction: return detail::opening_auction(cfg);
+        case Scenario::DeepPassive: return detail::deep_passive(cfg);
+        case Scenario::HashCollision: return detail::hash_collision(cfg);
+        case Scenario::PoolExhaustion: return detail::pool_exhaustion(cfg);
+        case Scenario::IcebergRefill: return detail::iceberg_refill(cfg);
+        case Scenario::FokSweep: return detail::fok_sweep(cfg);
+        case Scenario::StopCascade: return detail::stop_cascade(cfg);
+    }
+    return {};
+}
+
+} // namespace ob
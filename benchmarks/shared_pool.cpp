@@ -0,0 +1,121 @@
+#include "book_traits.hpp"
+#include "timer.hpp"
+#include "workload.hpp"
+#include "harness.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace ob;
+
+static constexpr size_t SYMBOLS = 64;
+static constexpr size_t HOT_SYMBOLS = 4;
+static constexpr size_t HOT_OPS = 60'000;        // per hot symbol
+static constexpr size_t COLD_OPS = 2'000;        // per other symbol
+static constexpr size_t SHARD_ORDERS = 1 << 17;  // order slots for the whole shard
+
+// the same memory either split evenly or shared through one depot
+using PrivateBook = BookOf<Sized<100000, SHARD_ORDERS / SYMBOLS, ArenaTraits>>;
+using SharedBook = BookOf<Sized<100000, SHARD_ORDERS, ShardTraits>>;
+
+struct Tagged {
+    uint32_t symbol;
+    Op op;
+};
+
+template<typename Book>
+bool run_op(Book& book, const Op& op) {
+    switch (op.type) {
+        case OpType::Add: return book.add(op.id, op.side, op.price, op.qty, op.ord_type) == AddResult::Ok;
+        case OpType::Cancel: return book.cancel(op.id);
+        case OpType::Match: (void)book.match(op.side, op.qty); return true;
+        case OpType::Modify: (void)book.modify(op.id, op.price, op.qty); return true;
+    }
+    return true;
+}
+
+// one shard's flow on one thread, every op timed
+template<typename Book>
+void bench(const char* name, std::vector<std::unique_ptr<Book>>& books, const std::vector<Tagged>& flow,
+           uint64_t overhead, double freq_ghz) {
+    std::array<LatencyHistogram<>, OP_TYPES> cycles{};
+    size_t rejected = 0;
+    uint64_t total_start = rdtsc_fenced();
+    for (const Tagged& t : flow) {
+        uint64_t start = rdtsc_fenced();
+        bool ok = run_op(*books[t.symbol], t.op);
+        cycles[static_cast<size_t>(t.op.type)].record(net_cycles(start, overhead));
+        if (!ok && t.op.type == OpType::Add) ++rejected;
+    }
+    uint64_t ns = cycles_to_ns(rdtsc_end() - total_start, freq_ghz);
+
+    size_t hot = 0, resting = 0;
+    for (size_t s = 0; s < SYMBOLS; ++s) {
+        resting += books[s]->order_count();
+        if (s < HOT_SYMBOLS) hot += books[s]->order_count();
+    }
+    printf("  %-8s %6.2f Mops/s", name, static_cast<double>(flow.size()) / static_cast<double>(ns) * 1e3);
+    for (auto [t, label] : {std::pair{OpType::Add, "add"}, std::pair{OpType::Cancel, "cancel"}}) {
+        auto st = LatencyStats::of(cycles[static_cast<size_t>(t)], 1.0 / freq_ghz);
+        printf(" | %s p50=%-4lu p99=%-5lu p99.9=%-6lu", label, st.p50, st.p99, st.p999);
+    }
+    printf(" | rejected=%zu resting=%zu (hot %zu)\n", rejected, resting, hot);
+}
+
+// shared_pool [--cpu N]
+int main(int argc, char** argv) {
+    HarnessOptions opt = parse_harness_args(argc, argv);
+    printf("=== Shared order pool ===\n\n");
+    MachineInfo machine = setup_machine(opt);
+    print_machine(machine);
+    double freq_ghz = machine.tsc.ghz;
+    printf("%zu symbols, %zu order slots for the shard: %zu per book, or one depot\n",
+           SYMBOLS, SHARD_ORDERS, PrivateBook::max_orders());
+    printf("%zu hot symbols x %zu ops that keep building depth, the rest %zu ops each\n",
+           HOT_SYMBOLS, HOT_OPS, COLD_OPS);
+
+    // per-symbol streams, interleaved at random but in order within a symbol
+    std::vector<std::vector<Op>> streams;
+    std::vector<uint32_t> order;
+    for (uint32_t s = 0; s < SYMBOLS; ++s) {
+        bool is_hot = s < HOT_SYMBOLS;
+        WorkloadGen gen(100 + s, 1000.0, 50000, is_hot ? 200.0 : 50.0, is_hot ? 0.30 : 0.35,
+                        is_hot ? 0.10 : 0.25, 0.05, 1.5, PrivateBook::max_price());
+        streams.push_back(gen.generate(is_hot ? HOT_OPS : COLD_OPS));
+        order.insert(order.end(), streams.back().size(), s);
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937_64{42});
+    std::vector<Tagged> flow;
+    flow.reserve(order.size());
+    std::vector<size_t> next(SYMBOLS, 0);
+    for (uint32_t s : order) flow.push_back(Tagged{s, streams[s][next[s]++]});
+
+    printf("\n");
+    {
+        Arena arena(size_t{8} << 30);
+        std::vector<std::unique_ptr<PrivateBook>> books;
+        {
+            ArenaScope scope(arena);
+            for (size_t s = 0; s < SYMBOLS; ++s) books.push_back(std::make_unique<PrivateBook>());
+        }
+        bench("private", books, flow, machine.timer_overhead, freq_ghz);
+    }
+    {
+        Arena arena(size_t{16} << 30);
+        ArenaScope scope(arena);
+        auto depot = std::make_unique<SharedBook::pool_type::depot_type>();
+        std::vector<std::unique_ptr<SharedBook>> books;
+        {
+            PoolScope pool_scope(*depot);
+            for (size_t s = 0; s < SYMBOLS; ++s) books.push_back(std::make_unique<SharedBook>());
+        }
+        bench("shared", books, flow, machine.timer_overhead, freq_ghz);
+        size_t cached = 0;
+        for (auto& b : books) cached += b->pool().cached();
+        printf("  depot: %zu free, %zu cached in magazines\n", depot->available(), cached);
+    }
+    return 0;
+}
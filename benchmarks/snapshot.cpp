@@ -0,0 +1,86 @@
+#include "order_book.hpp"
+#include "snapshot.hpp"
+#include "timer.hpp"
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <unistd.h>
+
+using namespace ob;
+
+static constexpr size_t ORDERS = 5'000'000;
+static constexpr int64_t MID = 50000;
+static constexpr int64_t SPREAD = 10000;    // ticks each side of the mid
+
+using DenseBook = OrderBook<100000, ORDERS>;
+using SlotBook = OrderBook<100000, ORDERS, NullListener, DirectIndex, InlineStorage, SlotLadder>;
+
+static double ms_since(uint64_t start, double freq_ghz) {
+    return static_cast<double>(cycles_to_ns(rdtsc_end() - start, freq_ghz)) / 1e6;
+}
+
+// full book, resting only: bids below the mid, asks above
+template<typename Book>
+void fill(Book& book) {
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<int64_t> off(1, SPREAD);
+    std::uniform_int_distribution<int64_t> qty(1, 500);
+    for (uint64_t id = 1; id <= ORDERS; ++id) {
+        Side side = (id & 1) != 0 ? Side::Buy : Side::Sell;
+        Price px{side == Side::Buy ? MID - off(rng) : MID + off(rng)};
+        (void)book.add(OrderId{id}, side, px, Qty{qty(rng)}, OrdType::Limit, Timestamp{id});
+    }
+}
+
+template<typename Book>
+void bench(const char* name, const std::string& path, double freq_ghz) {
+    printf("%s (%zu B orders):\n", name, sizeof(typename Book::order_type));
+
+    uint64_t start = rdtsc_start();
+    auto live = std::make_unique<Book>();
+    double ctor_ms = ms_since(start, freq_ghz);
+
+    start = rdtsc_start();
+    fill(*live);
+    double add_ms = ms_since(start, freq_ghz);
+
+    start = rdtsc_start();
+    write_snapshot(path, *live);
+    double write_ms = ms_since(start, freq_ghz);
+    live.reset();
+
+    // failover path: map the file, construct, restore
+    start = rdtsc_start();
+    SnapshotFile file(path);
+    double map_ms = ms_since(start, freq_ghz);
+
+    start = rdtsc_start();
+    auto restored = std::make_unique<Book>();
+    double ctor2_ms = ms_since(start, freq_ghz);
+
+    start = rdtsc_start();
+    RestoreResult r = restored->restore(file.records());
+    double restore_ms = ms_since(start, freq_ghz);
+
+    printf("  construct %7.1f ms | %zu add() %7.1f ms\n", ctor_ms, ORDERS, add_ms);
+    printf("  snapshot  %7.1f ms (%zu MB)\n", write_ms,
+           (SNAPSHOT_HEADER + file.size() * sizeof(SnapshotRecord)) >> 20);
+    printf("  map %5.1f ms + construct %7.1f ms + restore %7.1f ms = %7.1f ms (%s, %zu orders, %.1f ns/order)\n",
+           map_ms, ctor2_ms, restore_ms, map_ms + ctor2_ms + restore_ms,
+           r == RestoreResult::Ok ? "ok" : "FAILED", restored->order_count(),
+           restore_ms * 1e6 / static_cast<double>(file.size()));
+    printf("  restore vs add(): %.1fx\n\n", add_ms / restore_ms);
+}
+
+// snapshot [file]
+int main(int argc, char** argv) {
+    printf("=== Snapshot / restore ===\n\n");
+    double freq_ghz = get_cpu_freq_ghz();
+    std::string path = argc > 1 ? argv[1] : "/tmp/ob_snapshot.bin";
+
+    bench<DenseBook>("dense ladder", path, freq_ghz);
+    bench<SlotBook>("compact 32B", path, freq_ghz);
+    if (argc <= 1) ::unlink(path.c_str());
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include "book_traits.hpp"
+#include "timer.hpp"
+#include "workload.hpp"
+#include "harness.hpp"
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+using namespace ob;
+
+static constexpr size_t STP_OPS = 1'000'000;
+static constexpr uint16_t PARTICIPANTS = 64;
+
+// what a wrapper around the book pays to spot self-trades: one hash lookup
+// of the passive order's participant per fill, after it already traded
+struct OwnerLookup {
+    std::unordered_map<uint64_t, uint16_t>* owners = nullptr;
+    uint16_t aggressor = 0;
+    size_t self_fills = 0;
+
+    void on_fill(const Fill& f) noexcept {
+        auto it = owners->find(f.passive_id.raw());
+        if (it != owners->end() && it->second == aggressor) ++self_fills;
+    }
+};
+
+struct StpCount {
+    size_t cancels = 0;
+
+    void on_fill(const Fill&) noexcept {}
+    void on_self_trade(const SelfTrade&) noexcept { ++cancels; }
+};
+
+using Sizes = Sized<100000, 1'000'000>;
+
+// participant of an order, fixed per id; matches take the next in turn
+[[nodiscard]] static uint16_t participant_of(uint64_t id) noexcept {
+    return static_cast<uint16_t>(id % PARTICIPANTS + 1);
+}
+
+// every op timed on one fresh book, net of the timer overhead
+// run(book, op, owner) applies it; the owner is untagged when stp is off
+template<typename Book, typename Run>
+void bench(const char* name, Book& book, const std::vector<Op>& ops, StpMode stp, Run&& run,
+           uint64_t overhead, double freq_ghz) {
+    std::array<LatencyHistogram<>, OP_TYPES> cycles{};
+    uint16_t next = 1;
+    uint64_t total_start = rdtsc_fenced();
+    for (const Op& op : ops) {
+        uint16_t p = op.type == OpType::Match ? next = static_cast<uint16_t>(next % PARTICIPANTS + 1)
+                                              : participant_of(op.id.raw());
+        Owner owner = stp == StpMode::None ? Owner{} : Owner{p, stp};
+        uint64_t start = rdtsc_fenced();
+        run(book, op, owner);
+        cycles[static_cast<size_t>(op.type)].record(net_cycles(start, overhead));
+    }
+    uint64_t ns = cycles_to_ns(rdtsc_end() - total_start, freq_ghz);
+
+    printf("  %-16s %6.2f Mops/s", name, static_cast<double>(ops.size()) / static_cast<double>(ns) * 1e3);
+    for (auto [t, label] : {std::pair{OpType::Add, "add"}, std::pair{OpType::Match, "match"}}) {
+        auto st = LatencyStats::of(cycles[static_cast<size_t>(t)], 1.0 / freq_ghz);
+        printf(" | %s p50=%-4lu p99=%-5lu p99.9=%-6lu", label, st.p50, st.p99, st.p999);
+    }
+}
+
+template<typename Book>
+void run_op(Book& book, const Op& op, Owner owner) {
+    switch (op.type) {
+        case OpType::Add: (void)book.add(op.id, op.side, op.price, op.qty, op.ord_type, Timestamp{0}, owner); break;
+        case OpType::Cancel: (void)book.cancel(op.id); break;
+        case OpType::Match: (void)book.match(op.side, op.qty, OrderId{0}, Timestamp{0}, owner); break;
+        case OpType::Modify: (void)book.modify(op.id, op.price, op.qty); break;
+    }
+}
+
+// stp [--cpu N]
+int main(int argc, char** argv) {
+    HarnessOptions opt = parse_harness_args(argc, argv);
+    printf("=== Self-trade prevention ===\n\n");
+    MachineInfo machine = setup_machine(opt);
+    print_machine(machine);
+    double freq_ghz = machine.tsc.ghz;
+    printf("%zu ops, %u participants; latencies in ns\n\n", STP_OPS, PARTICIPANTS);
+
+    WorkloadGen gen(42, 1000.0, 50000, 50.0, 0.30, 0.25, 0.05, 1.5, Sizes::max_price);
+    auto ops = gen.generate(STP_OPS);
+
+    {
+        auto book = std::make_unique<BookOf<Sizes>>();
+        bench("untagged", *book, ops, StpMode::None, run_op<BookOf<Sizes>>, machine.timer_overhead, freq_ghz);
+        printf("\n");
+    }
+    for (auto [label, mode] : {std::pair{"cancel newest", StpMode::CancelNewest},
+                               std::pair{"cancel oldest", StpMode::CancelOldest},
+                               std::pair{"decrement", StpMode::Decrement}}) {
+        using Book = BookOf<Listened<StpCount, Sizes>>;
+        auto book = std::make_unique<Book>();
+        bench(label, *book, ops, mode, run_op<Book>, machine.timer_overhead, freq_ghz);
+        printf(" | %zu stp\n", book->listener().cancels);
+    }
+    {
+        // the same flow through a wrapper that keeps owners in a map
+        using Book = BookOf<Listened<OwnerLookup, Sizes>>;
+        std::unordered_map<uint64_t, uint16_t> owners;
+        owners.reserve(STP_OPS);
+        auto book = std::make_unique<Book>();
+        book->listener().owners = &owners;
+        auto wrapped = [&owners](Book& b, const Op& op, Owner owner) {
+            if (op.type == OpType::Add) owners[op.id.raw()] = owner.participant;
+            if (op.type == OpType::Cancel) owners.erase(op.id.raw());
+            b.listener().aggressor = owner.participant;
+            run_op(b, op, Owner{});
+        };
+        bench("wrapper lookup", *book, ops, StpMode::CancelOldest, wrapped, machine.timer_overhead, freq_ghz);
+        printf(" | %zu self fills seen\n", book->listener().self_fills);
+    }
+    return 0;
+}
@@ -15,11 +15,12 @@ int main() {
     auto book = std::make_unique<Book>();
 
     WorkloadGen gen(12345, 1000.0, 50000, 200.0, 0.40, 0.25, 0.05);
+    gen.set_modify_rate(0.10);
 
     auto start = std::chrono::steady_clock::now();
 
-    size_t add_cnt = 0, cancel_cnt = 0, match_cnt = 0;
-    size_t add_ok = 0, cancel_ok = 0;
+    size_t add_cnt = 0, cancel_cnt = 0, match_cnt = 0, modify_cnt = 0;
+    size_t add_ok = 0, cancel_ok = 0, modify_ok = 0;
 
     for (size_t i = 0; i < STRESS_OPS; ++i) {
         auto op = gen.next();
@@ -41,6 +42,11 @@ int main() {
                 (void)book->match(op.side, op.qty);
                 break;
             }
+            case OpType::Modify: {
+                ++modify_cnt;
+                if (book->modify(op.id, op.price, op.qty) == ModifyResult::Ok) ++modify_ok;
+                break;
+            }
         }
     }
 
@@ -57,6 +63,8 @@ int main() {
     printf("  Cancel: %zu (success: %zu, %.1f%%)\n",
            cancel_cnt, cancel_ok, 100.0 * static_cast<double>(cancel_ok) / cancel_cnt);
     printf("  Match:  %zu\n", match_cnt);
+    printf("  Modify: %zu (success: %zu, %.1f%%)\n",
+           modify_cnt, modify_ok, 100.0 * static_cast<double>(modify_ok) / modify_cnt);
 
     printf("\nFinal book state:\n");
     printf("  Orders: %zu\n", book->order_count());
@@ -0,0 +1,91 @@
+#include "book_traits.hpp"
+#include "timer.hpp"
+#include "workload.hpp"
+#include "harness.hpp"
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+using namespace ob;
+
+static constexpr size_t TRAITS_OPS = 1'000'000;
+static constexpr int64_t TRAITS_MAX_PRICE = 100000;
+static constexpr size_t TRAITS_MAX_ORDERS = 1'000'000;
+
+// dense ladder with hashed ids, for venues with sparse ids but a narrow range
+struct DenseSwissTraits : BookTraits {
+    template<size_t Capacity, typename Storage, typename O>
+    using index = SwissIndex<Capacity, Storage, O>;
+};
+
+// 32-byte orders with hashed ids
+struct SlotSwissTraits : SlotTraits {
+    template<size_t Capacity, typename Storage, typename O>
+    using index = SwissIndex<Capacity, Storage, O>;
+};
+
+template<typename Traits>
+using Sized1M = BookOf<Sized<TRAITS_MAX_PRICE, TRAITS_MAX_ORDERS, Traits>>;
+
+// every op timed on one fresh book, net of the timer overhead
+template<typename Book>
+void bench(const char* name, const std::vector<Op>& ops, uint64_t overhead, double freq_ghz) {
+    auto book = std::make_unique<Book>();
+    std::array<LatencyHistogram<>, OP_TYPES> cycles{};
+    uint64_t total_start = rdtsc_fenced();
+    for (const Op& op : ops) {
+        uint64_t start = rdtsc_fenced();
+        switch (op.type) {
+            case OpType::Add: (void)book->add(op.id, op.side, op.price, op.qty); break;
+            case OpType::Cancel: (void)book->cancel(op.id); break;
+            case OpType::Match: (void)book->match(op.side, op.qty); break;
+            case OpType::Modify: (void)book->modify(op.id, op.price, op.qty); break;
+        }
+        cycles[static_cast<size_t>(op.type)].record(net_cycles(start, overhead));
+    }
+    uint64_t ns = cycles_to_ns(rdtsc_end() - total_start, freq_ghz);
+
+    printf("  %-22s %6.2f Mops/s", name, static_cast<double>(ops.size()) / static_cast<double>(ns) * 1e3);
+    for (auto [t, label] : {std::pair{OpType::Add, "add"}, std::pair{OpType::Cancel, "cancel"},
+                            std::pair{OpType::Match, "match"}}) {
+        auto st = LatencyStats::of(cycles[static_cast<size_t>(t)], 1.0 / freq_ghz);
+        printf(" | %s p50=%-4lu p99=%-5lu", label, st.p50, st.p99);
+    }
+    printf(" | %5zu KiB book\n", sizeof(Book) / 1024);
+}
+
+template<typename Traits>
+void bench_traits(const char* name, const std::vector<Op>& ops, uint64_t overhead, double freq_ghz) {
+    bench<Sized1M<Traits>>(name, ops, overhead, freq_ghz);
+}
+
+// traits [--cpu N]
+int main(int argc, char** argv) {
+    HarnessOptions opt = parse_harness_args(argc, argv);
+    printf("=== Book traits ===\n\n");
+    MachineInfo machine = setup_machine(opt);
+    print_machine(machine);
+    double freq_ghz = machine.tsc.ghz;
+    printf("Books: MaxPrice=%ld, MaxOrders=%zu, %zu ops; latencies in ns\n",
+           TRAITS_MAX_PRICE, TRAITS_MAX_ORDERS, TRAITS_OPS);
+
+    WorkloadGen seq_gen(42);
+    auto seq_ops = seq_gen.generate(TRAITS_OPS);
+    WorkloadGen random_gen(42);
+    random_gen.set_id_mode(IdMode::Random);
+    auto random_ops = random_gen.generate(TRAITS_OPS);
+
+    for (auto [label, ops] : {std::pair{"sequential ids", &seq_ops}, std::pair{"random ids", &random_ops}}) {
+        printf("\n%s:\n", label);
+        bench_traits<DenseTraits>("dense + direct", *ops, machine.timer_overhead, freq_ghz);
+        bench_traits<DenseSwissTraits>("dense + swiss", *ops, machine.timer_overhead, freq_ghz);
+        if (ops == &seq_ops) {  // 32-byte orders refuse 64-bit ids
+            bench_traits<SlotTraits>("slot 32B + direct", *ops, machine.timer_overhead, freq_ghz);
+            bench_traits<SlotSwissTraits>("slot 32B + swiss", *ops, machine.timer_overhead, freq_ghz);
+        }
+        bench_traits<SparseTraits>("window + swiss", *ops, machine.timer_overhead, freq_ghz);
+        bench_traits<MappedSparseTraits>("window + swiss, mmap", *ops, machine.timer_overhead, freq_ghz);
+    }
+    return 0;
+}
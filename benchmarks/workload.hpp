@@ -1,6 +1,7 @@
 #pragma once
 
 #include "types.hpp"
+#include "op.hpp"
 #include <random>
 #include <cmath>
 #include <vector>
@@ -8,19 +9,10 @@
 
 namespace ob {
 
-enum class OpType : uint8_t {
-    Add = 0,
-    Cancel = 1,
-    Match = 2
-};
-
-struct Op {
-    OpType type;
-    OrderId id;
-    Side side;
-    Price price;
-    Qty qty;
-    OrdType ord_type;
+// order id assignment
+enum class IdMode : uint8_t {
+    Sequential = 0,   // 1, 2, 3, ...
+    Random = 1        // unique, uniformly spread 64-bit ids (hashed exchange ids)
 };
 
 // Realistic workload generator
@@ -40,8 +32,20 @@ class WorkloadGen {
     int64_t mid_price_;
     int64_t max_price_;
 
+    double modify_rate_ = 0.0;      // off unless set - keeps existing streams unchanged
+    double size_down_share_ = 0.6;  // share of modifies that only cut qty
+
+    // resting orders as generated - fills aren't tracked
+    struct Resting {
+        OrderId id;
+        Side side;
+        Price price;
+        Qty qty;
+    };
+
     uint64_t next_id_ = 1;
-    std::vector<OrderId> active_ids_;
+    IdMode id_mode_ = IdMode::Sequential;
+    std::vector<Resting> active_;
 
 public:
     explicit WorkloadGen(
@@ -71,10 +75,14 @@ public:
         double r = uniform_(rng_);
 
         // Decide operation type
-        if (r < cancel_rate_ && !active_ids_.empty()) {
+        if (r < cancel_rate_ && !active_.empty()) {
             return gen_cancel();
         }
 
+        if (modify_rate_ > 0.0 && !active_.empty() && uniform_(rng_) < modify_rate_) {
+            return gen_modify();
+        }
+
         r = uniform_(rng_);
         if (r < market_rate_) {
             return gen_market();
@@ -93,18 +101,27 @@ public:
         return ops;
     }
 
+    void set_id_mode(IdMode mode) { id_mode_ = mode; }
+
+    // share of non-cancel ops that amend a resting order; of those,
+    // size_down_share only cut qty, the rest move price on the same side
+    void set_modify_rate(double rate, double size_down_share = 0.6) {
+        modify_rate_ = rate;
+        size_down_share_ = size_down_share;
+    }
+
     // Reset state
     void reset(uint64_t seed) {
         rng_.seed(seed);
         next_id_ = 1;
-        active_ids_.clear();
+        active_.clear();
     }
 
 private:
     Op gen_limit() {
         Op op;
         op.type = OpType::Add;
-        op.id = OrderId{next_id_++};
+        op.id = gen_id();
         op.side = uniform_(rng_) < 0.5 ? Side::Buy : Side::Sell;
         op.price = gen_price(op.side);
         op.qty = gen_qty();
@@ -115,7 +132,7 @@ private:
             op.ord_type = OrdType::IOC;
         } else {
             op.ord_type = OrdType::Limit;
-            active_ids_.push_back(op.id);
+            active_.push_back(Resting{op.id, op.side, op.price, op.qty});
         }
 
         return op;
@@ -134,24 +151,55 @@ private:
 
     Op gen_cancel() {
         // Pick random active order
-        std::uniform_int_distribution<size_t> idx_dist(0, active_ids_.size() - 1);
+        std::uniform_int_distribution<size_t> idx_dist(0, active_.size() - 1);
         size_t idx = idx_dist(rng_);
 
         Op op;
         op.type = OpType::Cancel;
-        op.id = active_ids_[idx];
+        op.id = active_[idx].id;
         op.side = Side::Buy;  // unused
         op.price = Price{0};  // unused
         op.qty = Qty{0};      // unused
         op.ord_type = OrdType::Limit;
 
         // Remove from active list (swap and pop)
-        active_ids_[idx] = active_ids_.back();
-        active_ids_.pop_back();
+        active_[idx] = active_.back();
+        active_.pop_back();
 
         return op;
     }
 
+    Op gen_modify() {
+        std::uniform_int_distribution<size_t> idx_dist(0, active_.size() - 1);
+        Resting& o = active_[idx_dist(rng_)];
+
+        Op op;
+        op.type = OpType::Modify;
+        op.id = o.id;
+        op.side = o.side;
+        op.ord_type = OrdType::Limit;
+        if (uniform_(rng_) < size_down_share_) {
+            op.price = o.price;
+            op.qty = Qty{std::max<int64_t>(1, static_cast<int64_t>(static_cast<double>(o.qty.raw()) * uniform_(rng_)))};
+        } else {
+            op.price = gen_price(o.side);
+            op.qty = o.qty;
+        }
+        o.price = op.price;
+        o.qty = op.qty;
+        return op;
+    }
+
+    OrderId gen_id() {
+        uint64_t seq = next_id_++;
+        if (id_mode_ == IdMode::Sequential) return OrderId{seq};
+        // splitmix64 finalizer is a bijection, so ids stay unique
+        uint64_t z = seq * 0x9e3779b97f4a7c15ULL;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return OrderId{z ^ (z >> 31)};
+    }
+
     Price gen_price(Side side) {
         // Normal distribution around mid
         double px = price_dist_(rng_);
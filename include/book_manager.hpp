@@ -0,0 +1,186 @@
+#pragma once
+
+#include "op.hpp"
+#include "spsc_ring.hpp"
+#include "shared_pool.hpp"
+#include "storage.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+
+namespace ob {
+
+// op routed to one symbol's book
+struct SymbolOp {
+    uint32_t symbol;
+    Op op;
+};
+
+// many books sharded over worker threads, one thread per shard
+// symbol s lives on shard s % shards; each shard is fed by an spsc ring, so
+// all submits must come from one producer thread. workers drain up to Batch
+// ops per wakeup and hand same-symbol runs to Book::apply
+// books are built on their worker thread, so first touch places them locally
+// with arena_bytes set, each worker also builds a per-core Arena first and
+// ArenaStorage books on that shard carve their arrays from it
+// books with a MagazinePool share one depot per shard, built the same way
+template<typename Book, size_t RingSize = 8192, size_t Batch = 256>
+class BookManager {
+    static constexpr bool SHARED_POOL = requires { typename Book::pool_type::depot_type; };
+
+    template<typename B>
+    struct DepotOf { struct type {}; };
+    template<typename B> requires requires { typename B::pool_type::depot_type; }
+    struct DepotOf<B> { using type = typename B::pool_type::depot_type; };
+    using Depot = typename DepotOf<Book>::type;
+
+    struct Shard {
+        SpscRing<SymbolOp, RingSize> ring;
+        std::unique_ptr<Arena> arena;               // outlives the depot and books
+        std::unique_ptr<Depot> depot;               // shared pool, outlives the books
+        std::vector<std::unique_ptr<Book>> books;   // symbol / shards -> book
+        alignas(64) std::atomic<uint64_t> applied{0};
+        alignas(64) uint64_t submitted = 0;         // producer only
+        std::jthread worker;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    size_t symbols_;
+    size_t arena_bytes_;
+    std::atomic<size_t> ready_{0};
+
+    // spin briefly, then give the core away - the producer may share it
+    static void backoff(unsigned& spins) noexcept {
+        if (++spins < 64) {
+            __builtin_ia32_pause();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    static void pin(int cpu) noexcept {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        (void)pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    void run(std::stop_token stop, Shard& s, size_t index, int cpu) {
+        if (cpu >= 0) pin(cpu);
+        if (arena_bytes_ > 0) s.arena = std::make_unique<Arena>(arena_bytes_);
+        {
+            std::optional<ArenaScope> arena_scope;
+            if (s.arena) arena_scope.emplace(*s.arena);
+            if constexpr (SHARED_POOL) s.depot = std::make_unique<Depot>();
+            for (size_t sym = index; sym < symbols_; sym += shards_.size()) {
+                if constexpr (SHARED_POOL) {
+                    PoolScope scope(*s.depot);
+                    s.books.push_back(std::make_unique<Book>());
+                } else {
+                    s.books.push_back(std::make_unique<Book>());
+                }
+            }
+        }
+        ready_.fetch_add(1, std::memory_order_release);
+
+        std::array<SymbolOp, Batch> in;
+        std::array<Op, Batch> ops;
+        unsigned spins = 0;
+        // keep draining after stop so nothing submitted is lost
+        while (true) {
+            size_t n = s.ring.pop_bulk(in);
+            if (n == 0) {
+                if (stop.stop_requested() && s.ring.empty()) break;
+                backoff(spins);
+                continue;
+            }
+            spins = 0;
+            for (size_t i = 0; i < n;) {
+                uint32_t sym = in[i].symbol;
+                size_t k = 0;
+                while (i < n && in[i].symbol == sym) ops[k++] = in[i++].op;
+                s.books[sym / shards_.size()]->apply(std::span<const Op>(ops.data(), k));
+            }
+            s.applied.fetch_add(n, std::memory_order_release);
+        }
+    }
+
+public:
+    // cpus[i] pins shard i's worker; shards past the end of cpus aren't pinned
+    // arena_bytes > 0 reserves that much address space per shard for ArenaStorage books
+    BookManager(size_t shards, size_t symbols, std::span<const int> cpus = {}, size_t arena_bytes = 0)
+        : symbols_(symbols), arena_bytes_(arena_bytes) {
+        shards_.reserve(shards);
+        for (size_t i = 0; i < shards; ++i) shards_.push_back(std::make_unique<Shard>());
+        for (size_t i = 0; i < shards; ++i) {
+            int cpu = i < cpus.size() ? cpus[i] : -1;
+            shards_[i]->worker = std::jthread([this, i, cpu](std::stop_token st) {
+                run(st, *shards_[i], i, cpu);
+            });
+        }
+        while (ready_.load(std::memory_order_acquire) != shards) std::this_thread::yield();
+    }
+
+    ~BookManager() { stop(); }
+
+    BookManager(const BookManager&) = delete;
+    BookManager& operator=(const BookManager&) = delete;
+
+    // producer: false if the shard's ring is full
+    [[nodiscard]] bool try_submit(uint32_t symbol, const Op& op) noexcept {
+        Shard& s = *shards_[symbol % shards_.size()];
+        if (!s.ring.try_push(SymbolOp{symbol, op})) return false;
+        ++s.submitted;
+        return true;
+    }
+
+    // producer: waits for room
+    void submit(uint32_t symbol, const Op& op) noexcept {
+        unsigned spins = 0;
+        while (!try_submit(symbol, op)) backoff(spins);
+    }
+
+    // producer: wait until every submitted op has been applied
+    void drain() noexcept {
+        for (auto& s : shards_) {
+            unsigned spins = 0;
+            while (s->applied.load(std::memory_order_acquire) != s->submitted) backoff(spins);
+        }
+    }
+
+    // drain and join the workers; books stay readable
+    void stop() noexcept {
+        for (auto& s : shards_) s->worker.request_stop();
+        for (auto& s : shards_) {
+            if (s->worker.joinable()) s->worker.join();
+        }
+    }
+
+    // only between drain() (or stop()) and the next submit
+    [[nodiscard]] Book& book(uint32_t symbol) noexcept {
+        return *shards_[symbol % shards_.size()]->books[symbol / shards_.size()];
+    }
+
+    [[nodiscard]] uint64_t applied() const noexcept {
+        uint64_t n = 0;
+        for (const auto& s : shards_) n += s->applied.load(std::memory_order_acquire);
+        return n;
+    }
+
+    // shard's arena, null without arena_bytes
+    [[nodiscard]] const Arena* arena(size_t shard) const noexcept { return shards_[shard]->arena.get(); }
+
+    [[nodiscard]] size_t shards() const noexcept { return shards_.size(); }
+    [[nodiscard]] size_t symbols() const noexcept { return symbols_; }
+};
+
+} // namespace ob
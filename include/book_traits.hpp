@@ -0,0 +1,115 @@
+#pragma once
+
+#include "order_book.hpp"
+#include "shared_pool.hpp"
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+
+namespace ob {
+
+// one policy bundle per book, so a venue's book is a single type
+// derive from BookTraits and override what differs:
+//   struct VenueTraits : BookTraits {
+//       template<size_t C, typename S, typename O> using index = SwissIndex<C, S, O>;
+//   };
+//   using VenueBook = BookOf<VenueTraits>;
+// everything resolves at compile time - BookOf is just an OrderBook
+struct BookTraits {
+    static constexpr int64_t max_price = DEFAULT_MAX_PRICE;
+    static constexpr size_t max_orders = DEFAULT_MAX_ORDERS;
+    using listener = NullListener;      // fills, top, l2 and instrumentation hooks
+    using storage = InlineStorage;      // pool, level and index arrays
+    // id -> order lookup, see order_index.hpp
+    template<size_t Capacity, typename Storage, typename O>
+    using index = DirectIndex<Capacity, Storage, O>;
+    // price levels and, through them, the order layout - see price_ladder.hpp
+    template<int64_t MaxPrice, typename Storage>
+    using ladder = DenseLadder<MaxPrice, Storage>;
+    // order nodes, see memory_pool.hpp and shared_pool.hpp
+    template<typename O, size_t Capacity, typename Storage, typename Idx>
+    using pool = MemPool<O, Capacity, Storage, Idx>;
+    // queue marks for queue_ahead, see queue_marks.hpp
+    template<size_t Capacity, typename Storage>
+    using queue = NoQueueMarks<Capacity, Storage>;
+};
+
+template<typename T>
+concept BookPolicy = requires {
+    { T::max_price } -> std::convertible_to<int64_t>;
+    { T::max_orders } -> std::convertible_to<size_t>;
+    typename T::listener;
+    typename T::storage;
+    typename T::template index<1, typename T::storage, Order>;
+    typename T::template ladder<1, typename T::storage>;
+    typename T::template pool<Order, 1, typename T::storage, size_t>;
+    typename T::template queue<1, typename T::storage>;
+};
+
+template<BookPolicy Traits = BookTraits>
+using BookOf = OrderBook<Traits::max_price, Traits::max_orders, typename Traits::listener,
+                         Traits::template index, typename Traits::storage,
+                         Traits::template ladder, Traits::template pool, Traits::template queue>;
+
+// base with another price range and pool size
+template<int64_t MaxPrice, size_t MaxOrders, BookPolicy Base = BookTraits>
+struct Sized : Base {
+    static constexpr int64_t max_price = MaxPrice;
+    static constexpr size_t max_orders = MaxOrders;
+};
+
+// base with another listener
+template<typename Listener, BookPolicy Base = BookTraits>
+struct Listened : Base {
+    using listener = Listener;
+};
+
+// base that keeps queue marks, for queue_ahead and entry_seq
+// 16 bytes a pool slot; the ladder must be one of PriceLevels
+template<BookPolicy Base = BookTraits>
+struct Queued : Base {
+    template<size_t Capacity, typename Storage>
+    using queue = QueueMarks<Capacity, Storage>;
+};
+
+// the common venue shapes
+
+// dense tick ladder and sequential ids - the default book
+using DenseTraits = BookTraits;
+
+// dense ladder of 32-byte orders: half the pool, 32-bit ids and qty
+struct SlotTraits : BookTraits {
+    template<int64_t MaxPrice, typename Storage>
+    using ladder = SlotLadder<MaxPrice, Storage>;
+};
+
+// sparse window ladder and hashed ids, for wide price ranges and venue-assigned ids
+struct SparseTraits : BookTraits {
+    template<size_t Capacity, typename Storage, typename O>
+    using index = SwissIndex<Capacity, Storage, O>;
+    template<int64_t MaxPrice, typename Storage>
+    using ladder = WindowLadder<MaxPrice, Storage>;
+};
+
+// sparse ladder and hashed ids on huge pages
+struct MappedSparseTraits : SparseTraits {
+    using storage = MappedStorage<>;
+};
+
+// many symbols per core: pool, levels and index carved from the current Arena
+// slim levels and a pointer index are all zero when empty, so a book only
+// commits the pages its orders and prices touch
+struct ArenaTraits : BookTraits {
+    using storage = ArenaStorage;
+    template<int64_t MaxPrice, typename Storage>
+    using ladder = CompactLadder<MaxPrice, Storage>;
+};
+
+// arena books on one shard drawing order nodes from a shared depot
+// max_orders sizes the depot, so it is provisioned for the shard, not per symbol
+struct ShardTraits : ArenaTraits {
+    template<typename O, size_t Capacity, typename Storage, typename Idx>
+    using pool = MagazinePool<O, Capacity, Storage, Idx>;
+};
+
+} // namespace ob
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "types.hpp"
+#include "fill_listener.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace ob {
+
+// new aggregate of one price level - an L2 delta; qty 0 means the level is gone
+struct LevelUpdate {
+    Price price;
+    Qty qty;
+    uint32_t count;       // resting orders at the level
+    Side side;
+};
+
+// optional listener hook: OrderBook calls on_level(update) whenever an
+// add/cancel/match/modify changes a level's aggregate, after the change
+template<typename L>
+concept DepthListener = requires(L& l, const LevelUpdate& u) {
+    { l.on_level(u) } noexcept;
+};
+
+// listener that coalesces level changes into a caller-provided span
+// one entry per (side, price) touched since the last clear(), holding its
+// latest aggregate - a batch that hits a level ten times emits it once.
+// levels past the end of the span are counted in dropped(); a consumer that
+// sees drops should resync from a full snapshot
+// fills pass through to Inner
+template<int64_t MaxPrice, FillListener Inner = NullListener>
+class DepthPublisher {
+    std::span<LevelUpdate> buf_;
+    size_t cnt_ = 0;
+    size_t dropped_ = 0;
+    size_t changes_ = 0;
+
+    // (price, side) -> 1 + position in buf_, 0 = clean; allocated once up front
+    std::vector<uint32_t> slot_;
+
+    [[no_unique_address]] Inner inner_{};
+
+    [[nodiscard]] static constexpr size_t key(const LevelUpdate& u) noexcept {
+        return static_cast<size_t>(u.price.raw()) * 2 + static_cast<size_t>(u.side);
+    }
+
+public:
+    DepthPublisher() : slot_(2 * static_cast<size_t>(MaxPrice + 1)) {}
+    explicit DepthPublisher(std::span<LevelUpdate> buf, Inner inner = Inner{})
+        : buf_(buf), slot_(2 * static_cast<size_t>(MaxPrice + 1)), inner_(std::move(inner)) {}
+
+    void on_fill(const Fill& f) noexcept { inner_.on_fill(f); }
+
+    void on_level(const LevelUpdate& u) noexcept {
+        ++changes_;
+        uint32_t& s = slot_[key(u)];
+        if (s != 0) [[likely]] {
+            buf_[s - 1] = u;
+        } else if (cnt_ < buf_.size()) [[likely]] {
+            buf_[cnt_] = u;
+            s = static_cast<uint32_t>(++cnt_);
+        } else {
+            ++dropped_;
+        }
+    }
+
+    // coalesced updates since the last clear, in first-touch order
+    [[nodiscard]] std::span<const LevelUpdate> updates() const noexcept { return buf_.first(cnt_); }
+
+    // start the next batch - o(updates), not o(levels)
+    void clear() noexcept {
+        for (size_t i = 0; i < cnt_; ++i) slot_[key(buf_[i])] = 0;
+        cnt_ = 0;
+        dropped_ = 0;
+        changes_ = 0;
+    }
+
+    // point at a new destination and start over
+    void reset(std::span<LevelUpdate> buf) noexcept {
+        clear();
+        buf_ = buf;
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return cnt_; }
+    [[nodiscard]] size_t dropped() const noexcept { return dropped_; }
+    [[nodiscard]] size_t changes() const noexcept { return changes_; }   // before coalescing
+    [[nodiscard]] bool empty() const noexcept { return cnt_ == 0; }
+
+    [[nodiscard]] Inner& inner() noexcept { return inner_; }
+};
+
+// a publisher only builds fills when the wrapped listener wants them
+template<int64_t MaxPrice, typename Inner>
+inline constexpr bool LISTENS<DepthPublisher<MaxPrice, Inner>> = LISTENS<Inner>;
+
+static_assert(FillListener<DepthPublisher<100>>);
+static_assert(DepthListener<DepthPublisher<100>>);
+
+} // namespace ob
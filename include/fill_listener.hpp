@@ -0,0 +1,90 @@
+#pragma once
+
+#include "types.hpp"
+#include <concepts>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+
+namespace ob {
+
+// execution report for matching - one per passive order touched
+struct Fill {
+    OrderId passive_id;
+    OrderId aggressor_id;
+    Qty qty;
+    Price price;          // passive (resting) price
+    Timestamp ts;         // aggressor timestamp
+};
+
+// compile-time fill hook for OrderBook - invoked inline from match_level
+template<typename L>
+concept FillListener = requires(L& l, const Fill& f) {
+    { l.on_fill(f) } noexcept;
+};
+
+// default listener - no fills are built or reported
+struct NullListener {
+    void on_fill(const Fill&) noexcept {}
+};
+
+// self-trade prevention report - the aggressor met a resting order of its own
+// participant; nothing traded, each side lost the qty given here
+struct SelfTrade {
+    OrderId passive_id;
+    OrderId aggressor_id;
+    Qty passive_qty;      // cancelled from the resting order
+    Qty aggressor_qty;    // cancelled from the aggressor
+    Price price;          // passive (resting) price
+};
+
+// optional hook for a listener that reports stp cancels
+template<typename L>
+concept StpListener = requires(L& l, const SelfTrade& s) {
+    { l.on_self_trade(s) } noexcept;
+};
+
+// true when a listener actually observes fills
+template<typename L>
+inline constexpr bool LISTENS = !std::is_same_v<L, NullListener>;
+
+// batched sink - appends fills into a caller-provided span, no allocation
+// fills past the end of the span are counted in dropped() and discarded
+class FillBuffer {
+    std::span<Fill> buf_;
+    size_t cnt_ = 0;
+    size_t dropped_ = 0;
+
+public:
+    FillBuffer() noexcept = default;
+    explicit FillBuffer(std::span<Fill> buf) noexcept : buf_(buf) {}
+
+    void on_fill(const Fill& f) noexcept {
+        if (cnt_ < buf_.size()) [[likely]] {
+            buf_[cnt_++] = f;
+        } else {
+            ++dropped_;
+        }
+    }
+
+    // point at a new destination and start over
+    void reset(std::span<Fill> buf) noexcept {
+        buf_ = buf;
+        clear();
+    }
+
+    void clear() noexcept {
+        cnt_ = 0;
+        dropped_ = 0;
+    }
+
+    [[nodiscard]] std::span<const Fill> fills() const noexcept { return buf_.first(cnt_); }
+    [[nodiscard]] size_t size() const noexcept { return cnt_; }
+    [[nodiscard]] size_t dropped() const noexcept { return dropped_; }
+    [[nodiscard]] bool empty() const noexcept { return cnt_ == 0; }
+};
+
+static_assert(FillListener<NullListener>);
+static_assert(FillListener<FillBuffer>);
+
+} // namespace ob
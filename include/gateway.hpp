@@ -0,0 +1,518 @@
+#pragma once
+
+#include "types.hpp"
+#include "fill_listener.hpp"
+#include "depth_feed.hpp"
+#include "replay.hpp"
+#include "spsc_ring.hpp"
+#include "timer.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+
+namespace ob {
+
+// a pipeline stage as a coroutine, run only by a StageLoop
+// a stage suspends on a Wait - data to read, room to write, or just its
+// turn - and the loop polls that wait before resuming it, so a blocked
+// stage costs one poll per pass and never an os wakeup
+class Stage {
+public:
+    struct Wait {
+        bool (*ready)(Wait*) noexcept;
+    };
+
+    struct promise_type {
+        Wait* wait = nullptr;
+
+        Stage get_return_object() noexcept {
+            return Stage{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    using handle = std::coroutine_handle<promise_type>;
+
+    // back of the queue: lets the other stages on this loop take a turn
+    struct Yield : Wait {
+        Yield() noexcept : Wait{[](Wait*) noexcept { return true; }} {}
+        bool await_ready() noexcept { return false; }
+        void await_suspend(handle h) noexcept { h.promise().wait = this; }
+        void await_resume() noexcept {}
+    };
+
+    // suspend until pred() holds
+    template<typename Pred>
+    struct Until : Wait {
+        Pred pred;
+        explicit Until(Pred p) noexcept
+            : Wait{[](Wait* w) noexcept { return static_cast<Until*>(w)->pred(); }}, pred(std::move(p)) {}
+        bool await_ready() noexcept { return pred(); }
+        void await_suspend(handle h) noexcept { h.promise().wait = this; }
+        void await_resume() noexcept {}
+    };
+
+    [[nodiscard]] static Yield yield() noexcept { return {}; }
+    template<typename Pred>
+    [[nodiscard]] static Until<Pred> until(Pred pred) noexcept { return Until<Pred>(std::move(pred)); }
+
+    explicit Stage(handle h) noexcept : h_(h) {}
+    Stage(Stage&& o) noexcept : h_(std::exchange(o.h_, {})) {}
+    Stage& operator=(Stage&& o) noexcept {
+        if (this != &o) {
+            if (h_) h_.destroy();
+            h_ = std::exchange(o.h_, {});
+        }
+        return *this;
+    }
+    Stage(const Stage&) = delete;
+    Stage& operator=(const Stage&) = delete;
+    ~Stage() {
+        if (h_) h_.destroy();
+    }
+
+    // resume if what the stage waits on is ready; false if it was not
+    bool step() noexcept {
+        Wait*& w = h_.promise().wait;
+        if (w != nullptr && !w->ready(w)) return false;
+        w = nullptr;
+        h_.resume();
+        return true;
+    }
+
+    [[nodiscard]] bool done() const noexcept { return h_.done(); }
+
+private:
+    handle h_;
+};
+
+// spsc ring between two stages, closed by the producer when it is finished
+// send suspends the producer while the ring is full - that is the
+// backpressure: a slow stage stalls everything upstream of it, never drops
+template<typename T, size_t Capacity>
+class Channel {
+    SpscRing<T, Capacity> ring_;
+    alignas(64) std::atomic<bool> closed_{false};
+
+public:
+    // every item, suspending while the ring is full
+    struct Send : Stage::Wait {
+        Channel& ch;
+        std::span<const T> rest;
+
+        Send(Channel& c, std::span<const T> items) noexcept
+            : Stage::Wait{[](Stage::Wait* w) noexcept { return static_cast<Send*>(w)->push(); }},
+              ch(c), rest(items) {}
+        [[nodiscard]] bool push() noexcept {
+            rest = rest.subspan(ch.ring_.try_push_bulk(rest));
+            return rest.empty();
+        }
+        bool await_ready() noexcept { return push(); }
+        void await_suspend(Stage::handle h) noexcept { h.promise().wait = this; }
+        void await_resume() noexcept {}
+    };
+
+    // up to out.size() items, suspending while the ring is empty
+    // 0 once the producer closed the channel and the ring is drained
+    struct Recv : Stage::Wait {
+        Channel& ch;
+        std::span<T> out;
+        size_t n = 0;
+
+        Recv(Channel& c, std::span<T> dst) noexcept
+            : Stage::Wait{[](Stage::Wait* w) noexcept { return static_cast<Recv*>(w)->pop(); }},
+              ch(c), out(dst) {}
+        [[nodiscard]] bool pop() noexcept {
+            n = ch.ring_.pop_bulk(out);
+            if (n != 0) return true;
+            if (!ch.closed_.load(std::memory_order_acquire)) return false;
+            n = ch.ring_.pop_bulk(out);   // items sent before close
+            return true;
+        }
+        bool await_ready() noexcept { return pop(); }
+        void await_suspend(Stage::handle h) noexcept { h.promise().wait = this; }
+        [[nodiscard]] size_t await_resume() noexcept { return n; }
+    };
+
+    [[nodiscard]] Send send(std::span<const T> items) noexcept { return Send(*this, items); }
+    [[nodiscard]] Recv recv(std::span<T> out) noexcept { return Recv(*this, out); }
+
+    // without suspending, for a stage that reads more than one channel
+    [[nodiscard]] size_t try_recv(std::span<T> out) noexcept { return ring_.pop_bulk(out); }
+    // without suspending, from code that cannot: how many of items went in
+    [[nodiscard]] size_t try_send(std::span<const T> items) noexcept { return ring_.try_push_bulk(items); }
+
+    // producer: nothing more will be sent
+    void close() noexcept { closed_.store(true, std::memory_order_release); }
+    // only while neither side is running
+    void reopen() noexcept { closed_.store(false, std::memory_order_relaxed); }
+
+    // closed and drained; closed is read first, so nothing sent before close is missed
+    [[nodiscard]] bool finished() const noexcept {
+        return closed_.load(std::memory_order_acquire) && ring_.empty();
+    }
+    [[nodiscard]] bool empty() const noexcept { return ring_.empty(); }
+};
+
+// round-robin scheduler for the stages on one thread
+class StageLoop {
+    std::vector<Stage> stages_;
+
+    static void backoff(unsigned& spins) noexcept {
+        if (++spins < 64) {
+            __builtin_ia32_pause();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+public:
+    void spawn(Stage s) { stages_.push_back(std::move(s)); }
+
+    // every stage gets one turn; false once all of them have finished
+    bool poll(size_t& ran) noexcept {
+        bool alive = false;
+        for (Stage& s : stages_) {
+            if (s.done()) continue;
+            if (s.step()) ++ran;
+            alive |= !s.done();
+        }
+        return alive;
+    }
+
+    // until every stage returns; backs off only when a whole pass is blocked
+    void run() noexcept {
+        unsigned spins = 0;
+        size_t ran = 0;
+        while (poll(ran)) {
+            if (ran == 0) {
+                backoff(spins);
+            } else {
+                spins = 0;
+            }
+            ran = 0;
+        }
+        stages_.clear();
+    }
+};
+
+// pre-trade limits, checked before a message reaches the book
+// malformed records never pass, cancels always do; executes are only held to max_qty
+struct RiskLimits {
+    Qty max_qty{std::numeric_limits<int64_t>::max()};
+    Price min_price{0};                                  // price collar
+    Price max_price{std::numeric_limits<int64_t>::max()};
+    int64_t max_notional = std::numeric_limits<int64_t>::max();   // qty * price, in ticks
+};
+
+enum class RiskCheck : uint8_t {
+    Ok = 0,
+    Qty = 1,
+    Price = 2,
+    Notional = 3,
+    Malformed = 4       // unknown record or ord_type, see well_formed
+};
+
+inline constexpr size_t RISK_CHECKS = 5;
+
+[[nodiscard]] inline RiskCheck check_risk(const RiskLimits& lim, const Msg& m) noexcept {
+    if (!well_formed(m)) [[unlikely]] return RiskCheck::Malformed;
+    // cancels and session changes carry no order to hold to limits
+    if (m.type == MsgType::Cancel || m.type == MsgType::Auction || m.type == MsgType::Uncross) return RiskCheck::Ok;
+    if (m.qty > lim.max_qty) return RiskCheck::Qty;
+    if (m.type == MsgType::Execute || m.ord_type == OrdType::Market) return RiskCheck::Ok;
+    if (m.price < lim.min_price || m.price > lim.max_price) return RiskCheck::Price;
+    // qty <= max_qty and price <= max_price, but the product can still overflow
+    if (m.price.raw() != 0 && m.qty.raw() > lim.max_notional / m.price.raw()) return RiskCheck::Notional;
+    return RiskCheck::Ok;
+}
+
+// book listener for a gateway: fills and level changes collect here until
+// the match stage ships them to the publisher after each batch
+// fixed capacity, filled from inside the match - nothing allocates there. a
+// sweep can make any number of fills (an iceberg refills), so a full tap is
+// spilled on the spot by the gateway bound to it; only a tap no gateway
+// drains counts what it cannot hold as dropped
+inline constexpr size_t TAP_CAPACITY = 4096;
+
+class GatewayTap {
+public:
+    // ships everything the tap holds and clears it
+    using Spill = void (*)(void* ctx) noexcept;
+
+private:
+    std::array<Fill, TAP_CAPACITY> fills_{};
+    std::array<LevelUpdate, TAP_CAPACITY> levels_{};
+    size_t nf_ = 0;
+    size_t nl_ = 0;
+    size_t dropped_ = 0;
+    Spill spill_ = nullptr;
+    void* ctx_ = nullptr;
+
+public:
+    void bind(Spill spill, void* ctx) noexcept {
+        spill_ = spill;
+        ctx_ = ctx;
+    }
+
+    void on_fill(const Fill& f) noexcept {
+        if (nf_ == fills_.size() && spill_ != nullptr) [[unlikely]] spill_(ctx_);
+        if (nf_ < fills_.size()) [[likely]] {
+            fills_[nf_++] = f;
+        } else {
+            ++dropped_;
+        }
+    }
+    void on_level(const LevelUpdate& u) noexcept {
+        if (nl_ == levels_.size() && spill_ != nullptr) [[unlikely]] spill_(ctx_);
+        if (nl_ < levels_.size()) [[likely]] {
+            levels_[nl_++] = u;
+        } else {
+            ++dropped_;
+        }
+    }
+
+    [[nodiscard]] std::span<const Fill> fills() const noexcept { return std::span(fills_).first(nf_); }
+    [[nodiscard]] std::span<const LevelUpdate> levels() const noexcept { return std::span(levels_).first(nl_); }
+    [[nodiscard]] bool empty() const noexcept { return nf_ == 0 && nl_ == 0; }
+    [[nodiscard]] size_t dropped() const noexcept { return dropped_; }     // since the last clear
+    void clear() noexcept {
+        nf_ = 0;
+        nl_ = 0;
+        dropped_ = 0;
+    }
+};
+
+static_assert(FillListener<GatewayTap> && DepthListener<GatewayTap>);
+
+// message in flight, stamped when it came off the wire
+struct Inbound {
+    Msg msg;
+    Timestamp ts;
+};
+
+struct GatewayStats {
+    size_t decoded = 0;
+    size_t routed = 0;                                  // passed risk, applied to the book
+    std::array<size_t, RISK_CHECKS> rejected{};         // by RiskCheck
+    size_t fills = 0;
+    size_t levels = 0;
+    size_t spills = 0;                                  // full taps shipped from inside a match
+};
+
+// pipelined front end: decode -> pre-trade risk -> book -> publish
+// each stage is a coroutine and the stages talk through spsc rings, so the
+// same pipeline runs cooperatively on one thread (run) or with a thread per
+// stage (run_threads). records are replay.hpp's wire format and are stamped
+// with the tsc per batch on decode; fills carry that stamp to the sink
+// Book's listener must be a GatewayTap, bound to the gateway while it lives
+// so a sweep past the tap spills into the rings. Sink takes on_fill and, if it has
+// one, on_level - always from the publish stage's thread
+// a stage moves up to Batch messages per turn: more is throughput, less is latency
+template<typename Book, typename Sink, size_t RingSize = 1024, size_t Batch = 64>
+class Gateway {
+    static_assert(std::is_same_v<std::remove_cvref_t<decltype(std::declval<Book&>().listener())>, GatewayTap>,
+                  "the book's listener must be a GatewayTap");
+    static_assert(FillListener<Sink>);
+
+    Book& book_;
+    Sink& sink_;
+    RiskLimits limits_;
+    GatewayStats stats_{};
+
+    Channel<Inbound, RingSize> decoded_;
+    Channel<Inbound, RingSize> checked_;
+    Channel<Fill, RingSize> fills_;
+    Channel<LevelUpdate, RingSize> levels_;
+    bool threaded_ = false;             // which way a spill makes room, set per run
+
+    static void pin(int cpu) noexcept {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        (void)pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    Stage decode_stage(std::span<const std::byte> bytes) {
+        std::array<Inbound, Batch> out;
+        size_t records = bytes.size() / REPLAY_RECORD;
+        for (size_t i = 0; i < records;) {
+            size_t n = std::min(Batch, records - i);
+            Timestamp now{rdtsc()};
+            for (size_t k = 0; k < n; ++k) {
+                out[k] = Inbound{decode(bytes.data() + (i + k) * REPLAY_RECORD), now};
+            }
+            i += n;
+            stats_.decoded += n;
+            co_await decoded_.send(std::span<const Inbound>(out.data(), n));
+            co_await Stage::yield();
+        }
+        decoded_.close();
+    }
+
+    Stage risk_stage() {
+        std::array<Inbound, Batch> in;
+        std::array<Inbound, Batch> out;
+        while (size_t n = co_await decoded_.recv(in)) {
+            size_t k = 0;
+            for (size_t i = 0; i < n; ++i) {
+                RiskCheck r = check_risk(limits_, in[i].msg);
+                if (r == RiskCheck::Ok) [[likely]] {
+                    out[k++] = in[i];
+                } else {
+                    ++stats_.rejected[static_cast<size_t>(r)];
+                }
+            }
+            if (k != 0) co_await checked_.send(std::span<const Inbound>(out.data(), k));
+            co_await Stage::yield();
+        }
+        checked_.close();
+    }
+
+    Stage match_stage() {
+        std::array<Inbound, Batch> in;
+        GatewayTap& tap = book_.listener();
+        while (size_t n = co_await checked_.recv(in)) {
+            for (size_t i = 0; i < n; ++i) dispatch(book_, in[i].msg, in[i].ts);
+            stats_.routed += n;
+            co_await fills_.send(tap.fills());
+            co_await levels_.send(tap.levels());
+            tap.clear();
+            co_await Stage::yield();
+        }
+        fills_.close();
+        levels_.close();
+    }
+
+    // everything in the fill and level rings to the sink; how many went
+    // one message can fill many orders: drain all of it each turn, or the
+    // fill ring backs up into the book under a sweep
+    size_t publish_ready() {
+        std::array<Fill, Batch> fills;
+        std::array<LevelUpdate, Batch> levels;
+        size_t total = 0;
+        while (true) {
+            size_t nf = fills_.try_recv(fills);
+            size_t nl = levels_.try_recv(levels);
+            if (nf == 0 && nl == 0) break;
+            for (size_t i = 0; i < nf; ++i) sink_.on_fill(fills[i]);
+            if constexpr (DepthListener<Sink>) {
+                for (size_t i = 0; i < nl; ++i) sink_.on_level(levels[i]);
+            }
+            stats_.fills += nf;
+            stats_.levels += nl;
+            total += nf + nl;
+        }
+        return total;
+    }
+
+    // into a ring from inside the match, where nothing can suspend: with a
+    // thread per stage the publisher makes room; on one thread the match
+    // stage is the only one running, so it publishes what is queued itself
+    template<typename T>
+    void push_all(Channel<T, RingSize>& ch, std::span<const T> items) noexcept {
+        while (!(items = items.subspan(ch.try_send(items))).empty()) {
+            if (threaded_) {
+                std::this_thread::yield();
+            } else {
+                (void)publish_ready();
+            }
+        }
+    }
+
+    // the tap filled up mid-match: ship it now, behind what is already queued
+    static void spill(void* self) noexcept {
+        auto* gw = static_cast<Gateway*>(self);
+        GatewayTap& tap = gw->book_.listener();
+        gw->push_all(gw->fills_, tap.fills());
+        gw->push_all(gw->levels_, tap.levels());
+        tap.clear();
+        ++gw->stats_.spills;
+    }
+
+    Stage publish_stage() {
+        while (true) {
+            size_t total = publish_ready();
+            if (total != 0) {
+                co_await Stage::yield();
+            } else if (fills_.finished() && levels_.finished()) {
+                break;
+            } else {
+                co_await Stage::until([this] { return !fills_.empty() || !levels_.empty() ||
+                                                      (fills_.finished() && levels_.finished()); });
+            }
+        }
+    }
+
+    void reopen() noexcept {
+        decoded_.reopen();
+        checked_.reopen();
+        fills_.reopen();
+        levels_.reopen();
+    }
+
+public:
+    Gateway(Book& book, Sink& sink, RiskLimits limits = RiskLimits{}) noexcept
+        : book_(book), sink_(sink), limits_(limits) {
+        book_.listener().bind(&Gateway::spill, this);
+    }
+    ~Gateway() { book_.listener().bind(nullptr, nullptr); }
+
+    Gateway(const Gateway&) = delete;
+    Gateway& operator=(const Gateway&) = delete;
+
+    // every record in bytes through all four stages on the calling thread
+    void run(std::span<const std::byte> bytes) {
+        reopen();
+        threaded_ = false;
+        StageLoop loop;
+        loop.spawn(decode_stage(bytes));
+        loop.spawn(risk_stage());
+        loop.spawn(match_stage());
+        loop.spawn(publish_stage());
+        loop.run();
+    }
+
+    // the same with a thread per stage; cpus[i] pins stage i, in pipeline order
+    // returns once the last fill is published
+    void run_threads(std::span<const std::byte> bytes, std::span<const int> cpus = {}) {
+        reopen();
+        threaded_ = true;
+        std::array<StageLoop, 4> loops;
+        loops[0].spawn(decode_stage(bytes));
+        loops[1].spawn(risk_stage());
+        loops[2].spawn(match_stage());
+        loops[3].spawn(publish_stage());
+        std::array<std::jthread, 4> threads;
+        for (size_t i = 0; i < loops.size(); ++i) {
+            int cpu = i < cpus.size() ? cpus[i] : -1;
+            threads[i] = std::jthread([&loops, i, cpu] {
+                if (cpu >= 0) pin(cpu);
+                loops[i].run();
+            });
+        }
+    }
+
+    void set_limits(const RiskLimits& limits) noexcept { limits_ = limits; }
+    [[nodiscard]] const RiskLimits& limits() const noexcept { return limits_; }
+
+    // stage counters; only read between runs
+    [[nodiscard]] const GatewayStats& stats() const noexcept { return stats_; }
+};
+
+} // namespace ob
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "types.hpp"
+#include "fill_listener.hpp"
+#include "top_of_book.hpp"
+#include "depth_feed.hpp"
+#include "op.hpp"
+#include "timer.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace ob {
+
+// optional listener hook: OrderBook calls on_latency(type, cycles) at the end
+// of every add/cancel/match/modify with the rdtsc cycles the op took, publish
+// included. books whose listener lacks it never read the clock
+template<typename L>
+concept LatencyListener = requires(L& l, OpType t, uint64_t cycles) {
+    { l.on_latency(t, cycles) } noexcept;
+};
+
+inline constexpr size_t OP_TYPES = 4;
+
+// where inside an op the book is: id index and pool, level list and
+// aggregate, stepping best price past emptied levels, the matching loop
+enum class Phase : uint8_t {
+    Lookup = 0,
+    Level,
+    Recovery,
+    Match
+};
+
+inline constexpr size_t PHASES = 4;
+
+// optional listener hook for profilers: OrderBook calls on_op_begin(type) on
+// entry to every add/cancel/match/modify, on_phase(p) each time the op moves
+// into another phase and on_op_end() on exit. everything between two calls
+// belongs to the phase named by the first. compiled out for other listeners
+template<typename L>
+concept PhaseListener = requires(L& l, OpType t, Phase p) {
+    { l.on_op_begin(t) } noexcept;
+    { l.on_phase(p) } noexcept;
+    { l.on_op_end() } noexcept;
+};
+
+// listener that keeps one cycle histogram per op type, for p99.9s out of a
+// live engine. fills, tops and level updates pass through to Inner
+template<FillListener Inner = NullListener, typename Hist = LatencyHistogram<>>
+class OpLatency {
+    std::array<Hist, OP_TYPES> hist_{};
+    [[no_unique_address]] Inner inner_{};
+
+public:
+    OpLatency() noexcept = default;
+    explicit OpLatency(Inner inner) noexcept : inner_(std::move(inner)) {}
+
+    void on_fill(const Fill& f) noexcept { inner_.on_fill(f); }
+    void on_top(const Bbo& b) noexcept requires TopListener<Inner> { inner_.on_top(b); }
+    void on_level(const LevelUpdate& u) noexcept requires DepthListener<Inner> { inner_.on_level(u); }
+
+    void on_latency(OpType t, uint64_t cycles) noexcept {
+        hist_[static_cast<size_t>(t)].record(cycles);
+    }
+
+    [[nodiscard]] const Hist& histogram(OpType t) const noexcept { return hist_[static_cast<size_t>(t)]; }
+
+    // every op type in one histogram
+    [[nodiscard]] Hist all() const noexcept {
+        Hist h;
+        for (const Hist& x : hist_) h.merge(x);
+        return h;
+    }
+
+    void clear() noexcept {
+        for (Hist& h : hist_) h.clear();
+    }
+
+    [[nodiscard]] Inner& inner() noexcept { return inner_; }
+};
+
+// timing alone doesn't make the book build fills
+template<typename Inner, typename Hist>
+inline constexpr bool LISTENS<OpLatency<Inner, Hist>> = LISTENS<Inner>;
+
+static_assert(FillListener<OpLatency<>>);
+static_assert(LatencyListener<OpLatency<>>);
+
+} // namespace ob
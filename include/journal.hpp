@@ -0,0 +1,318 @@
+#pragma once
+
+#include "types.hpp"
+#include "replay.hpp"
+#include "snapshot.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace ob {
+
+// write-ahead journal of accepted book ops
+//
+// the matching thread encodes each op as a replay record (replay.hpp) into a
+// preallocated in-memory ring and publishes it with one release store - no
+// syscall, no lock, no allocation. a background writer thread group-commits
+// whatever has accumulated: once a segment's worth is pending, or the oldest
+// pending record has waited a commit interval, it appends the lot with one
+// pwrite, fdatasyncs, then rewrites the header count and syncs again.
+// the file is therefore always a valid replay file whose count covers only
+// durable records, and recovery is load_snapshot + replay (see recover below)
+//
+// records drop the order timestamp (it only feeds fill reports) and, like
+// to_msg, hold prices, qtys and peaks in 32 bits: JournaledBook refuses an
+// op with a wider one before the book sees it, so nothing is journaled
+// other than it was done
+
+inline constexpr size_t JOURNAL_SEGMENT = 4096;   // records, 128 KB per pwrite
+
+template<size_t RingRecords = (1 << 16)>
+class Journal {
+    static_assert(std::has_single_bit(RingRecords), "ring size must be a power of two");
+    static_assert(RingRecords >= JOURNAL_SEGMENT, "ring must hold a full segment");
+    static constexpr size_t MASK = RingRecords - 1;
+
+    // producer side
+    alignas(64) std::atomic<uint64_t> head_{0};      // records published
+    uint64_t cached_durable_ = 0;
+    uint64_t stalls_ = 0;                             // appends that waited for the writer
+    uint64_t dropped_ = 0;                            // appends lost after a write error
+
+    // writer side
+    alignas(64) std::atomic<uint64_t> durable_{0};   // records on disk, header included
+    std::atomic<uint64_t> commits_{0};
+    std::atomic<int> error_{0};                      // errno of the first failed write
+
+    // shared controls
+    alignas(64) std::atomic<uint64_t> flush_to_{0};  // commit up to here now, partial segment or not
+    std::atomic<bool> stop_{false};
+
+    std::unique_ptr<std::byte[]> ring_;
+    std::chrono::microseconds interval_;
+
+    // file state - swapped by rotate() only while the writer has nothing to
+    // write; the writer reads it after acquiring a head_ past durable_
+    int fd_ = -1;
+    uint64_t base_ = 0;                              // first seq in the current file
+
+    std::thread writer_;
+
+    [[nodiscard]] static int open_file(const std::string& path) {
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) throw std::system_error(errno, std::generic_category(), path);
+        std::byte header[REPLAY_HEADER]{};
+        std::memcpy(header, REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+        if (::pwrite(fd, header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+            ::fdatasync(fd) != 0) {
+            int err = errno != 0 ? errno : EIO;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), path);
+        }
+        return fd;
+    }
+
+    // [from, to) of the ring to the file; false on a short or failed write
+    [[nodiscard]] bool write_range(uint64_t from, uint64_t to) noexcept {
+        while (from < to) {
+            size_t slot = from & MASK;
+            size_t n = std::min<uint64_t>(to - from, RingRecords - slot);
+            size_t len = n * REPLAY_RECORD;
+            auto off = static_cast<off_t>(REPLAY_HEADER + (from - base_) * REPLAY_RECORD);
+            if (::pwrite(fd_, ring_.get() + slot * REPLAY_RECORD, len, off) != static_cast<ssize_t>(len)) {
+                return false;
+            }
+            from += n;
+        }
+        return true;
+    }
+
+    // one group commit of [from, to)
+    [[nodiscard]] bool commit(uint64_t from, uint64_t to) noexcept {
+        std::byte count[sizeof(uint64_t)];
+        detail::store_le<uint64_t>(count, to - base_);
+        return write_range(from, to) && ::fdatasync(fd_) == 0 &&
+               ::pwrite(fd_, count, sizeof(count), 8) == static_cast<ssize_t>(sizeof(count)) &&
+               ::fdatasync(fd_) == 0;
+    }
+
+    void run() noexcept {
+        uint64_t done = durable_.load(std::memory_order_relaxed);
+        auto pending_since = std::chrono::steady_clock::time_point{};
+        for (;;) {
+            bool stopping = stop_.load(std::memory_order_acquire);
+            bool flush = flush_to_.load(std::memory_order_acquire) > done;
+            uint64_t h = head_.load(std::memory_order_acquire);
+            if (h == done) {
+                if (stopping) return;
+                pending_since = {};
+                std::this_thread::sleep_for(interval_ / 4);
+                continue;
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (pending_since == std::chrono::steady_clock::time_point{}) pending_since = now;
+            if (h - done < JOURNAL_SEGMENT && !flush && !stopping && now - pending_since < interval_) {
+                std::this_thread::sleep_for(interval_ / 4);
+                continue;
+            }
+
+            if (error_.load(std::memory_order_relaxed) == 0 && !commit(done, h)) [[unlikely]] {
+                error_.store(errno != 0 ? errno : EIO, std::memory_order_release);
+            }
+            // after an error the records are released unwritten so the
+            // producer never blocks on a dead disk; error() reports it
+            done = h;
+            pending_since = {};
+            commits_.fetch_add(1, std::memory_order_relaxed);
+            durable_.store(h, std::memory_order_release);
+        }
+    }
+
+    void wait_durable(uint64_t seq) noexcept {
+        while (durable_.load(std::memory_order_acquire) < seq) std::this_thread::yield();
+    }
+
+public:
+    // creates (truncates) path and starts the writer; throws std::system_error
+    explicit Journal(const std::string& path,
+                     std::chrono::microseconds commit_interval = std::chrono::microseconds{1000})
+        : ring_(std::make_unique<std::byte[]>(RingRecords * REPLAY_RECORD))   // zeroed: no faults later
+        , interval_(commit_interval)
+        , fd_(open_file(path)) {
+        writer_ = std::thread([this] { run(); });
+    }
+
+    // commits everything appended, then stops the writer
+    ~Journal() {
+        stop_.store(true, std::memory_order_release);
+        writer_.join();
+        ::close(fd_);
+    }
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // matching thread: one record; waits only when the ring is a full lap
+    // ahead of the disk
+    void append(const Msg& m) noexcept {
+        uint64_t h = head_.load(std::memory_order_relaxed);
+        if (h - cached_durable_ == RingRecords) [[unlikely]] {
+            ++stalls_;
+            flush_to_.store(h, std::memory_order_release);
+            wait_durable(h - RingRecords + 1);
+            cached_durable_ = durable_.load(std::memory_order_acquire);
+        }
+        if (error_.load(std::memory_order_relaxed) != 0) [[unlikely]] ++dropped_;
+        encode(ring_.get() + (h & MASK) * REPLAY_RECORD, m);
+        head_.store(h + 1, std::memory_order_release);
+    }
+
+    // matching thread: commit the partial segment now and wait until every
+    // record appended so far is durable; false if the writer hit an error
+    [[nodiscard]] bool flush() noexcept {
+        uint64_t h = head_.load(std::memory_order_relaxed);
+        flush_to_.store(h, std::memory_order_release);
+        wait_durable(h);
+        cached_durable_ = h;
+        return error() == 0;
+    }
+
+    // matching thread: flush, then continue in a new file at path; the old
+    // file is complete and closed. throws std::system_error
+    void rotate(const std::string& path) {
+        if (!flush()) throw std::system_error(error(), std::generic_category(), "journal");
+        int fd = open_file(path);
+        ::close(fd_);
+        fd_ = fd;
+        base_ = head_.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] uint64_t appended() const noexcept { return head_.load(std::memory_order_relaxed); }
+    [[nodiscard]] uint64_t durable() const noexcept { return durable_.load(std::memory_order_acquire); }
+    [[nodiscard]] uint64_t commits() const noexcept { return commits_.load(std::memory_order_relaxed); }
+    [[nodiscard]] uint64_t stalls() const noexcept { return stalls_; }
+    [[nodiscard]] uint64_t dropped() const noexcept { return dropped_; }
+    [[nodiscard]] int error() const noexcept { return error_.load(std::memory_order_acquire); }
+    [[nodiscard]] static constexpr size_t capacity() noexcept { return RingRecords; }
+};
+
+// book front end that journals every op that may have changed the book:
+// rejected adds/modifies, cancels of unknown ids and matches that traded
+// nothing are not logged, since replaying them would be a no-op
+template<typename Book, size_t RingRecords = (1 << 16)>
+class JournaledBook {
+    Book& book_;
+    Journal<RingRecords> journal_;
+
+    // what a replay record holds; negatives go on to the book, which refuses them
+    [[nodiscard]] static constexpr bool wire(int64_t v) noexcept { return v <= std::numeric_limits<uint32_t>::max(); }
+
+public:
+    JournaledBook(Book& book, const std::string& path,
+                  std::chrono::microseconds commit_interval = std::chrono::microseconds{1000})
+        : book_(book), journal_(path, commit_interval) {}
+
+    [[nodiscard]] AddResult add(OrderId id, Side side, Price px, Qty qty,
+                                OrdType type = OrdType::Limit, Timestamp ts = Timestamp{0}) noexcept {
+        if (!wire(px.raw())) [[unlikely]] return AddResult::InvalidPrice;
+        if (!wire(qty.raw())) [[unlikely]] return AddResult::InvalidQty;
+        AddResult r = book_.add(id, side, px, qty, type, ts);
+        // pool/level exhaustion comes after matching, so those adds may have traded
+        if (r == AddResult::Ok || r == AddResult::PoolExhausted || r == AddResult::LadderFull) [[likely]] {
+            journal_.append(Msg{MsgType::Add, side, type, qty, id, OrderId{0}, px});
+        }
+        return r;
+    }
+
+    [[nodiscard]] AddResult add_iceberg(OrderId id, Side side, Price px, Qty qty, Qty peak,
+                                        Timestamp ts = Timestamp{0}) noexcept {
+        if (!wire(px.raw())) [[unlikely]] return AddResult::InvalidPrice;
+        if (!wire(qty.raw()) || !wire(peak.raw())) [[unlikely]] return AddResult::InvalidQty;
+        AddResult r = book_.add_iceberg(id, side, px, qty, peak, ts);
+        if (r == AddResult::Ok || r == AddResult::PoolExhausted || r == AddResult::LadderFull) [[likely]] {
+            journal_.append(Msg{MsgType::Add, side, OrdType::Iceberg, qty, id, OrderId{0}, px, peak});
+        }
+        return r;
+    }
+
+    bool cancel(OrderId id) noexcept {
+        bool found = book_.cancel(id);
+        if (found) [[likely]] journal_.append(Msg{MsgType::Cancel, Side::Buy, OrdType::Limit, Qty{0}, id, OrderId{0}, Price{0}});
+        return found;
+    }
+
+    // a qty too wide to journal trades nothing
+    [[nodiscard]] Qty match(Side aggressor, Qty qty) noexcept {
+        if (!wire(qty.raw())) [[unlikely]] return qty;
+        Qty left = book_.match(aggressor, qty);
+        if (left != qty) [[likely]] {
+            journal_.append(Msg{MsgType::Execute, aggressor, OrdType::Market, qty, OrderId{0}, OrderId{0}, Price{0}});
+        }
+        return left;
+    }
+
+    [[nodiscard]] ModifyResult modify(OrderId id, Price px, Qty qty) noexcept {
+        if (!wire(px.raw())) [[unlikely]] return ModifyResult::InvalidPrice;
+        if (!wire(qty.raw())) [[unlikely]] return ModifyResult::InvalidQty;
+        ModifyResult r = book_.modify(id, px, qty);
+        // a LadderFull modify cancelled the order
+        if (r == ModifyResult::Ok || r == ModifyResult::LadderFull) [[likely]] {
+            journal_.append(Msg{MsgType::Replace, Side::Buy, OrdType::Limit, qty, id, id, px});
+        }
+        return r;
+    }
+
+    // call phases are journaled too, so recovery holds the same orders and
+    // uncrosses them at the same price
+    void begin_auction() noexcept {
+        book_.begin_auction();
+        journal_.append(Msg{MsgType::Auction, Side::Buy, OrdType::Limit, Qty{0}, OrderId{0}, OrderId{0}, Price{0}});
+    }
+
+    auto uncross(Timestamp ts = Timestamp{0}) noexcept {
+        auto r = book_.uncross(ts);
+        journal_.append(Msg{MsgType::Uncross, Side::Buy, OrdType::Limit, Qty{0}, OrderId{0}, OrderId{0}, Price{0}});
+        return r;
+    }
+
+    // snapshot the book and start a fresh journal from that point;
+    // recover(snapshot_path, journal_path) then rebuilds the current state
+    // false, writing nothing, while stops or icebergs rest or a call phase is
+    // open: a snapshot carries neither stops, reserves nor held orders, and the
+    // journal it replaces is their only copy
+    [[nodiscard]] bool checkpoint(const std::string& snapshot_path, const std::string& journal_path) {
+        if (book_.stop_count() != 0 || book_.iceberg_count() != 0 || book_.in_auction()) [[unlikely]] return false;
+        if (!journal_.flush()) throw std::system_error(journal_.error(), std::generic_category(), "journal");
+        write_snapshot(snapshot_path, book_);
+        journal_.rotate(journal_path);
+        return true;
+    }
+
+    [[nodiscard]] Book& book() noexcept { return book_; }
+    [[nodiscard]] Journal<RingRecords>& journal() noexcept { return journal_; }
+};
+
+// rebuild an empty book: restore the snapshot, then replay the journal written
+// since it; throws like SnapshotFile / ReplayFile
+template<typename Book>
+[[nodiscard]] inline RestoreResult recover(const std::string& snapshot_path,
+                                           const std::string& journal_path, Book& book) {
+    RestoreResult r = load_snapshot(snapshot_path, book);
+    if (r == RestoreResult::Ok) ReplayFile(journal_path).replay(book);
+    return r;
+}
+
+} // namespace ob
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+namespace ob {
+
+// hierarchical occupancy bitmap over [0, Bits)
+// leaf bit per price, each bit above summarises one 64-bit word below
+// set/clear o(1), next/prev occupied via tzcnt/lzcnt in at most 4 word scans
+template<size_t Bits>
+class LevelBitmap {
+    static constexpr size_t LEAF_WORDS = (Bits + 63) / 64;
+    static constexpr size_t MID_WORDS = (LEAF_WORDS + 63) / 64;
+    static constexpr size_t TOP_WORDS = (MID_WORDS + 63) / 64;
+    static_assert(TOP_WORDS <= 64, "LevelBitmap supports at most 2^24 positions");
+
+    std::array<uint64_t, LEAF_WORDS> leaf_{};
+    std::array<uint64_t, MID_WORDS> mid_{};
+    std::array<uint64_t, TOP_WORDS> top_{};
+    uint64_t root_ = 0;
+
+    static constexpr uint64_t bit(size_t b) noexcept { return uint64_t{1} << b; }
+
+    // bits strictly above b
+    static constexpr uint64_t above(size_t b) noexcept {
+        return b >= 63 ? 0 : ~uint64_t{0} << (b + 1);
+    }
+
+    // bits strictly below b
+    static constexpr uint64_t below(size_t b) noexcept {
+        return bit(b) - 1;
+    }
+
+    static constexpr size_t lowest(uint64_t w) noexcept {
+        return static_cast<size_t>(std::countr_zero(w));
+    }
+
+    static constexpr size_t highest(uint64_t w) noexcept {
+        return static_cast<size_t>(63 - std::countl_zero(w));
+    }
+
+    // r-th lowest set bit of w (0 = lowest), as a one-bit mask; w has more than r bits
+    static uint64_t low_bit(uint64_t w, size_t r) noexcept {
+#ifdef __BMI2__
+        return _pdep_u64(bit(r), w);
+#else
+        for (; r > 0; --r) w &= w - 1;
+        return w & -w;
+#endif
+    }
+
+    // descend from a non-empty mid word to the lowest/highest leaf position
+    [[nodiscard]] int64_t first_in_mid(size_t m) const noexcept {
+        size_t l = (m << 6) + lowest(mid_[m]);
+        return static_cast<int64_t>((l << 6) + lowest(leaf_[l]));
+    }
+
+    [[nodiscard]] int64_t last_in_mid(size_t m) const noexcept {
+        size_t l = (m << 6) + highest(mid_[m]);
+        return static_cast<int64_t>((l << 6) + highest(leaf_[l]));
+    }
+
+public:
+    [[nodiscard]] static constexpr int64_t size() noexcept { return static_cast<int64_t>(Bits); }
+
+    [[nodiscard]] bool test(int64_t pos) const noexcept {
+        auto p = static_cast<size_t>(pos);
+        return (leaf_[p >> 6] & bit(p & 63)) != 0;
+    }
+
+    [[nodiscard]] bool any() const noexcept { return root_ != 0; }
+
+    void set(int64_t pos) noexcept {
+        auto p = static_cast<size_t>(pos);
+        uint64_t& w = leaf_[p >> 6];
+        bool was_empty = w == 0;
+        w |= bit(p & 63);
+        if (!was_empty) [[likely]] return;  // summaries already set
+        mid_[p >> 12] |= bit((p >> 6) & 63);
+        top_[p >> 18] |= bit((p >> 12) & 63);
+        root_ |= bit(p >> 18);
+    }
+
+    void clear(int64_t pos) noexcept {
+        auto p = static_cast<size_t>(pos);
+        if ((leaf_[p >> 6] &= ~bit(p & 63)) != 0) [[likely]] return;
+        if ((mid_[p >> 12] &= ~bit((p >> 6) & 63)) != 0) return;
+        if ((top_[p >> 18] &= ~bit((p >> 12) & 63)) != 0) return;
+        root_ &= ~bit(p >> 18);
+    }
+
+    // lowest set position >= pos, or size() if none
+    [[nodiscard]] int64_t next(int64_t pos) const noexcept {
+        if (pos >= size()) [[unlikely]] return size();
+        auto p = static_cast<size_t>(pos < 0 ? 0 : pos);
+
+        size_t l = p >> 6;
+        uint64_t w = leaf_[l] & ~below(p & 63);
+        if (w != 0) [[likely]] return static_cast<int64_t>((l << 6) + lowest(w));
+
+        size_t m = l >> 6;
+        w = mid_[m] & above(l & 63);
+        if (w != 0) {
+            l = (m << 6) + lowest(w);
+            return static_cast<int64_t>((l << 6) + lowest(leaf_[l]));
+        }
+
+        size_t t = m >> 6;
+        w = top_[t] & above(m & 63);
+        if (w != 0) return first_in_mid((t << 6) + lowest(w));
+
+        w = root_ & above(t);
+        if (w == 0) return size();
+        t = lowest(w);
+        return first_in_mid((t << 6) + lowest(top_[t]));
+    }
+
+    // highest set position <= pos, or -1 if none
+    [[nodiscard]] int64_t prev(int64_t pos) const noexcept {
+        if (pos < 0) [[unlikely]] return -1;
+        auto p = static_cast<size_t>(pos >= size() ? size() - 1 : pos);
+
+        size_t l = p >> 6;
+        uint64_t w = leaf_[l] & ~above(p & 63);
+        if (w != 0) [[likely]] return static_cast<int64_t>((l << 6) + highest(w));
+
+        size_t m = l >> 6;
+        w = mid_[m] & below(l & 63);
+        if (w != 0) {
+            l = (m << 6) + highest(w);
+            return static_cast<int64_t>((l << 6) + highest(leaf_[l]));
+        }
+
+        size_t t = m >> 6;
+        w = top_[t] & below(m & 63);
+        if (w != 0) return last_in_mid((t << 6) + highest(w));
+
+        w = root_ & below(t);
+        if (w == 0) return -1;
+        t = highest(w);
+        return last_in_mid((t << 6) + highest(top_[t]));
+    }
+
+    // f(i, pos) for up to n set positions >= pos, i = rank from pos (0 = lowest)
+    // pops every bit of a leaf word before rescanning the summaries
+    template<typename F>
+    size_t for_each_up(int64_t pos, size_t n, F&& f) const noexcept {
+        size_t k = 0;
+        for (int64_t p = next(pos); k < n && p < size();) {
+            auto l = static_cast<size_t>(p) >> 6;
+            for (uint64_t w = leaf_[l] & ~below(static_cast<size_t>(p) & 63); w != 0 && k < n; w &= w - 1) {
+                f(k++, static_cast<int64_t>((l << 6) + lowest(w)));
+            }
+            p = next(static_cast<int64_t>((l + 1) << 6));
+        }
+        return k;
+    }
+
+    // f(i, pos) for up to n set positions <= pos, i = rank from pos (0 = highest)
+    // a word's bits are still popped lowest first - one-cycle blsr instead of
+    // an lzcnt chain - and ranked from the word's popcount
+    template<typename F>
+    size_t for_each_down(int64_t pos, size_t n, F&& f) const noexcept {
+        size_t k = 0;
+        for (int64_t p = prev(pos); k < n && p >= 0;) {
+            auto l = static_cast<size_t>(p) >> 6;
+            uint64_t w = leaf_[l] & ~above(static_cast<size_t>(p) & 63);
+            auto c = static_cast<size_t>(std::popcount(w));
+            size_t take = std::min(c, n - k);
+            if (take < c) w &= ~(low_bit(w, c - take) - 1);   // only the highest take bits
+            for (size_t i = k + take; w != 0; w &= w - 1) f(--i, static_cast<int64_t>((l << 6) + lowest(w)));
+            k += take;
+            p = prev(static_cast<int64_t>(l << 6) - 1);
+        }
+        return k;
+    }
+};
+
+} // namespace ob
@@ -1,33 +1,66 @@
 #pragma once
 
+#include "storage.hpp"
+#include <algorithm>
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <new>
 
 namespace ob {
 
+// blocks the pool grows by - storage that can prefault (ArenaStorage) commits
+// the next chunk as the frontier enters the current one
+inline constexpr size_t POOL_CHUNK_BYTES = size_t{16} << 10;
+
 // fixed-block pool with embedded free list
 // o(1) alloc/dealloc, no malloc in hot path
-template<typename T, size_t Capacity>
+// slots past the frontier have never been handed out and are never touched,
+// so an idle pool costs no memory beyond what its storage commits up front
+// (all of it for InlineStorage or a populated mapping, none for a lazy one)
+// Capacity is the compile-time ceiling; set_capacity() lowers it at run time
+// Storage decides where the blocks live (inline, mapped or arena, see storage.hpp)
+// Idx is the slot index type handed out by index_of() / taken by at()
+template<typename T, size_t Capacity, typename Storage = InlineStorage, typename Idx = size_t>
 class MemPool {
     static_assert(sizeof(T) >= sizeof(void*), "T must fit a pointer");
     static_assert(alignof(T) >= alignof(void*), "T alignment must be >= pointer");
+    static_assert(Capacity < std::numeric_limits<Idx>::max(), "every slot must fit Idx");
 
     struct FreeNode { FreeNode* next; };
 
-    alignas(64) std::array<std::byte, sizeof(T) * Capacity> storage_;
+    static constexpr size_t CHUNK_SLOTS = std::max<size_t>(POOL_CHUNK_BYTES / sizeof(T), 1);
+
+    alignas(64) typename Storage::template array<std::byte, sizeof(T) * Capacity> storage_;
     FreeNode* free_head_ = nullptr;
     size_t alloc_cnt_ = 0;
+    size_t frontier_ = 0;           // slots [frontier_, limit_) never handed out
+    size_t limit_ = Capacity;
 
-public:
-    MemPool() noexcept {
-        // build free list in reverse for cache-friendly allocation
+    // free list empty - take the next fresh slot
+    [[nodiscard]] T* grow() noexcept {
+        if (frontier_ == limit_) [[unlikely]] return nullptr;
         auto* base = reinterpret_cast<std::byte*>(storage_.data());
-        for (size_t i = Capacity; i > 0; --i) {
-            auto* node = reinterpret_cast<FreeNode*>(base + (i - 1) * sizeof(T));
-            node->next = free_head_;
-            free_head_ = node;
+        if constexpr (requires { storage_.prefault(size_t{0}, size_t{0}); }) {
+            // entering a chunk: commit the one after it before it is needed
+            if (frontier_ % CHUNK_SLOTS == 0 && frontier_ + CHUNK_SLOTS < limit_) {
+                size_t from = (frontier_ + CHUNK_SLOTS) * sizeof(T);
+                storage_.prefault(from, std::min(CHUNK_SLOTS, limit_ - frontier_ - CHUNK_SLOTS) * sizeof(T));
+            }
+        }
+        ++alloc_cnt_;
+        return std::launder(reinterpret_cast<T*>(base + frontier_++ * sizeof(T)));
+    }
+
+public:
+    MemPool() noexcept(Storage::NOTHROW) {
+        if constexpr (requires { storage_.prefault(size_t{0}, size_t{0}); }) {
+            storage_.prefault(0, std::min(CHUNK_SLOTS, Capacity) * sizeof(T));
+        } else if constexpr (requires { requires Storage::FAULT_IN; }) {
+            // no chunked commit: fault every block in now, off the hot path
+            auto* b = reinterpret_cast<volatile std::byte*>(storage_.data());
+            for (size_t off = 0; off < sizeof(T) * Capacity; off += SMALL_PAGE_SIZE) b[off] = std::byte{0};
         }
     }
 
@@ -36,10 +69,10 @@ public:
     MemPool(MemPool&&) = delete;
     MemPool& operator=(MemPool&&) = delete;
 
-    // o(1) allocation - pop from free list
+    // o(1) allocation - pop from free list, else advance the frontier
     [[nodiscard]] T* alloc() noexcept {
         if (free_head_ == nullptr) [[unlikely]] {
-            return nullptr;
+            return grow();
         }
         auto* node = free_head_;
         free_head_ = node->next;
@@ -57,6 +90,27 @@ public:
         --alloc_cnt_;
     }
 
+    // hand out slots [0, n) of an empty pool at once - bulk restore
+    // later allocs continue from slot n; nullptr if in use or too many
+    [[nodiscard]] T* alloc_front(size_t n) noexcept {
+        if (alloc_cnt_ != 0 || n > limit_) [[unlikely]] return nullptr;
+        if constexpr (requires { storage_.prefault(size_t{0}, size_t{0}); }) {
+            if (n > CHUNK_SLOTS) storage_.prefault(0, n * sizeof(T));
+        }
+        free_head_ = nullptr;
+        frontier_ = n;
+        alloc_cnt_ = n;
+        return std::launder(reinterpret_cast<T*>(storage_.data()));
+    }
+
+    // cap the pool below Capacity, e.g. sized from config at startup
+    // false if n is above Capacity or below the slots already handed out
+    [[nodiscard]] bool set_capacity(size_t n) noexcept {
+        if (n > Capacity || n < frontier_) return false;
+        limit_ = n;
+        return true;
+    }
+
     template<typename... Args>
     [[nodiscard]] T* create(Args&&... args) noexcept {
         T* p = alloc();
@@ -67,11 +121,23 @@ public:
     }
 
     [[nodiscard]] size_t used() const noexcept { return alloc_cnt_; }
-    [[nodiscard]] static constexpr size_t capacity() noexcept { return Capacity; }
-    [[nodiscard]] size_t available() const noexcept { return Capacity - alloc_cnt_; }
-    [[nodiscard]] bool full() const noexcept { return alloc_cnt_ == Capacity; }
+    [[nodiscard]] size_t capacity() const noexcept { return limit_; }
+    [[nodiscard]] static constexpr size_t max_capacity() noexcept { return Capacity; }
+    [[nodiscard]] size_t available() const noexcept { return limit_ - alloc_cnt_; }
+    [[nodiscard]] bool full() const noexcept { return alloc_cnt_ == limit_; }
+    // slots ever handed out - the part of the pool that has been touched
+    [[nodiscard]] size_t touched() const noexcept { return frontier_; }
     [[nodiscard]] bool empty() const noexcept { return alloc_cnt_ == 0; }
 
+    // first block - slot i lives at base() + i
+    [[nodiscard]] T* base() noexcept { return reinterpret_cast<T*>(storage_.data()); }
+
+    [[nodiscard]] Idx index_of(const T* p) const noexcept {
+        return static_cast<Idx>(p - reinterpret_cast<const T*>(storage_.data()));
+    }
+
+    [[nodiscard]] T* at(Idx i) noexcept { return base() + i; }
+
     [[nodiscard]] bool owns(const T* p) const noexcept {
         auto* base = storage_.data();
         auto* ptr = reinterpret_cast<const std::byte*>(p);
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "types.hpp"
+#include <cstdint>
+
+namespace ob {
+
+enum class OpType : uint8_t {
+    Add = 0,
+    Cancel = 1,
+    Match = 2,
+    Modify = 3      // price/qty: new price and open qty of a resting order
+};
+
+// one book operation - what WorkloadGen produces and OrderBook::apply consumes
+struct Op {
+    OpType type;
+    OrderId id;
+    Side side;
+    Price price;
+    Qty qty;
+    OrdType ord_type;
+    Qty peak{0};        // Iceberg: displayed slice
+};
+
+} // namespace ob
@@ -1,15 +1,31 @@
 #pragma once
 
 #include "types.hpp"
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <limits>
 
 namespace ob {
 
+// order layouts, selected by index type - the width of ids and pool slots
+//   BasicOrder<uint64_t> = Order:        64 bytes, raw prev/next pointers
+//   BasicOrder<uint32_t> = CompactOrder: 32 bytes, pool-relative uint32_t links
+// both expose the same field names; compact fields read back as full-width types
+// an iceberg shows qty, holds orig_qty back as its reserve and refills peak at a time
+// only Order has room for an Owner; CompactOrder is always untagged
+template<typename Idx>
+struct BasicOrder;
+
 // intrusive list node - exactly 64 bytes (1 cache line)
-struct alignas(64) Order {
+template<>
+struct alignas(64) BasicOrder<uint64_t> {
+    using index_type = uint64_t;
+    using Link = BasicOrder*;
+
     // hot - accessed during list ops
-    Order* prev = nullptr;  // 8
-    Order* next = nullptr;  // 8
+    BasicOrder* prev = nullptr;  // 8
+    BasicOrder* next = nullptr;  // 8
 
     // hot - accessed during lookup/cancel
     OrderId id;             // 8
@@ -23,11 +39,12 @@ struct alignas(64) Order {
     Side side;              // 1
     OrdType type;           // 1
 
-    std::byte _pad[6];      // 6
+    uint16_t owner;         // 2  participant, stp mode in the top 2 bits
+    Packed<Qty, uint32_t> peak;  // 4  iceberg slice
 
-    Order() noexcept = default;
+    BasicOrder() noexcept = default;
 
-    Order(OrderId id_, Price px_, Qty q_, Side s_, OrdType t_, Timestamp ts_) noexcept
+    BasicOrder(OrderId id_, Price px_, Qty q_, Side s_, OrdType t_, Timestamp ts_) noexcept
         : prev(nullptr)
         , next(nullptr)
         , id(id_)
@@ -37,16 +54,188 @@ struct alignas(64) Order {
         , ts(ts_)
         , side(s_)
         , type(t_)
-        , _pad{}
+        , owner{}
+        , peak{}
     {}
 
+    // every id and qty fits
+    [[nodiscard]] static constexpr bool fits(OrderId, Qty) noexcept { return true; }
+    [[nodiscard]] static constexpr bool fits(Owner w) noexcept { return w.participant <= MAX_PARTICIPANT; }
+    static constexpr bool TAGGED = true;
+    static constexpr int64_t MAX_PRICE = std::numeric_limits<int64_t>::max();
+    static constexpr int64_t MAX_PEAK = std::numeric_limits<uint32_t>::max();
+
     void fill(Qty amount) noexcept { qty -= amount; }
 
+    // amend: new open qty (the original moves by the same amount) / new price
+    // an iceberg keeps its slice, cut to q, and reserves the rest
+    void resize(Qty q) noexcept {
+        if (type == OrdType::Iceberg) {
+            qty = std::min(qty, q);
+            orig_qty = q - qty;
+            return;
+        }
+        orig_qty += q - qty;
+        qty = q;
+    }
+    void reprice(Price px) noexcept { price = px; }
+    void tag(Owner w) noexcept { owner = pack(w); }
+
+    // iceberg: show up to peak of the open qty, reserve the rest
+    // false once nothing is left to show
+    bool reslice() noexcept {
+        Qty open = open_qty();
+        qty = std::min(Qty{peak}, open);
+        orig_qty = open - qty;
+        return qty.raw() > 0;
+    }
+    // turn a fresh order into an iceberg showing peak at a time
+    void hide(Qty p) noexcept {
+        type = OrdType::Iceberg;
+        peak = Packed<Qty, uint32_t>{p};
+        orig_qty = Qty{0};
+        (void)reslice();
+    }
+
     [[nodiscard]] bool filled() const noexcept { return qty.raw() <= 0; }
     [[nodiscard]] Qty remaining() const noexcept { return qty; }
+    [[nodiscard]] Qty reserve() const noexcept { return type == OrdType::Iceberg ? orig_qty : Qty{0}; }
+    [[nodiscard]] Qty open_qty() const noexcept { return qty + reserve(); }
+    [[nodiscard]] uint16_t participant() const noexcept { return owner & MAX_PARTICIPANT; }
+    [[nodiscard]] Owner owned_by() const noexcept { return unpack_owner(owner); }
 };
 
+// compact list node - 32 bytes (2 per cache line)
+// links are slots in the owning MemPool, ts keeps the low 32 bits
+template<>
+struct alignas(32) BasicOrder<uint32_t> {
+    using index_type = uint32_t;
+    using Link = uint32_t;
+
+    static constexpr Link NIL = std::numeric_limits<uint32_t>::max();
+
+    // hot - accessed during list ops
+    Link prev = NIL;                          // 4
+    Link next = NIL;                          // 4
+
+    // hot - accessed during lookup/cancel
+    Packed<OrderId, uint32_t> id;             // 4
+    Packed<Price, int32_t> price;             // 4
+
+    // hot - accessed during matching
+    Packed<Qty, int32_t> qty;                 // 4  remaining
+    Packed<Qty, int32_t> orig_qty;            // 4  original
+
+    Packed<Timestamp, uint32_t> ts;           // 4
+    Side side;                                // 1
+    OrdType type;                             // 1
+
+    Packed<Qty, uint16_t> peak;               // 2  iceberg slice
+
+    BasicOrder() noexcept = default;
+
+    BasicOrder(OrderId id_, Price px_, Qty q_, Side s_, OrdType t_, Timestamp ts_) noexcept
+        : prev(NIL)
+        , next(NIL)
+        , id(id_)
+        , price(px_)
+        , qty(q_)
+        , orig_qty(q_)
+        , ts(ts_)
+        , side(s_)
+        , type(t_)
+        , peak{}
+    {}
+
+    // id and qty must survive the narrowing; prices are bounded by the book
+    [[nodiscard]] static constexpr bool fits(OrderId id_, Qty q_) noexcept {
+        return id_.raw() <= std::numeric_limits<uint32_t>::max() &&
+               q_.raw() <= std::numeric_limits<int32_t>::max();
+    }
+    // no bytes left for an owner
+    [[nodiscard]] static constexpr bool fits(Owner w) noexcept { return w.participant == 0; }
+    static constexpr bool TAGGED = false;
+    static constexpr int64_t MAX_PRICE = std::numeric_limits<int32_t>::max();
+    static constexpr int64_t MAX_PEAK = std::numeric_limits<uint16_t>::max();
+
+    void fill(Qty amount) noexcept { qty.val -= static_cast<int32_t>(amount.raw()); }
+
+    // amend: new open qty (the original moves by the same amount) / new price
+    // an iceberg keeps its slice, cut to q, and reserves the rest
+    void resize(Qty q) noexcept {
+        auto n = static_cast<int32_t>(q.raw());
+        if (type == OrdType::Iceberg) {
+            qty.val = std::min(qty.val, n);
+            orig_qty.val = n - qty.val;
+            return;
+        }
+        orig_qty.val += n - qty.val;
+        qty.val = n;
+    }
+    void reprice(Price px) noexcept { price = Packed<Price, int32_t>{px}; }
+    void tag(Owner) noexcept {}
+
+    // iceberg: show up to peak of the open qty, reserve the rest
+    // false once nothing is left to show
+    bool reslice() noexcept {
+        int32_t open = qty.val + orig_qty.val;
+        qty.val = std::min<int32_t>(peak.val, open);
+        orig_qty.val = open - qty.val;
+        return qty.val > 0;
+    }
+    // turn a fresh order into an iceberg showing peak at a time
+    void hide(Qty p) noexcept {
+        type = OrdType::Iceberg;
+        peak = Packed<Qty, uint16_t>{p};
+        orig_qty.val = 0;
+        (void)reslice();
+    }
+
+    [[nodiscard]] bool filled() const noexcept { return qty.val <= 0; }
+    [[nodiscard]] Qty remaining() const noexcept { return qty; }
+    [[nodiscard]] Qty reserve() const noexcept { return type == OrdType::Iceberg ? Qty{orig_qty} : Qty{0}; }
+    [[nodiscard]] Qty open_qty() const noexcept { return remaining() + reserve(); }
+    [[nodiscard]] static constexpr uint16_t participant() noexcept { return 0; }
+    [[nodiscard]] static constexpr Owner owned_by() noexcept { return Owner{}; }
+};
+
+using Order = BasicOrder<uint64_t>;
+using CompactOrder = BasicOrder<uint32_t>;
+
 static_assert(sizeof(Order) == 64, "Order must be exactly 64 bytes");
 static_assert(alignof(Order) == 64, "Order must be cache-line aligned");
+static_assert(sizeof(CompactOrder) == 32, "CompactOrder must be exactly 32 bytes");
+static_assert(alignof(CompactOrder) == 32, "CompactOrder must not straddle cache lines");
+
+// resolves list links to orders
+// pointer links resolve to themselves; slot links index the pool's base
+template<typename Idx>
+struct OrderLinks;
+
+template<>
+struct OrderLinks<uint64_t> {
+    static constexpr Order* NIL = nullptr;
+
+    OrderLinks() noexcept = default;
+    explicit OrderLinks(Order*) noexcept {}
+
+    [[nodiscard]] static Order* at(Order* l) noexcept { return l; }
+    [[nodiscard]] static Order* link(Order* o) noexcept { return o; }
+};
+
+template<>
+struct OrderLinks<uint32_t> {
+    static constexpr uint32_t NIL = CompactOrder::NIL;
+
+    CompactOrder* base = nullptr;
+
+    OrderLinks() noexcept = default;
+    explicit OrderLinks(CompactOrder* b) noexcept : base(b) {}
+
+    [[nodiscard]] CompactOrder* at(uint32_t l) const noexcept { return base + l; }
+    [[nodiscard]] uint32_t link(const CompactOrder* o) const noexcept {
+        return static_cast<uint32_t>(o - base);
+    }
+};
 
 } // namespace ob
@@ -3,180 +3,600 @@
 #include "types.hpp"
 #include "order.hpp"
 #include "price_level.hpp"
+#include "price_ladder.hpp"
 #include "memory_pool.hpp"
+#include "order_index.hpp"
+#include "fill_listener.hpp"
+#include "top_of_book.hpp"
+#include "depth_feed.hpp"
+#include "instrument.hpp"
+#include "snapshot.hpp"
+#include "stop_index.hpp"
+#include "queue_marks.hpp"
+#include "storage.hpp"
+#include "op.hpp"
 #include <algorithm>
 #include <array>
 #include <cstdint>
+#include <cstdlib>
+#include <span>
+#include <type_traits>
+#include <utility>
 
 namespace ob {
 
-// execution report for matching
-struct Fill {
-    OrderId passive_id;
-    Qty qty;
-    Price price;
-};
-
 // result of add operation
 enum class AddResult : uint8_t {
     Ok = 0,
     DuplicateId,
     InvalidPrice,
     PoolExhausted,
-    InvalidQty
+    InvalidQty,
+    LadderFull,       // sparse ladder or stop index has no level left for this price
+    InvalidId,        // id, qty or owner too wide for the order layout
+    Killed,           // fok that could not fill in full - nothing traded
+    SelfTrade,        // stp cancelled some of the order's qty; trades before it stand
+    WrongSession,     // ioc, fok or market order in an auction, or a Call sent to add()
+    InvalidType       // not an OrdType
+};
+
+// result of modify operation
+enum class ModifyResult : uint8_t {
+    Ok = 0,           // amended, or fully filled after crossing
+    NotFound,
+    InvalidPrice,
+    InvalidQty,
+    LadderFull        // repriced order had no level left - it was cancelled
+};
+
+// outcome of one op in an OrderBook::apply batch - the field for its type is set
+struct OpResult {
+    AddResult add = AddResult::Ok;  // Add
+    bool cancelled = false;         // Cancel: order was found
+    Qty left{0};                    // Match: unfilled qty
+    ModifyResult modify = ModifyResult::Ok;  // Modify
+};
+
+// distinct prices per side an auction holds off the ladder before refusing orders
+inline constexpr size_t AUCTION_LEVELS = 256;
+
+// clearing price of a call auction: the most executable volume, then the
+// least surplus, then the price nearest the last trade, then the lowest
+struct AuctionResult {
+    Price price{NO_BID};    // NO_BID when nothing crosses
+    Qty volume{0};          // traded at price by each side
+    Qty surplus{0};         // buy qty left at price minus sell qty left
+    size_t refused = 0;     // uncross: held orders the ladder had no level for - cancelled
 };
 
+// ops looked ahead by OrderBook::apply
+inline constexpr size_t APPLY_LOOKAHEAD = 8;
+
+// records looked ahead by OrderBook::restore - snapshot ids arrive in queue
+// order, not id order, so every index slot is a miss without it
+inline constexpr size_t RESTORE_LOOKAHEAD = 16;
+
 // high-performance order book
 // array-indexed price levels, o(1) operations
-template<int64_t MaxPrice = DEFAULT_MAX_PRICE, size_t MaxOrders = DEFAULT_MAX_ORDERS>
+// Listener receives every fill inline from match_level; NullListener compiles away
+// a Listener with on_top(Bbo) also sees the top after each add/cancel/match
+// one with on_latency(OpType, cycles) gets the cycles of every op and a
+// PhaseListener the phases inside each op (instrument.hpp)
+// Iceberg, FOK and Stop orders are native: icebergs refill their slice at the
+// back of the same level, stops wait in a StopIndex until a trade reaches them
+// orders may carry an Owner: an aggressor with an stp mode that meets its own
+// participant's resting order applies the mode instead of trading (types.hpp)
+// begin_auction() starts a call phase: orders that would cross are held off the
+// ladder and uncross() trades them at one clearing price, then resumes matching
+// cancel_lazy leaves tombstones - zero-qty orders still queued - that are
+// reclaimed at the front of a match, when a level's last live order goes, or by compact()
+// Index maps order ids to orders: DirectIndex (sequential ids), RobinHoodIndex, SwissIndex
+// Storage backs the pool, levels and index: InlineStorage or MappedStorage<MapOptions>
+// Ladder owns the price levels: DenseLadder (one per tick), CompactLadder (slim, SoA)
+// or WindowLadder (sparse); SlotLadder switches the book to 32-byte CompactOrders,
+// which have no room for an Owner
+// Pool hands out order nodes: MemPool (private), or MagazinePool over a depot
+// shared with other books (shared_pool.hpp), where MaxOrders is the depot's size
+// Queue keeps queue marks for queue_ahead: NoQueueMarks, or QueueMarks over a
+// ladder of PriceLevels (queue_marks.hpp)
+template<int64_t MaxPrice = DEFAULT_MAX_PRICE, size_t MaxOrders = DEFAULT_MAX_ORDERS,
+         FillListener Listener = NullListener,
+         template<size_t, typename, typename> class Index = DirectIndex,
+         typename Storage = InlineStorage,
+         template<int64_t, typename> class Ladder = DenseLadder,
+         template<typename, size_t, typename, typename> class Pool = MemPool,
+         template<size_t, typename> class Queue = NoQueueMarks>
 class OrderBook {
-    // array-based price level index
-    std::array<PriceLevel, MaxPrice + 1> levels_{};
+    using LadderT = Ladder<MaxPrice, Storage>;
+    using QueueT = Queue<MaxOrders, Storage>;
+
+public:
+    // order layout, picked by the ladder - see order.hpp
+    using order_type = typename LadderT::order_type;
+    using pool_type = Pool<order_type, MaxOrders, Storage, typename order_type::index_type>;
+
+private:
+    static_assert(MaxPrice <= order_type::MAX_PRICE, "prices must fit the order layout");
+    static_assert(!QueueT::ENABLED || requires(const LadderT& l) { l.at(Price{0}).traded(); },
+                  "queue marks need a ladder of PriceLevels: DenseLadder or WindowLadder");
+
+    // price levels and their occupancy, see price_ladder.hpp
+    LadderT ladder_;
 
     // best price tracking - hot data together
     Price best_bid_{NO_BID};
     Price best_ask_{Price{MaxPrice + 1}};
-    size_t total_orders_ = 0;
+    size_t total_orders_ = 0;       // linked orders, tombstones included
+    size_t dead_orders_ = 0;        // tombstones left by cancel_lazy
 
     // memory pool for orders
-    MemPool<Order, MaxOrders> pool_;
-
-    // direct-mapped order lookup: slot = id % maxorders
-    // o(1) for sequential ids, handles collisions via linear probe
-    std::array<Order*, MaxOrders> order_map_{};
-
-    // hash: simple modulo - perfect for sequential ids
-    [[nodiscard]] static constexpr size_t slot(OrderId id) noexcept {
-        return static_cast<size_t>(id.raw() % MaxOrders);
-    }
-
-    // o(1) lookup for sequential ids, o(k) for k collisions
-    [[nodiscard]] Order* lookup(OrderId id) const noexcept {
-        size_t idx = slot(id);
-        Order* o = order_map_[idx];
-        if (o != nullptr && o->id == id) [[likely]] {
-            return o;
-        }
-        // linear probe for collision case
-        size_t start = idx;
-        idx = (idx + 1) % MaxOrders;
-        while (idx != start) {
-            o = order_map_[idx];
-            if (o == nullptr) return nullptr;
-            if (o->id == id) return o;
-            idx = (idx + 1) % MaxOrders;
-        }
-        return nullptr;
-    }
-
-    // insert into map
-    bool insert_map(Order* o) noexcept {
-        size_t idx = slot(o->id);
-        size_t start = idx;
-        while (order_map_[idx] != nullptr) {
-            if (order_map_[idx]->id == o->id) [[unlikely]] {
-                return false;  // duplicate
+    pool_type pool_;
+
+    // order id -> order lookup, see order_index.hpp
+    Index<MaxOrders, Storage, order_type> order_map_{};
+
+    [[no_unique_address]] Listener listener_{};
+
+    // where each resting order joined its level, see queue_marks.hpp
+    [[no_unique_address]] QueueT marks_{};
+
+    // untriggered stops, and the price range traded since they were last checked
+    StopIndex<order_type> stops_;
+    Price last_px_{NO_BID};         // last trade, none yet
+    Price swept_lo_{Price{MaxPrice + 1}};
+    Price swept_hi_{NO_BID};
+
+    // orders an auction holds for the uncross, off the ladder like stops
+    StopIndex<order_type, AUCTION_LEVELS> calls_;
+    size_t icebergs_ = 0;           // resting icebergs - auction sums walk reserves only if any
+    bool auction_ = false;
+
+    // latest tombstone ids, so a full pool gets a node back without compact()
+    static constexpr size_t RECENT_DEAD = 64;
+    std::array<OrderId, RECENT_DEAD> recent_dead_{};
+    size_t recent_head_ = 0;
+
+    // aggressor qty cancelled by stp in the last match_internal
+    Qty stp_cut_{0};
+
+    // what an aggressor's participant() is compared with on every fill
+    // above MAX_PARTICIPANT, so never equal, when it does not prevent self-trades
+    static constexpr uint16_t NO_STP = 0xFFFF;
+    [[nodiscard]] static constexpr uint16_t stp_key(Owner w) noexcept {
+        return w.participant != 0 && w.stp != StpMode::None ? w.participant : NO_STP;
+    }
+
+    // update best bid after removal/match - highest occupied level at or below
+    // bids and asks never overlap, so every occupied level below best bid is a bid
+    void update_best_bid() noexcept {
+        phase(Phase::Recovery);
+        best_bid_ = ladder_.prev(best_bid_);
+    }
+
+    // update best ask after removal/match - lowest occupied level at or above
+    void update_best_ask() noexcept {
+        phase(Phase::Recovery);
+        best_ask_ = ladder_.next(best_ask_);
+    }
+
+    // remove order from book and pool
+    void remove_from_book(order_type* o) noexcept {
+        ladder_.remove(o);
+        drop(o);
+    }
+
+    // free an order that is no longer on the ladder
+    void drop(order_type* o) noexcept {
+        if (o->type == OrdType::Iceberg) [[unlikely]] --icebergs_;
+        order_map_.erase(o->id);
+        pool_.dealloc(o);
+        --total_orders_;
+    }
+
+    // live order by id - a tombstone's id is already cancelled
+    [[nodiscard]] order_type* find_live(OrderId id) const noexcept {
+        order_type* o = order_map_.find(id);
+        return o != nullptr && !o->filled() ? o : nullptr;
+    }
+
+    // unlink and free a tombstone; its level keeps a live order
+    void reclaim(order_type* o) noexcept {
+        --dead_orders_;
+        remove_from_book(o);
+    }
+
+    // o is about to leave its level as the last live order: reclaim the
+    // tombstones queued around it first, so the level empties with o
+    void reclaim_level(order_type* o) noexcept {
+        auto&& level = ladder_.at(o->price);
+        order_type* x = level.front();
+        while (level.count() > 1) {
+            order_type* next = level.next_of(x);
+            if (x != o) reclaim(x);
+            x = next;
+        }
+    }
+
+    // free one recent tombstone - its id still maps to a dead order unless it
+    // was reclaimed since; false if none of the ring is left
+    [[nodiscard]] bool reclaim_recent() noexcept {
+        for (size_t k = 0; k < RECENT_DEAD; ++k) {
+            order_type* o = order_map_.find(recent_dead_[--recent_head_ % RECENT_DEAD]);
+            if (o != nullptr && o->filled()) {
+                Price px = o->price;
+                Side side = o->side;
+                reclaim(o);
+                level_changed(side, px);
+                return true;
             }
-            idx = (idx + 1) % MaxOrders;
-            if (idx == start) [[unlikely]] return false;  // full
         }
-        order_map_[idx] = o;
-        return true;
+        return false;
     }
 
-    // remove from map with backward shift deletion
-    void remove_map(OrderId id) noexcept {
-        size_t idx = slot(id);
-        // find the order
-        while (order_map_[idx] != nullptr) {
-            if (order_map_[idx]->id == id) {
-                // found - remove and fix probe chain
-                order_map_[idx] = nullptr;
-                // rehash subsequent entries
-                size_t next = (idx + 1) % MaxOrders;
-                while (order_map_[next] != nullptr) {
-                    Order* to_rehash = order_map_[next];
-                    order_map_[next] = nullptr;
-                    insert_map(to_rehash);  // re-insert at proper position
-                    next = (next + 1) % MaxOrders;
-                }
-                return;
+    // every tombstone on one level
+    void compact_level(Side side, Price px) noexcept {
+        auto&& level = ladder_.at(px);
+        size_t before = dead_orders_;
+        for (order_type* o = level.front(); o != level.end();) {
+            order_type* next = level.next_of(o);
+            if (o->filled()) reclaim(o);
+            o = next;
+        }
+        if (dead_orders_ != before) level_changed(side, px);
+    }
+
+    // free every node the book holds - resting orders, tombstones and stops
+    // nothing is unlinked, the book is going away
+    void release_all() noexcept {
+        auto release_level = [this](Price px) {
+            auto&& level = ladder_.at(px);
+            for (order_type* o = level.front(); o != level.end();) {
+                order_type* next = level.next_of(o);
+                pool_.dealloc(o);
+                o = next;
             }
-            idx = (idx + 1) % MaxOrders;
+        };
+        for (Price px = best_bid_; px.raw() >= 0; px = ladder_.prev(px - Price{1})) release_level(px);
+        for (Price px = best_ask_; px.raw() <= MaxPrice; px = ladder_.next(px + Price{1})) release_level(px);
+        while (order_type* o = stops_.pop(Side::Buy, Price{INT64_MAX})) pool_.dealloc(o);
+        while (order_type* o = stops_.pop(Side::Sell, Price{INT64_MIN})) pool_.dealloc(o);
+        while (order_type* o = calls_.pop(Side::Buy, Price{INT64_MAX})) pool_.dealloc(o);
+        while (order_type* o = calls_.pop(Side::Sell, Price{INT64_MIN})) pool_.dealloc(o);
+    }
+
+    // slot-linked ladders resolve links against the pool
+    void bind_ladder() noexcept {
+        if constexpr (requires { ladder_.bind(pool_.base()); }) ladder_.bind(pool_.base());
+        stops_.bind(pool_.base());
+        calls_.bind(pool_.base());
+    }
+
+    // pool node for a new order; tombstones hold nodes, so free one before refusing
+    [[nodiscard]] order_type* alloc_order() noexcept {
+        order_type* o = pool_.alloc();
+        if (o == nullptr && dead_orders_ != 0) [[unlikely]] {
+            if (!reclaim_recent()) (void)compact();
+            o = pool_.alloc();
         }
+        return o;
     }
 
-    // update best bid after removal/match
-    void update_best_bid() noexcept {
-        while (best_bid_.raw() >= 0 && levels_[best_bid_.raw()].empty()) [[unlikely]] {
-            --best_bid_;
+    // a level traded at px
+    void traded(Price px) noexcept {
+        last_px_ = px;
+        swept_lo_ = std::min(swept_lo_, px);
+        swept_hi_ = std::max(swept_hi_, px);
+    }
+
+    // run every stop the op's trades reached, and those their trades reach
+    // a triggered stop is a market order under its own id
+    void fire_stops() noexcept {
+        if (stops_.empty()) [[likely]] return;
+        for (;;) {
+            order_type* o = stops_.pop(Side::Buy, swept_hi_);
+            if (o == nullptr) o = stops_.pop(Side::Sell, swept_lo_);
+            if (o == nullptr) break;
+            Side side = o->side;
+            Qty qty = o->remaining();
+            OrderId id = o->id;
+            Timestamp ts{o->ts};
+            Owner owner = o->owned_by();
+            order_map_.erase(id);
+            pool_.dealloc(o);
+            (void)match_internal(side, qty, side == Side::Buy ? Price{MaxPrice} : Price{0}, id, ts, owner);
         }
+        swept_lo_ = Price{MaxPrice + 1};
+        swept_hi_ = NO_BID;
     }
 
-    // update best ask after removal/match
-    void update_best_ask() noexcept {
-        while (best_ask_.raw() <= MaxPrice && levels_[best_ask_.raw()].empty()) [[unlikely]] {
-            ++best_ask_;
+    // iceberg slice filled: show the next one at the back of its level
+    template<typename Level>
+    void refill(Level& level, order_type* o) noexcept {
+        if (level.count() > 1) {
+            ladder_.remove(o);      // the level keeps other orders, nothing is freed
+            (void)o->reslice();
+            (void)ladder_.push_back(o);
+        } else {
+            (void)o->reslice();
+            level.requeue(o->remaining());
         }
+        queued(o);
     }
 
-    // remove order from book and pool
-    void remove_from_book(Order* o) noexcept {
-        levels_[o->price.raw()].remove(o);
-        remove_map(o->id);
-        pool_.dealloc(o);
-        --total_orders_;
+    // o just joined the back of its level: mark what stands ahead of it
+    void queued(const order_type* o) noexcept {
+        if constexpr (QueueT::ENABLED) {
+            const auto& level = ladder_.at(o->price);
+            marks_.enter(pool_.index_of(o), level.qty() - o->remaining() + level.traded());
+        }
     }
 
 public:
-    OrderBook() noexcept = default;
+    static constexpr bool NOTHROW = Storage::NOTHROW && std::is_nothrow_default_constructible_v<pool_type>;
+
+    OrderBook() noexcept(NOTHROW) { bind_ladder(); }
+    explicit OrderBook(Listener listener) noexcept(NOTHROW)
+        : listener_(std::move(listener)) { bind_ladder(); }
+
+    // a private pool goes with the book; nodes from a shared one are handed back
+    ~OrderBook() {
+        if constexpr (requires { typename pool_type::depot_type; }) release_all();
+    }
+
+    OrderBook(const OrderBook&) = delete;
+    OrderBook& operator=(const OrderBook&) = delete;
 
     // add limit order
     [[nodiscard]] AddResult add(OrderId id, Side side, Price px, Qty qty,
                                  OrdType type = OrdType::Limit,
-                                 Timestamp ts = Timestamp{0}) noexcept {
-        if (lookup(id) != nullptr) [[unlikely]] return AddResult::DuplicateId;
+                                 Timestamp ts = Timestamp{0},
+                                 Owner owner = Owner{}) noexcept {
+        uint64_t start = op_begin(OpType::Add);
+        AddResult r = add_internal(id, side, px, qty, type, ts, Qty{0}, owner);
+        fire_stops();
+        publish_top();
+        op_end(OpType::Add, start);
+        return r;
+    }
+
+    // add an iceberg: qty rests peak at a time, each slice filled refills the
+    // next at the back of the level; crossing qty trades in full first
+    [[nodiscard]] AddResult add_iceberg(OrderId id, Side side, Price px, Qty qty, Qty peak,
+                                        Timestamp ts = Timestamp{0},
+                                        Owner owner = Owner{}) noexcept {
+        uint64_t start = op_begin(OpType::Add);
+        AddResult r = add_internal(id, side, px, qty, OrdType::Iceberg, ts, peak, owner);
+        fire_stops();
+        publish_top();
+        op_end(OpType::Add, start);
+        return r;
+    }
+
+    // cancel order - o(1) expected
+    bool cancel(OrderId id) noexcept {
+        uint64_t start = op_begin(OpType::Cancel);
+        bool found = cancel_internal(id);
+        publish_top();
+        op_end(OpType::Cancel, start);
+        return found;
+    }
+
+    // cancel that only marks the order dead: its qty leaves the level, but
+    // the node stays queued as a tombstone - no unlink, index erase, free or
+    // best-price recovery. a level's last live order is cancelled normally,
+    // so best price never sits on a level of tombstones; so is any order
+    // while the pool is full. tombstones keep their index entries, and level
+    // order counts include them until they are reclaimed
+    bool cancel_lazy(OrderId id) noexcept {
+        uint64_t start = op_begin(OpType::Cancel);
+        bool found = cancel_lazy_internal(id);
+        publish_top();
+        op_end(OpType::Cancel, start);
+        return found;
+    }
+
+    // reclaim every tombstone, walking out from the touch until none are
+    // left - for idle time; returns how many were freed
+    size_t compact() noexcept {
+        size_t before = dead_orders_;
+        for (Price px = best_bid_; dead_orders_ != 0 && px.raw() >= 0; px = ladder_.prev(px - Price{1})) {
+            compact_level(Side::Buy, px);
+        }
+        for (Price px = best_ask_; dead_orders_ != 0 && px.raw() <= MaxPrice; px = ladder_.next(px + Price{1})) {
+            compact_level(Side::Sell, px);
+        }
+        return before - dead_orders_;
+    }
+
+    // market order - aggressor id/ts are only used for fill reports
+    // qty cancelled by stp is returned as unfilled; nothing trades in an auction
+    [[nodiscard]] Qty match(Side aggressor, Qty qty,
+                            OrderId aggressor_id = OrderId{0},
+                            Timestamp ts = Timestamp{0},
+                            Owner owner = Owner{}) noexcept {
+        if (auction_) [[unlikely]] return qty;
+        uint64_t start = op_begin(OpType::Match);
+        Qty left = match_internal(aggressor, qty,
+            aggressor == Side::Buy ? Price{MaxPrice} : Price{0}, aggressor_id, ts, owner);
+        left += stp_cut_;
+        fire_stops();
+        publish_top();
+        op_end(OpType::Match, start);
+        return left;
+    }
+
+    // amend price and/or open qty of a resting order, same node throughout
+    // qty down at the same price keeps queue position; qty up or a new price
+    // goes to the back of the target level; a price through the touch matches
+    // under the order's own owner
+    [[nodiscard]] ModifyResult modify(OrderId id, Price px, Qty qty) noexcept {
+        uint64_t start = op_begin(OpType::Modify);
+        ModifyResult r = modify_internal(id, px, qty);
+        fire_stops();
+        publish_top();
+        op_end(OpType::Modify, start);
+        return r;
+    }
+
+    // start a call phase: adds and amends no longer match - an order that
+    // would cross the ladder, or reaches the prices already held for its
+    // side, is held off it until uncross(); others rest as usual
+    // ioc, fok and market orders are refused, stops wait and match() trades nothing
+    void begin_auction() noexcept { auction_ = true; }
+
+    // clearing price and volume if the auction uncrossed now
+    // one pass up the populated prices between the lowest sell and the highest buy
+    [[nodiscard]] AuctionResult indicative() const noexcept {
+        AuctionResult best;
+        size_t buys = calls_.levels(Side::Buy);
+        size_t sells = calls_.levels(Side::Sell);
+        Price hi = buys != 0 ? std::max(best_bid_, calls_.price_at(Side::Buy, 0)) : best_bid_;
+        Price lo = sells != 0 ? std::min(best_ask_, calls_.price_at(Side::Sell, 0)) : best_ask_;
+        if (hi < lo) [[likely]] return best;
+
+        // buy qty at or above each price, starting from all of it at lo
+        Qty demand{0};
+        for (Price p = best_bid_; p >= lo && p.raw() >= 0; p = ladder_.prev(p - Price{1})) demand += open_at(p);
+        size_t b = 0;
+        for (; b < buys && calls_.price_at(Side::Buy, b) >= lo; ++b) demand += calls_.qty_at(Side::Buy, b);
+
+        Qty supply{0};
+        Price lp = ladder_.next(lo);
+        size_t s = 0;
+        for (;;) {
+            Price p = Price{MaxPrice + 1};
+            if (lp <= hi) p = lp;
+            if (s < sells) p = std::min(p, calls_.price_at(Side::Sell, s));
+            if (b > 0) p = std::min(p, calls_.price_at(Side::Buy, b - 1));
+            if (p > hi) break;
+
+            Qty bought{0};
+            if (lp == p) {
+                if (p <= best_bid_) {
+                    bought += open_at(p);
+                } else {
+                    supply += open_at(p);
+                }
+                lp = ladder_.next(p + Price{1});
+            }
+            if (s < sells && calls_.price_at(Side::Sell, s) == p) supply += calls_.qty_at(Side::Sell, s++);
+            if (b > 0 && calls_.price_at(Side::Buy, b - 1) == p) bought += calls_.qty_at(Side::Buy, --b);
+
+            Qty volume = std::min(demand, supply);
+            Qty surplus = demand - supply;
+            if (volume > best.volume || (volume.raw() > 0 && volume == best.volume && nearer(surplus, p, best))) {
+                best.price = p;
+                best.volume = volume;
+                best.surplus = surplus;
+            }
+            demand -= bought;
+        }
+        return best;
+    }
+
+    // trade the auction at its clearing price and go back to continuous
+    // matching; what is left rests on the ladder, uncrossed, in price-time order
+    // fills report the buy as aggressor and the sell as passive, with ts
+    AuctionResult uncross(Timestamp ts = Timestamp{0}) noexcept {
+        uint64_t start = op_begin(OpType::Match);
+        AuctionResult r = indicative();
+        auction_ = false;
+        if (r.volume.raw() > 0) {
+            phase(Phase::Match);
+            traded(r.price);
+            for (Qty left = r.volume; left.raw() > 0;) {
+                order_type* buy = uncross_front(Side::Buy, r.price);
+                order_type* sell = uncross_front(Side::Sell, r.price);
+                Qty fill = std::min({left, buy->remaining(), sell->remaining()});
+                if constexpr (LISTENS<Listener>) {
+                    listener_.on_fill(Fill{sell->id, buy->id, fill, r.price, ts});
+                }
+                uncross_fill(buy, fill);
+                uncross_fill(sell, fill);
+                left -= fill;
+            }
+        }
+        r.refused = release_calls();
+        fire_stops();
+        publish_top();
+        op_end(OpType::Match, start);
+        return r;
+    }
+
+private:
+    [[nodiscard]] AddResult add_internal(OrderId id, Side side, Price px, Qty qty,
+                                         OrdType type, Timestamp ts, Qty peak, Owner owner) noexcept {
+        phase(Phase::Lookup);
+        if (order_type* old = order_map_.find(id); old != nullptr) [[unlikely]] {
+            if (!old->filled()) return AddResult::DuplicateId;
+            // reusing the id of a lazily cancelled order
+            Price old_px = old->price;
+            Side old_side = old->side;
+            reclaim(old);
+            level_changed(old_side, old_px);
+        }
         if (qty.raw() <= 0) [[unlikely]] return AddResult::InvalidQty;
         if (px.raw() < 0 || px.raw() > MaxPrice) [[unlikely]] return AddResult::InvalidPrice;
+        if (!order_type::fits(id, qty) || !order_type::fits(owner)) [[unlikely]] return AddResult::InvalidId;
+        if (type >= OrdType::FOK) [[unlikely]] {
+            if (type > OrdType::Call) return AddResult::InvalidType;
+            if (type == OrdType::Stop) return add_stop(id, side, px, qty, ts, owner);
+            if (type == OrdType::Call) return AddResult::WrongSession;
+            if (type == OrdType::FOK && !auction_ && !fillable(side, px, qty)) return AddResult::Killed;
+            if (type == OrdType::Iceberg && (peak.raw() <= 0 || peak.raw() > order_type::MAX_PEAK)) {
+                return AddResult::InvalidQty;
+            }
+        }
+        if (auction_) [[unlikely]] {
+            if (type == OrdType::IOC || type == OrdType::Market || type == OrdType::FOK) return AddResult::WrongSession;
+            if (holds(side, px)) return add_call(id, side, px, qty, type, ts, peak, owner);
+        }
 
         // match if crossing
         Qty remaining = qty;
-        if (side == Side::Buy) {
-            if (px >= best_ask_) [[unlikely]] {
-                remaining = match_internal(side, remaining, px);
-            }
-        } else {
-            if (px <= best_bid_) [[unlikely]] {
-                remaining = match_internal(side, remaining, px);
-            }
+        AddResult done = AddResult::Ok;
+        if (side == Side::Buy ? px >= best_ask_ : px <= best_bid_) [[unlikely]] {
+            remaining = match_internal(side, remaining, px, id, ts, owner);
+            if (stp_cut_.raw() != 0) [[unlikely]] done = AddResult::SelfTrade;
         }
 
-        // ioc/market don't rest
-        if (type == OrdType::IOC || type == OrdType::Market) [[unlikely]] {
-            return AddResult::Ok;
+        // ioc/market don't rest, a fok that got here filled unless stp cut it
+        if (type == OrdType::IOC || type == OrdType::Market || type == OrdType::FOK) [[unlikely]] {
+            return done;
         }
 
-        // fully matched
+        // fully matched, or cancelled by stp
         if (remaining.raw() <= 0) [[unlikely]] {
-            return AddResult::Ok;
+            return done;
         }
 
         // allocate from pool
-        Order* o = pool_.alloc();
+        phase(Phase::Lookup);
+        order_type* o = alloc_order();
         if (o == nullptr) [[unlikely]] return AddResult::PoolExhausted;
 
         // construct
-        ::new (static_cast<void*>(o)) Order{id, px, remaining, side, type, ts};
+        ::new (static_cast<void*>(o)) order_type{id, px, remaining, side, type, ts};
+        o->tag(owner);
+        if (type == OrdType::Iceberg) [[unlikely]] o->hide(peak);
 
         // insert to map
-        if (!insert_map(o)) [[unlikely]] {
+        if (!order_map_.insert(o)) [[unlikely]] {
             pool_.dealloc(o);
             return AddResult::DuplicateId;
         }
 
         // add to price level
-        levels_[px.raw()].push_back(o);
+        phase(Phase::Level);
+        if (!ladder_.push_back(o)) [[unlikely]] {
+            order_map_.erase(id);
+            pool_.dealloc(o);
+            return AddResult::LadderFull;
+        }
         ++total_orders_;
+        if (type == OrdType::Iceberg) [[unlikely]] ++icebergs_;
+        queued(o);
+        level_changed(side, px);
 
         // update best
         if (side == Side::Buy) {
@@ -184,19 +604,242 @@ public:
         } else {
             if (px < best_ask_) [[likely]] best_ask_ = px;
         }
+        ladder_.follow(best_bid_, best_ask_);
+
+        return done;
+    }
 
+    // a stop the last trade already went through runs at once, others wait
+    // off the ladder; resting stops hold a pool node and an index entry but
+    // are not counted in order_count()
+    [[nodiscard]] AddResult add_stop(OrderId id, Side side, Price px, Qty qty, Timestamp ts,
+                                     Owner owner) noexcept {
+        bool through = side == Side::Buy ? last_px_ >= px : last_px_.raw() >= 0 && last_px_ <= px;
+        if (through && !auction_) {
+            (void)match_internal(side, qty, side == Side::Buy ? Price{MaxPrice} : Price{0}, id, ts, owner);
+            return stp_cut_.raw() != 0 ? AddResult::SelfTrade : AddResult::Ok;
+        }
+        if (stops_.empty()) {
+            // trades since the last check predate every stop
+            swept_lo_ = Price{MaxPrice + 1};
+            swept_hi_ = NO_BID;
+        }
+        order_type* o = alloc_order();
+        if (o == nullptr) [[unlikely]] return AddResult::PoolExhausted;
+        ::new (static_cast<void*>(o)) order_type{id, px, qty, side, OrdType::Stop, ts};
+        o->tag(owner);
+        if (!order_map_.insert(o)) [[unlikely]] {
+            pool_.dealloc(o);
+            return AddResult::DuplicateId;
+        }
+        if (!stops_.add(o)) [[unlikely]] {
+            order_map_.erase(id);
+            pool_.dealloc(o);
+            return AddResult::LadderFull;
+        }
         return AddResult::Ok;
     }
 
-    // cancel order - o(1) for sequential ids
-    bool cancel(OrderId id) noexcept {
-        Order* o = lookup(id);
+    void cancel_stop(order_type* o) noexcept {
+        stops_.remove(o);
+        order_map_.erase(o->id);
+        pool_.dealloc(o);
+    }
+
+    // an auction order is held if it would cross the ladder, or reaches the
+    // lowest held buy / highest held sell - so a price's queue goes by arrival
+    [[nodiscard]] bool holds(Side side, Price px) const noexcept {
+        size_t n = calls_.levels(side);
+        if (side == Side::Buy) return px >= best_ask_ || (n != 0 && px >= calls_.price_at(side, n - 1));
+        return px <= best_bid_ || (n != 0 && px <= calls_.price_at(side, n - 1));
+    }
+
+    // hold a new order for the uncross; an iceberg keeps its peak for when it rests
+    [[nodiscard]] AddResult add_call(OrderId id, Side side, Price px, Qty qty, OrdType type, Timestamp ts,
+                                     Qty peak, Owner owner) noexcept {
+        order_type* o = alloc_order();
+        if (o == nullptr) [[unlikely]] return AddResult::PoolExhausted;
+        ::new (static_cast<void*>(o)) order_type{id, px, qty, side, OrdType::Call, ts};
+        o->tag(owner);
+        if (type == OrdType::Iceberg) o->peak = decltype(o->peak){peak};
+        if (!order_map_.insert(o)) [[unlikely]] {
+            pool_.dealloc(o);
+            return AddResult::DuplicateId;
+        }
+        if (!calls_.add(o)) [[unlikely]] {
+            order_map_.erase(id);
+            pool_.dealloc(o);
+            return AddResult::LadderFull;
+        }
+        return AddResult::Ok;
+    }
+
+    // hold an order that is off the ladder at a new price and qty
+    // false if no held price level is left - it is freed
+    [[nodiscard]] bool hold(order_type* o, Price px, Qty qty) noexcept {
+        if (o->type == OrdType::Iceberg) --icebergs_;
+        o->type = OrdType::Call;        // qty is then all open, no reserve
+        o->resize(qty);
+        o->reprice(px);
+        if (calls_.add(o)) [[likely]] return true;
+        order_map_.erase(o->id);
+        pool_.dealloc(o);
+        return false;
+    }
+
+    void cancel_call(order_type* o) noexcept {
+        calls_.remove(o);
+        order_map_.erase(o->id);
+        pool_.dealloc(o);
+    }
+
+    // a held order, already out of calls_, goes on the ladder as a limit or iceberg
+    // false if the ladder had no level for it - it is freed
+    [[nodiscard]] bool rest_call(order_type* o) noexcept {
+        Side side = o->side;
+        Price px = o->price;
+        if (o->peak.raw() != 0) {
+            o->hide(Qty{o->peak});
+        } else {
+            o->type = OrdType::Limit;
+        }
+        if (!ladder_.push_back(o)) [[unlikely]] {
+            order_map_.erase(o->id);
+            pool_.dealloc(o);
+            return false;
+        }
+        ++total_orders_;
+        if (o->type == OrdType::Iceberg) ++icebergs_;
+        queued(o);
+        level_changed(side, px);
+        if (side == Side::Buy) {
+            if (px > best_bid_) best_bid_ = px;
+        } else {
+            if (px < best_ask_) best_ask_ = px;
+        }
+        return true;
+    }
+
+    // after the uncross every held order rests; returns how many the ladder refused
+    [[nodiscard]] size_t release_calls() noexcept {
+        size_t refused = 0;
+        // each price's queue comes off in fifo order, the prices worst first
+        while (order_type* o = calls_.pop(Side::Buy, Price{INT64_MAX})) refused += rest_call(o) ? 0 : 1;
+        while (order_type* o = calls_.pop(Side::Sell, Price{INT64_MIN})) refused += rest_call(o) ? 0 : 1;
+        ladder_.follow(best_bid_, best_ask_);
+        return refused;
+    }
+
+    // open qty at a ladder price: the level aggregate, plus reserves if any iceberg rests
+    [[nodiscard]] Qty open_at(Price px) const noexcept {
+        const auto& level = ladder_.level(px);
+        if (icebergs_ == 0) [[likely]] return level.qty();
+        Qty open{0};
+        for (const order_type* o = level.front(); o != level.end(); o = level.next_of(o)) open += o->open_qty();
+        return open;
+    }
+
+    // auction tie-break at equal volume: less surplus, then nearer the last trade
+    [[nodiscard]] bool nearer(Qty surplus, Price px, const AuctionResult& best) const noexcept {
+        int64_t a = std::abs(surplus.raw());
+        int64_t b = std::abs(best.surplus.raw());
+        if (a != b) return a < b;
+        return last_px_.raw() >= 0 && std::abs((px - last_px_).raw()) < std::abs((best.price - last_px_).raw());
+    }
+
+    // next order of a side to trade in the uncross at px: best price first, and
+    // at one price the ladder's orders, which queued before any held there
+    [[nodiscard]] order_type* uncross_front(Side side, Price px) noexcept {
+        order_type* call = calls_.front(side);
+        Price touch = side == Side::Buy ? best_bid_ : best_ask_;
+        bool on_ladder = side == Side::Buy ? touch >= px && touch.raw() >= 0 : touch <= px && touch.raw() <= MaxPrice;
+        Price held = call != nullptr ? Price{call->price} : touch;
+        if (!on_ladder || (side == Side::Buy ? held > touch : held < touch)) {
+            return call;
+        }
+        auto&& level = ladder_.at(touch);
+        order_type* o = level.front();
+        while (o->filled()) [[unlikely]] {
+            reclaim(o);     // tombstone reached the front
+            o = level.front();
+        }
+        return o;
+    }
+
+    // fill one side of an uncross trade, as match_level does for a passive order
+    // o is what uncross_front() returned: a held order is the front of calls_
+    void uncross_fill(order_type* o, Qty fill) noexcept {
+        if (o->type == OrdType::Call) {
+            calls_.fill_front(o->side, fill);
+            if (o->filled()) {
+                order_map_.erase(o->id);
+                pool_.dealloc(o);
+            }
+            return;
+        }
+        o->fill(fill);
+        Side side = o->side;
+        Price px = o->price;
+        auto&& level = ladder_.at(px);
+        level.trade(fill);
+        if (o->filled()) {
+            if (o->reserve().raw() > 0) [[unlikely]] {
+                refill(level, o);
+            } else {
+                if (dead_orders_ != 0 && level.qty().raw() == 0) [[unlikely]] reclaim_level(o);
+                bool last = level.count() == 1;
+                remove_from_book(o);
+                if (last) side == Side::Buy ? update_best_bid() : update_best_ask();
+            }
+        }
+        level_changed(side, px);
+    }
+
+    // whether limit px reaches qty on the other side; level aggregates first,
+    // then the reserves of icebergs queued there if those fall short
+    [[nodiscard]] bool fillable(Side side, Price px, Qty qty) const noexcept {
+        auto levels = [&](auto&& per_level) {
+            Qty sum{0};
+            if (side == Side::Buy) {
+                for (Price p = best_ask_; p <= px && p.raw() <= MaxPrice && sum < qty; p = ladder_.next(p + Price{1})) {
+                    sum += per_level(ladder_.level(p));
+                }
+            } else {
+                for (Price p = best_bid_; p >= px && p.raw() >= 0 && sum < qty; p = ladder_.prev(p - Price{1})) {
+                    sum += per_level(ladder_.level(p));
+                }
+            }
+            return sum >= qty;
+        };
+        if (levels([](const auto& level) { return level.qty(); })) [[likely]] return true;
+        return levels([](const auto& level) {
+            Qty open{0};
+            for (const order_type* o = level.front(); o != level.end(); o = level.next_of(o)) open += o->open_qty();
+            return open;
+        });
+    }
+
+    bool cancel_internal(OrderId id) noexcept {
+        phase(Phase::Lookup);
+        order_type* o = find_live(id);
         if (o == nullptr) [[unlikely]] return false;
+        if (o->type >= OrdType::Stop) [[unlikely]] {
+            o->type == OrdType::Stop ? cancel_stop(o) : cancel_call(o);
+            return true;
+        }
+        return cancel_order(o);
+    }
 
+    bool cancel_order(order_type* o) noexcept {
         Price px = o->price;
         Side side = o->side;
 
-        remove_from_book(o);
+        phase(Phase::Level);
+        if (dead_orders_ != 0 && ladder_.at(px).qty() == o->remaining()) [[unlikely]] reclaim_level(o);
+        ladder_.remove(o);
+        level_changed(side, px);
+        phase(Phase::Lookup);
+        drop(o);
 
         // update best only if at best
         if (side == Side::Buy) {
@@ -208,78 +851,490 @@ public:
         return true;
     }
 
-    // market order
-    [[nodiscard]] Qty match(Side aggressor, Qty qty) noexcept {
-        return match_internal(aggressor, qty,
-            aggressor == Side::Buy ? Price{MaxPrice} : Price{0});
+    bool cancel_lazy_internal(OrderId id) noexcept {
+        phase(Phase::Lookup);
+        order_type* o = find_live(id);
+        if (o == nullptr) [[unlikely]] return false;
+        if (o->type >= OrdType::Stop) [[unlikely]] {
+            o->type == OrdType::Stop ? cancel_stop(o) : cancel_call(o);
+            return true;
+        }
+
+        phase(Phase::Level);
+        auto&& level = ladder_.at(o->price);
+        // a full pool needs the node back now, not at the next compact
+        if (level.qty() == o->remaining() || pool_.full()) [[unlikely]] return cancel_order(o);
+        level.reduce_qty(o->remaining());
+        o->resize(Qty{0});      // an iceberg's reserve goes too
+        ++dead_orders_;
+        recent_dead_[recent_head_++ % RECENT_DEAD] = o->id;
+        level_changed(o->side, o->price);
+        return true;
     }
 
-private:
-    [[nodiscard]] Qty match_internal(Side aggressor, Qty qty, Price limit) noexcept {
+    [[nodiscard]] ModifyResult modify_internal(OrderId id, Price px, Qty qty) noexcept {
+        phase(Phase::Lookup);
+        order_type* o = find_live(id);
+        if (o == nullptr) [[unlikely]] return ModifyResult::NotFound;
+        if (qty.raw() <= 0 || !order_type::fits(id, qty)) [[unlikely]] return ModifyResult::InvalidQty;
+        if (px.raw() < 0 || px.raw() > MaxPrice) [[unlikely]] return ModifyResult::InvalidPrice;
+
+        // a stop is filed again under its new trigger, and runs if a trade already reached it
+        if (o->type == OrdType::Stop) [[unlikely]] {
+            Side side = o->side;
+            Timestamp ts{o->ts};
+            Owner owner = o->owned_by();
+            cancel_stop(o);
+            AddResult r = add_stop(id, side, px, qty, ts, owner);
+            return r == AddResult::Ok || r == AddResult::SelfTrade ? ModifyResult::Ok : ModifyResult::LadderFull;
+        }
+
+        // a held order is held again, or rests if its new price no longer reaches
+        // the held prices; qty down at the same price keeps its place
+        if (o->type == OrdType::Call) [[unlikely]] {
+            if (px == o->price && qty <= o->remaining()) {
+                calls_.reduce(o, o->remaining() - qty);
+                o->resize(qty);
+                return ModifyResult::Ok;
+            }
+            calls_.remove(o);
+            if (holds(o->side, px)) return hold(o, px, qty) ? ModifyResult::Ok : ModifyResult::LadderFull;
+            o->resize(qty);
+            o->reprice(px);
+            return rest_call(o) ? ModifyResult::Ok : ModifyResult::LadderFull;
+        }
+
+        Price old_px = o->price;
+        Qty old_qty = o->remaining();
+        phase(Phase::Level);
+
+        // size down in place - only the level aggregate changes
+        // an iceberg's qty is its open qty, cut from the reserve first
+        if (px == old_px && qty <= o->open_qty()) [[likely]] {
+            o->resize(qty);
+            ladder_.at(px).reduce_qty(old_qty - o->remaining());
+            level_changed(o->side, px);
+            return ModifyResult::Ok;
+        }
+
+        // unlink, leaving pool and id map alone
+        Side side = o->side;
+        if (dead_orders_ != 0 && ladder_.at(old_px).qty() == old_qty) [[unlikely]] reclaim_level(o);
+        ladder_.remove(o);
+        level_changed(side, old_px);
+        if (side == Side::Buy) {
+            if (old_px == best_bid_) update_best_bid();
+        } else {
+            if (old_px == best_ask_) update_best_ask();
+        }
+
+        // in an auction a new price that reaches the other side is held instead
+        if (auction_ && holds(side, px)) [[unlikely]] {
+            --total_orders_;
+            return hold(o, px, qty) ? ModifyResult::Ok : ModifyResult::LadderFull;
+        }
+
+        // a new price through the touch trades first; o is off the ladder
+        Qty remaining = qty;
+        if (side == Side::Buy ? px >= best_ask_ : px <= best_bid_) [[unlikely]] {
+            remaining = match_internal(side, qty, px, id, Timestamp{o->ts}, o->owned_by());
+        }
+        if (remaining.raw() <= 0) [[unlikely]] {
+            drop(o);
+            return ModifyResult::Ok;
+        }
+
+        phase(Phase::Level);
+        o->resize(remaining);
+        o->reprice(px);
+        if (o->type == OrdType::Iceberg) (void)o->reslice();
+        if (!ladder_.push_back(o)) [[unlikely]] {
+            drop(o);
+            return ModifyResult::LadderFull;
+        }
+        queued(o);
+        level_changed(side, px);
+
+        if (side == Side::Buy) {
+            if (px > best_bid_) best_bid_ = px;
+        } else {
+            if (px < best_ask_) best_ask_ = px;
+        }
+        ladder_.follow(best_bid_, best_ask_);
+        return ModifyResult::Ok;
+    }
+
+    // a level only counts as traded if some of its qty filled - stp may have
+    // cancelled all it touched; stp_cut_ is left with the qty stp took
+    [[nodiscard]] Qty match_internal(Side aggressor, Qty qty, Price limit,
+                                     OrderId aggressor_id, Timestamp ts, Owner owner) noexcept {
+        phase(Phase::Match);
+        stp_cut_ = Qty{0};
+        uint16_t key = stp_key(owner);
         if (aggressor == Side::Buy) {
             while (qty.raw() > 0 && best_ask_.raw() <= limit.raw() &&
                    best_ask_.raw() <= MaxPrice) [[likely]] {
-                PriceLevel& level = levels_[best_ask_.raw()];
-                qty = match_level(level, qty);
-                if (level.empty()) [[unlikely]] update_best_ask();
+                Price px = best_ask_;
+                Qty before = qty + stp_cut_;
+                bool emptied = match_level(ladder_.at(px), qty, aggressor_id, ts, key, owner.stp);
+                if (qty + stp_cut_ != before) [[likely]] traded(px);
+                if (emptied) [[unlikely]] {
+                    update_best_ask();
+                    phase(Phase::Match);
+                }
+                level_changed(Side::Sell, px);
             }
         } else {
             while (qty.raw() > 0 && best_bid_.raw() >= limit.raw() &&
                    best_bid_.raw() >= 0) [[likely]] {
-                PriceLevel& level = levels_[best_bid_.raw()];
-                qty = match_level(level, qty);
-                if (level.empty()) [[unlikely]] update_best_bid();
+                Price px = best_bid_;
+                Qty before = qty + stp_cut_;
+                bool emptied = match_level(ladder_.at(px), qty, aggressor_id, ts, key, owner.stp);
+                if (qty + stp_cut_ != before) [[likely]] traded(px);
+                if (emptied) [[unlikely]] {
+                    update_best_bid();
+                    phase(Phase::Match);
+                }
+                level_changed(Side::Buy, px);
             }
         }
         return qty;
     }
 
-    [[nodiscard]] Qty match_level(PriceLevel& level, Qty qty) noexcept {
-        while (qty.raw() > 0 && !level.empty()) [[likely]] {
-            Order* o = level.front();
+    // fill qty against one non-empty level in fifo order
+    // Level is a PriceLevel& or a ladder level handle
+    // stp is one compare per order met: its participant against the aggressor's key
+    // returns true once the level is emptied - it may no longer exist afterwards
+    template<typename Level>
+    [[nodiscard]] bool match_level(Level&& level, Qty& qty, OrderId aggressor_id, Timestamp ts,
+                                   uint16_t stp_key, StpMode stp) noexcept {
+        while (qty.raw() > 0) [[likely]] {
+            order_type* o = level.front();
+            if (o->filled()) [[unlikely]] {
+                reclaim(o);     // tombstone reached the front
+                continue;
+            }
+            if constexpr (order_type::TAGGED) {
+                if (o->participant() == stp_key) [[unlikely]] {
+                    if (self_trade(level, o, qty, aggressor_id, stp)) return true;
+                    continue;
+                }
+            }
 
             // prefetch next order
-            if (o->next != level.end()) [[likely]] {
-                __builtin_prefetch(o->next, 0, 3);
+            order_type* next = level.next_of(o);
+            if (next != level.end()) [[likely]] {
+                __builtin_prefetch(next, 0, 3);
             }
 
-            Qty fill = std::min(qty, o->qty);
+            Qty fill = std::min(qty, o->remaining());
             o->fill(fill);
             qty -= fill;
-            level.reduce_qty(fill);
+            level.trade(fill);
+
+            if constexpr (LISTENS<Listener>) {
+                listener_.on_fill(Fill{o->id, aggressor_id, fill, o->price, ts});
+            }
 
             if (o->filled()) [[likely]] {
+                if (o->reserve().raw() > 0) [[unlikely]] {
+                    refill(level, o);
+                    continue;
+                }
+                if (dead_orders_ != 0 && level.qty().raw() == 0) [[unlikely]] reclaim_level(o);
+                bool last = level.count() == 1;
                 remove_from_book(o);
+                if (last) return true;
             }
         }
-        return qty;
+        return false;
+    }
+
+    // the aggressor met its own participant's order o at the front of level:
+    // apply the mode instead of a fill; true once the level is emptied
+    template<typename Level>
+    [[nodiscard]] bool self_trade(Level& level, order_type* o, Qty& qty, OrderId aggressor_id,
+                                  StpMode stp) noexcept {
+        Qty open = o->open_qty();
+        Qty cut = stp == StpMode::CancelOldest ? Qty{0} : stp == StpMode::CancelNewest ? qty : std::min(qty, open);
+        Qty passive = stp == StpMode::CancelNewest ? Qty{0} : stp == StpMode::CancelOldest ? open : cut;
+        qty -= cut;
+        stp_cut_ += cut;
+        if constexpr (StpListener<Listener>) {
+            listener_.on_self_trade(SelfTrade{o->id, aggressor_id, passive, cut, o->price});
+        }
+
+        // decremented: an iceberg loses reserve first, as in modify
+        if (passive < open) {
+            if (passive.raw() > 0) {
+                Qty shown = o->remaining();
+                o->resize(open - passive);
+                level.reduce_qty(shown - o->remaining());
+            }
+            return false;
+        }
+
+        // resting order cancelled
+        if (dead_orders_ != 0 && level.qty() == o->remaining()) [[unlikely]] reclaim_level(o);
+        bool last = level.count() == 1;
+        remove_from_book(o);
+        return last;
+    }
+
+    // hand a level's new aggregate to a listener that tracks depth
+    // level() rather than at(): the level may be gone from a sparse ladder
+    void level_changed(Side side, Price px) noexcept {
+        if constexpr (DepthListener<Listener>) {
+            const auto& level = ladder_.level(px);
+            listener_.on_level(LevelUpdate{px, level.qty(), static_cast<uint32_t>(level.count()), side});
+        }
+    }
+
+    // hand the top of book to a listener that tracks it
+    void publish_top() noexcept {
+        if constexpr (TopListener<Listener>) listener_.on_top(top());
+    }
+
+    // op entry/exit for a listener that times or profiles ops - compiled out otherwise
+    [[nodiscard]] uint64_t op_begin(OpType type) noexcept {
+        if constexpr (PhaseListener<Listener>) listener_.on_op_begin(type);
+        if constexpr (LatencyListener<Listener>) {
+            return rdtsc();
+        } else {
+            return 0;
+        }
+    }
+
+    void op_end(OpType type, uint64_t start) noexcept {
+        if constexpr (LatencyListener<Listener>) listener_.on_latency(type, rdtsc() - start);
+        if constexpr (PhaseListener<Listener>) listener_.on_op_end();
+    }
+
+    // phase boundary inside an op, for a PhaseListener
+    void phase(Phase p) noexcept {
+        if constexpr (PhaseListener<Listener>) listener_.on_phase(p);
+    }
+
+    // pull in the index slots a later add/cancel of op.id probes
+    void prefetch_op(const Op& op) const noexcept {
+        if (op.type != OpType::Match) order_map_.prefetch(op.id);
+    }
+
+    [[nodiscard]] OpResult apply_one(const Op& op) noexcept {
+        OpResult r;
+        switch (op.type) {
+            case OpType::Add:
+                r.add = op.ord_type == OrdType::Iceberg ? add_iceberg(op.id, op.side, op.price, op.qty, op.peak)
+                                                        : add(op.id, op.side, op.price, op.qty, op.ord_type);
+                break;
+            case OpType::Cancel:
+                r.cancelled = cancel(op.id);
+                break;
+            case OpType::Match:
+                r.left = match(op.side, op.qty);
+                break;
+            case OpType::Modify:
+                r.modify = modify(op.id, op.price, op.qty);
+                break;
+        }
+        return r;
     }
 
 public:
+    // batch of ops, same result as calling add/cancel/match for each in order
+    // index slots are prefetched APPLY_LOOKAHEAD ops ahead so hashed lookups
+    // overlap; results[i] receives op i's outcome while it has room
+    void apply(std::span<const Op> ops, std::span<OpResult> results = {}) noexcept {
+        size_t n = ops.size();
+        for (size_t i = 0; i < std::min(n, APPLY_LOOKAHEAD); ++i) prefetch_op(ops[i]);
+
+        for (size_t i = 0; i < n; ++i) {
+            if (i + APPLY_LOOKAHEAD < n) prefetch_op(ops[i + APPLY_LOOKAHEAD]);
+            OpResult r = apply_one(ops[i]);
+            if (i < results.size()) results[i] = r;
+        }
+    }
+
+    // resting orders into out in snapshot order (see snapshot.hpp): bids best
+    // first, then asks best first, fifo within a level; returns records written
+    // ladder orders only - stops are not written, nor an iceberg's peak and reserve
+    size_t snapshot(std::span<SnapshotRecord> out) const noexcept {
+        static_assert(MaxPrice <= INT32_MAX, "snapshot records hold 32-bit prices");
+        size_t k = 0;
+        auto level_out = [this, out, &k](Price px) {
+            const auto& level = ladder_.level(px);
+            for (const order_type* o = level.front(); o != level.end() && k < out.size(); o = level.next_of(o)) {
+                if (o->filled()) continue;     // tombstone
+                // an iceberg is written as a limit order of its open qty
+                OrdType type = o->type == OrdType::Iceberg ? OrdType::Limit : o->type;
+                out[k++] = SnapshotRecord{o->id.raw(), o->ts.raw(), o->open_qty().raw(),
+                                          static_cast<int32_t>(o->price.raw()), o->side, type, pack(o->owned_by())};
+            }
+        };
+        for (Price px = best_bid_; px.raw() >= 0 && k < out.size(); px = ladder_.prev(px - Price{1})) level_out(px);
+        for (Price px = best_ask_; px.raw() <= MaxPrice && k < out.size(); px = ladder_.next(px + Price{1})) level_out(px);
+        return k;
+    }
+
+    // rebuild an empty book from snapshot records, queues in record order
+    // pool slots are taken in one block and filled in order, and no record
+    // goes through add(): no matching, crossing or best-price checks per order
+    [[nodiscard]] RestoreResult restore(std::span<const SnapshotRecord> recs) noexcept {
+        if (total_orders_ != 0) [[unlikely]] return RestoreResult::NotEmpty;
+        if (!stops_.empty() || calls_.size() != 0) [[unlikely]] return RestoreResult::OffLadder;
+        if (recs.size() > MaxOrders) [[unlikely]] return RestoreResult::PoolExhausted;
+
+        int64_t top_bid = -1;
+        int64_t low_ask = MaxPrice + 1;
+        for (const SnapshotRecord& r : recs) {
+            if (r.price < 0 || r.price > MaxPrice) [[unlikely]] return RestoreResult::InvalidPrice;
+            if (r.qty <= 0) [[unlikely]] return RestoreResult::InvalidQty;
+            if (!order_type::fits(OrderId{r.id}, Qty{r.qty}) || (!order_type::TAGGED && r.owner != 0)) [[unlikely]] {
+                return RestoreResult::InvalidId;
+            }
+            if (r.type != OrdType::Limit || (r.side != Side::Buy && r.side != Side::Sell)) [[unlikely]] {
+                return RestoreResult::InvalidType;
+            }
+            if (r.side == Side::Buy) {
+                top_bid = std::max<int64_t>(top_bid, r.price);
+            } else {
+                low_ask = std::min<int64_t>(low_ask, r.price);
+            }
+        }
+        if (top_bid >= low_ask) [[unlikely]] return RestoreResult::Crossed;
+
+        order_type* o = pool_.alloc_front(recs.size());
+        if (o == nullptr) [[unlikely]] return RestoreResult::PoolExhausted;
+        for (size_t i = 0; i < recs.size(); ++i, ++o) {
+            if (i + RESTORE_LOOKAHEAD < recs.size()) order_map_.prefetch(OrderId{recs[i + RESTORE_LOOKAHEAD].id});
+            const SnapshotRecord& r = recs[i];
+            ::new (static_cast<void*>(o)) order_type{OrderId{r.id}, Price{r.price}, Qty{r.qty},
+                                                     r.side, r.type, Timestamp{r.ts}};
+            o->tag(unpack_owner(r.owner));
+            RestoreResult err = !order_map_.insert(o) ? RestoreResult::DuplicateId
+                              : !ladder_.push_back(o) ? RestoreResult::LadderFull : RestoreResult::Ok;
+            if (err != RestoreResult::Ok) [[unlikely]] {
+                if (err == RestoreResult::LadderFull) order_map_.erase(o->id);
+                unwind_restore(i, recs.size());
+                return err;
+            }
+            queued(o);
+        }
+
+        total_orders_ = recs.size();
+        best_bid_ = Price{top_bid};
+        best_ask_ = Price{low_ask};
+        ladder_.follow(best_bid_, best_ask_);
+        publish_top();
+        return RestoreResult::Ok;
+    }
+
+private:
+    // undo the first `linked` restored orders and give back all `taken` slots
+    void unwind_restore(size_t linked, size_t taken) noexcept {
+        order_type* base = pool_.base();
+        for (size_t i = 0; i < linked; ++i) {
+            ladder_.remove(base + i);
+            order_map_.erase(base[i].id);
+        }
+        for (size_t i = 0; i < taken; ++i) pool_.dealloc(base + i);
+    }
+
+public:
+    // cap the pool below MaxOrders, e.g. sized from config at startup
+    // false if n is above MaxOrders or below the slots already handed out
+    [[nodiscard]] bool set_capacity(size_t n) noexcept { return pool_.set_capacity(n); }
+
     // accessors
     [[nodiscard]] Price bid() const noexcept { return best_bid_; }
     [[nodiscard]] Price ask() const noexcept { return best_ask_; }
 
     [[nodiscard]] Qty bid_qty() const noexcept {
         if (best_bid_.raw() < 0) [[unlikely]] return Qty{0};
-        return levels_[best_bid_.raw()].qty();
+        return ladder_.at(best_bid_).qty();
     }
 
     [[nodiscard]] Qty ask_qty() const noexcept {
         if (best_ask_.raw() > MaxPrice) [[unlikely]] return Qty{0};
-        return levels_[best_ask_.raw()].qty();
+        return ladder_.at(best_ask_).qty();
+    }
+
+    // n best populated levels of one side, best first, into out
+    // skips empty ticks through the ladder's occupancy; returns levels written
+    size_t depth(Side side, size_t n, std::span<LevelView> out) const noexcept {
+        n = std::min(n, out.size());
+        Price from = side == Side::Buy ? best_bid_ : best_ask_;
+        if (n == 0 || from.raw() < 0 || from.raw() > MaxPrice) return 0;
+        if constexpr (requires { ladder_.depth(side, from, n, out.data()); }) {
+            return ladder_.depth(side, from, n, out.data());
+        } else {
+            size_t k = 0;
+            for (Price px = from; k < n && px.raw() >= 0 && px.raw() <= MaxPrice;
+                 px = side == Side::Buy ? ladder_.prev(px - Price{1}) : ladder_.next(px + Price{1})) {
+                const auto& level = ladder_.level(px);
+                out[k].price = px;
+                out[k].qty = level.qty();
+                out[k++].count = static_cast<uint32_t>(level.count());
+            }
+            return k;
+        }
     }
 
+    [[nodiscard]] Bbo top() const noexcept { return Bbo{best_bid_, best_ask_, bid_qty(), ask_qty()}; }
     [[nodiscard]] Price spread() const noexcept { return best_ask_ - best_bid_; }
     [[nodiscard]] bool has_bid() const noexcept { return best_bid_.raw() >= 0; }
     [[nodiscard]] bool has_ask() const noexcept { return best_ask_.raw() <= MaxPrice; }
     [[nodiscard]] bool crossed() const noexcept { return has_bid() && has_ask() && best_bid_ >= best_ask_; }
-    [[nodiscard]] size_t order_count() const noexcept { return total_orders_; }
+    [[nodiscard]] size_t order_count() const noexcept { return total_orders_ - dead_orders_; }
+    [[nodiscard]] size_t tombstones() const noexcept { return dead_orders_; }
+    [[nodiscard]] size_t stop_count() const noexcept { return stops_.size(); }
+    [[nodiscard]] size_t iceberg_count() const noexcept { return icebergs_; }
+    [[nodiscard]] size_t call_count() const noexcept { return calls_.size(); }   // held for the uncross
+    [[nodiscard]] bool in_auction() const noexcept { return auction_; }
+    [[nodiscard]] Price last_trade() const noexcept { return last_px_; }
     [[nodiscard]] size_t pool_used() const noexcept { return pool_.used(); }
     [[nodiscard]] size_t pool_capacity() const noexcept { return pool_.capacity(); }
+    [[nodiscard]] pool_type& pool() noexcept { return pool_; }
+
+    [[nodiscard]] Listener& listener() noexcept { return listener_; }
+    [[nodiscard]] const Listener& listener() const noexcept { return listener_; }
 
-    [[nodiscard]] const Order* get_order(OrderId id) const noexcept { return lookup(id); }
-    [[nodiscard]] const PriceLevel& level_at(Price px) const noexcept { return levels_[px.raw()]; }
+    [[nodiscard]] const order_type* get_order(OrderId id) const noexcept { return find_live(id); }
+
+    // displayed qty queued ahead of a resting order, o(1) from its mark and
+    // its level's counters: what stood ahead when it joined less what the
+    // level has traded since. exact unless an order in front was cancelled
+    // or sized down since - those leave without saying from where, so it is
+    // then an upper bound, never above the level's qty less the order's own.
+    // zero at the front, Qty{-1} if id is not resting on the ladder
+    // needs a Queue that keeps marks
+    [[nodiscard]] Qty queue_ahead(OrderId id) const noexcept {
+        static_assert(QueueT::ENABLED, "queue_ahead needs a Queue policy that keeps marks, e.g. QueueMarks");
+        const order_type* o = find_live(id);
+        if (o == nullptr || o->type >= OrdType::Stop) [[unlikely]] return Qty{-1};
+        const auto& level = ladder_.at(o->price);
+        if (level.front() == o) return Qty{0};
+        Qty ahead = marks_.mark(pool_.index_of(o)) - level.traded();
+        return std::clamp(ahead, Qty{0}, level.qty() - o->remaining());
+    }
+
+    // entry number of a resting order's place in its level, from 1 and
+    // book-wide - the later it queued, the higher; an amend to the back or
+    // an iceberg's next slice is a new entry. 0 if id is not resting on the ladder
+    [[nodiscard]] uint64_t entry_seq(OrderId id) const noexcept {
+        static_assert(QueueT::ENABLED, "entry_seq needs a Queue policy that keeps marks, e.g. QueueMarks");
+        const order_type* o = find_live(id);
+        if (o == nullptr || o->type >= OrdType::Stop) [[unlikely]] return 0;
+        return marks_.seq(pool_.index_of(o));
+    }
+
+    // queue entries so far: an order has waited entries() - entry_seq(id) entries
+    [[nodiscard]] uint64_t entries() const noexcept {
+        static_assert(QueueT::ENABLED, "entries needs a Queue policy that keeps marks, e.g. QueueMarks");
+        return marks_.entries();
+    }
+    [[nodiscard]] decltype(auto) level_at(Price px) const noexcept { return ladder_.level(px); }
+    [[nodiscard]] const LadderT& ladder() const noexcept { return ladder_; }
 
     static constexpr int64_t max_price() noexcept { return MaxPrice; }
     static constexpr size_t max_orders() noexcept { return MaxOrders; }
@@ -0,0 +1,341 @@
+#pragma once
+
+#include "order.hpp"
+#include "storage.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <emmintrin.h>
+
+namespace ob {
+
+// order id -> Order* index policies for OrderBook
+// all share one interface: find / insert (false on duplicate or full) / erase,
+// plus prefetch(id) to pull in the slots a later lookup of id will probe
+// and take a Storage policy for their slot arrays and the order layout O
+
+// 64-bit finalizer (murmur3 fmix64) - spreads sequential and pre-hashed ids alike
+[[nodiscard]] constexpr uint64_t mix_id(uint64_t x) noexcept {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// power-of-two table with load factor <= 0.8 at full pool
+[[nodiscard]] constexpr size_t index_table_size(size_t capacity) noexcept {
+    size_t n = std::bit_ceil(capacity + capacity / 4);
+    return n < 16 ? 16 : n;
+}
+
+// direct-mapped order lookup: slot = id mod a power-of-two table with
+// headroom over capacity, so a full pool never means a full table
+// o(1) for sequential ids, handles collisions via linear probe
+template<size_t Capacity, typename Storage = InlineStorage, typename O = Order>
+class DirectIndex {
+    static constexpr size_t SIZE = index_table_size(Capacity);
+    static constexpr size_t MASK = SIZE - 1;
+
+    typename Storage::template array<O*, SIZE> slots_{};
+    // farthest any entry was ever placed from its home slot - a miss stops
+    // there instead of walking the rest of a long cluster
+    size_t max_probe_ = 0;
+
+    // hash: simple modulo - perfect for sequential ids
+    [[nodiscard]] static constexpr size_t slot(OrderId id) noexcept {
+        return static_cast<size_t>(id.raw() & MASK);
+    }
+
+public:
+    // o(1) lookup for sequential ids, o(k) for k collisions
+    [[nodiscard]] O* find(OrderId id) const noexcept {
+        size_t idx = slot(id);
+        O* o = slots_[idx];
+        if (o != nullptr && o->id == id) [[likely]] {
+            return o;
+        }
+        // linear probe for collision case
+        for (size_t d = 1; d <= max_probe_; ++d) {
+            idx = (idx + 1) & MASK;
+            o = slots_[idx];
+            if (o == nullptr) return nullptr;
+            if (o->id == id) return o;
+        }
+        return nullptr;
+    }
+
+    // sequential ids keep the live slots hot; this is for out-of-order ids
+    // such as a restore
+    void prefetch(OrderId id) const noexcept { __builtin_prefetch(&slots_[slot(id)], 1, 3); }
+
+    bool insert(O* o) noexcept {
+        size_t idx = slot(o->id);
+        size_t d = 0;
+        while (slots_[idx] != nullptr) {
+            if (slots_[idx]->id == o->id) [[unlikely]] {
+                return false;  // duplicate
+            }
+            idx = (idx + 1) & MASK;
+            if (++d == SIZE) [[unlikely]] return false;  // full
+        }
+        slots_[idx] = o;
+        max_probe_ = std::max(max_probe_, d);
+        return true;
+    }
+
+    // backward shift: later entries of the run move into the hole when their
+    // home is at or before it. nothing past max_probe_ from the hole can
+    // belong there, so the scan stops short of the end of a long cluster
+    void erase(OrderId id) noexcept {
+        size_t idx = slot(id);
+        for (size_t d = 0; d <= max_probe_ && slots_[idx] != nullptr; ++d, idx = (idx + 1) & MASK) {
+            if (slots_[idx]->id != id) continue;
+            size_t hole = idx;
+            size_t gap = 1;
+            for (size_t j = (hole + 1) & MASK; gap <= max_probe_ && slots_[j] != nullptr;
+                 j = (j + 1) & MASK, ++gap) {
+                size_t disp = (j - slot(slots_[j]->id)) & MASK;
+                if (disp >= gap) {
+                    slots_[hole] = slots_[j];
+                    hole = j;
+                    gap = 0;
+                }
+            }
+            slots_[hole] = nullptr;
+            return;
+        }
+    }
+};
+
+// robin hood open addressing with backward-shift deletion
+// slots carry the id so probes never touch the Order; probe length is bounded
+// by the richest-displaced entry and lookups stop early on a poorer slot
+template<size_t Capacity, typename Storage = InlineStorage, typename O = Order>
+class RobinHoodIndex {
+    static constexpr size_t SIZE = index_table_size(Capacity);
+    static constexpr size_t MASK = SIZE - 1;
+    static constexpr int SHIFT = 64 - std::countr_zero(SIZE);
+
+    struct Slot {
+        uint64_t id;
+        O* order;  // nullptr = empty
+    };
+
+    typename Storage::template array<Slot, SIZE> slots_{};
+    size_t size_ = 0;
+
+    // fibonacci hashing - one multiply, top bits
+    [[nodiscard]] static constexpr size_t home(uint64_t id) noexcept {
+        return static_cast<size_t>((id * 0x9e3779b97f4a7c15ULL) >> SHIFT);
+    }
+
+    [[nodiscard]] static constexpr size_t dist(size_t idx, uint64_t id) noexcept {
+        return (idx - home(id)) & MASK;
+    }
+
+public:
+    [[nodiscard]] O* find(OrderId id) const noexcept {
+        uint64_t key = id.raw();
+        size_t idx = home(key);
+        for (size_t d = 0;; ++d) {
+            const Slot& s = slots_[idx];
+            if (s.order == nullptr) return nullptr;
+            if (s.id == key) [[likely]] return s.order;
+            if (dist(idx, s.id) < d) return nullptr;  // key would have displaced s
+            idx = (idx + 1) & MASK;
+        }
+    }
+
+    void prefetch(OrderId id) const noexcept {
+        __builtin_prefetch(&slots_[home(id.raw())], 0, 3);
+    }
+
+    bool insert(O* o) noexcept {
+        if (size_ == SIZE) [[unlikely]] return false;
+        Slot cur{o->id.raw(), o};
+        size_t idx = home(cur.id);
+        bool displaced = false;
+        for (size_t d = 0;; ++d) {
+            Slot& s = slots_[idx];
+            if (s.order == nullptr) {
+                s = cur;
+                ++size_;
+                return true;
+            }
+            // until first swap the carried key is the new one
+            if (!displaced && s.id == cur.id) [[unlikely]] return false;
+            size_t sd = dist(idx, s.id);
+            if (sd < d) {
+                std::swap(cur, s);
+                d = sd;
+                displaced = true;
+            }
+            idx = (idx + 1) & MASK;
+        }
+    }
+
+    void erase(OrderId id) noexcept {
+        uint64_t key = id.raw();
+        size_t idx = home(key);
+        for (size_t d = 0;; ++d) {
+            const Slot& s = slots_[idx];
+            if (s.order == nullptr || dist(idx, s.id) < d) return;
+            if (s.id == key) break;
+            idx = (idx + 1) & MASK;
+        }
+        // backward shift: pull displaced successors one slot towards home
+        size_t next = (idx + 1) & MASK;
+        while (slots_[next].order != nullptr && dist(next, slots_[next].id) != 0) {
+            slots_[idx] = slots_[next];
+            idx = next;
+            next = (next + 1) & MASK;
+        }
+        slots_[idx] = Slot{};
+        --size_;
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+};
+
+// swiss-table style index: 16-slot groups with a 7-bit hash tag per slot
+// one sse2 compare finds tag candidates in a group; an order is only
+// dereferenced on a tag hit, so misses never touch order memory
+template<size_t Capacity, typename Storage = InlineStorage, typename O = Order>
+class SwissIndex {
+    static constexpr size_t SIZE = index_table_size(Capacity);
+    static constexpr size_t GROUP = 16;
+    static constexpr size_t GROUPS = SIZE / GROUP;
+
+    static constexpr uint8_t EMPTY = 0x80;
+    static constexpr uint8_t DELETED = 0xfe;  // tombstone, high bit set like EMPTY
+
+    alignas(64) typename Storage::template array<uint8_t, SIZE> tags_;
+    typename Storage::template array<O*, SIZE> slots_{};
+    size_t size_ = 0;
+    size_t tombstones_ = 0;
+
+    [[nodiscard]] static constexpr uint64_t hash(OrderId id) noexcept { return mix_id(id.raw()); }
+    [[nodiscard]] static constexpr size_t group_of(uint64_t h) noexcept { return (h >> 7) & (GROUPS - 1); }
+    [[nodiscard]] static constexpr uint8_t tag_of(uint64_t h) noexcept { return static_cast<uint8_t>(h & 0x7f); }
+
+    [[nodiscard]] __m128i load(size_t g) const noexcept {
+        return _mm_load_si128(reinterpret_cast<const __m128i*>(tags_.data() + g * GROUP));
+    }
+
+    [[nodiscard]] static uint32_t match(__m128i grp, uint8_t tag) noexcept {
+        return static_cast<uint32_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(grp, _mm_set1_epi8(static_cast<char>(tag)))));
+    }
+
+    // empty or deleted slots - both have the high bit set
+    [[nodiscard]] static uint32_t match_free(__m128i grp) noexcept {
+        return static_cast<uint32_t>(_mm_movemask_epi8(grp));
+    }
+
+    // slot index of id, or SIZE if absent
+    [[nodiscard]] size_t find_slot(OrderId id) const noexcept {
+        uint64_t h = hash(id);
+        uint8_t tag = tag_of(h);
+        size_t g = group_of(h);
+        // triangular probing visits every group of a power-of-two table
+        for (size_t i = 0; i < GROUPS; ++i) {
+            __m128i grp = load(g);
+            for (uint32_t m = match(grp, tag); m != 0; m &= m - 1) {
+                size_t idx = g * GROUP + static_cast<size_t>(std::countr_zero(m));
+                if (slots_[idx]->id == id) [[likely]] return idx;
+            }
+            if (match(grp, EMPTY) != 0) [[likely]] return SIZE;
+            g = (g + i + 1) & (GROUPS - 1);
+        }
+        return SIZE;
+    }
+
+    // first empty-or-deleted slot along h's probe sequence
+    [[nodiscard]] size_t first_free(uint64_t h) const noexcept {
+        size_t g = group_of(h);
+        for (size_t i = 0;; ++i) {
+            uint32_t m = match_free(load(g));
+            if (m != 0) return g * GROUP + static_cast<size_t>(std::countr_zero(m));
+            g = (g + i + 1) & (GROUPS - 1);
+        }
+    }
+
+public:
+    SwissIndex() noexcept(Storage::NOTHROW) { tags_.fill(EMPTY); }
+
+    [[nodiscard]] O* find(OrderId id) const noexcept {
+        size_t idx = find_slot(id);
+        return idx == SIZE ? nullptr : slots_[idx];
+    }
+
+    // tag group and the matching slot group
+    void prefetch(OrderId id) const noexcept {
+        size_t g = group_of(hash(id));
+        __builtin_prefetch(tags_.data() + g * GROUP, 0, 3);
+        __builtin_prefetch(&slots_[g * GROUP], 0, 3);
+    }
+
+    bool insert(O* o) noexcept {
+        if (size_ == SIZE) [[unlikely]] return false;
+        if (find_slot(o->id) != SIZE) [[unlikely]] return false;  // duplicate
+        if (tombstones_ > SIZE / 8) [[unlikely]] compact();
+
+        uint64_t h = hash(o->id);
+        size_t idx = first_free(h);
+        if (tags_[idx] == DELETED) --tombstones_;
+        tags_[idx] = tag_of(h);
+        slots_[idx] = o;
+        ++size_;
+        return true;
+    }
+
+    void erase(OrderId id) noexcept {
+        size_t idx = find_slot(id);
+        if (idx == SIZE) return;
+        // a group with an empty slot ends every probe through it,
+        // so the slot can go straight back to empty
+        if (match(load(idx / GROUP), EMPTY) != 0) {
+            tags_[idx] = EMPTY;
+        } else {
+            tags_[idx] = DELETED;
+            ++tombstones_;
+        }
+        slots_[idx] = nullptr;
+        --size_;
+    }
+
+    // in-place rehash that drops tombstones - o(table), amortised over erases
+    void compact() noexcept {
+        // live -> DELETED (pending placement), tombstone -> EMPTY
+        for (auto& t : tags_) t = (t & 0x80) != 0 ? EMPTY : DELETED;
+
+        for (size_t i = 0; i < SIZE; ++i) {
+            if (tags_[i] != DELETED) continue;
+            uint64_t h = hash(slots_[i]->id);
+            size_t target = first_free(h);
+            if (target / GROUP == i / GROUP) {
+                tags_[i] = tag_of(h);  // already in its first free group
+            } else if (tags_[target] == EMPTY) {
+                slots_[target] = slots_[i];
+                tags_[target] = tag_of(h);
+                slots_[i] = nullptr;
+                tags_[i] = EMPTY;
+            } else {
+                // target holds another pending entry - swap and reprocess i
+                std::swap(slots_[i], slots_[target]);
+                tags_[target] = tag_of(h);
+                --i;
+            }
+        }
+        tombstones_ = 0;
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+};
+
+} // namespace ob
@@ -0,0 +1,372 @@
+#pragma once
+
+#include "types.hpp"
+#include "order.hpp"
+#include "price_level.hpp"
+#include "level_bitmap.hpp"
+#include "memory_pool.hpp"
+#include "storage.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace ob {
+
+// price ladder policies for OrderBook: own the PriceLevels and their occupancy
+// shared interface:
+//   push_back(o) / remove(o)    link an order at o->price, false if no level available
+//   at(px)                      level of an occupied price (PriceLevel& or a level handle)
+//   level(px)                   read-only level at any price (shared empty level if none)
+//   prev(px) / next(px)         highest occupied <= px (-1) / lowest occupied >= px (MaxPrice+1)
+//   follow(bid, ask)            hint after the touch moves
+//   order_type                  order layout the ladder links
+// and optionally
+//   depth(side, from, n, out)   up to n occupied levels from `from` away from
+//                               the touch (down for bids, up for asks)
+
+// one populated level as seen by OrderBook::depth
+struct LevelView {
+    Price price;
+    Qty qty;
+    uint32_t count;
+};
+
+// one level per tick in [0, MaxPrice] plus occupancy bitmap
+// o(1) everything, ~128 bytes per tick
+template<int64_t MaxPrice, typename Storage = InlineStorage>
+class DenseLadder {
+    // array-based price level index
+    typename Storage::template array<PriceLevel, MaxPrice + 1> levels_{};
+
+    // occupancy index over levels_ - bit set iff level non-empty
+    LevelBitmap<MaxPrice + 1> occupied_;
+
+public:
+    using order_type = Order;
+
+    bool push_back(Order* o) noexcept {
+        PriceLevel& level = levels_[o->price.raw()];
+        if (level.empty()) occupied_.set(o->price.raw());
+        level.push_back(o);
+        return true;
+    }
+
+    void remove(Order* o) noexcept {
+        PriceLevel& level = levels_[o->price.raw()];
+        level.remove(o);
+        if (level.empty()) occupied_.clear(o->price.raw());
+    }
+
+    [[nodiscard]] PriceLevel& at(Price px) noexcept { return levels_[px.raw()]; }
+    [[nodiscard]] const PriceLevel& at(Price px) const noexcept { return levels_[px.raw()]; }
+    [[nodiscard]] const PriceLevel& level(Price px) const noexcept { return levels_[px.raw()]; }
+
+    [[nodiscard]] Price prev(Price px) const noexcept { return Price{occupied_.prev(px.raw())}; }
+    [[nodiscard]] Price next(Price px) const noexcept { return Price{occupied_.next(px.raw())}; }
+
+    void follow(Price, Price) noexcept {}
+
+    [[nodiscard]] size_t depth(Side side, Price from, size_t n, LevelView* out) const noexcept {
+        auto view = [this, out](size_t i, int64_t p) {
+            const PriceLevel& level = levels_[static_cast<size_t>(p)];
+            out[i].price = Price{p};
+            out[i].qty = level.qty();
+            out[i].count = static_cast<uint32_t>(level.count());
+        };
+        return side == Side::Buy ? occupied_.for_each_down(from.raw(), n, view)
+                                 : occupied_.for_each_up(from.raw(), n, view);
+    }
+};
+
+// one slim level per tick, structure-of-arrays: list heads and counts in one
+// array, aggregate qty in another - 32 bytes per tick instead of ~128, and
+// qty/depth scans stream through 8-byte entries
+// Idx = uint32_t links CompactOrder by pool slot (20 bytes per tick); the
+// book hands the pool base over through bind()
+template<int64_t MaxPrice, typename Storage = InlineStorage, typename Idx = uint64_t>
+class CompactLadder {
+    using Level = BasicSlimLevel<Idx>;
+    using Links = typename Level::links_type;
+    using Ref = SlimLevelRef<Level, Qty>;
+    using ConstRef = SlimLevelRef<const Level, const Qty>;
+
+    typename Storage::template array<Level, MaxPrice + 1> levels_{};
+    typename Storage::template array<Qty, MaxPrice + 1> qty_{};
+    LevelBitmap<MaxPrice + 1> occupied_;
+    [[no_unique_address]] Links links_{};
+
+public:
+    using order_type = typename Level::order_type;
+
+    void bind(order_type* base) noexcept { links_ = Links{base}; }
+
+    bool push_back(order_type* o) noexcept {
+        auto i = static_cast<size_t>(o->price.raw());
+        if (levels_[i].empty()) occupied_.set(o->price.raw());
+        levels_[i].push_back(o, links_);
+        qty_[i] += o->qty;
+        return true;
+    }
+
+    void remove(order_type* o) noexcept {
+        auto i = static_cast<size_t>(o->price.raw());
+        levels_[i].remove(o, links_);
+        qty_[i] -= o->qty;
+        if (levels_[i].empty()) occupied_.clear(o->price.raw());
+    }
+
+    [[nodiscard]] Ref at(Price px) noexcept {
+        auto i = static_cast<size_t>(px.raw());
+        return Ref{&levels_[i], &qty_[i], links_};
+    }
+
+    [[nodiscard]] ConstRef at(Price px) const noexcept { return level(px); }
+
+    [[nodiscard]] ConstRef level(Price px) const noexcept {
+        auto i = static_cast<size_t>(px.raw());
+        return ConstRef{&levels_[i], &qty_[i], links_};
+    }
+
+    [[nodiscard]] Price prev(Price px) const noexcept { return Price{occupied_.prev(px.raw())}; }
+    [[nodiscard]] Price next(Price px) const noexcept { return Price{occupied_.next(px.raw())}; }
+
+    void follow(Price, Price) noexcept {}
+
+    // contiguous per-tick aggregate qty, indexed by price
+    [[nodiscard]] const Qty* qty_data() const noexcept { return qty_.data(); }
+
+    // field by field: gcc otherwise builds the view on the stack and reloads
+    // it as one 16-byte vector, which stalls on store forwarding
+    [[nodiscard]] size_t depth(Side side, Price from, size_t n, LevelView* out) const noexcept {
+        auto view = [this, out](size_t i, int64_t p) {
+            auto t = static_cast<size_t>(p);
+            out[i].price = Price{p};
+            out[i].qty = qty_[t];
+            out[i].count = levels_[t].order_cnt;
+        };
+        return side == Side::Buy ? occupied_.for_each_down(from.raw(), n, view)
+                                 : occupied_.for_each_up(from.raw(), n, view);
+    }
+};
+
+// compact ladder over 32-byte CompactOrders
+template<int64_t MaxPrice, typename Storage = InlineStorage>
+using SlotLadder = CompactLadder<MaxPrice, Storage, uint32_t>;
+
+// dense window of Window levels around the touch, everything else in a
+// compact sorted overflow of pooled levels. the window recenters lazily once
+// the mid leaves its middle half; levels are spliced, orders never move
+template<int64_t MaxPrice, typename Storage = InlineStorage,
+         int64_t Window = 4096, size_t OverflowLevels = 4096>
+class WindowLadder {
+    static_assert(Window > 0 && Window <= MaxPrice + 1, "window must fit the price range");
+
+    static constexpr int64_t MAX_BASE = MaxPrice + 1 - Window;
+
+    // far-from-touch level, sorted by price
+    struct Far {
+        int64_t px;
+        PriceLevel* level;
+    };
+
+    typename Storage::template array<PriceLevel, Window> window_{};
+    LevelBitmap<Window> occupied_;   // window-relative
+    int64_t base_ = 0;               // window covers [base_, base_ + Window)
+
+    std::array<Far, OverflowLevels> far_{};
+    size_t far_cnt_ = 0;
+    MemPool<PriceLevel, OverflowLevels, Storage> far_pool_;
+
+    [[nodiscard]] bool in_window(int64_t px) const noexcept {
+        return px >= base_ && px < base_ + Window;
+    }
+
+    // first far entry with price >= px
+    [[nodiscard]] size_t far_lower(int64_t px) const noexcept {
+        const Far* it = std::lower_bound(far_.data(), far_.data() + far_cnt_, px,
+            [](const Far& f, int64_t p) { return f.px < p; });
+        return static_cast<size_t>(it - far_.data());
+    }
+
+    [[nodiscard]] PriceLevel* far_find(int64_t px) const noexcept {
+        size_t i = far_lower(px);
+        return i < far_cnt_ && far_[i].px == px ? far_[i].level : nullptr;
+    }
+
+    // far level for px, created if missing
+    [[nodiscard]] PriceLevel* far_get(int64_t px) noexcept {
+        size_t i = far_lower(px);
+        if (i < far_cnt_ && far_[i].px == px) return far_[i].level;
+        if (far_cnt_ == OverflowLevels) [[unlikely]] return nullptr;
+        PriceLevel* level = far_pool_.create();
+        if (level == nullptr) [[unlikely]] return nullptr;
+        std::memmove(&far_[i + 1], &far_[i], (far_cnt_ - i) * sizeof(Far));
+        far_[i] = Far{px, level};
+        ++far_cnt_;
+        return level;
+    }
+
+    void far_erase(size_t i) noexcept {
+        far_pool_.dealloc(far_[i].level);
+        std::memmove(&far_[i], &far_[i + 1], (far_cnt_ - i - 1) * sizeof(Far));
+        --far_cnt_;
+    }
+
+    // move the window to [new_base, new_base + Window)
+    // evicted levels go to overflow, overflow levels inside the new window come in
+    void recenter(int64_t new_base) noexcept {
+        int64_t delta = new_base - base_;
+        if (delta == 0) return;
+
+        // count evictions first - give up rather than overflow the overflow
+        size_t evict = 0;
+        for (int64_t off = occupied_.next(0); off < Window; off = occupied_.next(off + 1)) {
+            if (!(base_ + off >= new_base && base_ + off < new_base + Window)) ++evict;
+        }
+        if (evict > OverflowLevels - far_cnt_) [[unlikely]] return;
+
+        // evict levels that fall outside the new window
+        for (int64_t off = occupied_.next(0); off < Window; off = occupied_.next(off + 1)) {
+            int64_t px = base_ + off;
+            if (px >= new_base && px < new_base + Window) continue;
+            window_[static_cast<size_t>(off)].splice_into(*far_get(px));
+            occupied_.clear(off);
+        }
+
+        // shift survivors in the direction that never overwrites a pending level
+        if (delta > 0) {
+            for (int64_t off = occupied_.next(0); off < Window; off = occupied_.next(off + 1)) {
+                shift(off, off - delta);
+            }
+        } else {
+            for (int64_t off = occupied_.prev(Window - 1); off >= 0; off = occupied_.prev(off - 1)) {
+                shift(off, off - delta);
+            }
+        }
+        base_ = new_base;
+
+        // pull in overflow levels now inside the window - a contiguous run
+        size_t lo = far_lower(base_);
+        size_t hi = lo;
+        while (hi < far_cnt_ && far_[hi].px < base_ + Window) {
+            int64_t off = far_[hi].px - base_;
+            far_[hi].level->splice_into(window_[static_cast<size_t>(off)]);
+            occupied_.set(off);
+            far_pool_.dealloc(far_[hi].level);
+            ++hi;
+        }
+        std::memmove(&far_[lo], &far_[hi], (far_cnt_ - hi) * sizeof(Far));
+        far_cnt_ -= hi - lo;
+    }
+
+    void shift(int64_t from, int64_t to) noexcept {
+        window_[static_cast<size_t>(from)].splice_into(window_[static_cast<size_t>(to)]);
+        occupied_.clear(from);
+        occupied_.set(to);
+    }
+
+    [[nodiscard]] static constexpr int64_t clamp_base(int64_t b) noexcept {
+        return std::clamp(b, int64_t{0}, MAX_BASE);
+    }
+
+public:
+    using order_type = Order;
+
+    WindowLadder() noexcept(Storage::NOTHROW) = default;
+
+    bool push_back(Order* o) noexcept {
+        int64_t px = o->price.raw();
+        if (in_window(px)) [[likely]] {
+            PriceLevel& level = window_[static_cast<size_t>(px - base_)];
+            if (level.empty()) occupied_.set(px - base_);
+            level.push_back(o);
+            return true;
+        }
+        // empty ladder - anchor the window on the first order
+        if (!occupied_.any() && far_cnt_ == 0) {
+            base_ = clamp_base(px - Window / 2);
+            return push_back(o);
+        }
+        PriceLevel* level = far_get(px);
+        if (level == nullptr) [[unlikely]] return false;
+        level->push_back(o);
+        return true;
+    }
+
+    void remove(Order* o) noexcept {
+        int64_t px = o->price.raw();
+        if (in_window(px)) [[likely]] {
+            PriceLevel& level = window_[static_cast<size_t>(px - base_)];
+            level.remove(o);
+            if (level.empty()) occupied_.clear(px - base_);
+            return;
+        }
+        size_t i = far_lower(px);
+        far_[i].level->remove(o);
+        if (far_[i].level->empty()) far_erase(i);
+    }
+
+    [[nodiscard]] PriceLevel& at(Price px) noexcept {
+        if (in_window(px.raw())) [[likely]] return window_[static_cast<size_t>(px.raw() - base_)];
+        return *far_find(px.raw());
+    }
+
+    [[nodiscard]] const PriceLevel& at(Price px) const noexcept {
+        if (in_window(px.raw())) [[likely]] return window_[static_cast<size_t>(px.raw() - base_)];
+        return *far_find(px.raw());
+    }
+
+    [[nodiscard]] const PriceLevel& level(Price px) const noexcept {
+        static const PriceLevel none{};
+        if (in_window(px.raw())) return window_[static_cast<size_t>(px.raw() - base_)];
+        const PriceLevel* l = far_find(px.raw());
+        return l != nullptr ? *l : none;
+    }
+
+    [[nodiscard]] Price prev(Price px) const noexcept {
+        int64_t p = px.raw();
+        if (p < 0) return NO_BID;
+        // window first; overflow below the window can only win if the window has nothing
+        if (p >= base_) {
+            int64_t off = occupied_.prev(std::min(p - base_, Window - 1));
+            if (off >= 0 && p < base_ + Window) return Price{base_ + off};
+            size_t i = far_lower(p + 1);
+            int64_t far = i > 0 ? far_[i - 1].px : -1;
+            return Price{off >= 0 ? std::max(base_ + off, far) : far};
+        }
+        size_t i = far_lower(p + 1);
+        return Price{i > 0 ? far_[i - 1].px : -1};
+    }
+
+    [[nodiscard]] Price next(Price px) const noexcept {
+        int64_t p = px.raw();
+        if (p > MaxPrice) return Price{MaxPrice + 1};
+        if (p < base_ + Window) {
+            int64_t off = occupied_.next(std::max(p - base_, int64_t{0}));
+            if (off < Window && p >= base_) return Price{base_ + off};
+            size_t i = far_lower(p);
+            int64_t far = i < far_cnt_ ? far_[i].px : MaxPrice + 1;
+            return Price{off < Window ? std::min(base_ + off, far) : far};
+        }
+        size_t i = far_lower(p);
+        return Price{i < far_cnt_ ? far_[i].px : MaxPrice + 1};
+    }
+
+    // recenter on the mid once it leaves the middle half of the window
+    void follow(Price bid, Price ask) noexcept {
+        bool has_bid = bid.raw() >= 0;
+        bool has_ask = ask.raw() <= MaxPrice;
+        if (!has_bid && !has_ask) return;
+        int64_t mid = has_bid && has_ask ? (bid.raw() + ask.raw()) / 2
+                    : has_bid ? bid.raw() : ask.raw();
+        if (mid >= base_ + Window / 4 && mid < base_ + Window - Window / 4) [[likely]] return;
+        recenter(clamp_base(mid - Window / 2));
+    }
+
+    [[nodiscard]] int64_t window_base() const noexcept { return base_; }
+    [[nodiscard]] size_t overflow_levels() const noexcept { return far_cnt_; }
+};
+
+} // namespace ob
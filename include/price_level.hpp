@@ -1,15 +1,24 @@
 #pragma once
 
 #include "order.hpp"
+#include <cstdint>
+#include <type_traits>
 
 namespace ob {
 
 // sentinel-based intrusive doubly-linked list
 // eliminates null checks in hot path
+// pointer-linked orders only - the sentinel lives outside the order pool
+// entered/traded run from the level's last opening, for level statistics
+// and queue estimates (OrderBook::queue_ahead); entered - traded - qty is
+// what cancels and amends took out. they sit in the sentinel's padding,
+// so cost no space
 struct PriceLevel {
     Order sentinel;        // prev = tail, next = head
     size_t order_cnt = 0;
     Qty total_qty{0};
+    Qty entered_qty{0};    // displayed qty queued at the back
+    Qty traded_qty{0};     // qty filled from the front
 
     PriceLevel() noexcept {
         // circular: sentinel points to itself when empty
@@ -19,6 +28,10 @@ struct PriceLevel {
 
     // o(1) append to back (fifo ordering)
     void push_back(Order* o) noexcept {
+        if (order_cnt == 0) {
+            entered_qty = Qty{0};
+            traded_qty = Qty{0};
+        }
         Order* tail = sentinel.prev;
         o->prev = tail;
         o->next = &sentinel;
@@ -26,6 +39,7 @@ struct PriceLevel {
         sentinel.prev = o;
         ++order_cnt;
         total_qty += o->qty;
+        entered_qty += o->qty;
     }
 
     // o(1) remove order from list
@@ -38,11 +52,43 @@ struct PriceLevel {
         o->next = nullptr;
     }
 
-    // reduce total qty when order partially filled
+    // move every order to an empty level, leaving this one empty
+    // orders link to the sentinel so a level can't be copied - splice instead
+    void splice_into(PriceLevel& dst) noexcept {
+        if (empty()) return;
+        Order* head = sentinel.next;
+        Order* tail = sentinel.prev;
+        head->prev = &dst.sentinel;
+        tail->next = &dst.sentinel;
+        dst.sentinel.next = head;
+        dst.sentinel.prev = tail;
+        dst.order_cnt = order_cnt;
+        dst.total_qty = total_qty;
+        dst.entered_qty = entered_qty;
+        dst.traded_qty = traded_qty;
+        sentinel.prev = &sentinel;
+        sentinel.next = &sentinel;
+        order_cnt = 0;
+        total_qty = Qty{0};
+    }
+
+    // qty filled off the front
+    void trade(Qty amount) noexcept {
+        total_qty -= amount;
+        traded_qty += amount;
+    }
+
+    // qty taken out without trading - a lazy cancel or an amend down
     void reduce_qty(Qty amount) noexcept {
         total_qty -= amount;
     }
 
+    // a lone iceberg shows its next slice in place, queued as if pushed
+    void requeue(Qty amount) noexcept {
+        total_qty += amount;
+        entered_qty += amount;
+    }
+
     // first order (fifo head)
     [[nodiscard]] Order* front() noexcept {
         return sentinel.next;
@@ -52,11 +98,24 @@ struct PriceLevel {
         return sentinel.next;
     }
 
+    // successor in fifo order, end() after the last
+    [[nodiscard]] Order* next_of(const Order* o) noexcept {
+        return o->next;
+    }
+
+    [[nodiscard]] const Order* next_of(const Order* o) const noexcept {
+        return o->next;
+    }
+
     // last order
     [[nodiscard]] Order* back() noexcept {
         return sentinel.prev;
     }
 
+    [[nodiscard]] const Order* back() const noexcept {
+        return sentinel.prev;
+    }
+
     // check if level is empty
     [[nodiscard]] bool empty() const noexcept {
         return order_cnt == 0;
@@ -78,6 +137,101 @@ struct PriceLevel {
     [[nodiscard]] Qty qty() const noexcept {
         return total_qty;
     }
+
+    [[nodiscard]] Qty entered() const noexcept { return entered_qty; }
+    [[nodiscard]] Qty traded() const noexcept { return traded_qty; }
+    [[nodiscard]] Qty withdrawn() const noexcept { return entered_qty - traded_qty - total_qty; }
+};
+
+static_assert(sizeof(PriceLevel) == 2 * sizeof(Order), "level counters must fit the sentinel's padding");
+
+// compact level - no embedded sentinel, nil-terminated list
+// the aggregate qty is kept by the ladder in its own contiguous array
+// Idx picks the order layout: pointer links (24 bytes) or pool slots (12 bytes)
+template<typename Idx>
+struct BasicSlimLevel {
+    using order_type = BasicOrder<Idx>;
+    using links_type = OrderLinks<Idx>;
+    using Link = typename order_type::Link;
+
+    static constexpr Link NIL = links_type::NIL;
+
+    Link head = NIL;
+    Link tail = NIL;
+    uint32_t order_cnt = 0;
+
+    // o(1) append to back (fifo ordering)
+    void push_back(order_type* o, links_type links) noexcept {
+        Link self = links.link(o);
+        o->prev = tail;
+        o->next = NIL;
+        if (tail != NIL) {
+            links.at(tail)->next = self;
+        } else {
+            head = self;
+        }
+        tail = self;
+        ++order_cnt;
+    }
+
+    // o(1) remove order from list
+    void remove(order_type* o, links_type links) noexcept {
+        if (o->prev != NIL) {
+            links.at(o->prev)->next = o->next;
+        } else {
+            head = o->next;
+        }
+        if (o->next != NIL) {
+            links.at(o->next)->prev = o->prev;
+        } else {
+            tail = o->prev;
+        }
+        --order_cnt;
+        o->prev = NIL;
+        o->next = NIL;
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return order_cnt == 0; }
+};
+
+using SlimLevel = BasicSlimLevel<uint64_t>;
+using CompactSlimLevel = BasicSlimLevel<uint32_t>;
+
+static_assert(sizeof(SlimLevel) == 24, "SlimLevel must stay compact");
+static_assert(sizeof(CompactSlimLevel) == 12, "CompactSlimLevel must stay compact");
+
+// handle pairing a slim level with its out-of-line qty
+// same surface as PriceLevel so the matcher and readers take either
+template<typename Level, typename QtyT>
+class SlimLevelRef {
+    using Slim = std::remove_const_t<Level>;
+    using O = typename Slim::order_type;
+    using Links = typename Slim::links_type;
+
+    Level* level_;
+    QtyT* qty_;
+    [[no_unique_address]] Links links_;
+
+    [[nodiscard]] O* resolve(typename Slim::Link l) const noexcept {
+        return l != Slim::NIL ? links_.at(l) : nullptr;
+    }
+
+public:
+    SlimLevelRef(Level* level, QtyT* qty, Links links) noexcept
+        : level_(level), qty_(qty), links_(links) {}
+
+    // slim levels keep no running counters - every change is just qty
+    void trade(Qty amount) noexcept { *qty_ -= amount; }
+    void reduce_qty(Qty amount) noexcept { *qty_ -= amount; }
+    void requeue(Qty amount) noexcept { *qty_ += amount; }
+
+    [[nodiscard]] O* front() const noexcept { return resolve(level_->head); }
+    [[nodiscard]] O* back() const noexcept { return resolve(level_->tail); }
+    [[nodiscard]] O* next_of(const O* o) const noexcept { return resolve(o->next); }
+    [[nodiscard]] static constexpr O* end() noexcept { return nullptr; }
+    [[nodiscard]] bool empty() const noexcept { return level_->order_cnt == 0; }
+    [[nodiscard]] size_t count() const noexcept { return level_->order_cnt; }
+    [[nodiscard]] Qty qty() const noexcept { return *qty_; }
 };
 
 } // namespace ob
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "types.hpp"
+#include "storage.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace ob {
+
+// queue position policies for OrderBook, by pool slot
+// an order joining the back of a level takes the next entry number and notes
+// the qty then ahead of it plus the level's traded() so far. fills only come
+// off the front, so while it rests everything the level trades was ahead of
+// it: the mark less traded() is what still stands ahead, but for cancels and
+// amends down in front since it joined - see OrderBook::queue_ahead
+// the orders themselves have no bytes left, so the marks sit in their own
+// array beside the pool, and only slots in use are ever read
+
+// no marks - queue_ahead is not available, and the book pays nothing
+template<size_t Capacity, typename Storage = InlineStorage>
+struct NoQueueMarks {
+    static constexpr bool ENABLED = false;
+
+    void enter(size_t, Qty) noexcept {}
+};
+
+// 16 bytes per pool slot
+template<size_t Capacity, typename Storage = InlineStorage>
+class QueueMarks {
+    struct Mark {
+        Qty mark;           // qty ahead when the order joined, plus the level's traded()
+        uint64_t seq;       // entry number, from 1
+    };
+
+    typename Storage::template array<Mark, Capacity> marks_{};
+    uint64_t seq_ = 0;
+
+public:
+    static constexpr bool ENABLED = true;
+
+    // the order in slot joins the back of a level
+    void enter(size_t slot, Qty mark) noexcept { marks_[slot] = Mark{mark, ++seq_}; }
+
+    [[nodiscard]] Qty mark(size_t slot) const noexcept { return marks_[slot].mark; }
+    [[nodiscard]] uint64_t seq(size_t slot) const noexcept { return marks_[slot].seq; }
+
+    // entries so far - an order's age in entries is entries() - seq(slot)
+    [[nodiscard]] uint64_t entries() const noexcept { return seq_; }
+};
+
+} // namespace ob
@@ -0,0 +1,272 @@
+#pragma once
+
+#include "types.hpp"
+#include "op.hpp"
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ob {
+
+// packed binary message file, itch style: a 16-byte header then fixed
+// 32-byte little-endian records
+//
+//   header   0  char[8]  "OBREPLAY"
+//            8  u64      record count
+//   record   0  u8       type      'A' add, 'X' cancel, 'E' execute, 'U' replace,
+//                                  'O' call phase opens, 'C' uncross
+//            1  u8       side      'B' / 'S' - aggressor side for executes
+//            2  u8       ord_type  0 limit, 1 market, 2 ioc, 3 fok, 4 iceberg, 5 stop
+//            3  u8       reserved
+//            4  u32      qty
+//            8  u64      id        order ref (old ref for replace)
+//           16  u64      new_id    replace only
+//           24  u32      price     ticks (trigger price for a stop)
+//           28  u32      peak      iceberg slice, else 0
+//
+// execute sweeps qty from the opposite side like OrderBook::match;
+// replace is cancel(id) then add(new_id, ...), losing time priority as in itch;
+// a replace that keeps its ref (new_id == id) is an amend through OrderBook::modify;
+// 'O' and 'C' carry no order and drive begin_auction / uncross on books that have them
+
+static_assert(std::endian::native == std::endian::little, "records are decoded in place");
+
+inline constexpr char REPLAY_MAGIC[8] = {'O', 'B', 'R', 'E', 'P', 'L', 'A', 'Y'};
+inline constexpr size_t REPLAY_HEADER = 16;
+inline constexpr size_t REPLAY_RECORD = 32;
+
+enum class MsgType : uint8_t {
+    Add = 'A',
+    Cancel = 'X',
+    Execute = 'E',
+    Replace = 'U',
+    Auction = 'O',
+    Uncross = 'C'
+};
+
+// decoded record - fields widened to the book's types
+struct Msg {
+    MsgType type;
+    Side side;
+    OrdType ord_type;
+    Qty qty;
+    OrderId id;
+    OrderId new_id;
+    Price price;
+    Qty peak{0};
+};
+
+namespace detail {
+
+template<typename T>
+[[nodiscard]] inline T load_le(const std::byte* p) noexcept {
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+template<typename T>
+inline void store_le(std::byte* p, T v) noexcept {
+    std::memcpy(p, &v, sizeof(T));
+}
+
+} // namespace detail
+
+// read one record straight out of the mapping
+[[nodiscard]] inline Msg decode(const std::byte* r) noexcept {
+    return Msg{
+        static_cast<MsgType>(r[0]),
+        static_cast<uint8_t>(r[1]) == 'S' ? Side::Sell : Side::Buy,
+        static_cast<OrdType>(r[2]),
+        Qty{detail::load_le<uint32_t>(r + 4)},
+        OrderId{detail::load_le<uint64_t>(r + 8)},
+        OrderId{detail::load_le<uint64_t>(r + 16)},
+        Price{detail::load_le<uint32_t>(r + 24)},
+        Qty{detail::load_le<uint32_t>(r + 28)},
+    };
+}
+
+inline void encode(std::byte* r, const Msg& m) noexcept {
+    std::memset(r, 0, REPLAY_RECORD);
+    r[0] = static_cast<std::byte>(m.type);
+    r[1] = static_cast<std::byte>(m.side == Side::Sell ? 'S' : 'B');
+    r[2] = static_cast<std::byte>(m.ord_type);
+    detail::store_le(r + 4, static_cast<uint32_t>(m.qty.raw()));
+    detail::store_le(r + 8, m.id.raw());
+    detail::store_le(r + 16, m.new_id.raw());
+    detail::store_le(r + 24, static_cast<uint32_t>(m.price.raw()));
+    detail::store_le(r + 28, static_cast<uint32_t>(m.peak.raw()));
+}
+
+// a known record type, and for one that adds an order an ord_type the wire
+// carries - decode takes any byte, so check before a record reaches a book
+[[nodiscard]] constexpr bool well_formed(const Msg& m) noexcept {
+    switch (m.type) {
+        case MsgType::Add:
+        case MsgType::Replace: return m.ord_type <= OrdType::Stop;
+        case MsgType::Cancel:
+        case MsgType::Execute:
+        case MsgType::Auction:
+        case MsgType::Uncross: return true;
+    }
+    return false;
+}
+
+// WorkloadGen op -> message; prices and qtys must fit 32 bits
+[[nodiscard]] inline Msg to_msg(const Op& op) noexcept {
+    switch (op.type) {
+        case OpType::Add:
+            return Msg{MsgType::Add, op.side, op.ord_type, op.qty, op.id, OrderId{0}, op.price, op.peak};
+        case OpType::Cancel:
+            return Msg{MsgType::Cancel, op.side, op.ord_type, op.qty, op.id, OrderId{0}, op.price};
+        case OpType::Match:
+            return Msg{MsgType::Execute, op.side, op.ord_type, op.qty, op.id, OrderId{0}, op.price};
+        case OpType::Modify:
+            return Msg{MsgType::Replace, op.side, op.ord_type, op.qty, op.id, op.id, op.price};
+    }
+    return Msg{};
+}
+
+namespace detail {
+
+// AddResult::Ok and ModifyResult::Ok are 0 - without naming the book's enums here
+template<typename R>
+[[nodiscard]] constexpr bool ok(R r) noexcept { return r == R{}; }
+
+// the order m adds, under id
+template<typename Book>
+[[nodiscard]] inline auto add_from(Book& book, OrderId id, const Msg& m, Timestamp ts) noexcept {
+    if (m.ord_type == OrdType::Iceberg) return book.add_iceberg(id, m.side, m.price, m.qty, m.peak, ts);
+    return book.add(id, m.side, m.price, m.qty, m.ord_type, ts);
+}
+
+// whether a replace's new order passes the checks add() makes up front, so
+// the old ref is not cancelled for an add that is bound to be refused
+template<typename Book>
+[[nodiscard]] inline bool replaceable(const Book& book, const Msg& m) noexcept {
+    return book.get_order(m.id) != nullptr && book.get_order(m.new_id) == nullptr && m.qty.raw() > 0 &&
+           m.price.raw() >= 0 && m.price.raw() <= Book::max_price() &&
+           (m.ord_type != OrdType::Iceberg || m.peak.raw() > 0);
+}
+
+} // namespace detail
+
+// apply one message to a book; ts stamps the fills it causes
+// a record that is not well_formed is skipped. false if the book did not take
+// the message: skipped, refused, or a cancel, replace or execute that found nothing
+template<typename Book>
+inline bool dispatch(Book& book, const Msg& m, Timestamp ts = Timestamp{0}) noexcept {
+    if (!well_formed(m)) [[unlikely]] return false;
+    switch (m.type) {
+        case MsgType::Add:
+            return detail::ok(detail::add_from(book, m.id, m, ts));
+        case MsgType::Cancel:
+            return book.cancel(m.id);
+        case MsgType::Execute:
+            return book.match(m.side, m.qty, OrderId{0}, ts) != m.qty;
+        case MsgType::Replace:
+            if (m.new_id == m.id) return detail::ok(book.modify(m.id, m.price, m.qty));
+            // a ladder or stop level can still run out; the old order is then gone
+            if (!detail::replaceable(book, m) || !book.cancel(m.id)) return false;
+            return detail::ok(detail::add_from(book, m.new_id, m, ts));
+        case MsgType::Auction:
+            if constexpr (requires { book.begin_auction(); }) {
+                book.begin_auction();
+                return true;
+            }
+            return false;
+        case MsgType::Uncross:
+            if constexpr (requires { book.uncross(ts); }) {
+                (void)book.uncross(ts);
+                return true;
+            }
+            return false;
+    }
+    return false;
+}
+
+// read-only mapping of a replay file; throws std::system_error on open/map
+// failure and std::runtime_error on a malformed header
+class ReplayFile {
+    const std::byte* data_ = nullptr;
+    size_t len_ = 0;
+    size_t count_ = 0;
+
+public:
+    explicit ReplayFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::system_error(errno, std::generic_category(), path);
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), path);
+        }
+        len_ = static_cast<size_t>(st.st_size);
+        void* p = len_ == 0 ? MAP_FAILED : ::mmap(nullptr, len_, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) throw std::system_error(errno, std::generic_category(), path);
+        data_ = static_cast<const std::byte*>(p);
+        ::madvise(p, len_, MADV_SEQUENTIAL);
+
+        count_ = len_ >= REPLAY_HEADER ? detail::load_le<uint64_t>(data_ + 8) : 0;
+        if (len_ < REPLAY_HEADER || std::memcmp(data_, REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0 ||
+            count_ > (len_ - REPLAY_HEADER) / REPLAY_RECORD) {
+            ::munmap(const_cast<std::byte*>(data_), len_);
+            throw std::runtime_error(path + ": not a replay file");
+        }
+    }
+
+    ~ReplayFile() { ::munmap(const_cast<std::byte*>(data_), len_); }
+
+    ReplayFile(const ReplayFile&) = delete;
+    ReplayFile& operator=(const ReplayFile&) = delete;
+
+    [[nodiscard]] size_t size() const noexcept { return count_; }
+    [[nodiscard]] Msg operator[](size_t i) const noexcept {
+        return decode(data_ + REPLAY_HEADER + i * REPLAY_RECORD);
+    }
+
+    // raw records, for callers that decode themselves
+    [[nodiscard]] std::span<const std::byte> records() const noexcept {
+        return {data_ + REPLAY_HEADER, count_ * REPLAY_RECORD};
+    }
+
+    // every message into book, in file order
+    template<typename Book>
+    void replay(Book& book) const noexcept {
+        const std::byte* r = data_ + REPLAY_HEADER;
+        for (size_t i = 0; i < count_; ++i, r += REPLAY_RECORD) dispatch(book, decode(r));
+    }
+};
+
+// write ops as a replay file - how WorkloadGen streams reach the replay harness
+inline void write_replay(const std::string& path, std::span<const Op> ops) {
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (f == nullptr) throw std::system_error(errno, std::generic_category(), path);
+
+    std::byte header[REPLAY_HEADER]{};
+    std::memcpy(header, REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+    detail::store_le<uint64_t>(header + 8, ops.size());
+    bool ok = std::fwrite(header, 1, sizeof(header), f) == sizeof(header);
+
+    std::byte rec[REPLAY_RECORD];
+    for (size_t i = 0; ok && i < ops.size(); ++i) {
+        encode(rec, to_msg(ops[i]));
+        ok = std::fwrite(rec, 1, sizeof(rec), f) == sizeof(rec);
+    }
+    if (std::fclose(f) != 0 || !ok) throw std::system_error(EIO, std::generic_category(), path);
+}
+
+} // namespace ob
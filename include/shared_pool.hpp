@@ -0,0 +1,277 @@
+#pragma once
+
+#include "storage.hpp"
+#include "memory_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <utility>
+
+namespace ob {
+
+// free slots a magazine holds when full - the unit moved to and from the depot
+inline constexpr size_t MAGAZINE_SLOTS = 64;
+
+// order blocks shared by many books, e.g. every book on a shard
+// the depot keeps full batches of free slots on a stack behind a spinlock and
+// carves never-used slots from a frontier a batch at a time. books allocate
+// through their own MagazinePool and only come here once per batch, from
+// whichever thread they run on, so a book can move between cores
+// slot i lives at base() + i for every book, so slot-linked orders keep working
+template<typename T, size_t Capacity, typename Storage = InlineStorage, typename Idx = size_t>
+class SharedPool {
+public:
+    // free slots chain through their first bytes; a batch's head keeps its length
+    struct FreeNode {
+        FreeNode* next;
+        FreeNode* next_batch;
+        size_t count;
+    };
+
+private:
+    static_assert(sizeof(T) >= sizeof(FreeNode), "T must fit a free batch header");
+    static_assert(alignof(T) >= alignof(FreeNode), "T alignment must be >= pointer");
+    static_assert(Capacity < std::numeric_limits<Idx>::max(), "every slot must fit Idx");
+
+    static constexpr size_t CHUNK_SLOTS = std::max<size_t>(POOL_CHUNK_BYTES / sizeof(T), MAGAZINE_SLOTS);
+
+    alignas(64) typename Storage::template array<std::byte, sizeof(T) * Capacity> storage_;
+    alignas(64) std::atomic<bool> lock_{false};
+    FreeNode* batches_ = nullptr;
+    size_t frontier_ = 0;
+    std::atomic<size_t> free_{Capacity};    // in the depot or past the frontier
+
+    void lock() noexcept {
+        while (lock_.exchange(true, std::memory_order_acquire)) {
+            while (lock_.load(std::memory_order_relaxed)) __builtin_ia32_pause();
+        }
+    }
+
+    void unlock() noexcept { lock_.store(false, std::memory_order_release); }
+
+    // chain the next n never-used slots, under the lock
+    [[nodiscard]] FreeNode* carve(size_t n) noexcept {
+        auto* base = reinterpret_cast<std::byte*>(storage_.data());
+        if constexpr (requires { storage_.prefault(size_t{0}, size_t{0}); }) {
+            // entering a chunk: commit the one after it
+            size_t next = (frontier_ / CHUNK_SLOTS + 1) * CHUNK_SLOTS;
+            if (frontier_ % CHUNK_SLOTS < n && next < Capacity) {
+                storage_.prefault(next * sizeof(T), std::min(CHUNK_SLOTS, Capacity - next) * sizeof(T));
+            }
+        }
+        FreeNode* head = nullptr;
+        for (size_t i = frontier_ + n; i > frontier_; --i) {
+            auto* node = reinterpret_cast<FreeNode*>(base + (i - 1) * sizeof(T));
+            node->next = head;
+            head = node;
+        }
+        frontier_ += n;
+        return head;
+    }
+
+public:
+    SharedPool() noexcept(Storage::NOTHROW) {
+        if constexpr (requires { storage_.prefault(size_t{0}, size_t{0}); }) {
+            storage_.prefault(0, std::min(CHUNK_SLOTS, Capacity) * sizeof(T));
+        } else {
+            // no chunked commit: fault every block in now, as MemPool does
+            auto* b = reinterpret_cast<volatile std::byte*>(storage_.data());
+            for (size_t off = 0; off < sizeof(T) * Capacity; off += SMALL_PAGE_SIZE) b[off] = std::byte{0};
+        }
+    }
+
+    SharedPool(const SharedPool&) = delete;
+    SharedPool& operator=(const SharedPool&) = delete;
+    SharedPool(SharedPool&&) = delete;
+    SharedPool& operator=(SharedPool&&) = delete;
+
+    // one batch of up to MAGAZINE_SLOTS free slots and its length in n; null when spent
+    [[nodiscard]] FreeNode* take(size_t& n) noexcept {
+        lock();
+        FreeNode* head = batches_;
+        if (head != nullptr) {
+            batches_ = head->next_batch;
+            n = head->count;
+        } else {
+            n = std::min(MAGAZINE_SLOTS, Capacity - frontier_);
+            if (n != 0) head = carve(n);
+        }
+        free_.store(free_.load(std::memory_order_relaxed) - n, std::memory_order_relaxed);
+        unlock();
+        return head;
+    }
+
+    // return a chain of n free slots, from any thread
+    void give(FreeNode* head, size_t n) noexcept {
+        if (n == 0) return;
+        head->count = n;
+        lock();
+        head->next_batch = batches_;
+        batches_ = head;
+        free_.store(free_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        unlock();
+    }
+
+    // free slots not cached in any magazine - a snapshot, others may be taking
+    [[nodiscard]] size_t available() const noexcept { return free_.load(std::memory_order_relaxed); }
+    [[nodiscard]] static constexpr size_t capacity() noexcept { return Capacity; }
+
+    [[nodiscard]] T* base() noexcept { return reinterpret_cast<T*>(storage_.data()); }
+
+    [[nodiscard]] Idx index_of(const T* p) const noexcept {
+        return static_cast<Idx>(p - reinterpret_cast<const T*>(storage_.data()));
+    }
+
+    [[nodiscard]] T* at(Idx i) noexcept { return base() + i; }
+
+    [[nodiscard]] bool owns(const T* p) const noexcept {
+        auto* base = storage_.data();
+        auto* ptr = reinterpret_cast<const std::byte*>(p);
+        return ptr >= base && ptr < base + sizeof(T) * Capacity;
+    }
+
+    // depot that MagazinePools built on this thread draw from
+    [[nodiscard]] static SharedPool*& current() noexcept {
+        thread_local SharedPool* depot = nullptr;
+        return depot;
+    }
+};
+
+// makes a depot current on this thread for the books built in its scope
+template<typename Depot>
+class PoolScope {
+    Depot* prev_;
+
+public:
+    explicit PoolScope(Depot& depot) noexcept : prev_(Depot::current()) { Depot::current() = &depot; }
+    ~PoolScope() { Depot::current() = prev_; }
+
+    PoolScope(const PoolScope&) = delete;
+    PoolScope& operator=(const PoolScope&) = delete;
+};
+
+// a book's pool over a shared depot, with MemPool's interface
+// two magazines of free slots, loaded and spare (Bonwick): allocs pop
+// loaded, frees push it; when loaded runs dry or fills up it swaps with
+// spare, and only when both are empty or full does a batch move to or from
+// the depot. so each depot trip is worth at least MAGAZINE_SLOTS ops
+// a book only runs on one thread at a time; the depot takes any thread
+// Capacity is the depot's, and set_capacity() caps this book's share
+template<typename T, size_t Capacity, typename Storage = InlineStorage, typename Idx = size_t>
+class MagazinePool {
+public:
+    using depot_type = SharedPool<T, Capacity, Storage, Idx>;
+
+private:
+    using FreeNode = typename depot_type::FreeNode;
+
+    struct Magazine {
+        FreeNode* head = nullptr;
+        size_t count = 0;
+    };
+
+    depot_type* depot_;
+    Magazine loaded_{};
+    Magazine spare_{};                  // empty or full
+    size_t alloc_cnt_ = 0;
+    size_t limit_ = Capacity;
+
+    [[nodiscard]] static depot_type& current_depot() {
+        depot_type* d = depot_type::current();
+        if (d == nullptr) throw std::bad_alloc();   // no PoolScope on this thread
+        return *d;
+    }
+
+    // loaded is empty: swap in a full spare, else take a batch
+    [[nodiscard]] bool reload() noexcept {
+        if (spare_.count != 0) {
+            std::swap(loaded_, spare_);
+            return true;
+        }
+        size_t n = 0;
+        FreeNode* head = depot_->take(n);
+        if (head == nullptr) return false;
+        loaded_ = Magazine{head, n};
+        return true;
+    }
+
+    // loaded is full: it becomes the spare, and a full spare goes to the depot
+    void unload() noexcept {
+        if (spare_.count != 0) depot_->give(spare_.head, spare_.count);
+        spare_ = loaded_;
+        loaded_ = Magazine{};
+    }
+
+public:
+    MagazinePool() : depot_(&current_depot()) {}
+    ~MagazinePool() { flush(); }
+
+    MagazinePool(const MagazinePool&) = delete;
+    MagazinePool& operator=(const MagazinePool&) = delete;
+    MagazinePool(MagazinePool&&) = delete;
+    MagazinePool& operator=(MagazinePool&&) = delete;
+
+    [[nodiscard]] T* alloc() noexcept {
+        if (alloc_cnt_ == limit_) [[unlikely]] return nullptr;
+        if (loaded_.count == 0) [[unlikely]] {
+            if (!reload()) return nullptr;
+        }
+        FreeNode* node = loaded_.head;
+        loaded_.head = node->next;
+        --loaded_.count;
+        ++alloc_cnt_;
+        return std::launder(reinterpret_cast<T*>(node));
+    }
+
+    void dealloc(T* p) noexcept {
+        if (p == nullptr) [[unlikely]] return;
+        p->~T();
+        if (loaded_.count == MAGAZINE_SLOTS) [[unlikely]] unload();
+        auto* node = reinterpret_cast<FreeNode*>(p);
+        node->next = loaded_.head;
+        loaded_.head = node;
+        ++loaded_.count;
+        --alloc_cnt_;
+    }
+
+    // slots in a depot are not contiguous per book - bulk restore is refused
+    [[nodiscard]] T* alloc_front(size_t) noexcept { return nullptr; }
+
+    // give every cached free slot back, e.g. before the book goes idle
+    void flush() noexcept {
+        depot_->give(loaded_.head, loaded_.count);
+        depot_->give(spare_.head, spare_.count);
+        loaded_ = Magazine{};
+        spare_ = Magazine{};
+    }
+
+    // cap this book's share of the depot
+    // false if n is above Capacity or below the slots this book holds
+    [[nodiscard]] bool set_capacity(size_t n) noexcept {
+        if (n > Capacity || n < alloc_cnt_) return false;
+        limit_ = n;
+        return true;
+    }
+
+    [[nodiscard]] size_t used() const noexcept { return alloc_cnt_; }
+    [[nodiscard]] size_t capacity() const noexcept { return limit_; }
+    [[nodiscard]] static constexpr size_t max_capacity() noexcept { return Capacity; }
+    [[nodiscard]] size_t cached() const noexcept { return loaded_.count + spare_.count; }
+    [[nodiscard]] size_t available() const noexcept {
+        return std::min(limit_ - alloc_cnt_, cached() + depot_->available());
+    }
+    [[nodiscard]] bool full() const noexcept { return available() == 0; }
+    [[nodiscard]] bool empty() const noexcept { return alloc_cnt_ == 0; }
+
+    [[nodiscard]] depot_type& depot() noexcept { return *depot_; }
+
+    [[nodiscard]] T* base() noexcept { return depot_->base(); }
+    [[nodiscard]] Idx index_of(const T* p) const noexcept { return depot_->index_of(p); }
+    [[nodiscard]] T* at(Idx i) noexcept { return depot_->at(i); }
+    [[nodiscard]] bool owns(const T* p) const noexcept { return depot_->owns(p); }
+};
+
+} // namespace ob
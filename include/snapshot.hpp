@@ -0,0 +1,159 @@
+#pragma once
+
+#include "types.hpp"
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ob {
+
+// book snapshot file: a 32-byte header then one fixed 32-byte little-endian
+// record per resting order, bids best first then asks best first, each level
+// in fifo order - restoring the records in file order rebuilds the same queues
+//
+//   header   0  char[8]  "OBSNAPSH"
+//            8  u64      record count
+//           16  i64      max price of the book that wrote it
+//           24  u32      record size (32)
+//           28  u32      reserved
+//
+// records are SnapshotRecord as laid out in memory, so a mapped file is used
+// in place; the original qty of an order is not kept and restarts at its open qty
+// the owner keeps an order's participant and stp mode; untagged layouts write 0
+
+static_assert(std::endian::native == std::endian::little, "records are used in place");
+
+inline constexpr char SNAPSHOT_MAGIC[8] = {'O', 'B', 'S', 'N', 'A', 'P', 'S', 'H'};
+inline constexpr size_t SNAPSHOT_HEADER = 32;
+
+// one resting order, position-free
+struct SnapshotRecord {
+    uint64_t id;
+    uint64_t ts;
+    int64_t qty;          // open qty
+    int32_t price;
+    Side side;
+    OrdType type;
+    uint16_t owner;       // pack(Owner), 0 if untagged
+};
+
+static_assert(sizeof(SnapshotRecord) == 32, "SnapshotRecord is the on-disk record");
+static_assert(std::is_trivially_copyable_v<SnapshotRecord>);
+
+// result of OrderBook::restore - the book is left empty unless Ok
+enum class RestoreResult : uint8_t {
+    Ok = 0,
+    NotEmpty,         // restore only into a book with no orders
+    OffLadder,        // stops or held call orders rest, and take pool slots and ids
+    PoolExhausted,    // more records than the pool holds
+    InvalidPrice,
+    InvalidQty,
+    InvalidId,        // id or qty too wide, or an owner, for a compact order layout
+    InvalidType,      // not a buy or sell limit - nothing else rests on the ladder
+    Crossed,          // a bid at or above an ask
+    DuplicateId,
+    LadderFull
+};
+
+// read-only mapping of a snapshot file; throws std::system_error on open/map
+// failure and std::runtime_error on a malformed header
+class SnapshotFile {
+    const std::byte* data_ = nullptr;
+    size_t len_ = 0;
+    size_t count_ = 0;
+    int64_t max_price_ = 0;
+
+public:
+    explicit SnapshotFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::system_error(errno, std::generic_category(), path);
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), path);
+        }
+        len_ = static_cast<size_t>(st.st_size);
+        void* p = len_ == 0 ? MAP_FAILED : ::mmap(nullptr, len_, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) throw std::system_error(errno, std::generic_category(), path);
+        data_ = static_cast<const std::byte*>(p);
+        ::madvise(p, len_, MADV_SEQUENTIAL);
+
+        uint32_t rec_size = 0;
+        if (len_ >= SNAPSHOT_HEADER) {
+            std::memcpy(&count_, data_ + 8, sizeof(uint64_t));
+            std::memcpy(&max_price_, data_ + 16, sizeof(int64_t));
+            std::memcpy(&rec_size, data_ + 24, sizeof(uint32_t));
+        }
+        if (len_ < SNAPSHOT_HEADER || std::memcmp(data_, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+            rec_size != sizeof(SnapshotRecord) ||
+            count_ > (len_ - SNAPSHOT_HEADER) / sizeof(SnapshotRecord)) {
+            ::munmap(const_cast<std::byte*>(data_), len_);
+            throw std::runtime_error(path + ": not a snapshot file");
+        }
+    }
+
+    ~SnapshotFile() { ::munmap(const_cast<std::byte*>(data_), len_); }
+
+    SnapshotFile(const SnapshotFile&) = delete;
+    SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+    [[nodiscard]] size_t size() const noexcept { return count_; }
+    [[nodiscard]] int64_t max_price() const noexcept { return max_price_; }
+
+    [[nodiscard]] std::span<const SnapshotRecord> records() const noexcept {
+        return {reinterpret_cast<const SnapshotRecord*>(data_ + SNAPSHOT_HEADER), count_};
+    }
+};
+
+// write every resting order of book to path, straight into a shared mapping
+template<typename Book>
+inline void write_snapshot(const std::string& path, const Book& book) {
+    size_t n = book.order_count();
+    size_t len = SNAPSHOT_HEADER + n * sizeof(SnapshotRecord);
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) throw std::system_error(errno, std::generic_category(), path);
+    void* p = ::ftruncate(fd, static_cast<off_t>(len)) == 0
+        ? ::mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (p == MAP_FAILED) {
+        int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), path);
+    }
+
+    auto* data = static_cast<std::byte*>(p);
+    auto max_price = static_cast<int64_t>(Book::max_price());
+    auto rec_size = static_cast<uint32_t>(sizeof(SnapshotRecord));
+    std::memset(data, 0, SNAPSHOT_HEADER);
+    std::memcpy(data, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    std::memcpy(data + 8, &n, sizeof(uint64_t));
+    std::memcpy(data + 16, &max_price, sizeof(int64_t));
+    std::memcpy(data + 24, &rec_size, sizeof(uint32_t));
+    (void)book.snapshot({reinterpret_cast<SnapshotRecord*>(data + SNAPSHOT_HEADER), n});
+
+    int err = ::munmap(p, len) != 0 ? errno : 0;
+    if (::close(fd) != 0 && err == 0) err = errno;
+    if (err != 0) throw std::system_error(err, std::generic_category(), path);
+}
+
+// rebuild an empty book from a snapshot file
+template<typename Book>
+[[nodiscard]] inline RestoreResult load_snapshot(const std::string& path, Book& book) {
+    SnapshotFile file(path);
+    return book.restore(file.records());
+}
+
+} // namespace ob
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <span>
+
+namespace ob {
+
+// bounded lock-free single-producer/single-consumer ring
+// one thread pushes, one thread pops; each side caches the other's index
+// and only re-reads it when the ring looks full/empty
+template<typename T, size_t Capacity>
+class SpscRing {
+    static_assert(std::has_single_bit(Capacity), "capacity must be a power of two");
+    static constexpr size_t MASK = Capacity - 1;
+
+    // consumer side
+    alignas(64) std::atomic<size_t> head_{0};   // next slot to read
+    size_t cached_tail_ = 0;
+
+    // producer side
+    alignas(64) std::atomic<size_t> tail_{0};   // next slot to write
+    size_t cached_head_ = 0;
+
+    alignas(64) std::array<T, Capacity> buf_{};
+
+public:
+    // producer: false when full
+    [[nodiscard]] bool try_push(const T& v) noexcept {
+        size_t t = tail_.load(std::memory_order_relaxed);
+        if (t - cached_head_ == Capacity) [[unlikely]] {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (t - cached_head_ == Capacity) return false;
+        }
+        buf_[t & MASK] = v;
+        tail_.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // producer: as many of src as fit, published at once
+    [[nodiscard]] size_t try_push_bulk(std::span<const T> src) noexcept {
+        size_t t = tail_.load(std::memory_order_relaxed);
+        if (Capacity - (t - cached_head_) < src.size()) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+        }
+        size_t n = std::min(src.size(), Capacity - (t - cached_head_));
+        for (size_t i = 0; i < n; ++i) buf_[(t + i) & MASK] = src[i];
+        if (n != 0) tail_.store(t + n, std::memory_order_release);
+        return n;
+    }
+
+    // consumer: up to out.size() items, released at once
+    [[nodiscard]] size_t pop_bulk(std::span<T> out) noexcept {
+        size_t h = head_.load(std::memory_order_relaxed);
+        if (cached_tail_ - h < out.size()) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+        }
+        size_t n = std::min(out.size(), cached_tail_ - h);
+        for (size_t i = 0; i < n; ++i) out[i] = buf_[(h + i) & MASK];
+        if (n != 0) head_.store(h + n, std::memory_order_release);
+        return n;
+    }
+
+    // approximate unless called from one of the two threads while the other is idle
+    [[nodiscard]] size_t size() const noexcept {
+        size_t h = head_.load(std::memory_order_acquire);   // head first: tail can't fall behind it
+        return tail_.load(std::memory_order_acquire) - h;
+    }
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+    [[nodiscard]] static constexpr size_t capacity() noexcept { return Capacity; }
+};
+
+} // namespace ob
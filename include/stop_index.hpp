@@ -0,0 +1,151 @@
+#pragma once
+
+#include "types.hpp"
+#include "order.hpp"
+#include "price_level.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace ob {
+
+// distinct trigger prices per side before stop orders are refused
+inline constexpr size_t STOP_LEVELS = 1024;
+
+// resting stop orders, off the ladder, keyed by trigger price
+// each side is a sorted array of fifo lists with the next stop to trigger
+// at the back: buy stops highest trigger first, sell stops lowest first, so
+// firing pops from the back in o(1) per triggered order
+// stops link through their own prev/next, like orders on a SlimLevel
+// the same index holds the orders a call auction collects: the front of a
+// side is then its best price, highest buy and lowest sell
+template<typename O, size_t Levels = STOP_LEVELS>
+class StopIndex {
+    using Level = BasicSlimLevel<typename O::index_type>;
+    using Links = typename Level::links_type;
+
+    struct Entry {
+        int64_t px;
+        Qty qty;            // open qty queued at px
+        Level level;
+    };
+
+    struct Side_ {
+        std::array<Entry, Levels> entries{};
+        size_t cnt = 0;
+    };
+
+    std::array<Side_, 2> sides_{};
+    size_t orders_ = 0;
+    [[no_unique_address]] Links links_{};
+
+    // buy entries run high to low, sell entries low to high
+    [[nodiscard]] static bool before(Side side, int64_t a, int64_t b) noexcept {
+        return side == Side::Buy ? a > b : a < b;
+    }
+
+    // first entry at or past px in the side's order
+    [[nodiscard]] size_t lower(const Side_& s, Side side, int64_t px) const noexcept {
+        const Entry* it = std::lower_bound(s.entries.data(), s.entries.data() + s.cnt, px,
+            [side](const Entry& e, int64_t p) { return before(side, e.px, p); });
+        return static_cast<size_t>(it - s.entries.data());
+    }
+
+    void erase(Side_& s, size_t i) noexcept {
+        std::memmove(&s.entries[i], &s.entries[i + 1], (s.cnt - i - 1) * sizeof(Entry));
+        --s.cnt;
+    }
+
+public:
+    // slot links resolve against the order pool
+    void bind(O* base) noexcept { links_ = Links{base}; }
+
+    // queue o behind the stops at its trigger price, false if no level is left
+    bool add(O* o) noexcept {
+        Side_& s = sides_[static_cast<size_t>(o->side)];
+        int64_t px = o->price.raw();
+        size_t i = lower(s, o->side, px);
+        if (i == s.cnt || s.entries[i].px != px) {
+            if (s.cnt == Levels) [[unlikely]] return false;
+            std::memmove(&s.entries[i + 1], &s.entries[i], (s.cnt - i) * sizeof(Entry));
+            s.entries[i] = Entry{px, Qty{0}, Level{}};
+            ++s.cnt;
+        }
+        s.entries[i].qty += o->open_qty();
+        s.entries[i].level.push_back(o, links_);
+        ++orders_;
+        return true;
+    }
+
+    // unlink a resting stop
+    void remove(O* o) noexcept {
+        Side_& s = sides_[static_cast<size_t>(o->side)];
+        size_t i = lower(s, o->side, o->price.raw());
+        s.entries[i].qty -= o->open_qty();
+        s.entries[i].level.remove(o, links_);
+        if (s.entries[i].level.empty()) erase(s, i);
+        --orders_;
+    }
+
+    // o is about to lose q of its open qty in place
+    void reduce(const O* o, Qty q) noexcept {
+        Side_& s = sides_[static_cast<size_t>(o->side)];
+        s.entries[lower(s, o->side, o->price.raw())].qty -= q;
+    }
+
+    // unlink and return the next stop a trade at px triggers, null if none
+    // buy stops trigger at or below px, sell stops at or above
+    [[nodiscard]] O* pop(Side side, Price px) noexcept {
+        Side_& s = sides_[static_cast<size_t>(side)];
+        if (s.cnt == 0) return nullptr;
+        Entry& e = s.entries[s.cnt - 1];
+        if (side == Side::Buy ? e.px > px.raw() : e.px < px.raw()) return nullptr;
+        O* o = links_.at(e.level.head);
+        e.qty -= o->open_qty();
+        e.level.remove(o, links_);
+        if (e.level.empty()) --s.cnt;
+        --orders_;
+        return o;
+    }
+
+    // first order at the side's first price, null if none
+    [[nodiscard]] O* front(Side side) const noexcept {
+        const Side_& s = sides_[static_cast<size_t>(side)];
+        return s.cnt == 0 ? nullptr : links_.at(s.entries[0].level.head);
+    }
+
+    // the first order of a side traded q; unlinked once it has nothing left
+    void fill_front(Side side, Qty q) noexcept {
+        Side_& s = sides_[static_cast<size_t>(side)];
+        Entry& e = s.entries[0];
+        O* o = links_.at(e.level.head);
+        o->fill(q);
+        e.qty -= q;
+        if (!o->filled()) return;
+        e.level.remove(o, links_);
+        --orders_;
+        if (e.level.empty()) {
+            erase(s, 0);
+            return;
+        }
+        // the new front is in cache from the last call - pull in the one after it
+        auto next = links_.at(e.level.head)->next;
+        if (next != Level::NIL) __builtin_prefetch(links_.at(next), 1, 3);
+    }
+
+    // i-th price of a side in its order, and the open qty queued there
+    [[nodiscard]] Price price_at(Side side, size_t i) const noexcept {
+        return Price{sides_[static_cast<size_t>(side)].entries[i].px};
+    }
+    [[nodiscard]] Qty qty_at(Side side, size_t i) const noexcept {
+        return sides_[static_cast<size_t>(side)].entries[i].qty;
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return orders_ == 0; }
+    [[nodiscard]] size_t size() const noexcept { return orders_; }
+    [[nodiscard]] size_t levels(Side side) const noexcept { return sides_[static_cast<size_t>(side)].cnt; }
+};
+
+} // namespace ob
@@ -0,0 +1,346 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace ob {
+
+// storage policies for the large fixed arrays of a book (order pool, price
+// levels, id index). a policy exposes `template<T, N> array` with the
+// std::array subset the book uses: operator[], data(), size(), fill()
+// an array with prefault(offset, bytes) lets the pool commit its next chunk early;
+// without one, a policy with FAULT_IN set has the pool write every block at
+// construction, and any other leaves its pages to fault in on first use
+
+// arrays embedded in the owning object - the default; big books must be heap-allocated
+struct InlineStorage {
+    template<typename T, size_t N>
+    using array = std::array<T, N>;
+
+    static constexpr bool NOTHROW = true;
+    static constexpr bool FAULT_IN = true;
+};
+
+// mapping knobs for MappedStorage
+struct MapOptions {
+    bool huge_pages = true;   // MAP_HUGETLB, falling back to transparent huge pages
+    bool populate = true;     // prefault every page at construction
+    bool lock = false;        // mlock - keep pages resident
+    int numa_node = -1;       // MPOL_BIND to this node, -1 = leave to first touch
+};
+
+inline constexpr size_t HUGE_PAGE_SIZE = size_t{2} << 20;
+inline constexpr size_t SMALL_PAGE_SIZE = size_t{4} << 10;
+
+// how a region actually ended up being backed
+struct MapInfo {
+    bool hugetlb = false;     // explicit huge pages from the hugetlb pool
+    bool thp = false;         // madvise(MADV_HUGEPAGE) accepted
+    bool populated = false;
+    bool locked = false;
+    bool bound = false;       // numa policy applied
+};
+
+namespace detail {
+
+inline constexpr int MPOL_BIND_MODE = 2;
+inline constexpr int MADV_POPULATE_WRITE_ADVICE = 23;  // linux 5.14+
+
+[[nodiscard]] constexpr size_t round_up(size_t n, size_t align) noexcept {
+    return (n + align - 1) / align * align;
+}
+
+// anonymous mapping with the requested backing; throws std::bad_alloc
+// only when no mapping at all can be made - every other knob is best effort
+inline void* map_region(size_t bytes, size_t& len, const MapOptions& opts, MapInfo& info) {
+    constexpr int prot = PROT_READ | PROT_WRITE;
+    constexpr int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    void* p = MAP_FAILED;
+
+    if (opts.huge_pages) {
+        len = round_up(bytes, HUGE_PAGE_SIZE);
+        p = ::mmap(nullptr, len, prot, flags | MAP_HUGETLB, -1, 0);
+        info.hugetlb = p != MAP_FAILED;
+        if (p == MAP_FAILED) {
+            p = ::mmap(nullptr, len, prot, flags, -1, 0);
+            info.thp = p != MAP_FAILED && ::madvise(p, len, MADV_HUGEPAGE) == 0;
+        }
+    } else {
+        len = round_up(bytes, SMALL_PAGE_SIZE);
+        p = ::mmap(nullptr, len, prot, flags, -1, 0);
+    }
+    if (p == MAP_FAILED) throw std::bad_alloc();
+
+    // bind before the first fault so pages land on the right node
+    if (opts.numa_node >= 0 && opts.numa_node < 64) {
+        unsigned long mask = 1UL << opts.numa_node;
+        info.bound = ::syscall(SYS_mbind, p, len, MPOL_BIND_MODE, &mask,
+                               sizeof(mask) * 8 + 1, 0) == 0;
+    }
+
+    if (opts.populate) {
+        // write-fault every page now rather than on the hot path
+        if (::madvise(p, len, MADV_POPULATE_WRITE_ADVICE) != 0) {
+            size_t step = info.hugetlb ? HUGE_PAGE_SIZE : SMALL_PAGE_SIZE;
+            auto* bytes_p = static_cast<volatile std::byte*>(p);
+            for (size_t off = 0; off < len; off += step) bytes_p[off] = std::byte{0};
+        }
+        info.populated = true;
+    }
+
+    if (opts.lock) info.locked = ::mlock(p, len) == 0;
+    return p;
+}
+
+} // namespace detail
+
+// fixed-size array in its own anonymous mapping
+// fresh mappings are zero-filled, so trivially constructible T skips construction
+template<typename T, size_t N, MapOptions Opts>
+class MappedArray {
+    size_t len_ = 0;
+    MapInfo info_{};
+    T* data_;
+
+public:
+    MappedArray()
+        : data_(static_cast<T*>(detail::map_region(sizeof(T) * N, len_, Opts, info_))) {
+        if constexpr (!std::is_trivially_default_constructible_v<T>) {
+            std::uninitialized_value_construct_n(data_, N);
+        }
+    }
+
+    ~MappedArray() {
+        std::destroy_n(data_, N);
+        ::munmap(data_, len_);
+    }
+
+    MappedArray(const MappedArray&) = delete;
+    MappedArray& operator=(const MappedArray&) = delete;
+    MappedArray(MappedArray&&) = delete;
+    MappedArray& operator=(MappedArray&&) = delete;
+
+    [[nodiscard]] T& operator[](size_t i) noexcept { return data_[i]; }
+    [[nodiscard]] const T& operator[](size_t i) const noexcept { return data_[i]; }
+    [[nodiscard]] T* data() noexcept { return data_; }
+    [[nodiscard]] const T* data() const noexcept { return data_; }
+    [[nodiscard]] static constexpr size_t size() noexcept { return N; }
+
+    [[nodiscard]] T* begin() noexcept { return data_; }
+    [[nodiscard]] T* end() noexcept { return data_ + N; }
+    [[nodiscard]] const T* begin() const noexcept { return data_; }
+    [[nodiscard]] const T* end() const noexcept { return data_ + N; }
+
+    void fill(const T& v) noexcept { std::fill_n(data_, N, v); }
+
+    [[nodiscard]] const MapInfo& map_info() const noexcept { return info_; }
+    [[nodiscard]] size_t mapped_bytes() const noexcept { return len_; }
+};
+
+// arrays mapped separately from the owning object - the book itself stays small
+template<MapOptions Opts = MapOptions{}>
+struct MappedStorage {
+    template<typename T, size_t N>
+    using array = MappedArray<T, N, Opts>;
+
+    static constexpr bool NOTHROW = false;
+    static constexpr bool FAULT_IN = false;     // MapOptions::populate decides, at the mapping
+    static constexpr MapOptions OPTIONS = Opts;
+};
+
+// knobs for Arena
+struct ArenaOptions {
+    bool prefault = true;     // commit pool chunks ahead of the frontier
+    bool thp = false;         // madvise(MADV_HUGEPAGE) - faults whole 2 MB pages
+    int numa_node = -1;       // MPOL_BIND to this node, -1 = leave to first touch
+};
+
+// one reserved address range that many books carve their arrays from
+// the range is mapped MAP_NORESERVE and never prefaulted, so untouched parts
+// of a book - pool slots past its frontier, unused ticks and index slots -
+// cost address space only. a bump pointer hands out page-aligned blocks that
+// are given back only when the arena goes; build one per core, on that core
+class Arena {
+    std::byte* base_;
+    size_t len_;
+    size_t used_ = 0;
+    ArenaOptions opts_;
+
+public:
+    explicit Arena(size_t bytes, ArenaOptions opts = {})
+        : len_(detail::round_up(bytes, HUGE_PAGE_SIZE)), opts_(opts) {
+        void* p = ::mmap(nullptr, len_, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED) throw std::bad_alloc();
+        if (opts.thp) (void)::madvise(p, len_, MADV_HUGEPAGE);
+        if (opts.numa_node >= 0 && opts.numa_node < 64) {
+            unsigned long mask = 1UL << opts.numa_node;
+            (void)::syscall(SYS_mbind, p, len_, detail::MPOL_BIND_MODE, &mask, sizeof(mask) * 8 + 1, 0);
+        }
+        base_ = static_cast<std::byte*>(p);
+    }
+
+    ~Arena() { ::munmap(base_, len_); }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    Arena(Arena&&) = delete;
+    Arena& operator=(Arena&&) = delete;
+
+    // zeroed, page-aligned block; throws std::bad_alloc when the range is spent
+    [[nodiscard]] void* allocate(size_t bytes) {
+        size_t len = detail::round_up(std::max<size_t>(bytes, 1), SMALL_PAGE_SIZE);
+        if (len > len_ - used_) throw std::bad_alloc();
+        void* p = base_ + used_;
+        used_ += len;
+        return p;
+    }
+
+    // fault a range in now rather than on the match path
+    void prefault(void* p, size_t bytes) noexcept {
+        if (!opts_.prefault || bytes == 0) return;
+        auto addr = reinterpret_cast<uintptr_t>(p) & ~(uintptr_t{SMALL_PAGE_SIZE} - 1);
+        size_t len = detail::round_up(reinterpret_cast<uintptr_t>(p) + bytes - addr, SMALL_PAGE_SIZE);
+        if (::madvise(reinterpret_cast<void*>(addr), len, detail::MADV_POPULATE_WRITE_ADVICE) != 0) {
+            // rewrite one byte per page, the range may already hold data
+            auto* b = reinterpret_cast<volatile std::byte*>(addr);
+            for (size_t off = 0; off < len; off += SMALL_PAGE_SIZE) b[off] = b[off];
+        }
+    }
+
+    // build a T in the arena, with this arena current for its arrays
+    template<typename T, typename... Args>
+    [[nodiscard]] T* create(Args&&... args);
+
+    // bytes handed out and bytes actually resident (mincore - not for the hot path)
+    [[nodiscard]] size_t used() const noexcept { return used_; }
+    [[nodiscard]] size_t reserved() const noexcept { return len_; }
+    [[nodiscard]] size_t resident() const {
+        std::vector<unsigned char> pages(used_ / SMALL_PAGE_SIZE);
+        if (pages.empty() || ::mincore(base_, used_, pages.data()) != 0) return 0;
+        size_t n = 0;
+        for (unsigned char v : pages) n += v & 1;
+        return n * SMALL_PAGE_SIZE;
+    }
+
+    // arena that ArenaStorage arrays built on this thread come from
+    [[nodiscard]] static Arena*& current() noexcept {
+        thread_local Arena* arena = nullptr;
+        return arena;
+    }
+};
+
+// makes an arena current on this thread for the books built in its scope
+class ArenaScope {
+    Arena* prev_;
+
+public:
+    explicit ArenaScope(Arena& arena) noexcept : prev_(Arena::current()) { Arena::current() = &arena; }
+    ~ArenaScope() { Arena::current() = prev_; }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+};
+
+template<typename T, typename... Args>
+T* Arena::create(Args&&... args) {
+    ArenaScope scope(*this);
+    return ::new (allocate(sizeof(T))) T(std::forward<Args>(args)...);
+}
+
+// runs the destructor of an arena-built object; the memory stays with the arena
+struct ArenaDelete {
+    template<typename T>
+    void operator()(T* p) const noexcept { p->~T(); }
+};
+
+template<typename T>
+using ArenaPtr = std::unique_ptr<T, ArenaDelete>;
+
+template<typename T, typename... Args>
+[[nodiscard]] ArenaPtr<T> make_in(Arena& arena, Args&&... args) {
+    return ArenaPtr<T>(arena.create<T>(std::forward<Args>(args)...));
+}
+
+namespace detail {
+
+// true when T{} is all zero bytes - fresh arena memory already holds it
+template<typename T>
+[[nodiscard]] bool zero_constructed() noexcept {
+    if constexpr (!std::is_trivially_destructible_v<T> || !std::is_trivially_copyable_v<T>) {
+        return false;
+    } else {
+        alignas(T) std::byte probe[sizeof(T)]{};
+        ::new (static_cast<void*>(probe)) T{};
+        std::byte zero[sizeof(T)]{};
+        return std::memcmp(probe, zero, sizeof(T)) == 0;
+    }
+}
+
+} // namespace detail
+
+// fixed-size array carved from the current thread's Arena
+// elements whose default value is all zero bytes are not constructed, so
+// their pages stay untouched until used
+template<typename T, size_t N>
+class ArenaArray {
+    Arena* arena_;
+    T* data_;
+
+    [[nodiscard]] static Arena& arena() {
+        Arena* a = Arena::current();
+        if (a == nullptr) throw std::bad_alloc();   // no ArenaScope on this thread
+        return *a;
+    }
+
+public:
+    ArenaArray() : arena_(&arena()), data_(static_cast<T*>(arena_->allocate(sizeof(T) * N))) {
+        if (!detail::zero_constructed<T>()) std::uninitialized_value_construct_n(data_, N);
+    }
+
+    ~ArenaArray() { std::destroy_n(data_, N); }
+
+    ArenaArray(const ArenaArray&) = delete;
+    ArenaArray& operator=(const ArenaArray&) = delete;
+    ArenaArray(ArenaArray&&) = delete;
+    ArenaArray& operator=(ArenaArray&&) = delete;
+
+    [[nodiscard]] T& operator[](size_t i) noexcept { return data_[i]; }
+    [[nodiscard]] const T& operator[](size_t i) const noexcept { return data_[i]; }
+    [[nodiscard]] T* data() noexcept { return data_; }
+    [[nodiscard]] const T* data() const noexcept { return data_; }
+    [[nodiscard]] static constexpr size_t size() noexcept { return N; }
+
+    [[nodiscard]] T* begin() noexcept { return data_; }
+    [[nodiscard]] T* end() noexcept { return data_ + N; }
+    [[nodiscard]] const T* begin() const noexcept { return data_; }
+    [[nodiscard]] const T* end() const noexcept { return data_ + N; }
+
+    void fill(const T& v) noexcept { std::fill_n(data_, N, v); }
+
+    // commit [offset, offset + bytes) ahead of use
+    void prefault(size_t offset, size_t bytes) noexcept {
+        arena_->prefault(reinterpret_cast<std::byte*>(data_) + offset, bytes);
+    }
+};
+
+// arrays carved from a shared Arena - make one current with ArenaScope (or
+// build the book with Arena::create) before constructing the book
+struct ArenaStorage {
+    template<typename T, size_t N>
+    using array = ArenaArray<T, N>;
+
+    static constexpr bool NOTHROW = false;
+};
+
+} // namespace ob
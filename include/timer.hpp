@@ -2,11 +2,13 @@
 
 #include <cstdint>
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <limits>
 #include <vector>
-#include <fstream>
-#include <string>
-#include <chrono>
-#include <thread>
+#include <cpuid.h>
+#include <time.h>
 
 namespace ob {
 
@@ -54,28 +56,99 @@ inline uint64_t rdtsc_end() noexcept {
     return (static_cast<uint64_t>(hi) << 32) | lo;
 }
 
-// get cpu frequency from /proc/cpuinfo (linux)
-inline double get_cpu_freq_ghz() noexcept {
-    std::ifstream cpuinfo("/proc/cpuinfo");
-    std::string line;
-    while (std::getline(cpuinfo, line)) {
-        if (line.find("cpu MHz") != std::string::npos) {
-            auto pos = line.find(':');
-            if (pos != std::string::npos) {
-                double mhz = std::stod(line.substr(pos + 1));
-                return mhz / 1000.0;
-            }
+// lfence-bracketed rdtsc: earlier instructions retire before the read and
+// later ones don't start ahead of it - the start stamp of a timed region,
+// without rdtsc_start's cpuid (which traps to the hypervisor in a vm)
+inline uint64_t rdtsc_fenced() noexcept {
+    uint32_t lo, hi;
+    __asm__ volatile(
+        "lfence\n\t"
+        "rdtsc\n\t"
+        "lfence"
+        : "=a"(lo), "=d"(hi)
+    );
+    return (static_cast<uint64_t>(hi) << 32) | lo;
+}
+
+// where the tsc rate came from
+enum class TscSource : uint8_t {
+    Cpuid,          // leaf 0x15: crystal clock * tsc/crystal ratio
+    Hypervisor,     // leaf 0x40000010: tsc khz reported by the vmm
+    Calibrated      // measured against CLOCK_MONOTONIC_RAW
+};
+
+struct TscInfo {
+    double ghz;             // tsc ticks per ns
+    TscSource source;
+    bool invariant;         // constant rate across p-states and c-states
+};
+
+namespace detail {
+
+[[nodiscard]] inline double monotonic_ns() noexcept {
+    timespec ts{};
+    ::clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return static_cast<double>(ts.tv_sec) * 1e9 + static_cast<double>(ts.tv_nsec);
+}
+
+// median of 5 x 20ms windows, each end stamped between two clock reads
+[[nodiscard]] inline double calibrate_tsc_ghz() noexcept {
+    std::array<double, 5> rates{};
+    for (double& r : rates) {
+        double n0 = monotonic_ns();
+        uint64_t c0 = rdtsc_fenced();
+        double n1 = monotonic_ns();
+        while (monotonic_ns() - n1 < 20e6) {}
+        double n2 = monotonic_ns();
+        uint64_t c1 = rdtsc_fenced();
+        double n3 = monotonic_ns();
+        r = static_cast<double>(c1 - c0) / ((n2 + n3) / 2 - (n0 + n1) / 2);
+    }
+    std::sort(rates.begin(), rates.end());
+    return rates[rates.size() / 2];
+}
+
+[[nodiscard]] inline TscInfo probe_tsc() noexcept {
+    uint32_t a = 0, b = 0, c = 0, d = 0;
+    __cpuid(0x80000007, a, b, c, d);
+    bool invariant = (d >> 8) & 1;
+
+    if (__get_cpuid_max(0, nullptr) >= 0x15) {
+        __cpuid_count(0x15, 0, a, b, c, d);
+        if (a != 0 && b != 0 && c != 0) {
+            return {static_cast<double>(c) * b / a / 1e9, TscSource::Cpuid, invariant};
         }
     }
-    // fallback: calibrate using steady_clock
-    auto t1 = std::chrono::steady_clock::now();
-    uint64_t c1 = rdtsc();
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    uint64_t c2 = rdtsc();
-    auto t2 = std::chrono::steady_clock::now();
-
-    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count();
-    return static_cast<double>(c2 - c1) / static_cast<double>(ns);
+    __cpuid(0x40000000, a, b, c, d);
+    if (a >= 0x40000010) {
+        __cpuid(0x40000010, a, b, c, d);
+        if (a != 0) return {static_cast<double>(a) / 1e6, TscSource::Hypervisor, invariant};
+    }
+    return {calibrate_tsc_ghz(), TscSource::Calibrated, invariant};
+}
+
+} // namespace detail
+
+// tsc rate, probed once per process
+inline const TscInfo& tsc_info() noexcept {
+    static const TscInfo info = detail::probe_tsc();
+    return info;
+}
+
+// tsc ticks per ns - what cycles_to_ns needs. this used to read "cpu MHz"
+// from /proc/cpuinfo, which is the current core clock under frequency
+// scaling, not the rate rdtsc counts at
+inline double get_cpu_freq_ghz() noexcept { return tsc_info().ghz; }
+
+// cycles an empty rdtsc_fenced() .. rdtsc_end() region measures: the floor
+// every timed sample carries, to subtract from per-op samples
+inline uint64_t timer_overhead_cycles() noexcept {
+    uint64_t best = ~uint64_t{0};
+    for (int i = 0; i < 10000; ++i) {
+        uint64_t start = rdtsc_fenced();
+        best = std::min(best, rdtsc_end() - start);
+    }
+    return best;
 }
 
 // convert cycles to nanoseconds
@@ -128,6 +201,100 @@ struct LatencyStats {
             .avg   = static_cast<double>(sum) / static_cast<double>(data.size())
         };
     }
+
+    // from a histogram, every value scaled by scale (e.g. 1 / freq_ghz for
+    // cycles -> ns)
+    template<typename Hist>
+    static LatencyStats of(const Hist& h, double scale = 1.0) {
+        auto at = [&h, scale](double p) {
+            return static_cast<uint64_t>(static_cast<double>(h.percentile(p)) * scale);
+        };
+        return {
+            .p50   = at(0.50),
+            .p90   = at(0.90),
+            .p99   = at(0.99),
+            .p999  = at(0.999),
+            .p9999 = at(0.9999),
+            .min   = static_cast<uint64_t>(static_cast<double>(h.min()) * scale),
+            .max   = static_cast<uint64_t>(static_cast<double>(h.max()) * scale),
+            .avg   = h.mean() * scale
+        };
+    }
+};
+
+// log-linear latency histogram, hdr style
+// values below 2^SubBits land in exact buckets; above that every power of two
+// is split into 2^(SubBits-1) linear buckets, so a reported value is within
+// 2^-(SubBits-1) of the truth (< 0.8% at the default). record is a bit scan
+// and an increment, the counts are a fixed array (no allocation, no sort),
+// and histograms of the same shape merge by adding counts - keep one per
+// thread and merge when reporting. values >= 2^MaxBits share the top bucket
+template<unsigned SubBits = 8, unsigned MaxBits = 40>
+class LatencyHistogram {
+    static_assert(SubBits >= 2 && SubBits < MaxBits && MaxBits <= 63);
+    static constexpr uint64_t SUB = uint64_t{1} << SubBits;
+    static constexpr uint64_t HALF = SUB / 2;
+    static constexpr size_t BUCKETS = (MaxBits - SubBits + 2) * HALF;
+
+    std::array<uint64_t, BUCKETS> counts_{};
+    uint64_t total_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = std::numeric_limits<uint64_t>::max();
+    uint64_t max_ = 0;
+
+    [[nodiscard]] static constexpr size_t bucket(uint64_t v) noexcept {
+        auto width = static_cast<unsigned>(std::bit_width(v));
+        unsigned shift = width > SubBits ? width - SubBits : 0;
+        size_t b = shift * HALF + static_cast<size_t>(v >> shift);
+        return std::min(b, BUCKETS - 1);
+    }
+
+    // largest value that lands in bucket b
+    [[nodiscard]] static constexpr uint64_t upper(size_t b) noexcept {
+        if (b < SUB) return b;
+        unsigned shift = static_cast<unsigned>(b / HALF - 1);
+        uint64_t sub = b - shift * HALF;
+        return ((sub + 1) << shift) - 1;
+    }
+
+public:
+    void record(uint64_t v) noexcept {
+        ++counts_[bucket(v)];
+        ++total_;
+        sum_ += v;
+        min_ = std::min(min_, v);
+        max_ = std::max(max_, v);
+    }
+
+    void merge(const LatencyHistogram& o) noexcept {
+        for (size_t i = 0; i < BUCKETS; ++i) counts_[i] += o.counts_[i];
+        total_ += o.total_;
+        sum_ += o.sum_;
+        min_ = std::min(min_, o.min_);
+        max_ = std::max(max_, o.max_);
+    }
+
+    void clear() noexcept { *this = LatencyHistogram{}; }
+
+    // same rank as percentile_sorted(data, p) over the recorded values,
+    // reported as the top of its bucket (never above max)
+    [[nodiscard]] uint64_t percentile(double p) const noexcept {
+        if (total_ == 0) return 0;
+        auto rank = static_cast<uint64_t>(p * static_cast<double>(total_ - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += counts_[i];
+            if (seen >= rank) return i == BUCKETS - 1 ? max_ : std::clamp(upper(i), min_, max_);
+        }
+        return max_;
+    }
+
+    [[nodiscard]] uint64_t count() const noexcept { return total_; }
+    [[nodiscard]] uint64_t min() const noexcept { return total_ == 0 ? 0 : min_; }
+    [[nodiscard]] uint64_t max() const noexcept { return max_; }
+    [[nodiscard]] double mean() const noexcept {
+        return total_ == 0 ? 0.0 : static_cast<double>(sum_) / static_cast<double>(total_);
+    }
 };
 
 // scoped timer
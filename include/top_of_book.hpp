@@ -0,0 +1,127 @@
+#pragma once
+
+#include "types.hpp"
+#include "fill_listener.hpp"
+#include "depth_feed.hpp"
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace ob {
+
+// best bid/offer as seen at the end of one book operation
+struct Bbo {
+    Price bid{NO_BID};
+    Price ask{NO_ASK};
+    Qty bid_qty{0};
+    Qty ask_qty{0};
+    uint64_t version = 0;   // publications so far, set by the publisher
+
+    // same prices and sizes, whatever the version
+    [[nodiscard]] constexpr bool same_top(const Bbo& o) const noexcept {
+        return bid == o.bid && ask == o.ask && bid_qty == o.bid_qty && ask_qty == o.ask_qty;
+    }
+};
+
+// optional listener hook: OrderBook calls on_top(bbo) after every add/cancel/match
+template<typename L>
+concept TopListener = requires(L& l, const Bbo& b) {
+    { l.on_top(b) } noexcept;
+};
+
+// single-writer seqlock over a Bbo, on its own cache lines
+// readers never block the writer; try_load is wait-free and fails only
+// while a store is in flight, load retries until it gets a clean copy
+class SeqlockBbo {
+    alignas(64) std::atomic<uint64_t> seq_{0};   // odd while a store is in flight
+    std::atomic<int64_t> bid_{NO_BID.raw()};
+    std::atomic<int64_t> ask_{NO_ASK.raw()};
+    std::atomic<int64_t> bid_qty_{0};
+    std::atomic<int64_t> ask_qty_{0};
+    std::atomic<uint64_t> version_{0};
+    char pad_[64 - 6 * sizeof(uint64_t)] = {};
+
+public:
+    // writer only
+    void store(const Bbo& b) noexcept {
+        uint64_t s = seq_.load(std::memory_order_relaxed);
+        seq_.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bid_.store(b.bid.raw(), std::memory_order_relaxed);
+        ask_.store(b.ask.raw(), std::memory_order_relaxed);
+        bid_qty_.store(b.bid_qty.raw(), std::memory_order_relaxed);
+        ask_qty_.store(b.ask_qty.raw(), std::memory_order_relaxed);
+        version_.store(b.version, std::memory_order_relaxed);
+        seq_.store(s + 2, std::memory_order_release);
+    }
+
+    // any thread: false if a store overlapped the read
+    [[nodiscard]] bool try_load(Bbo& out) const noexcept {
+        uint64_t s0 = seq_.load(std::memory_order_acquire);
+        if ((s0 & 1) != 0) [[unlikely]] return false;
+        Bbo b;
+        b.bid = Price{bid_.load(std::memory_order_relaxed)};
+        b.ask = Price{ask_.load(std::memory_order_relaxed)};
+        b.bid_qty = Qty{bid_qty_.load(std::memory_order_relaxed)};
+        b.ask_qty = Qty{ask_qty_.load(std::memory_order_relaxed)};
+        b.version = version_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq_.load(std::memory_order_relaxed) != s0) [[unlikely]] return false;
+        out = b;
+        return true;
+    }
+
+    [[nodiscard]] Bbo load() const noexcept {
+        Bbo b;
+        while (!try_load(b)) __builtin_ia32_pause();
+        return b;
+    }
+
+    // stores begun so far - readers can tell how far behind a copy is
+    [[nodiscard]] uint64_t stores() const noexcept {
+        return (seq_.load(std::memory_order_acquire) + 1) / 2;
+    }
+};
+
+static_assert(sizeof(SeqlockBbo) == 64, "SeqlockBbo must own exactly one cache line");
+
+// listener that publishes the top of book to a SeqlockBbo when it changes
+// fills and level updates pass through to Inner; the snapshot lives
+// outside the book, so readers never share a line with best_bid_/best_ask_
+template<FillListener Inner = NullListener>
+class BboPublisher {
+    SeqlockBbo* out_ = nullptr;
+    Bbo last_{};
+    [[no_unique_address]] Inner inner_{};
+
+public:
+    BboPublisher() noexcept = default;
+    explicit BboPublisher(SeqlockBbo& out, Inner inner = Inner{}) noexcept
+        : out_(&out), inner_(std::move(inner)) {}
+
+    void on_fill(const Fill& f) noexcept { inner_.on_fill(f); }
+
+    // depth too when the wrapped listener takes it
+    void on_level(const LevelUpdate& u) noexcept requires DepthListener<Inner> { inner_.on_level(u); }
+
+    void on_top(const Bbo& b) noexcept {
+        if (b.same_top(last_)) [[likely]] return;
+        uint64_t version = last_.version + 1;
+        last_ = b;
+        last_.version = version;
+        if (out_ != nullptr) out_->store(last_);
+    }
+
+    [[nodiscard]] Inner& inner() noexcept { return inner_; }
+    [[nodiscard]] uint64_t published() const noexcept { return last_.version; }
+};
+
+// a publisher only builds fills when the wrapped listener wants them
+template<typename Inner>
+inline constexpr bool LISTENS<BboPublisher<Inner>> = LISTENS<Inner>;
+
+static_assert(FillListener<BboPublisher<>>);
+static_assert(TopListener<BboPublisher<>>);
+
+} // namespace ob
@@ -10,6 +10,8 @@ namespace ob {
 // zero-cost wrapper via spaceship operator
 template<typename T, typename Tag>
 struct Strong {
+    using value_type = T;
+
     T val;
 
     constexpr Strong() noexcept : val{} {}
@@ -30,13 +32,57 @@ struct Strong {
     constexpr Strong& operator--() noexcept { --val; return *this; }
 };
 
+// narrow storage for a Strong value, reads back as the full-width type
+// for compact layouts - the writer guarantees the value fits
+template<typename S, typename N>
+struct Packed {
+    N val;
+
+    constexpr Packed() noexcept : val{} {}
+    constexpr explicit Packed(S v) noexcept : val(static_cast<N>(v.raw())) {}
+
+    constexpr operator S() const noexcept { return S{raw()}; }
+    constexpr typename S::value_type raw() const noexcept {
+        return static_cast<typename S::value_type>(val);
+    }
+
+    constexpr bool operator==(const Packed&) const noexcept = default;
+};
+
 using OrderId   = Strong<uint64_t, struct OrderIdTag>;
 using Price     = Strong<int64_t, struct PriceTag>;      // fixed-point ticks
 using Qty       = Strong<int64_t, struct QtyTag>;
 using Timestamp = Strong<uint64_t, struct TimestampTag>;
 
 enum class Side : uint8_t { Buy = 0, Sell = 1 };
-enum class OrdType : uint8_t { Limit = 0, Market = 1, IOC = 2 };
+// Iceberg rests a displayed slice of its qty; FOK trades in full or not at all;
+// Stop waits off the book until a trade prints through its price, then runs as a market order;
+// Call is set by the book on a limit or iceberg held for an auction uncross - add() refuses it
+enum class OrdType : uint8_t { Limit = 0, Market = 1, IOC = 2, FOK = 3, Iceberg = 4, Stop = 5, Call = 6 };
+
+// self-trade prevention, chosen by the aggressor, for when it meets a resting
+// order of its own participant
+//   CancelNewest: the aggressor's remaining qty is cancelled, the resting order stays
+//   CancelOldest: the resting order is cancelled and the aggressor trades on
+//   Decrement:    both lose the smaller open qty, no fill; an order left with none is cancelled
+enum class StpMode : uint8_t { None = 0, CancelNewest = 1, CancelOldest = 2, Decrement = 3 };
+
+// participant (account) an order belongs to and its stp mode
+// participant 0 is untagged and never self-trades
+struct Owner {
+    uint16_t participant = 0;
+    StpMode stp = StpMode::None;
+};
+
+// participants fit 14 bits, so an owner packs into 2 bytes with its mode
+inline constexpr uint16_t MAX_PARTICIPANT = (1U << 14) - 1;
+
+[[nodiscard]] constexpr uint16_t pack(Owner w) noexcept {
+    return static_cast<uint16_t>(w.participant | static_cast<unsigned>(w.stp) << 14);
+}
+[[nodiscard]] constexpr Owner unpack_owner(uint16_t bits) noexcept {
+    return Owner{static_cast<uint16_t>(bits & MAX_PARTICIPANT), static_cast<StpMode>(bits >> 14)};
+}
 
 constexpr Side flip(Side s) noexcept {
     return s == Side::Buy ? Side::Sell : Side::Buy;
@@ -58,6 +104,7 @@ static_assert(sizeof(Price) == sizeof(int64_t));
 static_assert(sizeof(Qty) == sizeof(int64_t));
 static_assert(sizeof(Side) == 1);
 static_assert(sizeof(OrdType) == 1);
+static_assert(sizeof(StpMode) == 1);
 
 static_assert(std::is_trivially_copyable_v<OrderId>);
 static_assert(std::is_trivially_copyable_v<Price>);
@@ -1,12 +1,44 @@
 #include "order_book.hpp"
+#include "book_traits.hpp"
+#include "depth_feed.hpp"
+#include "book_manager.hpp"
+#include "gateway.hpp"
+#include "spsc_ring.hpp"
+#include "replay.hpp"
+#include "snapshot.hpp"
+#include "journal.hpp"
+#include "workload.hpp"
+#include "scenarios.hpp"
+#include "naive_book.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <cstdio>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <unistd.h>
 
 using namespace ob;
 
 // Small book for tests
 using TestBook = OrderBook<10000, 1000>;
 
+// narrow window so most of the ladder lives in overflow
+template<int64_t MaxPrice, typename Storage>
+using NarrowWindow = WindowLadder<MaxPrice, Storage, 256, 4096>;
+using WindowBook = OrderBook<10000, 1000, NullListener, DirectIndex, InlineStorage, NarrowWindow>;
+using CompactBook = OrderBook<10000, 1000, NullListener, DirectIndex, InlineStorage, CompactLadder>;
+using SlotBook = OrderBook<10000, 1000, NullListener, DirectIndex, InlineStorage, SlotLadder>;
+
 void test_empty_book() {
     TestBook book;
 
@@ -392,6 +424,2018 @@ void test_aggressive_ask_price_improvement() {
     printf("[PASS] aggressive_ask_price_improvement\n");
 }
 
+void test_level_bitmap_boundaries() {
+    LevelBitmap<1'000'001> bm;
+
+    assert(!bm.any());
+    assert(bm.next(0) == bm.size());
+    assert(bm.prev(1'000'000) == -1);
+
+    // positions straddling leaf, mid and top word boundaries
+    for (int64_t p : {0, 63, 64, 4095, 4096, 262143, 262144, 1'000'000}) {
+        bm.set(p);
+        assert(bm.test(p));
+        assert(bm.next(p) == p);
+        assert(bm.prev(p) == p);
+        bm.clear(p);
+        assert(!bm.test(p));
+    }
+
+    bm.set(5);
+    bm.set(262144);
+    bm.set(999'999);
+    assert(bm.next(6) == 262144);
+    assert(bm.next(262145) == 999'999);
+    assert(bm.next(1'000'000) == bm.size());
+    assert(bm.prev(262143) == 5);
+    assert(bm.prev(999'998) == 262144);
+    assert(bm.prev(4) == -1);
+
+    bm.clear(262144);
+    assert(bm.next(6) == 999'999);
+    assert(bm.prev(999'998) == 5);
+
+    printf("[PASS] level_bitmap_boundaries\n");
+}
+
+void test_sparse_best_recovery() {
+    TestBook book;
+
+    // thin book with wide gaps between levels
+    assert(book.add(OrderId{1}, Side::Buy, Price{10}, Qty{10}) == AddResult::Ok);
+    assert(book.add(OrderId{2}, Side::Buy, Price{4000}, Qty{10}) == AddResult::Ok);
+    assert(book.add(OrderId{3}, Side::Sell, Price{6000}, Qty{10}) == AddResult::Ok);
+    assert(book.add(OrderId{4}, Side::Sell, Price{9999}, Qty{10}) == AddResult::Ok);
+
+    // sweep best ask - recovery must jump to the next populated level
+    Qty remaining = book.match(Side::Buy, Qty{10});
+    assert(remaining.raw() == 0);
+    assert(book.ask().raw() == 9999);
+
+    // cancel at best bid
+    assert(book.cancel(OrderId{2}));
+    assert(book.bid().raw() == 10);
+
+    // re-quote inside the gap
+    assert(book.add(OrderId{5}, Side::Sell, Price{5000}, Qty{10}) == AddResult::Ok);
+    assert(book.ask().raw() == 5000);
+
+    // sweep both remaining asks
+    remaining = book.match(Side::Buy, Qty{25});
+    assert(remaining.raw() == 5);
+    assert(!book.has_ask());
+
+    assert(book.cancel(OrderId{1}));
+    assert(!book.has_bid());
+
+    printf("[PASS] sparse_best_recovery\n");
+}
+
+void test_fill_reports() {
+    std::array<Fill, 8> storage{};
+    OrderBook<10000, 1000, FillBuffer> book{FillBuffer{storage}};
+
+    assert(book.add(OrderId{1}, Side::Sell, Price{100}, Qty{10}) == AddResult::Ok);
+    assert(book.add(OrderId{2}, Side::Sell, Price{100}, Qty{10}) == AddResult::Ok);
+    assert(book.add(OrderId{3}, Side::Sell, Price{101}, Qty{10}) == AddResult::Ok);
+    assert(book.listener().empty());
+
+    // aggressive limit buy sweeps 100 and part of 101
+    auto res = book.add(OrderId{9}, Side::Buy, Price{101}, Qty{25},
+                        OrdType::Limit, Timestamp{777});
+    assert(res == AddResult::Ok);
+
+    auto fills = book.listener().fills();
+    assert(fills.size() == 3);
+    assert(fills[0].passive_id == OrderId{1} && fills[0].qty.raw() == 10 && fills[0].price.raw() == 100);
+    assert(fills[1].passive_id == OrderId{2} && fills[1].qty.raw() == 10 && fills[1].price.raw() == 100);
+    assert(fills[2].passive_id == OrderId{3} && fills[2].qty.raw() == 5 && fills[2].price.raw() == 101);
+    for (const auto& f : fills) {
+        assert(f.aggressor_id == OrderId{9});
+        assert(f.ts.raw() == 777);
+    }
+
+    // market order reports its own aggressor id
+    book.listener().clear();
+    Qty remaining = book.match(Side::Buy, Qty{2}, OrderId{10}, Timestamp{778});
+    assert(remaining.raw() == 0);
+    assert(book.listener().size() == 1);
+    assert(book.listener().fills()[0].aggressor_id == OrderId{10});
+    assert(book.listener().fills()[0].passive_id == OrderId{3});
+
+    printf("[PASS] fill_reports\n");
+}
+
+void test_fill_buffer_overflow() {
+    std::array<Fill, 2> storage{};
+    OrderBook<10000, 1000, FillBuffer> book{FillBuffer{storage}};
+
+    for (uint64_t i = 1; i <= 4; ++i) {
+        assert(book.add(OrderId{i}, Side::Buy, Price{100}, Qty{1}) == AddResult::Ok);
+    }
+
+    Qty remaining = book.match(Side::Sell, Qty{4});
+    assert(remaining.raw() == 0);
+    assert(book.listener().size() == 2);
+    assert(book.listener().dropped() == 2);
+    assert(book.listener().fills()[1].passive_id == OrderId{2});
+
+    printf("[PASS] fill_buffer_overflow\n");
+}
+
+void test_fill_callback_listener() {
+    struct Tally {
+        int64_t* qty;
+        void on_fill(const Fill& f) noexcept { *qty += f.qty.raw(); }
+    };
+
+    int64_t traded = 0;
+    OrderBook<10000, 1000, Tally> book{Tally{&traded}};
+
+    assert(book.add(OrderId{1}, Side::Buy, Price{100}, Qty{30}) == AddResult::Ok);
+    assert(book.add(OrderId{2}, Side::Sell, Price{99}, Qty{12}) == AddResult::Ok);
+    assert(traded == 12);
+
+    printf("[PASS] fill_callback_listener\n");
+}
+
+// model check of an id index against a plain set, with ids that all
+// collide modulo a power-of-two table and ids spread over the full 64-bit range
+template<template<size_t> class Index>
+void test_order_index(const char* name) {
+    constexpr size_t N = 1000;
+    auto index = std::make_unique<Index<N>>();
+    auto orders = std::make_unique<std::array<Order, N>>();
+    std::vector<bool> live(N, false);
+
+    auto key = [](size_t i) {
+        return i % 2 == 0 ? OrderId{(i << 20) + 7} : OrderId{mix_id(i)};
+    };
+
+    for (size_t i = 0; i < N; ++i) {
+        (*orders)[i].id = key(i);
+    }
+
+    uint64_t rng = 88172645463325252ULL;
+    for (size_t step = 0; step < 20000; ++step) {
+        rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+        size_t i = rng % N;
+        if constexpr (requires { index->compact(); }) {
+            if (step == 10000) index->compact();
+        }
+        if (live[i]) {
+            assert(index->find(key(i)) == &(*orders)[i]);
+            assert(!index->insert(&(*orders)[i]));  // duplicate
+            index->erase(key(i));
+            live[i] = false;
+        } else {
+            assert(index->find(key(i)) == nullptr);
+            assert(index->insert(&(*orders)[i]));
+            live[i] = true;
+        }
+    }
+
+    for (size_t i = 0; i < N; ++i) {
+        assert((index->find(key(i)) != nullptr) == live[i]);
+    }
+
+    // a full table: misses and erase/re-insert still work
+    auto full = std::make_unique<Index<N>>();
+    for (size_t i = 0; i < N; ++i) {
+        (*orders)[i].id = OrderId{i + 1};
+        assert(full->insert(&(*orders)[i]));
+    }
+    assert(full->find(OrderId{N + 1}) == nullptr && full->find(OrderId{2 * N + 5}) == nullptr);
+    for (size_t i = 0; i < N; i += 3) full->erase(OrderId{i + 1});
+    for (size_t i = 0; i < N; i += 3) assert(full->find(OrderId{i + 1}) == nullptr);
+    for (size_t i = 0; i < N; i += 3) assert(full->insert(&(*orders)[i]));
+    for (size_t i = 0; i < N; ++i) assert(full->find(OrderId{i + 1}) == &(*orders)[i]);
+
+    printf("[PASS] order_index<%s>\n", name);
+}
+
+void test_random_ids_through_book() {
+    using SwissBook = OrderBook<10000, 1000, NullListener, SwissIndex>;
+    auto book = std::make_unique<SwissBook>();
+
+    for (uint64_t i = 1; i <= 500; ++i) {
+        assert(book->add(OrderId{mix_id(i)}, Side::Buy, Price{100 + static_cast<int64_t>(i % 50)},
+                         Qty{1}) == AddResult::Ok);
+    }
+    assert(book->add(OrderId{mix_id(3)}, Side::Buy, Price{100}, Qty{1}) == AddResult::DuplicateId);
+    assert(book->order_count() == 500);
+
+    for (uint64_t i = 1; i <= 500; i += 2) {
+        assert(book->cancel(OrderId{mix_id(i)}));
+    }
+    assert(!book->cancel(OrderId{mix_id(1)}));
+    assert(book->order_count() == 250);
+    assert(book->get_order(OrderId{mix_id(2)}) != nullptr);
+
+    printf("[PASS] random_ids_through_book\n");
+}
+
+void test_mapped_storage() {
+    using MappedBook = OrderBook<10000, 1000, NullListener, SwissIndex,
+                                 MappedStorage<MapOptions{.huge_pages = true, .populate = true}>>;
+    using LazyBook = OrderBook<10000, 1000, NullListener, DirectIndex,
+                               MappedStorage<MapOptions{.huge_pages = false, .populate = false}>>;
+
+    // arrays live in their own mappings, the book object itself is small
+    static_assert(sizeof(MappedBook) < sizeof(TestBook) / 4);
+
+    MappedBook book;
+    LazyBook lazy;
+    for (uint64_t i = 0; i < 100; ++i) {
+        assert(book.add(OrderId{i}, Side::Sell, Price{100 + static_cast<int64_t>(i)}, Qty{10}) == AddResult::Ok);
+        assert(lazy.add(OrderId{i}, Side::Sell, Price{100 + static_cast<int64_t>(i)}, Qty{10}) == AddResult::Ok);
+    }
+    assert(book.ask().raw() == 100 && lazy.ask().raw() == 100);
+
+    assert(book.match(Side::Buy, Qty{1005}).raw() == 5);
+    assert(lazy.match(Side::Buy, Qty{1005}).raw() == 5);
+    assert(!book.has_ask() && !lazy.has_ask());
+    assert(book.pool_used() == 0 && lazy.pool_used() == 0);
+
+    printf("[PASS] mapped_storage\n");
+}
+
+template<typename Book>
+void apply_op(Book& book, const Op& op) {
+    switch (op.type) {
+        case OpType::Add:
+            (void)submit_add(book, op);
+            break;
+        case OpType::Cancel:
+            (void)book.cancel(op.id);
+            break;
+        case OpType::Match:
+            (void)book.match(op.side, op.qty);
+            break;
+        case OpType::Modify:
+            (void)book.modify(op.id, op.price, op.qty);
+            break;
+    }
+}
+
+// drive one flow through a dense book and an alternate-ladder book
+// the mid jumps between phases, which forces a window ladder to recenter
+template<typename Book>
+void test_ladder_matches_dense(const char* name) {
+    auto dense = std::make_unique<TestBook>();
+    auto other = std::make_unique<Book>();
+
+    for (int64_t mid : {5000, 1500, 8500, 5000}) {
+        WorkloadGen gen(static_cast<uint64_t>(mid), 1000.0, mid, 1500.0,
+                        0.40, 0.20, 0.05, 1.5, 10000);
+        gen.set_modify_rate(0.10);
+        for (size_t i = 0; i < 30000; ++i) {
+            Op op = gen.next();
+            apply_op(*dense, op);
+            apply_op(*other, op);
+            assert(dense->bid() == other->bid());
+            assert(dense->ask() == other->ask());
+            assert(dense->bid_qty() == other->bid_qty());
+            assert(dense->ask_qty() == other->ask_qty());
+            assert(dense->order_count() == other->order_count());
+        }
+    }
+
+    // every populated level is visible through level_at, in fifo order
+    for (int64_t px = 0; px <= 10000; ++px) {
+        const auto& a = dense->level_at(Price{px});
+        const auto& b = other->level_at(Price{px});
+        assert(a.qty() == b.qty() && a.count() == b.count());
+        const auto* oa = a.front();
+        const auto* ob = b.front();
+        for (size_t k = 0; k < a.count(); ++k, oa = a.next_of(oa), ob = b.next_of(ob)) {
+            assert(oa->id == ob->id);
+        }
+        assert(oa == a.end() && ob == b.end());
+    }
+
+    printf("[PASS] ladder_matches_dense<%s>\n", name);
+}
+
+// traits pick the same components as the positional parameters
+void test_book_traits() {
+    using Default = BookOf<Sized<10000, 1000>>;
+    static_assert(std::is_same_v<BookOf<>::order_type, OrderBook<>::order_type>);
+    static_assert(Default::max_price() == 10000 && Default::max_orders() == 1000);
+    static_assert(std::is_same_v<BookOf<Sized<10000, 1000, SlotTraits>>::order_type, CompactOrder>);
+    static_assert(std::is_same_v<BookOf<Listened<FillBuffer, Sized<10000, 1000>>>::order_type, Order>);
+    static_assert(!BookPolicy<int>);
+
+    // a derived bundle keeps everything it doesn't override
+    using Sparse = Sized<10000, 1000, SparseTraits>;
+    static_assert(std::is_same_v<Sparse::listener, NullListener> && std::is_same_v<Sparse::storage, InlineStorage>);
+
+    std::array<Fill, 16> fills{};
+    BookOf<Listened<FillBuffer, Sized<10000, 1000, SlotTraits>>> book{FillBuffer{fills}};
+    assert(book.add(OrderId{1}, Side::Sell, Price{101}, Qty{10}) == AddResult::Ok);
+    assert(book.match(Side::Buy, Qty{4}) == Qty{0});
+    assert(book.listener().size() == 1 && fills[0].passive_id == OrderId{1});
+
+    printf("[PASS] book_traits\n");
+}
+
+// arena books commit only what they touch, grow on demand and size from config
+void test_arena_storage() {
+    using ArenaBook = BookOf<Sized<10000, 1000, ArenaTraits>>;
+    Arena arena(size_t{64} << 20);
+
+    auto book = make_in<ArenaBook>(arena);
+    assert(arena.used() > 0 && arena.resident() < arena.used() / 2);
+    size_t idle = arena.resident();
+    for (uint64_t i = 1; i <= 1000; ++i) {
+        assert(book->add(OrderId{i}, i % 2 ? Side::Buy : Side::Sell,
+                         Price{i % 2 ? 4000 - static_cast<int64_t>(i % 50) : 6000 + static_cast<int64_t>(i % 50)},
+                         Qty{1}) == AddResult::Ok);
+    }
+    assert(book->add(OrderId{1001}, Side::Buy, Price{1}, Qty{1}) == AddResult::PoolExhausted);
+    assert(arena.resident() > idle);
+    book.reset();
+
+    // runtime capacity below the compile-time ceiling
+    auto small = make_in<ArenaBook>(arena);
+    assert(!small->set_capacity(ArenaBook::max_orders() + 1));
+    assert(small->set_capacity(3) && small->pool_capacity() == 3);
+    for (uint64_t i = 1; i <= 3; ++i) assert(small->add(OrderId{i}, Side::Buy, Price{100}, Qty{1}) == AddResult::Ok);
+    assert(small->add(OrderId{4}, Side::Buy, Price{100}, Qty{1}) == AddResult::PoolExhausted);
+    assert(!small->set_capacity(2));
+    assert(small->cancel(OrderId{2}));
+    assert(small->add(OrderId{4}, Side::Buy, Price{100}, Qty{1}) == AddResult::Ok);
+    assert(small->set_capacity(10) && small->add(OrderId{5}, Side::Buy, Price{100}, Qty{1}) == AddResult::Ok);
+
+    // arrays need an arena to come from
+    bool threw = false;
+    try {
+        auto stray = std::make_unique<ArenaBook>();
+    } catch (const std::bad_alloc&) {
+        threw = true;
+    }
+    assert(threw);
+
+    // one arena per shard
+    BookManager<ArenaBook, 256, 32> mgr(2, 5, {}, size_t{16} << 20);
+    assert(mgr.arena(0) != nullptr && mgr.arena(1) != nullptr && mgr.arena(0) != mgr.arena(1));
+    for (uint32_t sym = 0; sym < 5; ++sym) {
+        mgr.submit(sym, Op{OpType::Add, OrderId{sym + 1}, Side::Sell, Price{200}, Qty{4}, OrdType::Limit});
+    }
+    mgr.stop();
+    for (uint32_t sym = 0; sym < 5; ++sym) assert(mgr.book(sym).ask_qty() == Qty{4});
+
+    printf("[PASS] arena_storage\n");
+}
+
+// shared depot over inline storage
+struct InlineShard : BookTraits {
+    template<typename O, size_t Capacity, typename Storage, typename Idx>
+    using pool = MagazinePool<O, Capacity, Storage, Idx>;
+};
+
+// books on one depot share its slots, return them in batches and on destruction
+void test_shared_pool() {
+    using Book = BookOf<Sized<10000, 1000, InlineShard>>;
+    using Depot = Book::pool_type::depot_type;
+    auto depot = std::make_unique<Depot>();
+
+    bool threw = false;
+    try {
+        auto stray = std::make_unique<Book>();
+    } catch (const std::bad_alloc&) {
+        threw = true;
+    }
+    assert(threw);
+
+    PoolScope scope(*depot);
+    auto a = std::make_unique<Book>();
+    auto b = std::make_unique<Book>();
+
+    // one symbol takes most of the depot, the other gets what is left
+    for (uint64_t i = 1; i <= 900; ++i) assert(a->add(OrderId{i}, Side::Buy, Price{100}, Qty{1}) == AddResult::Ok);
+    size_t got = 0;
+    while (b->add(OrderId{got + 1}, Side::Sell, Price{200}, Qty{1}) == AddResult::Ok) ++got;
+    assert(got + 900 + a->pool().cached() == 1000 && a->pool().cached() < MAGAZINE_SLOTS);
+    assert(b->pool().full() && depot->available() == 0);
+
+    // frees fill a's magazines first, then go back to the depot in batches
+    for (uint64_t i = 1; i <= 900; ++i) assert(a->cancel(OrderId{i}));
+    assert(a->pool().cached() <= 2 * MAGAZINE_SLOTS);
+    assert(depot->available() + a->pool().cached() == 1000 - got);
+    assert(b->add(OrderId{5000}, Side::Sell, Price{200}, Qty{1}) == AddResult::Ok);
+
+    // a book's share can be capped from config
+    assert(a->set_capacity(2) && a->pool_capacity() == 2);
+    assert(a->add(OrderId{1}, Side::Buy, Price{100}, Qty{1}) == AddResult::Ok);
+    assert(a->add(OrderId{2}, Side::Buy, Price{100}, Qty{1}) == AddResult::Ok);
+    assert(a->add(OrderId{3}, Side::Buy, Price{100}, Qty{1}) == AddResult::PoolExhausted);
+    assert(!a->set_capacity(1));
+
+    // destroying a book hands back its orders, stops and cache
+    assert(a->set_capacity(1000));
+    assert(a->add(OrderId{7}, Side::Buy, Price{300}, Qty{5}, OrdType::Stop) == AddResult::Ok && a->stop_count() == 1);
+    b.reset();
+    a.reset();
+    assert(depot->available() == 1000);
+
+    // two threads, one book each, on one depot: same books as private pools
+    using WideBook = BookOf<Sized<10000, 4096, InlineShard>>;
+    auto wide = std::make_unique<WideBook::pool_type::depot_type>();
+    PoolScope wide_scope(*wide);
+    std::vector<std::vector<Op>> flows;
+    for (uint64_t seed : {7, 8}) {
+        WorkloadGen gen(seed, 1000.0, 5000, 50.0, 0.40, 0.20, 0.05, 1.5, 10000);
+        flows.push_back(gen.generate(40000));
+    }
+    std::array<std::unique_ptr<WideBook>, 2> shared;
+    for (auto& book : shared) book = std::make_unique<WideBook>();
+    {
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < 2; ++t) {
+            workers.emplace_back([&, t] { for (const Op& op : flows[t]) apply_op(*shared[t], op); });
+        }
+        for (auto& w : workers) w.join();
+    }
+    for (size_t t = 0; t < 2; ++t) {
+        auto own = std::make_unique<BookOf<Sized<10000, 4096>>>();
+        for (const Op& op : flows[t]) apply_op(*own, op);
+        assert(own->bid() == shared[t]->bid() && own->ask() == shared[t]->ask());
+        assert(own->bid_qty() == shared[t]->bid_qty() && own->ask_qty() == shared[t]->ask_qty());
+        assert(own->order_count() == shared[t]->order_count());
+    }
+    for (auto& book : shared) book.reset();
+    assert(wide->available() == 4096);
+
+    // a shard's books share its depot
+    BookManager<BookOf<Sized<10000, 1000, ShardTraits>>, 256, 32> mgr(2, 4, {}, size_t{16} << 20);
+    for (uint32_t sym = 0; sym < 4; ++sym) {
+        mgr.submit(sym, Op{OpType::Add, OrderId{sym + 1}, Side::Buy, Price{50}, Qty{2}, OrdType::Limit});
+    }
+    mgr.stop();
+    assert(&mgr.book(0).pool().depot() == &mgr.book(2).pool().depot());
+    assert(&mgr.book(0).pool().depot() != &mgr.book(1).pool().depot());
+    for (uint32_t sym = 0; sym < 4; ++sym) assert(mgr.book(sym).bid_qty() == Qty{2});
+
+    printf("[PASS] shared_pool\n");
+}
+
+void test_window_ladder_recenters() {
+    auto book = std::make_unique<WindowBook>();
+
+    // anchors on the first order, far levels go to overflow
+    assert(book->add(OrderId{1}, Side::Buy, Price{1000}, Qty{10}) == AddResult::Ok);
+    assert(book->add(OrderId{2}, Side::Sell, Price{1010}, Qty{10}) == AddResult::Ok);
+    int64_t base = book->ladder().window_base();
+    assert(book->add(OrderId{3}, Side::Sell, Price{9000}, Qty{10}) == AddResult::Ok);
+    assert(book->add(OrderId{4}, Side::Sell, Price{9100}, Qty{10}) == AddResult::Ok);
+    assert(book->ladder().overflow_levels() == 2);
+
+    // touch moves far away: clearing the low side recenters on the next add
+    assert(book->cancel(OrderId{1}));
+    Qty left = book->match(Side::Buy, Qty{10});
+    assert(left.raw() == 0);
+    assert(book->add(OrderId{5}, Side::Sell, Price{9005}, Qty{10}) == AddResult::Ok);
+    assert(book->ladder().window_base() != base);
+    assert(book->ladder().overflow_levels() == 0);
+    assert(!book->has_bid() && book->ask().raw() == 9000);
+    assert(book->level_at(Price{9005}).qty().raw() == 10);
+    assert(book->level_at(Price{9100}).count() == 1);
+
+    // sweep through the recentred levels
+    left = book->match(Side::Buy, Qty{35});
+    assert(left.raw() == 5 && !book->has_ask());
+
+    printf("[PASS] window_ladder_recenters\n");
+}
+
+void test_compact_orders() {
+    static_assert(std::is_same_v<SlotBook::order_type, CompactOrder>);
+    auto book = std::make_unique<SlotBook>();
+
+    // narrowed fields read back at full width
+    assert(book->add(OrderId{7}, Side::Sell, Price{100}, Qty{50}, OrdType::Limit,
+                     Timestamp{(uint64_t{1} << 32) + 9}) == AddResult::Ok);
+    const CompactOrder* o = book->get_order(OrderId{7});
+    assert(o != nullptr && o->id == OrderId{7} && o->price.raw() == 100);
+    assert(o->qty.raw() == 50 && o->orig_qty.raw() == 50 && o->ts.raw() == 9);
+
+    // ids and qtys past 32 bits are refused, not truncated
+    assert(book->add(OrderId{uint64_t{1} << 32 | 7}, Side::Sell, Price{101}, Qty{1}) == AddResult::InvalidId);
+    assert(book->add(OrderId{8}, Side::Sell, Price{101}, Qty{int64_t{1} << 31}) == AddResult::InvalidId);
+    assert(book->get_order(OrderId{uint64_t{1} << 32 | 7}) == nullptr);
+    assert(book->order_count() == 1);
+
+    // fifo across slot links, and fills larger than any one order
+    assert(book->add(OrderId{8}, Side::Sell, Price{100}, Qty{30}) == AddResult::Ok);
+    assert(book->add(OrderId{9}, Side::Sell, Price{100}, Qty{20}) == AddResult::Ok);
+    assert(book->cancel(OrderId{8}));
+    assert(book->level_at(Price{100}).count() == 2);
+    assert(book->level_at(Price{100}).back()->id == OrderId{9});
+    Qty left = book->match(Side::Buy, Qty{60});
+    assert(left.raw() == 0 && book->ask_qty().raw() == 10);
+    assert(book->get_order(OrderId{7}) == nullptr);
+    assert(book->get_order(OrderId{9})->qty.raw() == 10);
+
+    printf("[PASS] compact_orders\n");
+}
+
+// apply() over batches matches op-by-op calls, results included
+void test_batch_apply() {
+    using SwissBook = OrderBook<10000, 1000, NullListener, SwissIndex>;
+    auto single = std::make_unique<SwissBook>();
+    auto batched = std::make_unique<SwissBook>();
+
+    WorkloadGen gen(7, 1000.0, 5000, 50.0, 0.40, 0.20, 0.05, 1.5, 10000);
+    gen.set_id_mode(IdMode::Random);
+    std::vector<Op> ops = gen.generate(20000);
+    // a duplicate add and a repeated cancel inside one batch
+    ops[10] = ops[3];
+    ops[11] = Op{OpType::Cancel, ops[3].id, Side::Buy, Price{0}, Qty{0}, OrdType::Limit};
+    ops[12] = ops[11];
+
+    std::vector<OpResult> results(ops.size());
+    std::span<const Op> all(ops);
+    for (size_t i = 0; i < ops.size(); i += 100) {
+        size_t n = std::min<size_t>(100, ops.size() - i);
+        batched->apply(all.subspan(i, n), std::span<OpResult>(results).subspan(i, n));
+
+        for (size_t k = i; k < i + n; ++k) {
+            const Op& op = ops[k];
+            switch (op.type) {
+                case OpType::Add:
+                    assert(single->add(op.id, op.side, op.price, op.qty, op.ord_type) == results[k].add);
+                    break;
+                case OpType::Cancel:
+                    assert(single->cancel(op.id) == results[k].cancelled);
+                    break;
+                case OpType::Match:
+                    assert(single->match(op.side, op.qty) == results[k].left);
+                    break;
+                case OpType::Modify:
+                    assert(single->modify(op.id, op.price, op.qty) == results[k].modify);
+                    break;
+            }
+        }
+        assert(single->bid() == batched->bid() && single->ask() == batched->ask());
+        assert(single->bid_qty() == batched->bid_qty() && single->ask_qty() == batched->ask_qty());
+        assert(single->order_count() == batched->order_count());
+    }
+    assert(!results[12].cancelled);
+
+    // a short result span only takes the first ops
+    std::array<OpResult, 1> one{};
+    batched->apply(all.first(2), one);
+
+    printf("[PASS] batch_apply\n");
+}
+
+void test_spsc_ring() {
+    constexpr uint64_t N = 200000;
+    auto ring = std::make_unique<SpscRing<uint64_t, 64>>();
+
+    // bulk push against a small ring, order preserved across wraps
+    std::thread producer([&] {
+        std::array<uint64_t, 5> chunk{};
+        for (uint64_t i = 0; i < N; i += 5) {
+            for (uint64_t k = 0; k < 5; ++k) chunk[k] = i + k;
+            std::span<const uint64_t> rest(chunk);
+            while (!rest.empty()) {
+                size_t n = ring->try_push_bulk(rest);
+                if (n == 0) std::this_thread::yield();
+                rest = rest.subspan(n);
+            }
+        }
+    });
+
+    std::array<uint64_t, 16> out{};
+    uint64_t expect = 0;
+    while (expect < N) {
+        size_t n = ring->pop_bulk(out);
+        if (n == 0) std::this_thread::yield();
+        for (size_t k = 0; k < n; ++k) assert(out[k] == expect++);
+    }
+    producer.join();
+    assert(ring->empty());
+    assert(ring->try_push(7) && ring->size() == 1);
+
+    printf("[PASS] spsc_ring\n");
+}
+
+// sharded books end up identical to books fed directly
+void test_book_manager() {
+    using Book = OrderBook<10000, 1000>;
+    constexpr uint32_t SYMBOLS = 5;
+    constexpr size_t OPS = 20000;
+
+    std::vector<std::vector<Op>> streams;
+    std::vector<std::unique_ptr<Book>> expected;
+    for (uint32_t sym = 0; sym < SYMBOLS; ++sym) {
+        WorkloadGen gen(sym + 1, 1000.0, 5000, 50.0, 0.40, 0.20, 0.05, 1.5, 10000);
+        streams.push_back(gen.generate(OPS));
+        expected.push_back(std::make_unique<Book>());
+        for (const Op& op : streams.back()) apply_op(*expected.back(), op);
+    }
+
+    BookManager<Book, 256, 32> mgr(3, SYMBOLS);
+    for (size_t i = 0; i < OPS; ++i) {
+        // uneven interleave so runs of one symbol reach the workers too
+        for (uint32_t sym = 0; sym < SYMBOLS; ++sym) {
+            if (sym == 0 && i % 2 == 0) mgr.submit(sym, streams[sym][i]);
+            if (sym != 0) mgr.submit(sym, streams[sym][i]);
+        }
+        if (i % 2 == 1) mgr.submit(0, streams[0][i]);
+    }
+    mgr.drain();
+    assert(mgr.applied() == SYMBOLS * OPS);
+
+    for (uint32_t sym = 0; sym < SYMBOLS; ++sym) {
+        const Book& a = *expected[sym];
+        const Book& b = mgr.book(sym);
+        assert(a.bid() == b.bid() && a.ask() == b.ask());
+        assert(a.bid_qty() == b.bid_qty() && a.ask_qty() == b.ask_qty());
+        assert(a.order_count() == b.order_count());
+    }
+
+    // stop drains whatever is still queued
+    mgr.submit(1, Op{OpType::Add, OrderId{999999}, Side::Buy, Price{1}, Qty{3}, OrdType::Limit});
+    mgr.stop();
+    assert(mgr.book(1).get_order(OrderId{999999}) != nullptr);
+
+    printf("[PASS] book_manager\n");
+}
+
+// what the gateway published
+struct GatewayLog {
+    size_t fills = 0;
+    size_t levels = 0;
+    Qty volume{0};
+
+    void on_fill(const Fill& f) noexcept {
+        ++fills;
+        volume += f.qty;
+    }
+    void on_level(const LevelUpdate&) noexcept { ++levels; }
+};
+
+// the pipeline leaves the book and the published fills exactly as the plain loop does
+void test_gateway() {
+    using Book = OrderBook<10000, 1000, GatewayTap>;
+    using RefBook = OrderBook<10000, 1000, GatewayLog>;
+    WorkloadGen gen(17, 1000.0, 5000, 50.0, 0.40, 0.20, 0.05, 1.5, 10000);
+    std::vector<Op> ops = gen.generate(20000);
+    std::vector<std::byte> wire(ops.size() * REPLAY_RECORD);
+    for (size_t i = 0; i < ops.size(); ++i) encode(wire.data() + i * REPLAY_RECORD, to_msg(ops[i]));
+
+    auto ref = std::make_unique<RefBook>();
+    for (size_t i = 0; i < ops.size(); ++i) dispatch(*ref, decode(wire.data() + i * REPLAY_RECORD));
+    assert(ref->listener().fills > 0);
+
+    auto same = [&](const Book& b, const GatewayLog& log) {
+        assert(b.bid() == ref->bid() && b.ask() == ref->ask());
+        assert(b.bid_qty() == ref->bid_qty() && b.ask_qty() == ref->ask_qty());
+        assert(b.order_count() == ref->order_count());
+        assert(log.fills == ref->listener().fills && log.volume == ref->listener().volume);
+    };
+
+    // one thread, cooperative
+    {
+        auto book = std::make_unique<Book>();
+        GatewayLog log;
+        auto gw = std::make_unique<Gateway<Book, GatewayLog>>(*book, log);
+        gw->run(wire);
+        same(*book, log);
+        assert(gw->stats().decoded == ops.size() && gw->stats().routed == ops.size());
+        assert(gw->stats().fills == log.fills && gw->stats().levels == log.levels && log.levels > 0);
+    }
+
+    // a thread per stage over tiny rings, so every stage stalls on backpressure
+    {
+        auto book = std::make_unique<Book>();
+        GatewayLog log;
+        auto gw = std::make_unique<Gateway<Book, GatewayLog, 8, 4>>(*book, log);
+        gw->run_threads(wire);
+        same(*book, log);
+        assert(gw->stats().routed == ops.size());
+    }
+
+    // risk stops what breaks the limits before the book sees it
+    {
+        auto book = std::make_unique<Book>();
+        GatewayLog log;
+        Gateway<Book, GatewayLog, 8, 4> gw(*book, log, RiskLimits{Qty{100}, Price{90}, Price{110}, 5000});
+        std::vector<Msg> msgs = {
+            {MsgType::Add, Side::Buy, OrdType::Limit, Qty{10}, OrderId{1}, OrderId{0}, Price{100}},
+            {MsgType::Add, Side::Buy, OrdType::Limit, Qty{101}, OrderId{2}, OrderId{0}, Price{100}},
+            {MsgType::Add, Side::Sell, OrdType::Limit, Qty{10}, OrderId{3}, OrderId{0}, Price{111}},
+            {MsgType::Add, Side::Sell, OrdType::Limit, Qty{60}, OrderId{4}, OrderId{0}, Price{100}},
+            {MsgType::Execute, Side::Sell, OrdType::Market, Qty{4}, OrderId{5}, OrderId{0}, Price{0}},
+            {MsgType::Cancel, Side::Buy, OrdType::Limit, Qty{0}, OrderId{1}, OrderId{0}, Price{0}},
+        };
+        std::vector<std::byte> bytes(msgs.size() * REPLAY_RECORD);
+        for (size_t i = 0; i < msgs.size(); ++i) encode(bytes.data() + i * REPLAY_RECORD, msgs[i]);
+        gw.run(bytes);
+        const GatewayStats& st = gw.stats();
+        assert(st.routed == 3);
+        assert(st.rejected[static_cast<size_t>(RiskCheck::Qty)] == 1);
+        assert(st.rejected[static_cast<size_t>(RiskCheck::Price)] == 1);
+        assert(st.rejected[static_cast<size_t>(RiskCheck::Notional)] == 1);
+        assert(log.fills == 1 && log.volume == Qty{4} && book->order_count() == 0);
+
+        // a second run reuses the pipeline
+        gw.run(std::span<const std::byte>(bytes).first(REPLAY_RECORD));
+        assert(book->bid() == Price{100} && gw.stats().routed == 4);
+    }
+
+    // a sweep that fills more than the tap holds spills it mid-match and loses
+    // nothing: one resting order per fill, then an iceberg refilling far past it
+    using DeepBook = OrderBook<10000, 8192, GatewayTap>;
+    auto sweep = [](auto&& run) {
+        constexpr size_t N = TAP_CAPACITY + 100;
+        constexpr int64_t SLICES = 3 * TAP_CAPACITY;
+        auto book = std::make_unique<DeepBook>();
+        std::vector<std::byte> bytes((N + 3) * REPLAY_RECORD);
+        for (size_t i = 0; i < N; ++i) {
+            encode(bytes.data() + i * REPLAY_RECORD, Msg{MsgType::Add, Side::Sell, OrdType::Limit, Qty{1},
+                                                         OrderId{i + 1}, OrderId{0}, Price{100}});
+        }
+        encode(bytes.data() + N * REPLAY_RECORD, Msg{MsgType::Execute, Side::Buy, OrdType::Market,
+                                                     Qty{static_cast<int64_t>(N)}, OrderId{0}, OrderId{0}, Price{0}});
+        encode(bytes.data() + (N + 1) * REPLAY_RECORD, Msg{MsgType::Add, Side::Sell, OrdType::Iceberg, Qty{SLICES},
+                                                           OrderId{N + 1}, OrderId{0}, Price{100}, Qty{1}});
+        encode(bytes.data() + (N + 2) * REPLAY_RECORD, Msg{MsgType::Execute, Side::Buy, OrdType::Market,
+                                                           Qty{SLICES}, OrderId{0}, OrderId{0}, Price{0}});
+        GatewayLog log;
+        GatewayStats st = run(*book, log, bytes);
+        assert(book->order_count() == 0 && !book->has_ask() && book->listener().dropped() == 0);
+        assert(log.fills == N + SLICES && log.volume == Qty{static_cast<int64_t>(N) + SLICES});
+        assert(st.fills == log.fills && st.spills >= 3 && st.routed == N + 3);
+    };
+    sweep([](DeepBook& book, GatewayLog& log, std::span<const std::byte> bytes) {
+        auto gw = std::make_unique<Gateway<DeepBook, GatewayLog>>(book, log);
+        gw->run(bytes);
+        return gw->stats();
+    });
+    sweep([](DeepBook& book, GatewayLog& log, std::span<const std::byte> bytes) {
+        auto gw = std::make_unique<Gateway<DeepBook, GatewayLog, 8, 4>>(book, log);
+        gw->run(bytes);
+        return gw->stats();
+    });
+    sweep([](DeepBook& book, GatewayLog& log, std::span<const std::byte> bytes) {
+        auto gw = std::make_unique<Gateway<DeepBook, GatewayLog, 8, 4>>(book, log);
+        gw->run_threads(bytes);
+        return gw->stats();
+    });
+
+    printf("[PASS] gateway\n");
+}
+
+void test_bbo_publisher() {
+    static_assert(!LISTENS<BboPublisher<>> && LISTENS<BboPublisher<FillBuffer>>);
+    using PubBook = OrderBook<10000, 1000, BboPublisher<>>;
+    SeqlockBbo snap;
+    auto book = std::make_unique<PubBook>(BboPublisher<>{snap});
+
+    assert(book->add(OrderId{1}, Side::Buy, Price{100}, Qty{10}) == AddResult::Ok);
+    Bbo b = snap.load();
+    assert(b.bid.raw() == 100 && b.bid_qty.raw() == 10 && b.version == 1);
+
+    // size at the touch changes the top, a deeper level doesn't
+    assert(book->add(OrderId{2}, Side::Buy, Price{100}, Qty{5}) == AddResult::Ok);
+    assert(book->add(OrderId{3}, Side::Buy, Price{90}, Qty{5}) == AddResult::Ok);
+    b = snap.load();
+    assert(b.bid_qty.raw() == 15 && b.version == 2);
+
+    assert(book->add(OrderId{4}, Side::Sell, Price{110}, Qty{7}) == AddResult::Ok);
+    (void)book->match(Side::Sell, Qty{15});
+    b = snap.load();
+    assert(b.bid.raw() == 90 && b.ask.raw() == 110 && b.ask_qty.raw() == 7 && b.version == 4);
+    assert(book->cancel(OrderId{3}));
+    assert(snap.load().bid == NO_BID && snap.stores() == 5);
+
+    // a reader racing the writer only ever sees whole, uncrossed snapshots
+    std::atomic<bool> done{false};
+    std::thread reader([&] {
+        uint64_t last = 0;
+        while (!done.load(std::memory_order_acquire)) {
+            Bbo r;
+            if (!snap.try_load(r)) continue;
+            assert(r.version >= last);
+            last = r.version;
+            assert((r.bid.raw() < 0) == (r.bid_qty.raw() == 0));
+            assert(r.bid.raw() < 0 || r.ask.raw() > 10000 || r.bid < r.ask);
+            std::this_thread::yield();
+        }
+    });
+    WorkloadGen gen(5, 1000.0, 5000, 50.0, 0.40, 0.20, 0.05, 1.5, 10000);
+    for (size_t i = 0; i < 50000; ++i) apply_op(*book, gen.next());
+    done.store(true, std::memory_order_release);
+    reader.join();
+    assert(snap.load().same_top(book->top()));
+
+    printf("[PASS] bbo_publisher\n");
+}
+
+void test_replay_roundtrip() {
+    char tmpl[] = "/tmp/ob_replay_test_XXXXXX";
+    int fd = ::mkstemp(tmpl);
+    assert(fd >= 0);
+    ::close(fd);
+    std::string path = tmpl;
+
+    WorkloadGen gen(11, 1000.0, 5000, 50.0, 0.40, 0.20, 0.05, 1.5, 10000);
+    std::vector<Op> ops = gen.generate(20000);
+    write_replay(path, ops);
+
+    {
+        ReplayFile file(path);
+        assert(file.size() == ops.size());
+        assert(file.records().size() == ops.size() * REPLAY_RECORD);
+        for (size_t i = 0; i < ops.size(); ++i) {
+            Msg m = file[i];
+            assert(m.id == ops[i].id && m.side == ops[i].side && m.qty == ops[i].qty);
+            assert(m.type != MsgType::Add || (m.price == ops[i].price && m.ord_type == ops[i].ord_type));
+        }
+
+        // replayed book matches one driven op by op
+        auto direct = std::make_unique<TestBook>();
+        auto replayed = std::make_unique<TestBook>();
+        for (const Op& op : ops) apply_op(*direct, op);
+        file.replay(*replayed);
+        assert(direct->bid() == replayed->bid() && direct->ask() == replayed->ask());
+        assert(direct->bid_qty() == replayed->bid_qty() && direct->ask_qty() == replayed->ask_qty());
+        assert(direct->order_count() == replayed->order_count());
+    }
+
+    // iceberg slices and stops survive the round trip
+    ScenarioConfig cfg;
+    cfg.ops = 5000;
+    cfg.mid = 5000;
+    cfg.max_price = TestBook::max_price();
+    cfg.capacity = TestBook::max_orders();
+    for (Scenario sc : {Scenario::IcebergRefill, Scenario::StopCascade}) {
+        std::vector<Op> flow = make_scenario(sc, cfg);
+        write_replay(path, flow);
+        auto direct = std::make_unique<TestBook>();
+        auto replayed = std::make_unique<TestBook>();
+        for (const Op& op : flow) apply_op(*direct, op);
+        ReplayFile(path).replay(*replayed);
+        assert(direct->bid() == replayed->bid() && direct->ask() == replayed->ask());
+        assert(direct->bid_qty() == replayed->bid_qty() && direct->ask_qty() == replayed->ask_qty());
+        assert(direct->order_count() == replayed->order_count() && direct->stop_count() == replayed->stop_count());
+    }
+
+    // replace loses priority: cancel the old ref, add the new one at the back
+    auto book = std::make_unique<TestBook>();
+    assert(book->add(OrderId{1}, Side::Buy, Price{100}, Qty{10}) == AddResult::Ok);
+    assert(book->add(OrderId{2}, Side::Buy, Price{100}, Qty{10}) == AddResult::Ok);
+    std::byte rec[REPLAY_RECORD];
+    encode(rec, Msg{MsgType::Replace, Side::Buy, OrdType::Limit, Qty{4}, OrderId{1}, OrderId{3}, Price{100}});
+    dispatch(*book, decode(rec));
+    assert(book->get_order(OrderId{1}) == nullptr);
+    assert(book->level_at(Price{100}).back()->id == OrderId{3});
+    assert(book->bid_qty().raw() == 14);
+
+    // an iceberg replaced under a new ref keeps its peak; a replace whose new
+    // order would be refused leaves the old one standing
+    assert(book->add_iceberg(OrderId{4}, Side::Buy, Price{99}, Qty{30}, Qty{5}) == AddResult::Ok);
+    encode(rec, Msg{MsgType::Replace, Side::Buy, OrdType::Iceberg, Qty{20}, OrderId{4}, OrderId{5}, Price{99}, Qty{5}});
+    assert(dispatch(*book, decode(rec)));
+    assert(book->get_order(OrderId{4}) == nullptr && book->get_order(OrderId{5})->open_qty() == Qty{20});
+    assert(book->level_at(Price{99}).qty() == Qty{5});
+    encode(rec, Msg{MsgType::Replace, Side::Buy, OrdType::Iceberg, Qty{20}, OrderId{5}, OrderId{6}, Price{99}});
+    assert(!dispatch(*book, decode(rec)) && book->get_order(OrderId{5}) != nullptr);
+    encode(rec, Msg{MsgType::Replace, Side::Buy, OrdType::Limit, Qty{20}, OrderId{5}, OrderId{2}, Price{99}});
+    assert(!dispatch(*book, decode(rec)) && book->get_order(OrderId{5}) != nullptr);
+    assert(book->cancel(OrderId{5}));
+
+    // an ord_type byte past the enum never reaches the ladder
+    encode(rec, Msg{MsgType::Add, Side::Buy, OrdType::Limit, Qty{5}, OrderId{9}, OrderId{0}, Price{100}});
+    rec[2] = std::byte{9};
+    Msg bad = decode(rec);
+    assert(!well_formed(bad) && check_risk(RiskLimits{}, bad) == RiskCheck::Malformed);
+    dispatch(*book, bad);
+    assert(book->get_order(OrderId{9}) == nullptr && book->bid_qty().raw() == 14);
+    assert(book->add(OrderId{9}, Side::Buy, Price{100}, Qty{5}, bad.ord_type) == AddResult::InvalidType);
+    assert(book->order_count() == 2 && book->call_count() == 0);
+    rec[0] = std::byte{'Z'};
+    assert(!well_formed(decode(rec)));
+
+    // anything else is refused
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    std::fputs("not a replay file", f);
+    std::fclose(f);
+    bool threw = false;
+    try {
+        ReplayFile bad(path);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    ::unlink(path.c_str());
+
+    printf("[PASS] replay_roundtrip\n");
+}
+
+void test_modify() {
+    auto book = std::make_unique<TestBook>();
+    assert(book->add(OrderId{1}, Side::Buy, Price{100}, Qty{10}) == AddResult::Ok);
+    assert(book->add(OrderId{2}, Side::Buy, Price{100}, Qty{10}) == AddResult::Ok);
+    assert(book->add(OrderId{3}, Side::Buy, Price{100}, Qty{10}) == AddResult::Ok);
+
+    // size down keeps the queue position
+    assert(book->modify(OrderId{1}, Price{100}, Qty{4}) == ModifyResult::Ok);
+    assert(book->level_at(Price{100}).front()->id == OrderId{1});
+    assert(book->bid_qty().raw() == 24);
+    assert(book->get_order(OrderId{1})->remaining().raw() == 4);
+
+    // size up goes to the back
+    assert(book->modify(OrderId{2}, Price{100}, Qty{15}) == ModifyResult::Ok);
+    assert(book->level_at(Price{100}).back()->id == OrderId{2});
+    assert(book->level_at(Price{100}).count() == 3);
+    assert(book->bid_qty().raw() == 29);
+
+    // reprice reuses the node and moves the best
+    const auto* node = book->get_order(OrderId{3});
+    assert(book->modify(OrderId{3}, Price{105}, Qty{10}) == ModifyResult::Ok);
+    assert(book->get_order(OrderId{3}) == node);
+    assert(book->pool_used() == 3 && book->order_count() == 3);
+    assert(book->bid().raw() == 105 && book->bid_qty().raw() == 10);
+    assert(book->level_at(Price{100}).count() == 2);
+
+    // moving the last order off the best falls back to the next level
+    assert(book->modify(OrderId{3}, Price{90}, Qty{10}) == ModifyResult::Ok);
+    assert(book->bid().raw() == 100 && book->bid_qty().raw() == 19);
+
+    // a reprice through the touch trades, the rest rests at the new price
+    assert(book->add(OrderId{4}, Side::Sell, Price{110}, Qty{6}) == AddResult::Ok);
+    assert(book->modify(OrderId{3}, Price{110}, Qty{10}) == ModifyResult::Ok);
+    assert(!book->has_ask());
+    assert(book->bid().raw() == 110 && book->bid_qty().raw() == 4);
+    assert(book->pool_used() == 3);
+
+    // and one that fills completely is gone
+    assert(book->add(OrderId{5}, Side::Sell, Price{120}, Qty{20}) == AddResult::Ok);
+    assert(book->modify(OrderId{1}, Price{120}, Qty{4}) == ModifyResult::Ok);
+    assert(book->get_order(OrderId{1}) == nullptr);
+    assert(book->ask_qty().raw() == 16);
+    assert(book->pool_used() == book->order_count());
+
+    // rejects leave the order alone
+    assert(book->modify(OrderId{99}, Price{100}, Qty{1}) == ModifyResult::NotFound);
+    assert(book->modify(OrderId{2}, Price{100}, Qty{0}) == ModifyResult::InvalidQty);
+    assert(book->modify(OrderId{2}, Price{-1}, Qty{1}) == ModifyResult::InvalidPrice);
+    assert(book->modify(OrderId{2}, Price{10001}, Qty{1}) == ModifyResult::InvalidPrice);
+    assert(book->get_order(OrderId{2})->remaining().raw() == 15);
+
+    // compact layout: same priority rules through slot links
+    auto slot = std::make_unique<SlotBook>();
+    assert(slot->add(OrderId{1}, Side::Sell, Price{200}, Qty{10}) == AddResult::Ok);
+    assert(slot->add(OrderId{2}, Side::Sell, Price{200}, Qty{10}) == AddResult::Ok);
+    assert(slot->modify(OrderId{2}, Price{200}, Qty{3}) == ModifyResult::Ok);
+    assert(slot->level_at(Price{200}).back()->id == OrderId{2});
+    assert(slot->modify(OrderId{1}, Price{200}, Qty{11}) == ModifyResult::Ok);
+    assert(slot->level_at(Price{200}).front()->id == OrderId{2});
+    assert(slot->ask_qty().raw() == 14);
+    assert(slot->match(Side::Buy, Qty{3}).raw() == 0);
+    assert(slot->get_order(OrderId{2}) == nullptr);
+
+    printf("[PASS] modify\n");
+}
+
+// top-n through depth() against a tick-by-tick walk of level_at
+template<typename Book>
+void check_depth(const Book& book, Side side, size_t n) {
+    std::array<LevelView, 80> got{};
+    size_t k = book.depth(side, n, std::span<LevelView>(got).first(std::min<size_t>(n, got.size())));
+    size_t seen = 0;
+    int64_t step = side == Side::Buy ? -1 : 1;
+    int64_t px = side == Side::Buy ? book.bid().raw() : book.ask().raw();
+    for (; seen < std::min<size_t>(n, got.size()) && px >= 0 && px <= Book::max_price(); px += step) {
+        const auto& level = book.level_at(Price{px});
+        if (level.empty()) continue;
+        assert(seen < k);
+        assert(got[seen].price.raw() == px && got[seen].qty == level.qty() && got[seen].count == level.count());
+        ++seen;
+    }
+    assert(seen == k);
+}
+
+template<typename Book>
+void test_depth_snapshot(const char* name) {
+    auto book = std::make_unique<Book>();
+    std::array<LevelView, 4> out{};
+    assert(book->depth(Side::Buy, 4, out) == 0 && book->depth(Side::Sell, 4, out) == 0);
+
+    // a run of more than a bitmap word, then gaps
+    uint64_t id = 1;
+    for (int64_t px = 4900; px < 5000; ++px) {
+        assert(book->add(OrderId{id++}, Side::Buy, Price{px}, Qty{px % 7 + 1}) == AddResult::Ok);
+    }
+    for (int64_t px = 5001; px < 9000; px += 37) {
+        assert(book->add(OrderId{id++}, Side::Sell, Price{px}, Qty{3}) == AddResult::Ok);
+        assert(book->add(OrderId{id++}, Side::Sell, Price{px}, Qty{4}) == AddResult::Ok);
+    }
+    for (size_t n : {size_t{1}, size_t{10}, size_t{63}, size_t{64}, size_t{65}, size_t{80}}) {
+        check_depth(*book, Side::Buy, n);
+        check_depth(*book, Side::Sell, n);
+    }
+    assert(book->depth(Side::Sell, 4, out) == 4);
+    assert(out[0].price.raw() == 5001 && out[0].qty.raw() == 7 && out[0].count == 2);
+    assert(out[3].price.raw() == 5001 + 3 * 37);
+    assert(book->depth(Side::Buy, 0, out) == 0);
+    assert(book->depth(Side::Buy, 10, std::span<LevelView>(out).first(2)) == 2);
+
+    // and through a live flow
+    book = std::make_unique<Book>();
+    WorkloadGen gen(77, 1000.0, 5000, 400.0, 0.40, 0.20, 0.05, 1.5, 10000);
+    gen.set_modify_rate(0.10);
+    for (size_t i = 0; i < 20000; ++i) {
+        apply_op(*book, gen.next());
+        if (i % 16 == 0) {
+            check_depth(*book, Side::Buy, 10);
+            check_depth(*book, Side::Sell, 10);
+        }
+    }
+
+    printf("[PASS] depth_snapshot<%s>\n", name);
+}
+
+// same levels, same queues, same counts
+template<typename Book>
+void assert_same_book(const Book& a, const Book& b) {
+    assert(a.bid() == b.bid() && a.ask() == b.ask());
+    assert(a.order_count() == b.order_count() && b.pool_used() == b.order_count());
+    for (int64_t px = 0; px <= Book::max_price(); ++px) {
+        const auto& la = a.level_at(Price{px});
+        const auto& lb = b.level_at(Price{px});
+        assert(la.qty() == lb.qty() && la.count() == lb.count());
+        const auto* oa = la.front();
+        const auto* ob = lb.front();
+        for (size_t k = 0; k < la.count(); ++k, oa = la.next_of(oa), ob = lb.next_of(ob)) {
+            assert(oa->id == ob->id && oa->remaining() == ob->remaining() && oa->side == ob->side);
+            assert(b.get_order(ob->id) == ob);
+        }
+    }
+}
+
+// snapshot a live book, restore into a fresh one, then drive both on
+template<typename Book>
+void test_snapshot_restore(const char* name) {
+    auto live = std::make_unique<Book>();
+    WorkloadGen gen(31, 1000.0, 5000, 400.0, 0.40, 0.20, 0.05, 1.5, 10000);
+    gen.set_modify_rate(0.10);
+    for (size_t i = 0; i < 20000; ++i) apply_op(*live, gen.next());
+    assert(live->order_count() > 100);
+
+    std::vector<SnapshotRecord> recs(live->order_count());
+    assert(live->snapshot(recs) == recs.size());
+    // bids best first, then asks best first
+    assert(recs.front().side == Side::Buy && recs.front().price == live->bid().raw());
+    assert(recs.back().side == Side::Sell);
+
+    auto restored = std::make_unique<Book>();
+    assert(restored->restore(recs) == RestoreResult::Ok);
+    assert_same_book(*live, *restored);
+    assert(restored->restore(recs) == RestoreResult::NotEmpty);
+
+    // a bad record anywhere leaves the book empty and usable
+    std::vector<SnapshotRecord> dup = recs;
+    dup.push_back(recs.front());
+    auto empty = std::make_unique<Book>();
+    assert(empty->restore(dup) == RestoreResult::DuplicateId);
+    assert(empty->order_count() == 0 && empty->pool_used() == 0 && !empty->has_bid());
+    assert(empty->get_order(OrderId{recs.front().id}) == nullptr);
+    dup.back() = SnapshotRecord{1 << 30, 0, 5, static_cast<int32_t>(recs.back().price + 1), Side::Buy, OrdType::Limit, 0};
+    assert(empty->restore(dup) == RestoreResult::Crossed);
+    dup.back().price = -1;
+    assert(empty->restore(dup) == RestoreResult::InvalidPrice);
+    // only buy and sell limits rest on the ladder
+    dup.back() = recs.front();
+    dup.back().id = 1 << 30;
+    dup.back().type = OrdType::Stop;
+    assert(empty->restore(dup) == RestoreResult::InvalidType);
+    dup.back().type = OrdType::Iceberg;
+    assert(empty->restore(dup) == RestoreResult::InvalidType);
+    dup.back().type = OrdType::Limit;
+    dup.back().side = static_cast<Side>(2);
+    assert(empty->restore(dup) == RestoreResult::InvalidType);
+    assert(empty->order_count() == 0 && empty->stop_count() == 0 && empty->pool_used() == 0);
+    assert(empty->restore(recs) == RestoreResult::Ok);
+    assert_same_book(*live, *empty);
+
+    // stops and held calls are not ladder orders but still take slots and ids
+    auto held = std::make_unique<Book>();
+    assert(held->add(OrderId{1 << 30}, Side::Buy, Price{Book::max_price()}, Qty{5}, OrdType::Stop) == AddResult::Ok);
+    assert(held->order_count() == 0 && held->restore(recs) == RestoreResult::OffLadder);
+    assert(held->order_count() == 0 && held->pool_used() == 1);
+    assert(held->cancel(OrderId{1 << 30}));
+    held->begin_auction();
+    assert(held->add(OrderId{1 << 30}, Side::Buy, Price{5}, Qty{5}) == AddResult::Ok);
+    assert(held->add(OrderId{(1 << 30) + 1}, Side::Sell, Price{5}, Qty{5}) == AddResult::Ok);
+    assert(held->cancel(OrderId{1 << 30}) && held->order_count() == 0 && held->call_count() == 1);
+    assert(held->restore(recs) == RestoreResult::OffLadder);
+    assert(held->cancel(OrderId{(1 << 30) + 1}) && held->restore(recs) == RestoreResult::Ok);
+    assert_same_book(*live, *held);
+
+    std::vector<Op> more = gen.generate(5000);
+    for (const Op& op : more) {
+        apply_op(*live, op);
+        apply_op(*restored, op);
+    }
+    assert_same_book(*live, *restored);
+
+    printf("[PASS] snapshot_restore<%s>\n", name);
+}
+
+void test_snapshot_file() {
+    char tmpl[] = "/tmp/ob_snapshot_test_XXXXXX";
+    int fd = ::mkstemp(tmpl);
+    assert(fd >= 0);
+    ::close(fd);
+    std::string path = tmpl;
+
+    auto book = std::make_unique<TestBook>();
+    assert(book->add(OrderId{1}, Side::Buy, Price{100}, Qty{10}, OrdType::Limit, Timestamp{7}) == AddResult::Ok);
+    assert(book->add(OrderId{2}, Side::Buy, Price{100}, Qty{20}) == AddResult::Ok);
+    assert(book->add(OrderId{3}, Side::Buy, Price{98}, Qty{30}) == AddResult::Ok);
+    assert(book->add(OrderId{4}, Side::Sell, Price{105}, Qty{40}) == AddResult::Ok);
+    write_snapshot(path, *book);
+
+    {
+        SnapshotFile file(path);
+        assert(file.size() == 4 && file.max_price() == 10000);
+        auto r = file.records();
+        assert(r[0].id == 1 && r[0].ts == 7 && r[1].id == 2 && r[2].id == 3 && r[3].id == 4);
+        assert(r[3].side == Side::Sell && r[3].price == 105 && r[3].qty == 40);
+    }
+    auto restored = std::make_unique<TestBook>();
+    assert(load_snapshot(path, *restored) == RestoreResult::Ok);
+    assert_same_book(*book, *restored);
+    assert(restored->match(Side::Sell, Qty{15}).raw() == 0);
+    assert(restored->get_order(OrderId{1}) == nullptr && restored->bid_qty().raw() == 15);
+
+    // an empty book writes a valid empty snapshot
+    write_snapshot(path, TestBook{});
+    assert(SnapshotFile(path).size() == 0);
+
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    std::fputs("OBSNAPSH but not really a snapshot", f);
+    std::fclose(f);
+    bool threw = false;
+    try {
+        SnapshotFile bad(path);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    ::unlink(path.c_str());
+
+    printf("[PASS] snapshot_file\n");
+}
+
+std::string temp_path(const char* stem) {
+    std::string tmpl = std::string("/tmp/") + stem + "_XXXXXX";
+    int fd = ::mkstemp(tmpl.data());
+    assert(fd >= 0);
+    ::close(fd);
+    return tmpl;
+}
+
+// journal a live flow, then rebuild it from the journal alone and from a
+// checkpoint snapshot plus the journal written after it
+void test_journal() {
+    std::string j1 = temp_path("ob_journal_a");
+    std::string j2 = temp_path("ob_journal_b");
+    std::string snap = temp_path("ob_journal_snap");
+
+    auto live = std::make_unique<TestBook>();
+    WorkloadGen gen(47, 1000.0, 5000, 400.0, 0.40, 0.20, 0.05, 1.5, 10000);
+    gen.set_modify_rate(0.10);
+    {
+        JournaledBook<TestBook, JOURNAL_SEGMENT> jb(*live, j1, std::chrono::microseconds{200});
+        assert(jb.add(OrderId{1 << 30}, Side::Buy, Price{-1}, Qty{5}) == AddResult::InvalidPrice);
+        assert(!jb.cancel(OrderId{1 << 30}));
+        assert(jb.journal().appended() == 0);   // rejected ops are not logged
+
+        // nor are ops with a price, qty or peak the 32-bit records would truncate
+        Qty wide{int64_t{1} << 32};
+        assert(jb.add(OrderId{1 << 30}, Side::Buy, Price{100}, wide) == AddResult::InvalidQty);
+        assert(jb.add_iceberg(OrderId{1 << 30}, Side::Buy, Price{100}, wide, Qty{5}) == AddResult::InvalidQty);
+        assert(jb.add(OrderId{1 << 30}, Side::Buy, Price{1}, Qty{5}) == AddResult::Ok);
+        assert(jb.modify(OrderId{1 << 30}, Price{1}, wide) == ModifyResult::InvalidQty);
+        assert(jb.modify(OrderId{1 << 30}, Price{int64_t{1} << 32}, Qty{5}) == ModifyResult::InvalidPrice);
+        assert(jb.match(Side::Sell, wide) == wide && live->bid_qty() == Qty{5});
+        assert(jb.cancel(OrderId{1 << 30}) && jb.journal().appended() == 2 && live->order_count() == 0);
+
+        for (size_t i = 0; i < 20000; ++i) apply_op(jb, gen.next());   // laps the 4096-record ring
+        assert(jb.journal().flush());
+        assert(jb.journal().durable() == jb.journal().appended() && jb.journal().error() == 0);
+
+        auto replayed = std::make_unique<TestBook>();
+        ReplayFile file(j1);
+        assert(file.size() == jb.journal().appended());
+        file.replay(*replayed);
+        assert_same_book(*live, *replayed);
+
+        // a snapshot would drop a stop or an iceberg's reserve, so no checkpoint while one rests
+        uint64_t logged = jb.journal().appended();
+        assert(jb.add(OrderId{1 << 30}, Side::Buy, Price{9999}, Qty{5}, OrdType::Stop) == AddResult::Ok);
+        assert(!jb.checkpoint(snap, j2) && jb.journal().appended() == logged + 1);
+        assert(jb.cancel(OrderId{1 << 30}));
+        assert(jb.add_iceberg(OrderId{1 << 30}, Side::Buy, Price{1}, Qty{50}, Qty{5}) == AddResult::Ok);
+        assert(!jb.checkpoint(snap, j2));
+        assert(jb.cancel(OrderId{1 << 30}));
+        assert(jb.checkpoint(snap, j2));
+        for (size_t i = 0; i < 5000; ++i) apply_op(jb, gen.next());
+        // destructor commits the tail
+    }
+    auto recovered = std::make_unique<TestBook>();
+    assert(recover(snap, j2, *recovered) == RestoreResult::Ok);
+    assert_same_book(*live, *recovered);
+
+    ::unlink(j1.c_str());
+    ::unlink(j2.c_str());
+    ::unlink(snap.c_str());
+    printf("[PASS] journal\n");
+}
+
+// a call phase replays as one: held orders, then a single-price uncross
+void test_journal_auction() {
+    std::string j = temp_path("ob_journal_auction");
+    std::string snap = temp_path("ob_journal_auction_snap");
+    auto live = std::make_unique<TestBook>();
+    {
+        JournaledBook<TestBook, JOURNAL_SEGMENT> jb(*live, j);
+        assert(jb.add(OrderId{1}, Side::Buy, Price{99}, Qty{10}) == AddResult::Ok);
+        assert(jb.add(OrderId{2}, Side::Sell, Price{101}, Qty{10}) == AddResult::Ok);
+        jb.begin_auction();
+        assert(jb.add(OrderId{3}, Side::Buy, Price{103}, Qty{15}) == AddResult::Ok);
+        assert(jb.add(OrderId{4}, Side::Sell, Price{98}, Qty{20}) == AddResult::Ok);
+        assert(jb.add(OrderId{5}, Side::Buy, Price{100}, Qty{5}, OrdType::IOC) == AddResult::WrongSession);
+        assert(live->call_count() == 2 && !jb.checkpoint(snap, j));
+        AuctionResult r = jb.uncross(Timestamp{9});
+        assert(r.volume.raw() > 0 && !live->in_auction());
+        assert(jb.add(OrderId{6}, Side::Sell, Price{99}, Qty{3}) == AddResult::Ok);
+        assert(jb.journal().flush());
+    }
+    auto replayed = std::make_unique<TestBook>();
+    ReplayFile(j).replay(*replayed);
+    assert(!replayed->in_auction() && replayed->call_count() == 0);
+    assert(replayed->last_trade() == live->last_trade());
+    assert_same_book(*live, *replayed);
+
+    ::unlink(j.c_str());
+    ::unlink(snap.c_str());
+    printf("[PASS] journal_auction\n");
+}
+
+// histogram percentiles against exact ones from a sorted copy
+void test_latency_histogram() {
+    LatencyHistogram<> a;
+    LatencyHistogram<> b;
+    std::vector<uint64_t> all;
+    std::mt19937_64 rng(5);
+    std::lognormal_distribution<double> lat(5.0, 1.2);
+    for (size_t i = 0; i < 200000; ++i) {
+        auto v = static_cast<uint64_t>(lat(rng));
+        (i % 3 == 0 ? a : b).record(v);
+        all.push_back(v);
+    }
+    a.merge(b);
+    std::sort(all.begin(), all.end());
+    assert(a.count() == all.size() && a.min() == all.front() && a.max() == all.back());
+    for (double p : {0.0, 0.5, 0.9, 0.99, 0.999, 0.9999, 1.0}) {
+        uint64_t exact = percentile_sorted(all, p);
+        uint64_t approx = a.percentile(p);
+        assert(approx >= exact && approx <= exact + exact / 128);   // top of the exact value's bucket
+    }
+
+    // exact below 256, and huge values clamp into the last bucket
+    LatencyHistogram<> small;
+    for (uint64_t v = 0; v < 256; ++v) small.record(v);
+    assert(small.percentile(0.5) == 127 && small.percentile(1.0) == 255);
+    small.record(uint64_t{1} << 50);
+    assert(small.max() == uint64_t{1} << 50 && small.percentile(1.0) == uint64_t{1} << 50);
+    small.clear();
+    assert(small.count() == 0 && small.percentile(0.99) == 0);
+
+    // in-book hooks see every op, by type; plain books have none
+    static_assert(!LatencyListener<NullListener>);
+    OrderBook<10000, 1000, OpLatency<FillBuffer>> book;
+    (void)book.add(OrderId{1}, Side::Sell, Price{100}, Qty{10});
+    (void)book.add(OrderId{2}, Side::Sell, Price{101}, Qty{10});
+    (void)book.cancel(OrderId{2});
+    (void)book.match(Side::Buy, Qty{5});
+    (void)book.modify(OrderId{1}, Price{100}, Qty{2});
+    const auto& hooks = book.listener();
+    assert(hooks.histogram(OpType::Add).count() == 2 && hooks.histogram(OpType::Cancel).count() == 1);
+    assert(hooks.histogram(OpType::Match).count() == 1 && hooks.histogram(OpType::Modify).count() == 1);
+    assert(hooks.all().count() == 5 && hooks.all().min() > 0);
+
+    printf("[PASS] latency_histogram\n");
+}
+
+// every scenario is exactly cfg.ops long, and the book ends with the same
+// resting orders as the std::map baseline wherever its pool doesn't run out
+void test_scenarios() {
+    using Book = OrderBook<100000, 4096>;
+    ScenarioConfig cfg;
+    cfg.ops = 20000;
+    cfg.max_price = Book::max_price();
+    cfg.capacity = Book::max_orders();
+    for (Scenario sc : ALL_SCENARIOS) {
+        std::vector<Op> ops = make_scenario(sc, cfg);
+        assert(ops.size() == cfg.ops);
+        auto book = std::make_unique<Book>();
+        NaiveBook naive;
+        size_t rejected = 0;
+        for (const Op& op : ops) {
+            assert(op.price.raw() >= 0 && op.price.raw() <= Book::max_price());
+            switch (op.type) {
+                case OpType::Add: {
+                    bool ok = submit_add(*book, op) == AddResult::Ok;
+                    rejected += !ok;
+                    assert(ok == submit_add(naive, op) || sc == Scenario::PoolExhaustion);
+                    break;
+                }
+                case OpType::Cancel:
+                    assert(book->cancel(op.id) == naive.cancel(op.id) || sc == Scenario::PoolExhaustion);
+                    break;
+                case OpType::Match:
+                    assert(book->match(op.side, op.qty) == naive.match(op.side, op.qty) ||
+                           sc == Scenario::PoolExhaustion);
+                    break;
+                case OpType::Modify:
+                    break;
+            }
+        }
+        if (sc == Scenario::PoolExhaustion) {
+            assert(rejected > 0 && book->order_count() == Book::max_orders());
+        } else {
+            assert(book->order_count() == naive.order_count() && book->stop_count() == naive.stop_count());
+            assert(rejected == 0 || sc == Scenario::FokSweep);
+        }
+    }
+    printf("[PASS] scenarios\n");
+}
+
+// records the phases of the last op, in order
+struct PhaseTrace {
+    std::vector<Phase> phases;
+    int open = 0;
+    size_t ops = 0;
+
+    void on_fill(const Fill&) noexcept {}
+    void on_op_begin(OpType) noexcept {
+        ++open;
+        phases.clear();
+    }
+    void on_phase(Phase p) noexcept {
+        if (phases.empty() || phases.back() != p) phases.push_back(p);
+    }
+    void on_op_end() noexcept {
+        --open;
+        ++ops;
+    }
+    [[nodiscard]] bool saw(Phase p) const { return std::find(phases.begin(), phases.end(), p) != phases.end(); }
+};
+
+void test_phase_marks() {
+    static_assert(PhaseListener<PhaseTrace> && !PhaseListener<NullListener>);
+    OrderBook<10000, 1000, PhaseTrace> book;
+    const PhaseTrace& t = book.listener();
+
+    (void)book.add(OrderId{1}, Side::Sell, Price{100}, Qty{10});
+    assert(t.open == 0 && t.phases == (std::vector<Phase>{Phase::Lookup, Phase::Level}));
+    (void)book.add(OrderId{2}, Side::Sell, Price{101}, Qty{10});
+
+    // cancel at best steps the ask past the emptied level
+    assert(book.cancel(OrderId{1}));
+    assert(t.phases == (std::vector<Phase>{Phase::Lookup, Phase::Level, Phase::Lookup, Phase::Recovery}));
+    (void)book.cancel(OrderId{9});
+    assert(t.phases == std::vector<Phase>{Phase::Lookup});
+
+    // sweep: match, recovery after the level empties, then back to matching
+    (void)book.add(OrderId{3}, Side::Sell, Price{102}, Qty{10});
+    assert(book.match(Side::Buy, Qty{15}) == Qty{0});
+    assert(t.phases == (std::vector<Phase>{Phase::Match, Phase::Recovery, Phase::Match}));
+
+    // crossing add trades, then rests its remainder
+    (void)book.add(OrderId{4}, Side::Buy, Price{102}, Qty{10});
+    assert(t.phases == (std::vector<Phase>{Phase::Lookup, Phase::Match, Phase::Recovery, Phase::Match, Phase::Lookup,
+                                               Phase::Level}));
+    assert(book.bid() == Price{102} && book.bid_qty() == Qty{5});
+
+    (void)book.modify(OrderId{4}, Price{103}, Qty{5});
+    assert(t.saw(Phase::Recovery) && t.phases.back() == Phase::Level);
+    assert(t.open == 0 && t.ops == 8);
+
+    printf("[PASS] phase_marks\n");
+}
+
+template<typename Book>
+void test_iceberg(const char* name) {
+    auto book = std::make_unique<Book>();
+    assert(book->add(OrderId{1}, Side::Sell, Price{100}, Qty{5}) == AddResult::Ok);
+    assert(book->add_iceberg(OrderId{2}, Side::Sell, Price{100}, Qty{25}, Qty{10}) == AddResult::Ok);
+    assert(book->add(OrderId{3}, Side::Sell, Price{100}, Qty{5}) == AddResult::Ok);
+    assert(book->add_iceberg(OrderId{4}, Side::Sell, Price{100}, Qty{5}, Qty{0}) == AddResult::InvalidQty);
+    assert(book->add(OrderId{4}, Side::Sell, Price{100}, Qty{5}, OrdType::Iceberg) == AddResult::InvalidQty);
+
+    // only the slice is displayed
+    assert(book->ask_qty() == Qty{20} && book->order_count() == 3);
+    const auto* ice = book->get_order(OrderId{2});
+    assert(ice->remaining() == Qty{10} && ice->reserve() == Qty{15} && ice->open_qty() == Qty{25});
+
+    // a filled slice refills at the back, behind order 3
+    assert(book->match(Side::Buy, Qty{15}) == Qty{0});
+    assert(book->get_order(OrderId{1}) == nullptr);
+    assert(ice->remaining() == Qty{10} && ice->reserve() == Qty{5});
+    assert(book->ask_qty() == Qty{15} && book->level_at(Price{100}).count() == 2);
+    const auto& level = book->level_at(Price{100});
+    assert(level.front()->id == OrderId{3} && level.next_of(level.front())->id == OrderId{2});
+
+    // alone on its level it refills in place; the last slice is what is left
+    assert(book->match(Side::Buy, Qty{17}) == Qty{0});
+    assert(book->get_order(OrderId{3}) == nullptr && ice->remaining() == Qty{3} && ice->reserve() == Qty{0});
+    assert(book->ask_qty() == Qty{3});
+
+    // amends count the reserve: a cut comes out of it first, and a requeue reslices
+    assert(book->add_iceberg(OrderId{5}, Side::Buy, Price{90}, Qty{100}, Qty{10}) == AddResult::Ok);
+    assert(book->modify(OrderId{5}, Price{90}, Qty{95}) == ModifyResult::Ok);
+    const auto* b = book->get_order(OrderId{5});
+    assert(b->remaining() == Qty{10} && b->reserve() == Qty{85} && book->bid_qty() == Qty{10});
+    assert(book->modify(OrderId{5}, Price{90}, Qty{4}) == ModifyResult::Ok);
+    assert(b->remaining() == Qty{4} && b->reserve() == Qty{0} && book->bid_qty() == Qty{4});
+    assert(book->modify(OrderId{5}, Price{91}, Qty{30}) == ModifyResult::Ok);
+    assert(b->remaining() == Qty{10} && b->reserve() == Qty{20} && book->bid() == Price{91});
+
+    // a crossing iceberg trades its full qty before resting a slice
+    assert(book->add_iceberg(OrderId{6}, Side::Buy, Price{100}, Qty{20}, Qty{4}) == AddResult::Ok);
+    assert(!book->has_ask() && book->bid() == Price{100} && book->bid_qty() == Qty{4});
+    assert(book->get_order(OrderId{6})->reserve() == Qty{13});
+
+    // snapshots write the open qty as a limit order
+    std::array<SnapshotRecord, 4> recs{};
+    assert(book->snapshot(recs) == 2);
+    assert(recs[0].id == 6 && recs[0].qty == 17 && recs[0].type == OrdType::Limit);
+
+    // lazy cancel drops the reserve with the slice
+    assert(book->add(OrderId{7}, Side::Buy, Price{91}, Qty{5}) == AddResult::Ok);
+    assert(book->cancel_lazy(OrderId{5}) && book->bid_qty() == Qty{4});
+    assert(book->cancel(OrderId{6}) && book->bid() == Price{91} && book->bid_qty() == Qty{5});
+    printf("[PASS] iceberg<%s>\n", name);
+}
+
+void test_fok() {
+    TestBook book;
+    assert(book.add(OrderId{1}, Side::Sell, Price{100}, Qty{10}) == AddResult::Ok);
+    assert(book.add(OrderId{2}, Side::Sell, Price{101}, Qty{10}) == AddResult::Ok);
+    assert(book.add_iceberg(OrderId{3}, Side::Sell, Price{102}, Qty{30}, Qty{5}) == AddResult::Ok);
+
+    // short of qty inside the limit: killed, nothing traded
+    assert(book.add(OrderId{10}, Side::Buy, Price{101}, Qty{21}, OrdType::FOK) == AddResult::Killed);
+    assert(book.ask() == Price{100} && book.ask_qty() == Qty{10} && book.order_count() == 3);
+    assert(book.add(OrderId{11}, Side::Buy, Price{99}, Qty{1}, OrdType::FOK) == AddResult::Killed);
+
+    // enough: trades in full and never rests
+    assert(book.add(OrderId{12}, Side::Buy, Price{101}, Qty{15}, OrdType::FOK) == AddResult::Ok);
+    assert(book.ask() == Price{101} && book.ask_qty() == Qty{5} && book.get_order(OrderId{12}) == nullptr);
+
+    // hidden reserve counts: the displayed 10 are short of 30, the open 35 are not
+    assert(book.add(OrderId{13}, Side::Buy, Price{102}, Qty{36}, OrdType::FOK) == AddResult::Killed);
+    assert(book.add(OrderId{14}, Side::Buy, Price{102}, Qty{30}, OrdType::FOK) == AddResult::Ok);
+    assert(book.ask() == Price{102} && book.ask_qty() == Qty{5} && book.order_count() == 1);
+
+    // sell side
+    assert(book.add(OrderId{20}, Side::Buy, Price{90}, Qty{8}) == AddResult::Ok);
+    assert(book.add(OrderId{21}, Side::Sell, Price{90}, Qty{9}, OrdType::FOK) == AddResult::Killed);
+    assert(book.add(OrderId{22}, Side::Sell, Price{90}, Qty{8}, OrdType::FOK) == AddResult::Ok);
+    assert(!book.has_bid());
+    printf("[PASS] fok\n");
+}
+
+void test_stop_orders() {
+    std::array<Fill, 16> storage{};
+    OrderBook<10000, 1000, FillBuffer> book{FillBuffer{storage}};
+    const auto& fills = book.listener();
+    for (int64_t i = 0; i < 5; ++i) {
+        assert(book.add(OrderId{static_cast<uint64_t>(1 + i)}, Side::Buy, Price{99 - i}, Qty{10}) == AddResult::Ok);
+        assert(book.add(OrderId{static_cast<uint64_t>(11 + i)}, Side::Sell, Price{101 + i}, Qty{10}) == AddResult::Ok);
+    }
+
+    // stops wait off the book, by trigger price
+    assert(book.add(OrderId{20}, Side::Sell, Price{98}, Qty{20}, OrdType::Stop) == AddResult::Ok);
+    assert(book.add(OrderId{21}, Side::Sell, Price{96}, Qty{5}, OrdType::Stop) == AddResult::Ok);
+    assert(book.add(OrderId{22}, Side::Buy, Price{103}, Qty{5}, OrdType::Stop) == AddResult::Ok);
+    assert(book.add(OrderId{20}, Side::Buy, Price{103}, Qty{5}, OrdType::Stop) == AddResult::DuplicateId);
+    assert(book.stop_count() == 3 && book.order_count() == 10);
+    assert(book.bid() == Price{99} && book.ask() == Price{101});
+
+    // a trade at 98 fires the 98 stop, whose sale prints at 97 and 96 and fires the 96 stop
+    assert(book.match(Side::Sell, Qty{11}) == Qty{0});
+    assert(book.stop_count() == 1 && book.last_trade() == Price{96});
+    assert(book.bid() == Price{96} && book.bid_qty() == Qty{4});
+    auto f = fills.fills();
+    assert(f.size() == 6);
+    assert(f[2].aggressor_id == OrderId{20} && f[2].passive_id == OrderId{2} && f[2].qty == Qty{9});
+    assert(f[4].aggressor_id == OrderId{20} && f[4].passive_id == OrderId{4} && f[4].qty == Qty{1});
+    assert(f[5].aggressor_id == OrderId{21} && f[5].passive_id == OrderId{4} && f[5].qty == Qty{5});
+
+    // cancel and reprice a resting stop; a trigger the last trade already passed runs at once
+    assert(book.modify(OrderId{22}, Price{104}, Qty{5}) == ModifyResult::Ok);
+    assert(book.get_order(OrderId{22})->price == Price{104});
+    assert(book.cancel(OrderId{22}) && book.stop_count() == 0 && !book.cancel(OrderId{22}));
+    book.listener().clear();
+    assert(book.add(OrderId{23}, Side::Sell, Price{97}, Qty{2}, OrdType::Stop) == AddResult::Ok);
+    assert(book.stop_count() == 0 && fills.size() == 1 && fills.fills()[0].aggressor_id == OrderId{23});
+
+    // a buy stop past the touch fires once the offer lifts through it
+    assert(book.add(OrderId{24}, Side::Buy, Price{102}, Qty{12}, OrdType::Stop) == AddResult::Ok);
+    assert(book.match(Side::Buy, Qty{10}) == Qty{0} && book.stop_count() == 1);
+    assert(book.match(Side::Buy, Qty{1}) == Qty{0});
+    assert(book.stop_count() == 0 && book.ask() == Price{103} && book.ask_qty() == Qty{7});
+    printf("[PASS] stop_orders\n");
+}
+
+// fills and stp reports, kept in order
+struct StpLog {
+    std::array<Fill, 16> fills{};
+    std::array<SelfTrade, 16> stps{};
+    size_t fill_cnt = 0;
+    size_t stp_cnt = 0;
+
+    void on_fill(const Fill& f) noexcept { fills[fill_cnt++ % fills.size()] = f; }
+    void on_self_trade(const SelfTrade& s) noexcept { stps[stp_cnt++ % stps.size()] = s; }
+};
+
+template<template<int64_t, typename> class Ladder>
+using StpBook = OrderBook<10000, 1000, StpLog, DirectIndex, InlineStorage, Ladder>;
+
+template<template<int64_t, typename> class Ladder>
+void test_self_trade_prevention(const char* name) {
+    auto book = std::make_unique<StpBook<Ladder>>();
+    const StpLog& log = book->listener();
+    assert(book->add(OrderId{1}, Side::Sell, Price{100}, Qty{10}, OrdType::Limit, Timestamp{0}, Owner{7}) == AddResult::Ok);
+    assert(book->add(OrderId{2}, Side::Sell, Price{100}, Qty{10}, OrdType::Limit, Timestamp{0}, Owner{8}) == AddResult::Ok);
+    assert(book->add(OrderId{3}, Side::Sell, Price{101}, Qty{10}, OrdType::Limit, Timestamp{0}, Owner{7}) == AddResult::Ok);
+    assert(book->get_order(OrderId{1})->participant() == 7);
+
+    // cancel newest: the aggressor goes before anything trades, and nothing prints
+    Owner newest{7, StpMode::CancelNewest};
+    assert(book->add(OrderId{10}, Side::Buy, Price{101}, Qty{15}, OrdType::Limit, Timestamp{0}, newest) ==
+           AddResult::SelfTrade);
+    assert(book->get_order(OrderId{10}) == nullptr && book->order_count() == 3 && book->ask_qty() == Qty{20});
+    assert(log.fill_cnt == 0 && log.stp_cnt == 1 && book->last_trade() == NO_BID);
+    assert(log.stps[0].passive_id == OrderId{1} && log.stps[0].aggressor_qty == Qty{15} &&
+           log.stps[0].passive_qty == Qty{0});
+
+    // a participant without a mode trades with itself
+    assert(book->match(Side::Buy, Qty{5}, OrderId{11}, Timestamp{0}, Owner{7}) == Qty{0});
+    assert(book->get_order(OrderId{1})->remaining() == Qty{5} && log.fill_cnt == 1);
+
+    // cancel oldest: own orders leave as they are met, the rest trades, stp qty is unfilled
+    assert(book->match(Side::Buy, Qty{12}, OrderId{12}, Timestamp{0}, Owner{7, StpMode::CancelOldest}) == Qty{2});
+    assert(!book->has_ask() && book->order_count() == 0 && log.fill_cnt == 2 && log.stp_cnt == 3);
+    assert(log.fills[1].passive_id == OrderId{2} && log.fills[1].qty == Qty{10});
+    assert(log.stps[2].passive_id == OrderId{3} && log.stps[2].passive_qty == Qty{10});
+    assert(book->last_trade() == Price{100});     // 101 only saw a cancel
+
+    // decrement: both lose the smaller qty; an iceberg loses reserve first
+    Owner dec{3, StpMode::Decrement};
+    assert(book->add(OrderId{20}, Side::Buy, Price{99}, Qty{10}, OrdType::Limit, Timestamp{0}, Owner{3}) == AddResult::Ok);
+    assert(book->add(OrderId{21}, Side::Buy, Price{99}, Qty{10}, OrdType::Limit, Timestamp{0}, Owner{4}) == AddResult::Ok);
+    assert(book->add_iceberg(OrderId{22}, Side::Buy, Price{98}, Qty{30}, Qty{5}, Timestamp{0}, Owner{3}) == AddResult::Ok);
+    assert(book->add(OrderId{30}, Side::Sell, Price{98}, Qty{25}, OrdType::Limit, Timestamp{0}, dec) ==
+           AddResult::SelfTrade);
+    assert(book->get_order(OrderId{20}) == nullptr && book->get_order(OrderId{30}) == nullptr);
+    assert(book->bid() == Price{98} && book->bid_qty() == Qty{5} && book->order_count() == 1);
+    assert(book->get_order(OrderId{22})->open_qty() == Qty{25} && log.fill_cnt == 3);
+
+    // an aggressor with qty left after decrementing rests it
+    assert(book->add(OrderId{31}, Side::Sell, Price{98}, Qty{40}, OrdType::Limit, Timestamp{0}, dec) ==
+           AddResult::SelfTrade);
+    assert(!book->has_bid() && book->ask() == Price{98} && book->ask_qty() == Qty{15});
+    assert(book->get_order(OrderId{31})->owned_by().stp == StpMode::Decrement);
+
+    // a repriced order keeps its owner
+    assert(book->add(OrderId{40}, Side::Buy, Price{97}, Qty{5}, OrdType::Limit, Timestamp{0}, Owner{3}) == AddResult::Ok);
+    assert(book->modify(OrderId{31}, Price{97}, Qty{15}) == ModifyResult::Ok);
+    assert(!book->has_bid() && book->ask() == Price{97} && book->ask_qty() == Qty{10} && log.fill_cnt == 3);
+
+    // a stop the last trade already passed runs under its owner at once
+    assert(book->add(OrderId{51}, Side::Buy, Price{97}, Qty{4}, OrdType::Stop, Timestamp{0},
+                     Owner{3, StpMode::CancelNewest}) == AddResult::SelfTrade);
+    assert(book->stop_count() == 0 && book->ask_qty() == Qty{10} && log.fill_cnt == 3);
+
+    assert(book->add(OrderId{60}, Side::Buy, Price{90}, Qty{1}, OrdType::Limit, Timestamp{0},
+                     Owner{MAX_PARTICIPANT + 1}) == AddResult::InvalidId);
+    printf("[PASS] self_trade_prevention<%s>\n", name);
+}
+
+// 32-byte orders have no room for an owner
+void test_stp_untagged_layout() {
+    SlotBook book;
+    assert(book.add(OrderId{1}, Side::Sell, Price{100}, Qty{10}, OrdType::Limit, Timestamp{0}, Owner{1}) ==
+           AddResult::InvalidId);
+    assert(book.add(OrderId{1}, Side::Sell, Price{100}, Qty{10}) == AddResult::Ok);
+    assert(book.match(Side::Buy, Qty{4}, OrderId{2}, Timestamp{0}, Owner{}) == Qty{0});
+
+    // nor for a tagged snapshot record
+    SnapshotRecord tagged{3, 0, 5, 100, Side::Sell, OrdType::Limit, pack(Owner{1})};
+    SlotBook empty;
+    assert(empty.restore(std::span(&tagged, 1)) == RestoreResult::InvalidId && empty.order_count() == 0);
+    printf("[PASS] stp_untagged_layout\n");
+}
+
+// owners survive a snapshot, so a restored book still prevents self-trades
+void test_stp_snapshot() {
+    auto live = std::make_unique<StpBook<DenseLadder>>();
+    assert(live->add(OrderId{1}, Side::Sell, Price{100}, Qty{10}, OrdType::Limit, Timestamp{0}, Owner{7}) == AddResult::Ok);
+    assert(live->add(OrderId{2}, Side::Sell, Price{101}, Qty{10}, OrdType::Limit, Timestamp{0},
+                     Owner{MAX_PARTICIPANT, StpMode::Decrement}) == AddResult::Ok);
+    assert(live->add(OrderId{3}, Side::Buy, Price{90}, Qty{10}) == AddResult::Ok);
+
+    std::array<SnapshotRecord, 3> recs{};
+    assert(live->snapshot(recs) == 3);
+    assert(recs[0].owner == 0 && recs[1].owner == pack(Owner{7}));
+    auto restored = std::make_unique<StpBook<DenseLadder>>();
+    assert(restored->restore(recs) == RestoreResult::Ok);
+    assert(restored->get_order(OrderId{1})->participant() == 7);
+    const auto* o = restored->get_order(OrderId{2});
+    assert(o->participant() == MAX_PARTICIPANT && o->owned_by().stp == StpMode::Decrement);
+
+    Owner newest{7, StpMode::CancelNewest};
+    assert(restored->add(OrderId{10}, Side::Buy, Price{100}, Qty{5}, OrdType::Limit, Timestamp{0}, newest) ==
+           AddResult::SelfTrade);
+    assert(restored->listener().fill_cnt == 0 && restored->ask_qty() == Qty{10});
+    printf("[PASS] stp_snapshot\n");
+}
+
+template<template<int64_t, typename> class Ladder>
+void test_call_auction(const char* name) {
+    std::array<Fill, 16> storage{};
+    auto book = std::make_unique<OrderBook<10000, 1000, FillBuffer, DirectIndex, InlineStorage, Ladder>>(
+        FillBuffer{storage});
+    const auto& fills = book->listener();
+    assert(book->add(OrderId{1}, Side::Buy, Price{99}, Qty{10}) == AddResult::Ok);
+    assert(book->add(OrderId{2}, Side::Buy, Price{98}, Qty{10}) == AddResult::Ok);
+    assert(book->add(OrderId{3}, Side::Sell, Price{101}, Qty{10}) == AddResult::Ok);
+    assert(book->add(OrderId{4}, Side::Sell, Price{102}, Qty{5}) == AddResult::Ok);
+
+    // crossing orders are held off the ladder, nothing trades
+    book->begin_auction();
+    assert(book->add(OrderId{10}, Side::Buy, Price{102}, Qty{20}) == AddResult::Ok);
+    assert(book->add(OrderId{11}, Side::Sell, Price{99}, Qty{30}) == AddResult::Ok);
+    assert(book->call_count() == 2 && book->order_count() == 4 && fills.empty());
+    assert(book->bid() == Price{99} && book->ask() == Price{101});
+
+    // below the held buys a bid rests; a sell through it is held
+    assert(book->add(OrderId{12}, Side::Buy, Price{100}, Qty{5}) == AddResult::Ok);
+    assert(book->add(OrderId{13}, Side::Sell, Price{100}, Qty{5}) == AddResult::Ok);
+    assert(book->add_iceberg(OrderId{14}, Side::Sell, Price{101}, Qty{20}, Qty{5}) == AddResult::Ok);
+    assert(book->bid() == Price{100} && book->ask_qty() == Qty{15} && book->call_count() == 3);
+
+    // no immediate orders; held orders cancel and amend
+    assert(book->add(OrderId{15}, Side::Buy, Price{102}, Qty{1}, OrdType::IOC) == AddResult::WrongSession);
+    assert(book->match(Side::Buy, Qty{5}) == Qty{5});
+    assert(book->add(OrderId{16}, Side::Buy, Price{103}, Qty{3}) == AddResult::Ok && book->cancel(OrderId{16}));
+    assert(book->add(OrderId{17}, Side::Sell, Price{99}, Qty{1}) == AddResult::Ok && book->call_count() == 4);
+    assert(book->modify(OrderId{17}, Price{105}, Qty{1}) == ModifyResult::Ok);
+    assert(book->call_count() == 3 && book->level_at(Price{105}).qty() == Qty{1});
+
+    // buys 20@102 5@100 10@99 10@98 against sells 30@99 5@100 30@101 5@102:
+    // 30 trade at 99, against 25 at 100 and 20 above
+    AuctionResult r = book->indicative();
+    assert(r.price == Price{99} && r.volume == Qty{30} && r.surplus == Qty{5});
+    assert(book->uncross().volume == Qty{30} && !book->in_auction());
+    auto f = fills.fills();
+    assert(f.size() == 3);
+    assert(f[0].aggressor_id == OrderId{10} && f[0].passive_id == OrderId{11} && f[0].qty == Qty{20});
+    assert(f[1].aggressor_id == OrderId{12} && f[1].qty == Qty{5} && f[1].price == Price{99});
+    assert(f[2].aggressor_id == OrderId{1} && f[2].qty == Qty{5});
+
+    // what is left rests uncrossed, and matching resumes
+    assert(book->call_count() == 0 && book->last_trade() == Price{99});
+    assert(book->bid() == Price{99} && book->bid_qty() == Qty{5});
+    assert(book->ask() == Price{100} && book->ask_qty() == Qty{5} && book->order_count() == 7);
+    assert(book->add(OrderId{20}, Side::Buy, Price{101}, Qty{8}, OrdType::IOC) == AddResult::Ok);
+    assert(book->ask() == Price{101} && book->ask_qty() == Qty{12});
+
+    // nothing crossed: the held prices go back to the ladder untraded
+    book->begin_auction();
+    assert(book->add(OrderId{30}, Side::Buy, Price{101}, Qty{4}) == AddResult::Ok && book->cancel(OrderId{3}));
+    assert(book->cancel(OrderId{14}) && book->indicative().volume == Qty{0});
+    assert(book->uncross().price == NO_BID && book->bid() == Price{101} && book->ask() == Price{102});
+    printf("[PASS] call_auction<%s>\n", name);
+}
+
+template<typename Book>
+void test_lazy_cancel(const char* name) {
+    auto book = std::make_unique<Book>();
+    for (uint64_t i = 1; i <= 4; ++i) {
+        assert(book->add(OrderId{i}, Side::Sell, Price{100}, Qty{10}) == AddResult::Ok);
+    }
+
+    // tombstones leave the level qty and the live count, not the queue
+    assert(book->cancel_lazy(OrderId{1}) && book->cancel_lazy(OrderId{3}));
+    assert(!book->cancel_lazy(OrderId{1}) && !book->cancel(OrderId{3}));
+    assert(book->get_order(OrderId{1}) == nullptr);
+    assert(book->order_count() == 2 && book->tombstones() == 2);
+    assert(book->ask() == Price{100} && book->ask_qty() == Qty{20} && book->level_at(Price{100}).count() == 4);
+    assert(book->modify(OrderId{3}, Price{100}, Qty{5}) == ModifyResult::NotFound);
+
+    // snapshots skip them
+    std::array<SnapshotRecord, 8> recs{};
+    assert(book->snapshot(recs) == 2 && recs[0].id == 2 && recs[1].id == 4);
+
+    // matching reclaims the front tombstone and fills order 2 first
+    assert(book->match(Side::Buy, Qty{12}) == Qty{0});
+    assert(book->get_order(OrderId{2}) == nullptr && book->get_order(OrderId{4})->remaining() == Qty{8});
+    assert(book->tombstones() == 0 && book->level_at(Price{100}).count() == 1);
+
+    // cancelling a level's last live order takes its tombstones along
+    assert(book->add(OrderId{5}, Side::Sell, Price{100}, Qty{10}) == AddResult::Ok);
+    assert(book->add(OrderId{6}, Side::Sell, Price{101}, Qty{10}) == AddResult::Ok);
+    assert(book->cancel_lazy(OrderId{4}));
+    assert(book->cancel_lazy(OrderId{5}));
+    assert(book->tombstones() == 0 && book->ask() == Price{101} && book->level_at(Price{100}).count() == 0);
+
+    // so does a sweep or an amend off the level
+    for (uint64_t i = 7; i <= 9; ++i) {
+        assert(book->add(OrderId{i}, Side::Buy, Price{50}, Qty{10}) == AddResult::Ok);
+    }
+    assert(book->cancel_lazy(OrderId{8}) && book->cancel_lazy(OrderId{7}));
+    assert(book->modify(OrderId{9}, Price{49}, Qty{10}) == ModifyResult::Ok);
+    assert(book->tombstones() == 0 && book->bid() == Price{49} && book->level_at(Price{50}).count() == 0);
+    assert(book->add(OrderId{10}, Side::Buy, Price{49}, Qty{10}) == AddResult::Ok);
+    assert(book->cancel_lazy(OrderId{9}));
+    assert(book->match(Side::Sell, Qty{10}) == Qty{0});
+    assert(book->tombstones() == 0 && !book->has_bid());
+
+    // a tombstone's id can be reused
+    assert(book->add(OrderId{11}, Side::Buy, Price{40}, Qty{10}) == AddResult::Ok);
+    assert(book->add(OrderId{12}, Side::Buy, Price{40}, Qty{10}) == AddResult::Ok);
+    assert(book->cancel_lazy(OrderId{11}));
+    assert(book->add(OrderId{11}, Side::Buy, Price{41}, Qty{3}) == AddResult::Ok);
+    assert(book->tombstones() == 0 && book->level_at(Price{40}).count() == 1 && book->bid() == Price{41});
+
+    // compact frees the rest on both sides
+    for (uint64_t i = 20; i < 40; ++i) {
+        Side side = i % 2 ? Side::Sell : Side::Buy;
+        int64_t px = side == Side::Buy ? 30 - static_cast<int64_t>(i % 5) : 200 + static_cast<int64_t>(i % 5);
+        assert(book->add(OrderId{i}, side, Price{px}, Qty{1}) == AddResult::Ok);
+    }
+    for (uint64_t i = 20; i < 30; ++i) assert(book->cancel_lazy(OrderId{i}));
+    size_t live = book->order_count();
+    assert(book->tombstones() > 0);
+    size_t dead = book->tombstones();
+    assert(book->compact() == dead && book->tombstones() == 0 && book->order_count() == live);
+    assert(book->compact() == 0);
+
+    // adversarial flows end where eager cancels leave them, pool refusals included
+    ScenarioConfig cfg;
+    cfg.ops = 20000;
+    cfg.mid = 5000;
+    cfg.max_price = Book::max_price();
+    cfg.capacity = Book::max_orders();
+    for (Scenario sc : ALL_SCENARIOS) {
+        std::vector<Op> ops = make_scenario(sc, cfg);
+        auto lazy = std::make_unique<Book>();
+        auto eager = std::make_unique<Book>();
+        for (size_t i = 0; i < ops.size(); ++i) {
+            const Op& op = ops[i];
+            if (op.type == OpType::Add) {
+                assert(submit_add(*lazy, op) == submit_add(*eager, op));
+            } else if (op.type == OpType::Cancel) {
+                assert(lazy->cancel_lazy(op.id) == eager->cancel(op.id));
+            } else if (op.type == OpType::Match) {
+                assert(lazy->match(op.side, op.qty) == eager->match(op.side, op.qty));
+            }
+            assert(lazy->bid() == eager->bid() && lazy->ask() == eager->ask());
+            assert(lazy->bid_qty() == eager->bid_qty() && lazy->ask_qty() == eager->ask_qty());
+            if (i % 4096 == 0) (void)lazy->compact();
+        }
+        assert(lazy->order_count() == eager->order_count());
+        (void)lazy->compact();
+        assert(lazy->tombstones() == 0 && lazy->order_count() == eager->order_count());
+    }
+    printf("[PASS] lazy_cancel<%s>\n", name);
+}
+
+template<template<int64_t, typename> class Ladder>
+using DepthBook = OrderBook<10000, 1000, DepthPublisher<10000>, DirectIndex, InlineStorage, Ladder>;
+
+// replay coalesced deltas into a side/price map and check it against a full
+// level scan after every batch
+template<template<int64_t, typename> class Ladder>
+void test_depth_feed_rebuilds(const char* name) {
+    std::array<LevelUpdate, 512> buf{};
+    auto book = std::make_unique<DepthBook<Ladder>>(DepthPublisher<10000>{buf});
+    std::map<std::pair<int, int64_t>, std::pair<int64_t, uint32_t>> depth;
+
+    WorkloadGen gen(21, 1000.0, 5000, 300.0, 0.40, 0.20, 0.05, 1.5, 10000);
+    gen.set_modify_rate(0.10);
+    std::vector<Op> ops = gen.generate(30000);
+    std::span<const Op> all(ops);
+    size_t changes = 0;
+    size_t updates = 0;
+    for (size_t i = 0; i < ops.size(); i += 100) {
+        book->apply(all.subspan(i, std::min<size_t>(100, ops.size() - i)));
+        auto& feed = book->listener();
+        assert(feed.dropped() == 0);
+        changes += feed.changes();
+        updates += feed.size();
+        for (const LevelUpdate& u : feed.updates()) {
+            auto k = std::make_pair(static_cast<int>(u.side), u.price.raw());
+            if (u.qty.raw() == 0) {
+                assert(u.count == 0);
+                depth.erase(k);
+            } else {
+                depth[k] = {u.qty.raw(), u.count};
+            }
+        }
+        feed.clear();
+
+        size_t levels = 0;
+        for (int64_t px = 0; px <= 10000; ++px) {
+            const auto& level = book->level_at(Price{px});
+            if (level.count() == 0) continue;
+            ++levels;
+            auto it = depth.find({static_cast<int>(level.front()->side), px});
+            assert(it != depth.end());
+            assert(it->second.first == level.qty().raw() && it->second.second == level.count());
+        }
+        assert(levels == depth.size());
+    }
+    assert(updates < changes);   // batches do coalesce
+
+    printf("[PASS] depth_feed_rebuilds<%s>\n", name);
+}
+
+void test_depth_feed() {
+    std::array<LevelUpdate, 4> buf{};
+    auto book = std::make_unique<DepthBook<DenseLadder>>(DepthPublisher<10000>{buf});
+    auto& feed = book->listener();
+
+    // several changes to one level collapse into its latest aggregate
+    assert(book->add(OrderId{1}, Side::Buy, Price{100}, Qty{10}) == AddResult::Ok);
+    assert(book->add(OrderId{2}, Side::Buy, Price{100}, Qty{10}) == AddResult::Ok);
+    assert(book->add(OrderId{3}, Side::Buy, Price{101}, Qty{5}) == AddResult::Ok);
+    assert(book->modify(OrderId{2}, Price{100}, Qty{4}) == ModifyResult::Ok);
+    assert(book->cancel(OrderId{3}));
+    assert(feed.changes() == 5 && feed.size() == 2);
+    auto u = feed.updates();
+    assert(u[0].side == Side::Buy && u[0].price.raw() == 100 && u[0].qty.raw() == 14 && u[0].count == 2);
+    assert(u[1].price.raw() == 101 && u[1].qty.raw() == 0 && u[1].count == 0);
+    feed.clear();
+    assert(feed.empty());
+
+    // a sweep reports each level it went through
+    assert(book->add(OrderId{4}, Side::Sell, Price{200}, Qty{5}) == AddResult::Ok);
+    assert(book->add(OrderId{5}, Side::Sell, Price{201}, Qty{5}) == AddResult::Ok);
+    feed.clear();
+    assert(book->match(Side::Buy, Qty{7}).raw() == 0);
+    assert(feed.size() == 2);
+    u = feed.updates();
+    assert(u[0].side == Side::Sell && u[0].price.raw() == 200 && u[0].qty.raw() == 0);
+    assert(u[1].price.raw() == 201 && u[1].qty.raw() == 3 && u[1].count == 1);
+    feed.clear();
+
+    // the same price on the other side is its own entry
+    assert(book->add(OrderId{6}, Side::Buy, Price{201}, Qty{8}) == AddResult::Ok);
+    assert(feed.size() == 2);
+    assert(feed.updates()[0].side == Side::Sell && feed.updates()[0].qty.raw() == 0);
+    assert(feed.updates()[1].side == Side::Buy && feed.updates()[1].qty.raw() == 5);
+    feed.clear();
+
+    // past the span: counted, not written
+    for (int64_t px = 10; px < 16; ++px) {
+        assert(book->add(OrderId{static_cast<uint64_t>(px)}, Side::Buy, Price{px}, Qty{1}) == AddResult::Ok);
+    }
+    assert(feed.size() == 4 && feed.dropped() == 2);
+    feed.clear();
+
+    // composes under BboPublisher
+    SeqlockBbo live;
+    std::array<LevelUpdate, 4> buf2{};
+    using Both = OrderBook<10000, 1000, BboPublisher<DepthPublisher<10000>>>;
+    auto both = std::make_unique<Both>(BboPublisher<DepthPublisher<10000>>{live, DepthPublisher<10000>{buf2}});
+    assert(both->add(OrderId{1}, Side::Buy, Price{100}, Qty{10}) == AddResult::Ok);
+    assert(both->listener().inner().size() == 1 && live.load().bid.raw() == 100);
+
+    printf("[PASS] depth_feed\n");
+}
+
+// queue marks on a dense and a narrow window ladder
+using QueuedBook = BookOf<Queued<Sized<10000, 1000>>>;
+using QueuedWindowBook = OrderBook<10000, 1000, NullListener, DirectIndex, InlineStorage, NarrowWindow, MemPool,
+                                   QueueMarks>;
+
+// displayed qty in front of id, walked from the level's front
+template<typename Book>
+Qty walk_ahead(const Book& book, OrderId id) {
+    const auto* o = book.get_order(id);
+    const auto& level = book.level_at(o->price);
+    Qty ahead{0};
+    for (const auto* x = level.front(); x != o; x = level.next_of(x)) ahead += x->remaining();
+    return ahead;
+}
+
+template<typename Book>
+void test_queue_position(const char* name) {
+    auto book = std::make_unique<Book>();
+    assert(book->add(OrderId{1}, Side::Sell, Price{100}, Qty{100}) == AddResult::Ok);
+    assert(book->add(OrderId{2}, Side::Sell, Price{100}, Qty{50}) == AddResult::Ok);
+    assert(book->add(OrderId{3}, Side::Sell, Price{100}, Qty{30}) == AddResult::Ok);
+    assert(book->add(OrderId{4}, Side::Sell, Price{100}, Qty{20}) == AddResult::Ok);
+    assert(book->queue_ahead(OrderId{1}) == Qty{0} && book->queue_ahead(OrderId{2}) == Qty{100});
+    assert(book->queue_ahead(OrderId{3}) == Qty{150} && book->queue_ahead(OrderId{4}) == Qty{180});
+    assert(book->entry_seq(OrderId{1}) == 1 && book->entry_seq(OrderId{4}) == 4 && book->entries() == 4);
+
+    // fills come off the front, so they come off everyone's qty ahead
+    assert(book->match(Side::Buy, Qty{60}) == Qty{0});
+    assert(book->queue_ahead(OrderId{2}) == Qty{40} && book->queue_ahead(OrderId{4}) == Qty{120});
+    const auto& level = book->level_at(Price{100});
+    assert(level.entered() == Qty{200} && level.traded() == Qty{60} && level.withdrawn() == Qty{0});
+
+    // amending down keeps the place; behind it, what left in front is only
+    // bounded - by what entered ahead less fills, and by the level's qty
+    assert(book->modify(OrderId{2}, Price{100}, Qty{20}) == ModifyResult::Ok);
+    assert(book->entry_seq(OrderId{2}) == 2 && book->queue_ahead(OrderId{2}) == Qty{40});
+    assert(book->queue_ahead(OrderId{3}) == Qty{80} && walk_ahead(*book, OrderId{3}) == Qty{60});
+    assert(book->queue_ahead(OrderId{4}) == Qty{90} && walk_ahead(*book, OrderId{4}) == Qty{90});
+    assert(book->level_at(Price{100}).withdrawn() == Qty{30});
+
+    // so does a cancel in front
+    assert(book->add(OrderId{5}, Side::Sell, Price{100}, Qty{10}) == AddResult::Ok);
+    assert(book->cancel(OrderId{2}));
+    assert(book->queue_ahead(OrderId{4}) == Qty{80} && walk_ahead(*book, OrderId{4}) == Qty{70});
+    assert(book->queue_ahead(OrderId{5}) == Qty{90} && walk_ahead(*book, OrderId{5}) == Qty{90});
+
+    // amending up or away is a new entry at the back
+    assert(book->modify(OrderId{3}, Price{100}, Qty{40}) == ModifyResult::Ok);
+    assert(book->entry_seq(OrderId{3}) == 6 && book->entries() == 6);
+    assert(book->queue_ahead(OrderId{3}) == Qty{70} && walk_ahead(*book, OrderId{3}) == Qty{70});
+
+    // an iceberg's next slice queues at the back, or in place when alone
+    assert(book->add_iceberg(OrderId{6}, Side::Buy, Price{50}, Qty{30}, Qty{10}) == AddResult::Ok);
+    assert(book->add(OrderId{7}, Side::Buy, Price{50}, Qty{5}) == AddResult::Ok);
+    assert(book->match(Side::Sell, Qty{10}) == Qty{0});
+    assert(book->queue_ahead(OrderId{7}) == Qty{0} && book->queue_ahead(OrderId{6}) == Qty{5});
+    assert(book->match(Side::Sell, Qty{5}) == Qty{0});
+    assert(book->match(Side::Sell, Qty{10}) == Qty{0});
+    assert(book->add(OrderId{8}, Side::Buy, Price{50}, Qty{5}) == AddResult::Ok);
+    assert(book->queue_ahead(OrderId{8}) == Qty{10} && walk_ahead(*book, OrderId{8}) == Qty{10});
+
+    // far from the window too, and nothing for what isn't resting
+    assert(book->add(OrderId{9}, Side::Sell, Price{9000}, Qty{10}) == AddResult::Ok);
+    assert(book->add(OrderId{10}, Side::Sell, Price{9000}, Qty{10}) == AddResult::Ok);
+    assert(book->queue_ahead(OrderId{10}) == Qty{10});
+    assert(book->add(OrderId{11}, Side::Buy, Price{9500}, Qty{10}, OrdType::Stop) == AddResult::Ok);
+    assert(book->queue_ahead(OrderId{11}) == Qty{-1} && book->entry_seq(OrderId{11}) == 0);
+    assert(book->queue_ahead(OrderId{2}) == Qty{-1} && book->queue_ahead(OrderId{99}) == Qty{-1});
+
+    // random flows: exact while nothing is cancelled or amended, else a bound
+    for (bool withdraw : {false, true}) {
+        auto b = std::make_unique<Book>();
+        std::mt19937_64 rng(withdraw ? 11 : 7);
+        std::vector<OrderId> live;
+        for (uint64_t id = 1; id <= 20000; ++id) {
+            uint64_t r = rng() % 16;
+            Side side = (rng() & 1) != 0 ? Side::Buy : Side::Sell;
+            if (r == 0) {
+                (void)b->match(side, Qty{static_cast<int64_t>(1 + rng() % 40)});
+            } else if (withdraw && r < 4 && !live.empty()) {
+                OrderId v = live[rng() % live.size()];
+                if (r == 1) (void)b->cancel(v);
+                else if (r == 2) (void)b->cancel_lazy(v);
+                else (void)b->modify(v, Price{static_cast<int64_t>(1 + rng() % 100) * 60}, Qty{1});
+            } else {
+                // buys below 5000 and sells above, so nothing crosses but the match
+                int64_t px = side == Side::Buy ? 4990 - static_cast<int64_t>(rng() % 8) * 700
+                                               : 5010 + static_cast<int64_t>(rng() % 8) * 700;
+                auto qty = Qty{static_cast<int64_t>(1 + rng() % 20)};
+                AddResult a = rng() % 8 == 0 ? b->add_iceberg(OrderId{id}, side, Price{px}, Qty{qty.raw() * 3}, qty)
+                                             : b->add(OrderId{id}, side, Price{px}, qty);
+                if (a == AddResult::Ok) live.push_back(OrderId{id});
+            }
+            if (id % 64 != 0) continue;
+            std::erase_if(live, [&](OrderId v) { return b->get_order(v) == nullptr; });
+            for (OrderId v : live) {
+                Qty est = b->queue_ahead(v);
+                Qty exact = walk_ahead(*b, v);
+                const auto* o = b->get_order(v);
+                assert(withdraw ? est >= exact : est == exact);
+                assert(est <= b->level_at(o->price).qty() - o->remaining());
+            }
+        }
+    }
+
+    printf("[PASS] queue_position (%s)\n", name);
+}
+
 int main() {
     printf("=== Order Book Correctness Tests ===\n\n");
 
@@ -416,6 +2460,74 @@ int main() {
     test_pool_reuse();
     test_aggressive_bid_price_improvement();
     test_aggressive_ask_price_improvement();
+    test_level_bitmap_boundaries();
+    test_sparse_best_recovery();
+    test_fill_reports();
+    test_fill_buffer_overflow();
+    test_fill_callback_listener();
+    test_order_index<DirectIndex>("DirectIndex");
+    test_order_index<RobinHoodIndex>("RobinHoodIndex");
+    test_order_index<SwissIndex>("SwissIndex");
+    test_random_ids_through_book();
+    test_mapped_storage();
+    test_ladder_matches_dense<WindowBook>("WindowLadder");
+    test_ladder_matches_dense<CompactBook>("CompactLadder");
+    test_ladder_matches_dense<SlotBook>("SlotLadder");
+    test_compact_orders();
+    test_batch_apply();
+    test_spsc_ring();
+    test_book_manager();
+    test_gateway();
+    test_queue_position<QueuedBook>("DenseLadder");
+    test_queue_position<QueuedWindowBook>("WindowLadder");
+    test_bbo_publisher();
+    test_replay_roundtrip();
+    test_modify();
+    test_snapshot_restore<TestBook>("DenseLadder");
+    test_snapshot_restore<SlotBook>("SlotLadder");
+    test_snapshot_restore<WindowBook>("WindowLadder");
+    test_snapshot_file();
+    test_journal();
+    test_journal_auction();
+    test_latency_histogram();
+    test_phase_marks();
+    test_scenarios();
+    test_iceberg<TestBook>("DenseLadder");
+    test_iceberg<SlotBook>("SlotLadder");
+    test_iceberg<WindowBook>("WindowLadder");
+    test_fok();
+    test_stop_orders();
+    test_self_trade_prevention<DenseLadder>("DenseLadder");
+    test_self_trade_prevention<CompactLadder>("CompactLadder");
+    test_self_trade_prevention<NarrowWindow>("WindowLadder");
+    test_stp_untagged_layout();
+    test_stp_snapshot();
+    test_call_auction<DenseLadder>("DenseLadder");
+    test_call_auction<CompactLadder>("CompactLadder");
+    test_call_auction<SlotLadder>("SlotLadder");
+    test_call_auction<NarrowWindow>("WindowLadder");
+    test_lazy_cancel<TestBook>("DenseLadder");
+    test_lazy_cancel<CompactBook>("CompactLadder");
+    test_lazy_cancel<SlotBook>("SlotLadder");
+    test_lazy_cancel<WindowBook>("WindowLadder");
+    test_depth_feed();
+    test_depth_snapshot<TestBook>("DenseLadder");
+    test_depth_snapshot<CompactBook>("CompactLadder");
+    test_depth_snapshot<SlotBook>("SlotLadder");
+    test_depth_snapshot<WindowBook>("WindowLadder");
+    test_depth_feed_rebuilds<DenseLadder>("DenseLadder");
+    test_depth_feed_rebuilds<SlotLadder>("SlotLadder");
+    test_depth_feed_rebuilds<NarrowWindow>("WindowLadder");
+    test_window_ladder_recenters();
+    test_book_traits();
+    test_ladder_matches_dense<BookOf<Sized<10000, 1000, SparseTraits>>>("SparseTraits");
+    test_arena_storage();
+    test_shared_pool();
+    {
+        Arena arena(size_t{64} << 20);
+        ArenaScope scope(arena);
+        test_ladder_matches_dense<BookOf<Sized<10000, 1000, ArenaTraits>>>("ArenaTraits");
+    }
 
     printf("\n=== All tests passed ===\n");
     return 0;
@@ -0,0 +1,281 @@
+#include "order_book.hpp"
+#include "book_traits.hpp"
+#include "workload.hpp"
+#include "scenarios.hpp"
+#include "naive_book.hpp"
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+using namespace ob;
+
+// differential test against the NaiveBook reference model
+// every op goes through an OrderBook and the reference, and after each one
+// the two must agree on the op's result, the fills it printed, the touch and
+// the TOP_LEVELS best levels a side; the whole depth is compared every
+// DEEP_EVERY ops and at the end. the first disagreement aborts with the flow
+// and op index, so a failing seed replays exactly
+//
+//   differential [--ops N] [--seed S]
+//
+// built with OB_LIBFUZZER the same checks run as a libFuzzer target, each
+// input decoded into ops on a small book
+
+static constexpr size_t TOP_LEVELS = 8;
+static constexpr size_t DEEP_EVERY = 4096;
+static constexpr size_t BATCH = 64;
+
+struct FillLog {
+    std::vector<Fill> fills;
+
+    void on_fill(const Fill& f) noexcept { fills.push_back(f); }
+};
+
+// how ops reach the book: one call each, cancels as tombstones, or apply()
+enum class Drive : uint8_t {
+    Direct,
+    Lazy,
+    Batch
+};
+
+[[nodiscard]] constexpr const char* drive_name(Drive d) noexcept {
+    switch (d) {
+        case Drive::Direct: return "direct";
+        case Drive::Lazy: return "lazy";
+        case Drive::Batch: return "batch";
+    }
+    return "?";
+}
+
+template<typename Book>
+class Differential {
+    std::unique_ptr<Book> book_ = std::make_unique<Book>();
+    NaiveBook ref_{true};
+    Drive drive_;
+    std::string flow_;
+    size_t at_ = 0;
+    std::vector<LevelView> got_ = std::vector<LevelView>(Book::max_orders());
+    std::vector<LevelView> want_ = std::vector<LevelView>(Book::max_orders());
+    std::array<OpResult, BATCH> results_{};
+
+    void check(bool ok, const char* what) const {
+        if (ok) [[likely]] return;
+        std::fprintf(stderr, "differential: %s differs, %s (%s) at op %zu\n", what, flow_.c_str(),
+                     drive_name(drive_), at_);
+        std::abort();
+    }
+
+    // reference side of one op; bool results are "accepted" for adds and modifies
+    void reference(const Op& op, OpResult& r, OrderId aggressor) {
+        switch (op.type) {
+            case OpType::Add: {
+                bool ok = op.ord_type == OrdType::Iceberg ? ref_.add_iceberg(op.id, op.side, op.price, op.qty, op.peak)
+                                                          : ref_.add(op.id, op.side, op.price, op.qty, op.ord_type);
+                r.add = ok ? AddResult::Ok : AddResult::Killed;
+                break;
+            }
+            case OpType::Cancel: r.cancelled = ref_.cancel(op.id); break;
+            case OpType::Match: r.left = ref_.match(op.side, op.qty, aggressor); break;
+            case OpType::Modify:
+                r.modify = ref_.modify(op.id, op.price, op.qty) ? ModifyResult::Ok : ModifyResult::NotFound;
+                break;
+        }
+    }
+
+    void same_result(const Op& op, const OpResult& got, const OpResult& want) const {
+        switch (op.type) {
+            case OpType::Add:
+                check(got.add != AddResult::PoolExhausted && got.add != AddResult::LadderFull, "capacity");
+                check((got.add == AddResult::Ok) == (want.add == AddResult::Ok), "add result");
+                break;
+            case OpType::Cancel: check(got.cancelled == want.cancelled, "cancel result"); break;
+            case OpType::Match: check(got.left == want.left, "match result"); break;
+            case OpType::Modify:
+                check((got.modify == ModifyResult::Ok) == (want.modify == ModifyResult::Ok), "modify result");
+                break;
+        }
+    }
+
+    void same_fills() {
+        std::vector<Fill>& got = book_->listener().fills;
+        std::span<const Fill> want = ref_.fills();
+        check(got.size() == want.size(), "fill count");
+        for (size_t i = 0; i < got.size(); ++i) {
+            check(got[i].passive_id == want[i].passive_id && got[i].aggressor_id == want[i].aggressor_id, "fill ids");
+            check(got[i].qty == want[i].qty && got[i].price == want[i].price, "fill qty or price");
+        }
+        got.clear();
+        ref_.clear_fills();
+    }
+
+    // n best levels a side; lazy books count tombstones, so only their qty is held
+    void same_levels(size_t n) {
+        check(book_->has_bid() == ref_.has_bid() && (!ref_.has_bid() || book_->bid() == ref_.bid()), "bid");
+        check(book_->has_ask() == ref_.has_ask() && (!ref_.has_ask() || book_->ask() == ref_.ask()), "ask");
+        for (Side side : {Side::Buy, Side::Sell}) {
+            size_t k = book_->depth(side, n, got_);
+            check(k == ref_.depth(side, n, want_), "level count");
+            for (size_t i = 0; i < k; ++i) {
+                check(got_[i].price == want_[i].price && got_[i].qty == want_[i].qty, "level qty");
+                check(drive_ == Drive::Lazy || got_[i].count == want_[i].count, "level orders");
+            }
+        }
+        check(book_->order_count() == ref_.order_count() && book_->stop_count() == ref_.stop_count(), "order count");
+    }
+
+    void settle(size_t ops) {
+        same_fills();
+        size_t before = at_;
+        at_ += ops;
+        bool deep = at_ / DEEP_EVERY != before / DEEP_EVERY;
+        if (deep && drive_ == Drive::Lazy) (void)book_->compact();
+        same_levels(deep ? Book::max_orders() : TOP_LEVELS);
+    }
+
+public:
+    Differential(Drive drive, std::string flow) : drive_(drive), flow_(std::move(flow)) {}
+
+    void step(const Op& op) {
+        OpResult got, want;
+        switch (op.type) {
+            case OpType::Add: got.add = submit_add(*book_, op); break;
+            case OpType::Cancel:
+                got.cancelled = drive_ == Drive::Lazy ? book_->cancel_lazy(op.id) : book_->cancel(op.id);
+                break;
+            case OpType::Match: got.left = book_->match(op.side, op.qty, op.id); break;
+            case OpType::Modify: got.modify = book_->modify(op.id, op.price, op.qty); break;
+        }
+        reference(op, want, op.id);
+        same_result(op, got, want);
+        settle(1);
+    }
+
+    // apply() reports no aggressor id for matches
+    void batch(std::span<const Op> ops) {
+        book_->apply(ops, results_);
+        for (size_t i = 0; i < ops.size(); ++i) {
+            OpResult want;
+            reference(ops[i], want, OrderId{0});
+            same_result(ops[i], results_[i], want);
+        }
+        settle(ops.size());
+    }
+
+    void run(std::span<const Op> ops) {
+        if (drive_ == Drive::Batch) {
+            for (size_t i = 0; i < ops.size(); i += BATCH) batch(ops.subspan(i, std::min(BATCH, ops.size() - i)));
+        } else {
+            for (const Op& op : ops) step(op);
+        }
+        same_levels(Book::max_orders());
+    }
+};
+
+template<typename Book>
+void differential(const char* name, Drive drive, std::span<const Op> ops) {
+    auto d = std::make_unique<Differential<Book>>(drive, name);
+    d->run(ops);
+    std::printf("[PASS] differential %s (%s), %zu ops\n", name, drive_name(drive), ops.size());
+}
+
+#ifdef OB_LIBFUZZER
+
+using FuzzBook = OrderBook<1024, 4096, FillLog>;
+
+// 8 bytes per op: type and flags, side, price offset, qty, id
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    std::vector<Op> ops;
+    ops.reserve(size / 8);
+    for (size_t i = 0; i + 8 <= size; i += 8) {
+        const uint8_t* b = data + i;
+        Op op{};
+        op.type = static_cast<OpType>(b[0] & 3);
+        op.ord_type = static_cast<OrdType>((b[0] >> 2) % 6);
+        op.side = (b[1] & 1) != 0 ? Side::Sell : Side::Buy;
+        op.price = Price{512 + static_cast<int8_t>(b[2])};
+        op.qty = Qty{1 + b[3]};
+        op.peak = op.ord_type == OrdType::Iceberg ? Qty{1 + (b[4] & 15)} : Qty{0};
+        uint32_t id = 0;
+        std::memcpy(&id, b + 4, sizeof(id));
+        op.id = OrderId{1 + (id >> 4) % 512};
+        ops.push_back(op);
+    }
+    Differential<FuzzBook>(ops.size() % 2 != 0 ? Drive::Lazy : Drive::Direct, "fuzz").run(ops);
+    return 0;
+}
+
+#else
+
+template<typename Traits>
+using Test = BookOf<Listened<FillLog, Sized<100000, 1 << 20, Traits>>>;
+
+template<int64_t MaxPrice, typename Storage>
+using NarrowWindow = WindowLadder<MaxPrice, Storage, 256, 4096>;
+struct WindowTraits : BookTraits {
+    template<int64_t MaxPrice, typename Storage>
+    using ladder = NarrowWindow<MaxPrice, Storage>;
+};
+struct CompactTraits : BookTraits {
+    template<int64_t MaxPrice, typename Storage>
+    using ladder = CompactLadder<MaxPrice, Storage>;
+};
+struct RobinHoodTraits : BookTraits {
+    template<size_t Capacity, typename Storage, typename O>
+    using index = RobinHoodIndex<Capacity, Storage, O>;
+};
+
+// differential [--ops N] [--seed S]
+int main(int argc, char** argv) {
+    size_t ops = 200'000;
+    uint64_t seed = 42;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--ops") == 0) ops = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (std::strcmp(argv[i], "--seed") == 0) seed = std::strtoull(argv[i + 1], nullptr, 10);
+        else std::fprintf(stderr, "unknown option %s\n", argv[i]);
+    }
+    printf("=== Differential test against NaiveBook, seed %lu ===\n\n", seed);
+
+    // the default mix with amends, sequential and hashed ids
+    WorkloadGen gen(seed, 1000.0, 50000, 50.0, 0.30, 0.25, 0.05, 1.5, 100000);
+    gen.set_modify_rate(0.10);
+    std::vector<Op> flow = gen.generate(ops);
+    WorkloadGen rgen(seed + 1, 1000.0, 50000, 50.0, 0.30, 0.25, 0.05, 1.5, 100000);
+    rgen.set_id_mode(IdMode::Random);
+    rgen.set_modify_rate(0.10);
+    std::vector<Op> random_flow = rgen.generate(ops);
+
+    differential<Test<DenseTraits>>("workload DenseLadder", Drive::Direct, flow);
+    differential<Test<DenseTraits>>("workload DenseLadder", Drive::Lazy, flow);
+    differential<Test<DenseTraits>>("workload DenseLadder", Drive::Batch, flow);
+    differential<Test<CompactTraits>>("workload CompactLadder", Drive::Direct, flow);
+    differential<Test<SlotTraits>>("workload SlotLadder", Drive::Direct, flow);
+    differential<Test<WindowTraits>>("workload WindowLadder", Drive::Lazy, flow);
+    differential<Test<SparseTraits>>("random ids SwissIndex", Drive::Direct, random_flow);
+    differential<Test<RobinHoodTraits>>("random ids RobinHoodIndex", Drive::Batch, random_flow);
+
+    // the stress shapes; the reference has no pool to exhaust, and the narrow
+    // window would run out of overflow levels on deep_passive
+    ScenarioConfig cfg;
+    cfg.ops = std::max<size_t>(ops / 10, 1000);
+    cfg.seed = seed;
+    cfg.max_price = 100000;
+    cfg.capacity = 1 << 20;
+    for (Scenario sc : ALL_SCENARIOS) {
+        if (sc == Scenario::PoolExhaustion) continue;
+        std::vector<Op> s = make_scenario(sc, cfg);
+        std::string name = std::string("scenario ") + scenario_name(sc);
+        differential<Test<DenseTraits>>(name.c_str(), Drive::Direct, s);
+        differential<Test<CompactTraits>>(name.c_str(), Drive::Batch, s);
+    }
+
+    printf("\n=== No differences ===\n");
+    return 0;
+}
+
+#endif